@@ -280,14 +280,7 @@ book_mark_flush (WEdit * edit, int c)
 void
 book_mark_inc (WEdit * edit, long line)
 {
-    if (edit->book_mark != NULL)
-    {
-        edit_book_mark_t *p;
-
-        p = book_mark_find (edit, line);
-        for (p = p->next; p != NULL; p = p->next)
-            p->line++;
-    }
+    book_mark_shift (edit, line, 1);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -295,6 +288,15 @@ book_mark_inc (WEdit * edit, long line)
 
 void
 book_mark_dec (WEdit * edit, long line)
+{
+    book_mark_shift (edit, line, -1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** shift bookmarks after this line by count lines, those shifted up stop at this line */
+
+void
+book_mark_shift (WEdit * edit, long line, long count)
 {
     if (edit->book_mark != NULL)
     {
@@ -302,7 +304,7 @@ book_mark_dec (WEdit * edit, long line)
 
         p = book_mark_find (edit, line);
         for (p = p->next; p != NULL; p = p->next)
-            p->line--;
+            p->line = MAX (p->line + count, line);
     }
 }
 
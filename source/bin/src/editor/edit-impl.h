@@ -18,6 +18,7 @@
 #include "lib/vfs/vfs.h"        /* vfs_path_t */
 
 #include "edit.h"
+#include "editundo.h"
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
@@ -39,26 +40,6 @@
 #define EDIT_TOP_EXTREME 0
 #define EDIT_BOTTOM_EXTREME 0
 
-/* Initial size of the undo stack, in bytes */
-#define START_STACK_SIZE 32
-
-/* Some codes that may be pushed onto or returned from the undo stack */
-#define CURS_LEFT       601
-#define CURS_RIGHT      602
-#define DELCHAR         603
-#define BACKSPACE       604
-#define STACK_BOTTOM    605
-#define CURS_LEFT_LOTS  606
-#define CURS_RIGHT_LOTS 607
-#define COLUMN_ON       608
-#define COLUMN_OFF      609
-#define DELCHAR_BR      610
-#define BACKSPACE_BR    611
-#define MARK_1          1000
-#define MARK_2          500000000
-#define MARK_CURS       1000000000
-#define KEY_PRESS       1500000000
-
 /* Tabs spaces: (sofar only HALF_TAB_SIZE is used: */
 #define TAB_SIZE      option_tab_spacing
 #define HALF_TAB_SIZE ((int) option_tab_spacing / 2)
@@ -126,7 +107,6 @@ extern edit_stack_type edit_history_moveto[MAX_HISTORY_MOVETO];
 
 extern int option_line_state_width;
 
-extern int option_max_undo;
 extern gboolean option_auto_syntax;
 
 extern gboolean search_create_bookmark;
@@ -145,6 +125,8 @@ void edit_menu_cmd (WDialog * h);
 void user_menu (WEdit * edit, const char *menu_file, int selected_entry);
 void edit_init_menu (WMenuBar * menubar);
 void edit_save_mode_cmd (void);
+gboolean edit_save_finish (WEdit * edit, gboolean wait);
+int edit_save_get_progress (const WEdit * edit);
 off_t edit_move_forward3 (const WEdit * edit, off_t current, long cols, off_t upto);
 void edit_scroll_screen_over_cursor (WEdit * edit);
 void edit_render_keypress (WEdit * edit);
@@ -160,6 +142,8 @@ void edit_update_curs_row (WEdit * edit);
 void edit_update_curs_col (WEdit * edit);
 void edit_find_bracket (WEdit * edit);
 gboolean edit_reload_line (WEdit * edit, const vfs_path_t * filename_vpath, long line);
+gboolean edit_count_file_lines (WEdit * edit, gboolean all);
+void edit_check_mapped_file (WEdit * edit);
 void edit_set_codeset (WEdit * edit);
 
 void edit_block_copy_cmd (WEdit * edit);
@@ -172,10 +156,13 @@ int edit_backspace (WEdit * edit, gboolean byte_delete);
 void edit_insert (WEdit * edit, int c);
 void edit_insert_over (WEdit * edit);
 void edit_cursor_move (WEdit * edit, off_t increment);
-void edit_push_undo_action (WEdit * edit, long c);
-void edit_push_redo_action (WEdit * edit, long c);
+void edit_push_undo_action (WEdit * edit, edit_undo_action_t action, off_t value);
+void edit_push_undo_text (WEdit * edit, edit_undo_action_t action, const char *text, off_t len);
 void edit_push_key_press (WEdit * edit);
 void edit_insert_ahead (WEdit * edit, int c);
+void edit_insert_block (WEdit * edit, const char *data, off_t len);
+void edit_insert_block_ahead (WEdit * edit, const char *data, off_t len);
+void edit_delete_block (WEdit * edit, off_t len);
 off_t edit_write_stream (WEdit * edit, FILE * f);
 char *edit_get_write_filter (const vfs_path_t * write_name_vpath,
                              const vfs_path_t * filename_vpath);
@@ -238,6 +225,9 @@ void edit_set_filename (WEdit * edit, const vfs_path_t * name_vpath);
 void edit_load_syntax (WEdit * edit, GPtrArray * pnames, const char *type);
 void edit_free_syntax_rules (WEdit * edit);
 int edit_get_syntax_color (WEdit * edit, off_t byte_index);
+void edit_syntax_invalidate (WEdit * edit, off_t offset);
+gboolean edit_syntax_prescan_pending (const WEdit * edit);
+gboolean edit_syntax_prescan (WEdit * edit);
 void edit_syntax_dialog (WEdit * edit);
 
 void book_mark_insert (WEdit * edit, long line, int c);
@@ -247,6 +237,7 @@ gboolean book_mark_clear (WEdit * edit, long line, int c);
 void book_mark_flush (WEdit * edit, int c);
 void book_mark_inc (WEdit * edit, long line);
 void book_mark_dec (WEdit * edit, long line);
+void book_mark_shift (WEdit * edit, long line, long count);
 void book_mark_serialize (WEdit * edit, int color);
 void book_mark_restore (WEdit * edit, int color);
 
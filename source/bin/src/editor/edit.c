@@ -39,6 +39,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>              /* open() */
 #include <sys/stat.h>
 #include <stdint.h>             /* UINTMAX_MAX */
 #include <stdlib.h>
@@ -87,7 +88,8 @@ gboolean option_backspace_through_tabs = FALSE;
 gboolean option_fake_half_tabs = TRUE;
 int option_save_mode = EDIT_QUICK_SAVE;
 gboolean option_save_position = TRUE;
-int option_max_undo = 32768;
+int option_max_undo = 32768;    /* memory for the undo of each file, in KiB */
+gboolean option_undo_spill = FALSE;
 gboolean option_persistent_selections = TRUE;
 gboolean option_cursor_beyond_eol = FALSE;
 gboolean option_line_state = FALSE;
@@ -102,6 +104,8 @@ gboolean show_right_margin = FALSE;
 
 char *option_backup_ext = NULL;
 char *option_filesize_threshold = NULL;
+char *option_filesize_lazy = NULL;
+char *option_filesize_pieces = NULL;
 
 unsigned int edit_stack_iterator = 0;
 edit_stack_type edit_history_moveto[MAX_HISTORY_MOVETO];
@@ -140,6 +144,11 @@ static const struct edit_filters
 };
 
 static const off_t option_filesize_default_threshold = 64 * 1024 * 1024;        /* 64 MB */
+static const off_t option_filesize_default_lazy = 16 * 1024 * 1024;     /* 16 MB */
+static const off_t option_filesize_default_pieces = 64 * 1024 * 1024;   /* 64 MB */
+
+/* a file that has changed under its mapping is read again rather than mapped */
+static gboolean edit_load_eager = FALSE;
 
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
@@ -172,6 +181,73 @@ edit_load_status_update_cb (status_msg_t * sm)
     return status_msg_common_update (sm);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Initialize the buffer for a file of the given size. The text of a big file is kept in a piece
+ * table, where a change anywhere does not move the text that follows it.
+ */
+
+static void
+edit_init_buffer (edit_buffer_t * buf, off_t file_size, off_t size)
+{
+    static uintmax_t threshold = UINTMAX_MAX;
+
+    if (threshold == UINTMAX_MAX)
+    {
+        gboolean err = FALSE;
+
+        if (option_filesize_pieces != NULL)
+            threshold = parse_integer (option_filesize_pieces, &err);
+        if (option_filesize_pieces == NULL || err)
+            threshold = option_filesize_default_pieces;
+    }
+
+    edit_buffer_init (buf, size);
+
+    if ((uintmax_t) file_size >= threshold)
+        edit_buffer_use_pieces (buf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Map a big local file into memory instead of reading it. The lines are counted later.
+ *
+ * @return FALSE if the file is not big enough or cannot be mapped
+ */
+
+static gboolean
+edit_load_file_lazy (edit_buffer_t * buf, const vfs_path_t * filename_vpath)
+{
+    static uintmax_t threshold = UINTMAX_MAX;
+    struct stat st;
+    int fd;
+    gboolean ret = FALSE;
+
+    if (threshold == UINTMAX_MAX)
+    {
+        gboolean err = FALSE;
+
+        if (option_filesize_lazy != NULL)
+            threshold = parse_integer (option_filesize_lazy, &err);
+        if (option_filesize_lazy == NULL || err)
+            threshold = option_filesize_default_lazy;
+    }
+
+    if (edit_load_eager || (uintmax_t) buf->size < threshold)
+        return FALSE;
+
+    fd = open (vfs_path_as_str (filename_vpath), O_RDONLY | O_BINARY);
+    if (fd == -1)
+        return FALSE;
+
+    /* the file has not changed since it was checked; the buffer keeps a duplicate descriptor */
+    if (fstat (fd, &st) == 0 && st.st_size == buf->size)
+        ret = edit_buffer_map_file (buf, fd, buf->size);
+
+    (void) close (fd);
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Load file OR text into buffers.  Set cursor to the beginning of file.
@@ -187,6 +263,9 @@ edit_load_file_fast (edit_buffer_t * buf, const vfs_path_t * filename_vpath)
     edit_buffer_read_file_status_msg_t rsm;
     gboolean aborted;
 
+    if (edit_load_file_lazy (buf, filename_vpath))
+        return TRUE;
+
     file = mc_open (filename_vpath, O_RDONLY | O_BINARY);
     if (file < 0)
     {
@@ -270,13 +349,14 @@ edit_get_filter (const vfs_path_t * filename_vpath)
 static off_t
 edit_insert_stream (WEdit * edit, FILE * f)
 {
-    int c;
+    char buf[TEMP_BUF_LEN];
+    size_t n;
     off_t i = 0;
 
-    while ((c = fgetc (f)) >= 0)
+    while ((n = fread (buf, 1, sizeof (buf), f)) > 0)
     {
-        edit_insert (edit, c);
-        i++;
+        edit_insert_block (edit, buf, (off_t) n);
+        i += (off_t) n;
     }
     return i;
 }
@@ -430,7 +510,7 @@ edit_load_file (WEdit * edit)
 
     if (fast_load)
     {
-        edit_buffer_init (&edit->buffer, edit->stat1.st_size);
+        edit_init_buffer (&edit->buffer, edit->stat1.st_size, edit->stat1.st_size);
 
         if (!edit_load_file_fast (&edit->buffer, edit->filename_vpath))
         {
@@ -440,7 +520,8 @@ edit_load_file (WEdit * edit)
     }
     else
     {
-        edit_buffer_init (&edit->buffer, 0);
+        edit_init_buffer (&edit->buffer,
+                          edit->filename_vpath != NULL ? edit->stat1.st_size : 0, 0);
 
         if (edit->filename_vpath != NULL
             && *(vfs_path_get_by_index (edit->filename_vpath, 0)->path) != '\0')
@@ -452,6 +533,8 @@ edit_load_file (WEdit * edit)
                 return FALSE;
             }
             edit->undo_stack_disable = 0;
+            /* the reverse of the loading is not to be redone */
+            edit_undo_clear (&edit->redo);
         }
     }
     edit->lb = LB_ASIS;
@@ -484,6 +567,10 @@ edit_load_position (WEdit * edit, gboolean load_position)
     if (!load_position)
         return;
 
+    /* the position is looked for with the exact number of lines */
+    if (line > 0 || offset > 0)
+        edit_count_file_lines (edit, TRUE);
+
     if (line > 0)
     {
         edit_move_to_line (edit, line - 1);
@@ -528,93 +615,18 @@ edit_purge_widget (WEdit * edit)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/** Get the journal of the reverse of the changes: the redo journal while an undo is replayed */
 
-/*
-   TODO: if the user undos until the stack bottom, and the stack has not wrapped,
-   then the file should be as it was when he loaded up. Then set edit->modified to 0.
- */
-
-static long
-edit_pop_undo_action (WEdit * edit)
+static edit_undo_t *
+edit_get_undo_journal (WEdit * edit)
 {
-    long c;
-    unsigned long sp = edit->undo_stack_pointer;
-
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
-
-    sp = (sp - 1) & edit->undo_stack_size_mask;
-    c = edit->undo_stack[sp];
-    if (c >= 0)
-    {
-        /*      edit->undo_stack[sp] = '@'; */
-        edit->undo_stack_pointer = (edit->undo_stack_pointer - 1) & edit->undo_stack_size_mask;
-        return c;
-    }
-
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
-
-    c = edit->undo_stack[(sp - 1) & edit->undo_stack_size_mask];
-    if (edit->undo_stack[sp] == -2)
-    {
-        /*      edit->undo_stack[sp] = '@'; */
-        edit->undo_stack_pointer = sp;
-    }
-    else
-        edit->undo_stack[sp]++;
-
-    return c;
-}
-
-static long
-edit_pop_redo_action (WEdit * edit)
-{
-    long c;
-    unsigned long sp = edit->redo_stack_pointer;
-
-    if (sp == edit->redo_stack_bottom)
-        return STACK_BOTTOM;
-
-    sp = (sp - 1) & edit->redo_stack_size_mask;
-    c = edit->redo_stack[sp];
-    if (c >= 0)
-    {
-        edit->redo_stack_pointer = (edit->redo_stack_pointer - 1) & edit->redo_stack_size_mask;
-        return c;
-    }
-
-    if (sp == edit->redo_stack_bottom)
-        return STACK_BOTTOM;
-
-    c = edit->redo_stack[(sp - 1) & edit->redo_stack_size_mask];
-    if (edit->redo_stack[sp] == -2)
-        edit->redo_stack_pointer = sp;
-    else
-        edit->redo_stack[sp]++;
-
-    return c;
-}
-
-static long
-get_prev_undo_action (WEdit * edit)
-{
-    long c;
-    unsigned long sp = edit->undo_stack_pointer;
-
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
-
-    sp = (sp - 1) & edit->undo_stack_size_mask;
-    c = edit->undo_stack[sp];
-    if (c >= 0)
-        return c;
+    if (edit->undo_stack_disable)
+        return &edit->redo;
 
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
+    if (edit->redo_stack_reset)
+        edit_undo_clear (&edit->redo);
 
-    c = edit->undo_stack[(sp - 1) & edit->undo_stack_size_mask];
-    return c;
+    return &edit->undo;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -680,6 +692,83 @@ is_blank (const edit_buffer_t * buf, off_t offset)
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the number of lines below a line, up to @max. They are looked for in the text while the
+ * lines of a lazily loaded file are not counted.
+ *
+ * @param edit editor object
+ * @param bol the beginning of the line
+ * @param line number of the line
+ * @param max the most lines that are needed
+ */
+
+static long
+edit_lines_below (const WEdit * edit, off_t bol, long line, long max)
+{
+    off_t eol;
+
+    if (!edit_buffer_lines_pending (&edit->buffer))
+        return MIN (edit->buffer.lines - line, max);
+
+    eol = edit_buffer_get_forward_offset (&edit->buffer, bol, max, 0);
+    return edit_buffer_count_lines (&edit->buffer, bol, eol);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether a command can do without the number of lines of the file: the cursor moves and
+ * the typing know the lines they pass over or change.
+ */
+
+static gboolean
+edit_command_without_lines (long command)
+{
+    switch (command)
+    {
+    case CK_InsertChar:
+    case CK_Enter:
+    case CK_Return:
+    case CK_Tab:
+    case CK_BackSpace:
+    case CK_Delete:
+    case CK_DeleteToWordBegin:
+    case CK_DeleteToWordEnd:
+    case CK_DeleteToHome:
+    case CK_DeleteToEnd:
+    case CK_Left:
+    case CK_Right:
+    case CK_Up:
+    case CK_Down:
+    case CK_WordLeft:
+    case CK_WordRight:
+    case CK_Home:
+    case CK_End:
+    case CK_PageUp:
+    case CK_PageDown:
+    case CK_ScrollUp:
+    case CK_ScrollDown:
+    case CK_Top:
+    case CK_TopOnScreen:
+    case CK_BottomOnScreen:
+    case CK_MarkLeft:
+    case CK_MarkRight:
+    case CK_MarkUp:
+    case CK_MarkDown:
+    case CK_MarkToWordBegin:
+    case CK_MarkToWordEnd:
+    case CK_MarkToHome:
+    case CK_MarkToEnd:
+    case CK_MarkPageUp:
+    case CK_MarkPageDown:
+    case CK_MarkScrollUp:
+    case CK_MarkScrollDown:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** returns the offset of line i */
 
@@ -689,6 +778,9 @@ edit_find_line (WEdit * edit, long line)
     long i, j = 0;
     long m = 2000000000;        /* what is the magic number? */
 
+    /* the cache knows the last line */
+    edit_count_file_lines (edit, TRUE);
+
     if (!edit->caches_valid)
     {
         memset (edit->line_numbers, 0, sizeof (edit->line_numbers));
@@ -1060,7 +1152,9 @@ static void
 edit_move_updown (WEdit * edit, long lines, gboolean do_scroll, gboolean direction)
 {
     long p;
-    long l = direction ? edit->buffer.curs_line : edit->buffer.lines - edit->buffer.curs_line;
+    long l = direction ? edit->buffer.curs_line :
+        edit_lines_below (edit, edit_buffer_get_current_bol (&edit->buffer),
+                          edit->buffer.curs_line, lines);
 
     if (lines > l)
         lines = l;
@@ -1139,173 +1233,122 @@ edit_left_delete_word (WEdit * edit)
 
 /* --------------------------------------------------------------------------------------------- */
 /**
-   the start column position is not recorded, and hence does not
-   undo as it happed. But who would notice.
+ * Replay the actions of one key press from a journal.
+ *
+ * @param edit editor object
+ * @param journal undo or redo journal
  */
 
 static void
-edit_do_undo (WEdit * edit)
+edit_replay_journal (WEdit * edit, edit_undo_t * journal)
 {
-    long ac;
+    edit_undo_record_t r;
     long count = 0;
 
-    edit->undo_stack_disable = 1;       /* don't record undo's onto undo stack! */
     edit->over_col = 0;
-    while ((ac = edit_pop_undo_action (edit)) < KEY_PRESS)
+
+    while (TRUE)
     {
-        switch ((int) ac)
+        char *text;
+
+        text = edit_undo_pop (journal, &r);
+        if (r.action == EDIT_UNDO_NONE)
+            return;
+        if (r.action == EDIT_UNDO_KEY_PRESS)
+            break;
+
+        switch (r.action)
         {
-        case STACK_BOTTOM:
-            goto done_undo;
-        case CURS_RIGHT:
-            edit_cursor_move (edit, 1);
+        case EDIT_UNDO_CURSOR:
+            edit_cursor_move (edit, r.value);
             break;
-        case CURS_LEFT:
-            edit_cursor_move (edit, -1);
+        case EDIT_UNDO_INSERT:
+            edit_insert_block (edit, text, r.value);
             break;
-        case BACKSPACE:
-        case BACKSPACE_BR:
-            edit_backspace (edit, TRUE);
+        case EDIT_UNDO_INSERT_AHEAD:
+            edit_insert_block_ahead (edit, text, r.value);
             break;
-        case DELCHAR:
-        case DELCHAR_BR:
-            edit_delete (edit, TRUE);
+        case EDIT_UNDO_BACKSPACE:
+        case EDIT_UNDO_BACKSPACE_BR:
+            edit_cursor_move (edit, -r.value);
+            edit_delete_block (edit, r.value);
             break;
-        case COLUMN_ON:
-            edit->column_highlight = 1;
+        case EDIT_UNDO_DELETE:
+        case EDIT_UNDO_DELETE_BR:
+            edit_delete_block (edit, r.value);
             break;
-        case COLUMN_OFF:
-            edit->column_highlight = 0;
+        case EDIT_UNDO_MARKERS:
+            {
+                off_t m[3];
+
+                memcpy (m, text, sizeof (m));
+                edit->mark1 = m[0];
+                edit->mark2 = m[1];
+                edit->end_mark_curs = m[2];
+                edit->column1 =
+                    (long) edit_move_forward3 (edit,
+                                               edit_buffer_get_bol (&edit->buffer, edit->mark1),
+                                               0, edit->mark1);
+                edit->column2 =
+                    (long) edit_move_forward3 (edit,
+                                               edit_buffer_get_bol (&edit->buffer, edit->mark2),
+                                               0, edit->mark2);
+            }
+            break;
+        case EDIT_UNDO_COLUMN:
+            edit->column_highlight = r.value != 0 ? 1 : 0;
             break;
         default:
             break;
         }
-        if (ac >= 256 && ac < 512)
-            edit_insert_ahead (edit, ac - 256);
-        if (ac >= 0 && ac < 256)
-            edit_insert (edit, ac);
 
-        if (ac >= MARK_1 - 2 && ac < MARK_2 - 2)
-        {
-            edit->mark1 = ac - MARK_1;
-            edit->column1 =
-                (long) edit_move_forward3 (edit, edit_buffer_get_bol (&edit->buffer, edit->mark1),
-                                           0, edit->mark1);
-        }
-        if (ac >= MARK_2 - 2 && ac < MARK_CURS - 2)
-        {
-            edit->mark2 = ac - MARK_2;
-            edit->column2 =
-                (long) edit_move_forward3 (edit, edit_buffer_get_bol (&edit->buffer, edit->mark2),
-                                           0, edit->mark2);
-        }
-        else if (ac >= MARK_CURS - 2 && ac < KEY_PRESS)
-        {
-            edit->end_mark_curs = ac - MARK_CURS;
-        }
-        if (count++)
-            edit->force |= REDRAW_PAGE; /* more than one pop usually means something big */
+        g_free (text);
+
+        /* more than one pop usually means something big */
+        if (count++ != 0)
+            edit->force |= REDRAW_PAGE;
     }
 
-    if (edit->start_display > ac - KEY_PRESS)
+    if (edit->start_display > r.value)
     {
-        edit->start_line -=
-            edit_buffer_count_lines (&edit->buffer, ac - KEY_PRESS, edit->start_display);
+        edit->start_line -= edit_buffer_count_lines (&edit->buffer, r.value, edit->start_display);
         edit->force |= REDRAW_PAGE;
     }
-    else if (edit->start_display < ac - KEY_PRESS)
+    else if (edit->start_display < r.value)
     {
-        edit->start_line +=
-            edit_buffer_count_lines (&edit->buffer, edit->start_display, ac - KEY_PRESS);
+        edit->start_line += edit_buffer_count_lines (&edit->buffer, edit->start_display, r.value);
         edit->force |= REDRAW_PAGE;
     }
-    edit->start_display = ac - KEY_PRESS;       /* see push and pop above */
+    edit->start_display = r.value;      /* see edit_push_key_press() */
     edit_update_curs_row (edit);
-
-  done_undo:
-    edit->undo_stack_disable = 0;
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+   the start column position is not recorded, and hence does not
+   undo as it happed. But who would notice.
+ */
 
 static void
-edit_do_redo (WEdit * edit)
+edit_do_undo (WEdit * edit)
 {
-    long ac;
-    long count = 0;
-
-    if (edit->redo_stack_reset)
+    if (edit_undo_peek (&edit->undo) == NULL)
         return;
 
-    edit->over_col = 0;
-    while ((ac = edit_pop_redo_action (edit)) < KEY_PRESS)
-    {
-        switch ((int) ac)
-        {
-        case STACK_BOTTOM:
-            goto done_redo;
-        case CURS_RIGHT:
-            edit_cursor_move (edit, 1);
-            break;
-        case CURS_LEFT:
-            edit_cursor_move (edit, -1);
-            break;
-        case BACKSPACE:
-            edit_backspace (edit, TRUE);
-            break;
-        case DELCHAR:
-            edit_delete (edit, TRUE);
-            break;
-        case COLUMN_ON:
-            edit->column_highlight = 1;
-            break;
-        case COLUMN_OFF:
-            edit->column_highlight = 0;
-            break;
-        default:
-            break;
-        }
-        if (ac >= 256 && ac < 512)
-            edit_insert_ahead (edit, ac - 256);
-        if (ac >= 0 && ac < 256)
-            edit_insert (edit, ac);
-
-        if (ac >= MARK_1 - 2 && ac < MARK_2 - 2)
-        {
-            edit->mark1 = ac - MARK_1;
-            edit->column1 =
-                (long) edit_move_forward3 (edit, edit_buffer_get_bol (&edit->buffer, edit->mark1),
-                                           0, edit->mark1);
-        }
-        else if (ac >= MARK_2 - 2 && ac < KEY_PRESS)
-        {
-            edit->mark2 = ac - MARK_2;
-            edit->column2 =
-                (long) edit_move_forward3 (edit, edit_buffer_get_bol (&edit->buffer, edit->mark2),
-                                           0, edit->mark2);
-        }
-        /* more than one pop usually means something big */
-        if (count++)
-            edit->force |= REDRAW_PAGE;
-    }
+    edit->undo_stack_disable = 1;       /* don't record undo's onto undo stack! */
+    /* the reverse of the actions undone is one key press for redo */
+    edit_undo_push (&edit->redo, EDIT_UNDO_KEY_PRESS, edit->start_display);
+    edit_replay_journal (edit, &edit->undo);
+    edit->undo_stack_disable = 0;
+}
 
-    if (edit->start_display > ac - KEY_PRESS)
-    {
-        edit->start_line -=
-            edit_buffer_count_lines (&edit->buffer, ac - KEY_PRESS, edit->start_display);
-        edit->force |= REDRAW_PAGE;
-    }
-    else if (edit->start_display < ac - KEY_PRESS)
-    {
-        edit->start_line +=
-            edit_buffer_count_lines (&edit->buffer, edit->start_display, ac - KEY_PRESS);
-        edit->force |= REDRAW_PAGE;
-    }
-    edit->start_display = ac - KEY_PRESS;       /* see push and pop above */
-    edit_update_curs_row (edit);
+/* --------------------------------------------------------------------------------------------- */
 
-  done_redo:
-    ;
+static void
+edit_do_redo (WEdit * edit)
+{
+    if (!edit->redo_stack_reset)
+        edit_replay_journal (edit, &edit->redo);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1313,19 +1356,21 @@ edit_do_redo (WEdit * edit)
 static void
 edit_group_undo (WEdit * edit)
 {
-    long ac = KEY_PRESS;
-    long cur_ac = KEY_PRESS;
-    while (ac != STACK_BOTTOM && ac == cur_ac)
+    const edit_undo_record_t *r;
+    edit_undo_action_t ac;
+
+    r = edit_undo_peek (&edit->undo);
+    if (r == NULL)
+        return;
+
+    /* if option_group_undo is set, the key presses that end with the same action go together */
+    do
     {
-        cur_ac = get_prev_undo_action (edit);
+        ac = r->action;
         edit_do_undo (edit);
-        ac = get_prev_undo_action (edit);
-        /* exit from cycle if option_group_undo is not set,
-         * and make single UNDO operation
-         */
-        if (!option_group_undo)
-            ac = STACK_BOTTOM;
+        r = edit_undo_peek (&edit->undo);
     }
+    while (option_group_undo && r != NULL && r->action == ac);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2028,25 +2073,20 @@ edit_insert_file (WEdit * edit, const vfs_path_t * filename_vpath)
             if (!option_persistent_selections && edit->modified)
             {
                 if (!edit->column_highlight)
-                    edit_push_undo_action (edit, COLUMN_OFF);
+                    edit_push_undo_action (edit, EDIT_UNDO_COLUMN, 0);
                 edit->column_highlight = 1;
             }
         }
         else
         {
-            off_t i;
-
             while ((blocklen = mc_read (file, (char *) buf, TEMP_BUF_LEN)) > 0)
-            {
-                for (i = 0; i < blocklen; i++)
-                    edit_insert (edit, buf[i]);
-            }
+                edit_insert_block (edit, buf, blocklen);
             /* highlight inserted text then not persistent blocks */
             if (!option_persistent_selections && edit->modified)
             {
                 edit_set_markers (edit, edit->buffer.curs1, current, 0, 0);
                 if (edit->column_highlight)
-                    edit_push_undo_action (edit, COLUMN_ON);
+                    edit_push_undo_action (edit, EDIT_UNDO_COLUMN, 1);
                 edit->column_highlight = 0;
             }
 
@@ -2131,13 +2171,9 @@ edit_init (WEdit * edit, int y, int x, int lines, int cols, const vfs_path_t * f
     /* set file name before load file */
     edit_set_filename (edit, filename_vpath);
 
-    edit->undo_stack_size = START_STACK_SIZE;
-    edit->undo_stack_size_mask = START_STACK_SIZE - 1;
-    edit->undo_stack = g_malloc0 ((edit->undo_stack_size + 10) * sizeof (long));
-
-    edit->redo_stack_size = START_STACK_SIZE;
-    edit->redo_stack_size_mask = START_STACK_SIZE - 1;
-    edit->redo_stack = g_malloc0 ((edit->redo_stack_size + 10) * sizeof (long));
+    option_max_undo = MAX (option_max_undo, 256);
+    edit_undo_init (&edit->undo, (gsize) option_max_undo * 1024, option_undo_spill);
+    edit_undo_init (&edit->redo, (gsize) option_max_undo * 1024, option_undo_spill);
 
 #ifdef HAVE_CHARSET
     edit->utf8 = FALSE;
@@ -2167,8 +2203,14 @@ edit_init (WEdit * edit, int y, int x, int lines, int cols, const vfs_path_t * f
         edit_load_position (edit, FALSE);
         if (line <= 0)
             line = 1;
-        edit_move_display (edit, line - 1);
-        edit_move_to_line (edit, line - 1);
+        if (line > 1)
+            edit_count_file_lines (edit, TRUE);
+        /* a file whose lines are not counted yet is shown from the beginning */
+        if (!edit_buffer_lines_pending (&edit->buffer))
+        {
+            edit_move_display (edit, line - 1);
+            edit_move_to_line (edit, line - 1);
+        }
     }
 
     edit_load_macro_cmd (edit);
@@ -2185,6 +2227,9 @@ edit_clean (WEdit * edit)
     if (edit == NULL)
         return FALSE;
 
+    /* the text of the file that is written in the background goes away with the buffer */
+    edit_save_finish (edit, TRUE);
+
     /* a stale lock, remove it */
     if (edit->locked)
         (void) unlock_file (edit->filename_vpath);
@@ -2200,12 +2245,13 @@ edit_clean (WEdit * edit)
         unlink (vfs_path_get_last_path_str (edit->filename_vpath));
 
     edit_free_syntax_rules (edit);
+    edit_complete_free_words (edit);
     book_mark_flush (edit, -1);
 
     edit_buffer_clean (&edit->buffer);
 
-    g_free (edit->undo_stack);
-    g_free (edit->redo_stack);
+    edit_undo_clean (&edit->undo);
+    edit_undo_clean (&edit->redo);
     vfs_path_free (edit->filename_vpath, TRUE);
     vfs_path_free (edit->dir_vpath, TRUE);
     edit_search_deinit (edit);
@@ -2235,6 +2281,9 @@ edit_reload_line (WEdit * edit, const vfs_path_t * filename_vpath, long line)
     Widget *w = WIDGET (edit);
     WEdit *e;
 
+    /* the file is read again when it is written */
+    edit_save_finish (edit, TRUE);
+
     e = g_malloc0 (sizeof (WEdit));
     *WIDGET (e) = *w;
     /* save some widget parameters */
@@ -2254,6 +2303,89 @@ edit_reload_line (WEdit * edit, const vfs_path_t * filename_vpath, long line)
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count the lines of a lazily loaded file: a piece of them while the user does nothing, or all
+ * of them as soon as something needs the exact number.
+ *
+ * @param edit editor object
+ * @param all count all the lines that are left
+ *
+ * @return TRUE if there are more lines to count
+ */
+
+gboolean
+edit_count_file_lines (WEdit * edit, gboolean all)
+{
+    if (!edit_buffer_lines_pending (&edit->buffer))
+        return FALSE;
+
+    if (edit_buffer_count_file_lines (&edit->buffer, all))
+        return TRUE;
+
+    /* the line cache and the line numbers were based on the lines counted so far */
+    edit->caches_valid = FALSE;
+    edit->force |= REDRAW_COMPLETELY;
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether a lazily loaded file has been changed by another program, at most once a second
+ * unless the mapping has read the pages of a truncated file as zeros. An unmodified file is read
+ * again in full. The text of a modified file is copied out of the mapping as it is now, and the
+ * user is told that it may show the changes.
+ *
+ * @param edit editor object
+ */
+
+void
+edit_check_mapped_file (WEdit * edit)
+{
+    gint64 now;
+    gchar *msg;
+
+    /* the file is read while it is written */
+    if (edit->buffer.map_fd == -1 || edit->save != NULL)
+        return;
+
+    now = g_get_monotonic_time ();
+    if (now - edit->map_checked < G_USEC_PER_SEC && !mc_mmap_read_faulted (edit->buffer.map))
+        return;
+    edit->map_checked = now;
+
+    if (!edit_buffer_map_changed (&edit->buffer))
+        return;
+
+    if (!edit->modified)
+    {
+        vfs_path_t *vpath;
+        gboolean ok;
+
+        vpath = vfs_path_clone (edit->filename_vpath);
+        edit_load_eager = TRUE;
+        ok = edit_reload_line (edit, vpath, edit->buffer.curs_line + 1);
+        edit_load_eager = FALSE;
+        vfs_path_free (vpath, TRUE);
+
+        if (ok)
+        {
+            edit->force |= REDRAW_COMPLETELY;
+            return;
+        }
+    }
+
+    if (!edit_buffer_map_detach (&edit->buffer))
+        return;
+
+    edit->force |= REDRAW_COMPLETELY;
+    msg = g_strdup_printf (_("%s has been changed by another program.\n"
+                             "The text that you have not edited may show the changes."),
+                           vfs_path_as_str (edit->filename_vpath));
+    edit_error_dialog (_("Warning"), msg);
+    g_free (msg);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 #ifdef HAVE_CHARSET
@@ -2286,216 +2418,45 @@ edit_set_codeset (WEdit * edit)
 /* --------------------------------------------------------------------------------------------- */
 
 /**
- * Recording stack for undo:
- * The following is an implementation of a compressed stack. Identical
- * pushes are recorded by a negative prefix indicating the number of times the
- * same char was pushed. This saves space for repeated curs-left or curs-right
- * delete etc.
- *
- * eg:
- *
- * pushed:       stored:
- *
- * a
- * b             a
- * b            -3
- * b             b
- * c  -->       -4
- * c             c
- * c             d
- * c
- * d
- *
- * If the stack long int is 0-255 it represents a normal insert (from a backspace),
- * 256-512 is an insert ahead (from a delete), If it is betwen 600 and 700 it is one
- * of the cursor functions define'd in edit-impl.h. 1000 through 700'000'000 is to
- * set edit->mark1 position. 700'000'000 through 1400'000'000 is to set edit->mark2
- * position.
- *
+ * Recording journal for undo:
  * The only way the cursor moves or the buffer is changed is through the routines:
- * insert, backspace, insert_ahead, delete, and cursor_move.
- * These record the reverse undo movements onto the stack each time they are
- * called.
+ * insert, backspace, insert_ahead, delete, cursor_move and their block versions.
+ * These record the reverse undo movements onto the journal each time they are
+ * called. Repeated actions are merged into one record, so a long cursor move,
+ * typing or deleting a block takes one record, see editundo.c.
  *
  * Each key press results in a set of actions (insert; delete ...). So each time
- * a key is pressed the current position of start_display is pushed as
- * KEY_PRESS + start_display. Then for undoing, we pop until we get to a number
- * over KEY_PRESS. We then assign this number less KEY_PRESS to start_display. So undo
- * tracks scrolling and key actions exactly. (KEY_PRESS is about (2^31) * (2/3) = 1400'000'000)
- *
+ * a key is pressed the current position of start_display is pushed as an
+ * EDIT_UNDO_KEY_PRESS record. Then for undoing, we pop until we get to such a record
+ * and assign its value to start_display. So undo tracks scrolling and key actions exactly.
  *
+ * While an undo is replayed, the reverse actions go onto the redo journal.
  *
  * @param edit editor object
- * @param c code of the action
+ * @param action action that reverses the change
+ * @param value see edit_undo_action_t
  */
 
 void
-edit_push_undo_action (WEdit * edit, long c)
-{
-    unsigned long sp = edit->undo_stack_pointer;
-    unsigned long spm1;
-    long *t;
-
-    /* first enlarge the stack if necessary */
-    if (sp > edit->undo_stack_size - 10)
-    {                           /* say */
-        if (option_max_undo < 256)
-            option_max_undo = 256;
-        if (edit->undo_stack_size < (unsigned long) option_max_undo)
-        {
-            t = g_realloc (edit->undo_stack, (edit->undo_stack_size * 2 + 10) * sizeof (long));
-            if (t)
-            {
-                edit->undo_stack = t;
-                edit->undo_stack_size <<= 1;
-                edit->undo_stack_size_mask = edit->undo_stack_size - 1;
-            }
-        }
-    }
-    spm1 = (edit->undo_stack_pointer - 1) & edit->undo_stack_size_mask;
-    if (edit->undo_stack_disable)
-    {
-        edit_push_redo_action (edit, KEY_PRESS);
-        edit_push_redo_action (edit, c);
-        return;
-    }
-
-    if (edit->redo_stack_reset)
-        edit->redo_stack_bottom = edit->redo_stack_pointer = 0;
-
-    if (edit->undo_stack_bottom != sp
-        && spm1 != edit->undo_stack_bottom
-        && ((sp - 2) & edit->undo_stack_size_mask) != edit->undo_stack_bottom)
-    {
-        long d;
-        if (edit->undo_stack[spm1] < 0)
-        {
-            d = edit->undo_stack[(sp - 2) & edit->undo_stack_size_mask];
-            if (d == c && edit->undo_stack[spm1] > -1000000000)
-            {
-                if (c < KEY_PRESS)      /* --> no need to push multiple do-nothings */
-                    edit->undo_stack[spm1]--;
-                return;
-            }
-        }
-        else
-        {
-            d = edit->undo_stack[spm1];
-            if (d == c)
-            {
-                if (c >= KEY_PRESS)
-                    return;     /* --> no need to push multiple do-nothings */
-                edit->undo_stack[sp] = -2;
-                goto check_bottom;
-            }
-        }
-    }
-    edit->undo_stack[sp] = c;
-
-  check_bottom:
-    edit->undo_stack_pointer = (edit->undo_stack_pointer + 1) & edit->undo_stack_size_mask;
-
-    /* if the sp wraps round and catches the undo_stack_bottom then erase
-     * the first set of actions on the stack to make space - by moving
-     * undo_stack_bottom forward one "key press" */
-    c = (edit->undo_stack_pointer + 2) & edit->undo_stack_size_mask;
-    if ((unsigned long) c == edit->undo_stack_bottom ||
-        (((unsigned long) c + 1) & edit->undo_stack_size_mask) == edit->undo_stack_bottom)
-        do
-        {
-            edit->undo_stack_bottom = (edit->undo_stack_bottom + 1) & edit->undo_stack_size_mask;
-        }
-        while (edit->undo_stack[edit->undo_stack_bottom] < KEY_PRESS
-               && edit->undo_stack_bottom != edit->undo_stack_pointer);
-
-    /*If a single key produced enough pushes to wrap all the way round then we would notice that the [undo_stack_bottom] does not contain KEY_PRESS. The stack is then initialised: */
-    if (edit->undo_stack_pointer != edit->undo_stack_bottom
-        && edit->undo_stack[edit->undo_stack_bottom] < KEY_PRESS)
-    {
-        edit->undo_stack_bottom = edit->undo_stack_pointer = 0;
-    }
+edit_push_undo_action (WEdit * edit, edit_undo_action_t action, off_t value)
+{
+    edit_undo_push (edit_get_undo_journal (edit), action, value);
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Record an undo action that inserts text back or restores the markers.
+ *
+ * @param edit editor object
+ * @param action EDIT_UNDO_INSERT, EDIT_UNDO_INSERT_AHEAD or EDIT_UNDO_MARKERS
+ * @param text text in the order of the file
+ * @param len length of the text
+ */
 
 void
-edit_push_redo_action (WEdit * edit, long c)
-{
-    unsigned long sp = edit->redo_stack_pointer;
-    unsigned long spm1;
-    long *t;
-    /* first enlarge the stack if necessary */
-    if (sp > edit->redo_stack_size - 10)
-    {                           /* say */
-        if (option_max_undo < 256)
-            option_max_undo = 256;
-        if (edit->redo_stack_size < (unsigned long) option_max_undo)
-        {
-            t = g_realloc (edit->redo_stack, (edit->redo_stack_size * 2 + 10) * sizeof (long));
-            if (t)
-            {
-                edit->redo_stack = t;
-                edit->redo_stack_size <<= 1;
-                edit->redo_stack_size_mask = edit->redo_stack_size - 1;
-            }
-        }
-    }
-    spm1 = (edit->redo_stack_pointer - 1) & edit->redo_stack_size_mask;
-
-    if (edit->redo_stack_bottom != sp
-        && spm1 != edit->redo_stack_bottom
-        && ((sp - 2) & edit->redo_stack_size_mask) != edit->redo_stack_bottom)
-    {
-        long d;
-        if (edit->redo_stack[spm1] < 0)
-        {
-            d = edit->redo_stack[(sp - 2) & edit->redo_stack_size_mask];
-            if (d == c && edit->redo_stack[spm1] > -1000000000)
-            {
-                if (c < KEY_PRESS)      /* --> no need to push multiple do-nothings */
-                    edit->redo_stack[spm1]--;
-                return;
-            }
-        }
-        else
-        {
-            d = edit->redo_stack[spm1];
-            if (d == c)
-            {
-                if (c >= KEY_PRESS)
-                    return;     /* --> no need to push multiple do-nothings */
-                edit->redo_stack[sp] = -2;
-                goto redo_check_bottom;
-            }
-        }
-    }
-    edit->redo_stack[sp] = c;
-
-  redo_check_bottom:
-    edit->redo_stack_pointer = (edit->redo_stack_pointer + 1) & edit->redo_stack_size_mask;
-
-    /* if the sp wraps round and catches the redo_stack_bottom then erase
-     * the first set of actions on the stack to make space - by moving
-     * redo_stack_bottom forward one "key press" */
-    c = (edit->redo_stack_pointer + 2) & edit->redo_stack_size_mask;
-    if ((unsigned long) c == edit->redo_stack_bottom ||
-        (((unsigned long) c + 1) & edit->redo_stack_size_mask) == edit->redo_stack_bottom)
-        do
-        {
-            edit->redo_stack_bottom = (edit->redo_stack_bottom + 1) & edit->redo_stack_size_mask;
-        }
-        while (edit->redo_stack[edit->redo_stack_bottom] < KEY_PRESS
-               && edit->redo_stack_bottom != edit->redo_stack_pointer);
-
-    /*
-     * If a single key produced enough pushes to wrap all the way round then
-     * we would notice that the [redo_stack_bottom] does not contain KEY_PRESS.
-     * The stack is then initialised:
-     */
-
-    if (edit->redo_stack_pointer != edit->redo_stack_bottom
-        && edit->redo_stack[edit->redo_stack_bottom] < KEY_PRESS)
-        edit->redo_stack_bottom = edit->redo_stack_pointer = 0;
+edit_push_undo_text (WEdit * edit, edit_undo_action_t action, const char *text, off_t len)
+{
+    edit_undo_push_text (edit_get_undo_journal (edit), action, text, len);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2530,15 +2491,17 @@ edit_insert (WEdit * edit, int c)
     /* save the reverse command onto the undo stack */
     /* ordinary char and not space */
     if (c > 32)
-        edit_push_undo_action (edit, BACKSPACE);
+        edit_push_undo_action (edit, EDIT_UNDO_BACKSPACE, 1);
     else
-        edit_push_undo_action (edit, BACKSPACE_BR);
+        edit_push_undo_action (edit, EDIT_UNDO_BACKSPACE_BR, 1);
     /* update markers */
     edit->mark1 += (edit->mark1 > edit->buffer.curs1) ? 1 : 0;
     edit->mark2 += (edit->mark2 > edit->buffer.curs1) ? 1 : 0;
-    edit->last_get_rule += (edit->last_get_rule > edit->buffer.curs1) ? 1 : 0;
+    edit_syntax_invalidate (edit, edit->buffer.curs1);
+    edit_complete_change_begin (edit, edit->buffer.curs1, 0);
 
     edit_buffer_insert (&edit->buffer, c);
+    edit_complete_change_end (edit, 1);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2562,15 +2525,168 @@ edit_insert_ahead (WEdit * edit, int c)
     }
     /* ordinary char and not space */
     if (c > 32)
-        edit_push_undo_action (edit, DELCHAR);
+        edit_push_undo_action (edit, EDIT_UNDO_DELETE, 1);
     else
-        edit_push_undo_action (edit, DELCHAR_BR);
+        edit_push_undo_action (edit, EDIT_UNDO_DELETE_BR, 1);
 
     edit->mark1 += (edit->mark1 >= edit->buffer.curs1) ? 1 : 0;
     edit->mark2 += (edit->mark2 >= edit->buffer.curs1) ? 1 : 0;
-    edit->last_get_rule += (edit->last_get_rule >= edit->buffer.curs1) ? 1 : 0;
+    edit_syntax_invalidate (edit, edit->buffer.curs1);
+    edit_complete_change_begin (edit, edit->buffer.curs1, 0);
 
     edit_buffer_insert_ahead (&edit->buffer, c);
+    edit_complete_change_end (edit, 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Insert a block of bytes and move right. It is what edit_insert() does for each byte, but the
+ * lines, the bookmarks and the markers are updated once.
+ */
+
+void
+edit_insert_block (WEdit * edit, const char *data, off_t len)
+{
+    const off_t curs1 = edit->buffer.curs1;
+    long lines;
+
+    if (len <= 0)
+        return;
+
+    /* Mark file as modified, unless the file hasn't been fully loaded */
+    if (edit->loading_done)
+        edit_modification (edit);
+
+    /* save the reverse command onto the undo stack, it takes one record for the whole block */
+    edit_push_undo_action (edit, EDIT_UNDO_BACKSPACE, len);
+
+    /* update markers */
+    edit->mark1 += (edit->mark1 > curs1) ? len : 0;
+    edit->mark2 += (edit->mark2 > curs1) ? len : 0;
+    edit_syntax_invalidate (edit, curs1);
+    edit_complete_change_begin (edit, curs1, 0);
+
+    lines = edit_buffer_insert_bytes (&edit->buffer, data, len);
+    edit_complete_change_end (edit, len);
+
+    /* update the position of the display window */
+    if (curs1 < edit->start_display)
+    {
+        edit->start_display += len;
+        edit->start_line += lines;
+    }
+
+    if (lines != 0)
+    {
+        book_mark_shift (edit, edit->buffer.curs_line, lines);
+        edit->buffer.curs_line += lines;
+        edit->buffer.lines += lines;
+        edit->force |= REDRAW_LINE_ABOVE | REDRAW_AFTER_CURSOR;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** same as edit_insert_block and stay before the block */
+
+void
+edit_insert_block_ahead (WEdit * edit, const char *data, off_t len)
+{
+    const off_t curs1 = edit->buffer.curs1;
+    long lines;
+
+    if (len <= 0)
+        return;
+
+    edit_modification (edit);
+
+    edit_push_undo_action (edit, EDIT_UNDO_DELETE, len);
+
+    edit->mark1 += (edit->mark1 >= curs1) ? len : 0;
+    edit->mark2 += (edit->mark2 >= curs1) ? len : 0;
+    edit_syntax_invalidate (edit, curs1);
+    edit_complete_change_begin (edit, curs1, 0);
+
+    lines = edit_buffer_insert_bytes_ahead (&edit->buffer, data, len);
+    edit_complete_change_end (edit, len);
+
+    if (curs1 < edit->start_display)
+    {
+        edit->start_display += len;
+        edit->start_line += lines;
+    }
+
+    if (lines != 0)
+    {
+        book_mark_shift (edit, edit->buffer.curs_line, lines);
+        edit->buffer.lines += lines;
+        edit->force |= REDRAW_AFTER_CURSOR;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Delete a block of bytes after the cursor. It is what edit_delete() does for each byte, but
+ * the lines, the bookmarks and the markers are updated once.
+ */
+
+void
+edit_delete_block (WEdit * edit, off_t len)
+{
+    const off_t curs1 = edit->buffer.curs1;
+    off_t i;
+    long lines;
+
+    len = MIN (len, edit->buffer.curs2);
+    if (len <= 0)
+        return;
+
+    if (edit->mark2 != edit->mark1)
+        edit_push_markers (edit);
+
+    /* save the deleted text onto the undo stack */
+    for (i = 0; i < len;)
+    {
+        const char *p;
+        off_t n;
+
+        p = edit_buffer_get_span (&edit->buffer, curs1 + i, &n);
+        n = MIN (n, len - i);
+        edit_push_undo_text (edit, EDIT_UNDO_INSERT_AHEAD, p, n);
+        i += n;
+    }
+
+    /* update markers, those inside the block go to its start */
+    if (edit->mark1 > curs1)
+    {
+        const off_t d = MIN (edit->mark1 - curs1, len);
+
+        edit->mark1 -= d;
+        edit->end_mark_curs -= d;
+    }
+    if (edit->mark2 > curs1)
+        edit->mark2 -= MIN (edit->mark2 - curs1, len);
+    edit_syntax_invalidate (edit, curs1);
+
+    /* the display window starts no earlier than the cursor */
+    if (curs1 < edit->start_display)
+    {
+        const off_t d = MIN (edit->start_display - curs1, len);
+
+        edit->start_line -= edit_buffer_count_lines (&edit->buffer, curs1, curs1 + d);
+        edit->start_display -= d;
+    }
+
+    edit_complete_change_begin (edit, curs1, len);
+    lines = edit_buffer_delete_range (&edit->buffer, len);
+    edit_complete_change_end (edit, 0);
+
+    edit_modification (edit);
+    if (lines != 0)
+    {
+        book_mark_shift (edit, edit->buffer.curs_line, -lines);
+        edit->buffer.lines -= lines;
+        edit->force |= REDRAW_AFTER_CURSOR;
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2594,6 +2710,7 @@ edit_delete (WEdit * edit, gboolean byte_delete)
     int p = 0;
     int char_length = 1;
     int i;
+    char c;
 
     if (edit->buffer.curs2 == 0)
         return 0;
@@ -2622,12 +2739,14 @@ edit_delete (WEdit * edit, gboolean byte_delete)
         }
         if (edit->mark2 > edit->buffer.curs1)
             edit->mark2--;
-        if (edit->last_get_rule > edit->buffer.curs1)
-            edit->last_get_rule--;
+        edit_syntax_invalidate (edit, edit->buffer.curs1);
+        edit_complete_change_begin (edit, edit->buffer.curs1, 1);
 
         p = edit_buffer_delete (&edit->buffer);
+        edit_complete_change_end (edit, 0);
 
-        edit_push_undo_action (edit, p + 256);
+        c = (char) p;
+        edit_push_undo_text (edit, EDIT_UNDO_INSERT_AHEAD, &c, 1);
     }
 
     edit_modification (edit);
@@ -2655,6 +2774,7 @@ edit_backspace (WEdit * edit, gboolean byte_delete)
     int p = 0;
     int char_length = 1;
     int i;
+    char c;
 
     if (edit->buffer.curs1 == 0)
         return 0;
@@ -2682,12 +2802,14 @@ edit_backspace (WEdit * edit, gboolean byte_delete)
         }
         if (edit->mark2 >= edit->buffer.curs1)
             edit->mark2--;
-        if (edit->last_get_rule >= edit->buffer.curs1)
-            edit->last_get_rule--;
+        edit_syntax_invalidate (edit, edit->buffer.curs1 - 1);
+        edit_complete_change_begin (edit, edit->buffer.curs1 - 1, 1);
 
         p = edit_buffer_backspace (&edit->buffer);
+        edit_complete_change_end (edit, 0);
 
-        edit_push_undo_action (edit, p);
+        c = (char) p;
+        edit_push_undo_text (edit, EDIT_UNDO_INSERT, &c, 1);
     }
     edit_modification (edit);
     if (p == '\n')
@@ -2716,38 +2838,22 @@ edit_cursor_move (WEdit * edit, off_t increment)
 {
     if (increment < 0)
     {
-        for (; increment < 0 && edit->buffer.curs1 != 0; increment++)
+        increment = -MIN (-increment, edit->buffer.curs1);
+        if (increment != 0)
         {
-            int c;
-
-            edit_push_undo_action (edit, CURS_RIGHT);
-
-            c = edit_buffer_get_previous_byte (&edit->buffer);
-            edit_buffer_insert_ahead (&edit->buffer, c);
-            c = edit_buffer_backspace (&edit->buffer);
-            if (c == '\n')
-            {
-                edit->buffer.curs_line--;
+            edit_push_undo_action (edit, EDIT_UNDO_CURSOR, -increment);
+            if (edit_buffer_move_gap (&edit->buffer, increment) != 0)
                 edit->force |= REDRAW_LINE_BELOW;
-            }
         }
     }
     else
     {
-        for (; increment > 0 && edit->buffer.curs2 != 0; increment--)
+        increment = MIN (increment, edit->buffer.curs2);
+        if (increment != 0)
         {
-            int c;
-
-            edit_push_undo_action (edit, CURS_LEFT);
-
-            c = edit_buffer_get_current_byte (&edit->buffer);
-            edit_buffer_insert (&edit->buffer, c);
-            c = edit_buffer_delete (&edit->buffer);
-            if (c == '\n')
-            {
-                edit->buffer.curs_line++;
+            edit_push_undo_action (edit, EDIT_UNDO_CURSOR, -increment);
+            if (edit_buffer_move_gap (&edit->buffer, increment) != 0)
                 edit->force |= REDRAW_LINE_ABOVE;
-            }
         }
     }
 }
@@ -2898,7 +3004,9 @@ edit_scroll_downward (WEdit * edit, long i)
 {
     long lines_below;
 
-    lines_below = edit->buffer.lines - edit->start_line - (WIDGET (edit)->lines - 1);
+    lines_below =
+        edit_lines_below (edit, edit->start_display, edit->start_line,
+                          i + WIDGET (edit)->lines - 1) - (WIDGET (edit)->lines - 1);
     if (lines_below > 0)
     {
         if (i > lines_below)
@@ -3043,9 +3151,12 @@ edit_move_display (WEdit * e, long line)
 void
 edit_push_markers (WEdit * edit)
 {
-    edit_push_undo_action (edit, MARK_1 + edit->mark1);
-    edit_push_undo_action (edit, MARK_2 + edit->mark2);
-    edit_push_undo_action (edit, MARK_CURS + edit->end_mark_curs);
+    off_t m[3];
+
+    m[0] = edit->mark1;
+    m[1] = edit->mark2;
+    m[2] = edit->end_mark_curs;
+    edit_push_undo_text (edit, EDIT_UNDO_MARKERS, (const char *) m, sizeof (m));
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -3168,12 +3279,9 @@ edit_delete_line (WEdit * edit)
 void
 edit_push_key_press (WEdit * edit)
 {
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
     if (edit->mark2 == -1)
-    {
-        edit_push_undo_action (edit, MARK_1 + edit->mark1);
-        edit_push_undo_action (edit, MARK_CURS + edit->end_mark_curs);
-    }
+        edit_push_markers (edit);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -3262,6 +3370,12 @@ edit_execute_cmd (WEdit * edit, long command, int char_for_insertion)
     if (edit_handle_move_resize (edit, command))
         return;
 
+    edit_check_mapped_file (edit);
+
+    /* a key was pressed before the lines were counted */
+    if (!edit_command_without_lines (command))
+        edit_count_file_lines (edit, TRUE);
+
     edit->force |= REDRAW_LINE;
 
     /* The next key press will unhighlight the found string, so update
@@ -3425,7 +3539,7 @@ edit_execute_cmd (WEdit * edit, long command, int char_for_insertion)
         if (!option_persistent_selections && edit->mark2 >= 0)
         {
             if (edit->column_highlight)
-                edit_push_undo_action (edit, COLUMN_ON);
+                edit_push_undo_action (edit, EDIT_UNDO_COLUMN, 1);
             edit->column_highlight = 0;
             edit_mark_cmd (edit, TRUE);
         }
@@ -3689,14 +3803,14 @@ edit_execute_cmd (WEdit * edit, long command, int char_for_insertion)
         if (edit->mark2 >= 0)
         {
             if (edit->column_highlight)
-                edit_push_undo_action (edit, COLUMN_ON);
+                edit_push_undo_action (edit, EDIT_UNDO_COLUMN, 1);
             edit->column_highlight = 0;
         }
         edit_mark_cmd (edit, FALSE);
         break;
     case CK_MarkColumn:
         if (!edit->column_highlight)
-            edit_push_undo_action (edit, COLUMN_OFF);
+            edit_push_undo_action (edit, EDIT_UNDO_COLUMN, 0);
         edit->column_highlight = 1;
         edit_mark_cmd (edit, FALSE);
         break;
@@ -3706,19 +3820,19 @@ edit_execute_cmd (WEdit * edit, long command, int char_for_insertion)
         break;
     case CK_Unmark:
         if (edit->column_highlight)
-            edit_push_undo_action (edit, COLUMN_ON);
+            edit_push_undo_action (edit, EDIT_UNDO_COLUMN, 1);
         edit->column_highlight = 0;
         edit_mark_cmd (edit, TRUE);
         break;
     case CK_MarkWord:
         if (edit->column_highlight)
-            edit_push_undo_action (edit, COLUMN_ON);
+            edit_push_undo_action (edit, EDIT_UNDO_COLUMN, 1);
         edit->column_highlight = 0;
         edit_mark_current_word_cmd (edit);
         break;
     case CK_MarkLine:
         if (edit->column_highlight)
-            edit_push_undo_action (edit, COLUMN_ON);
+            edit_push_undo_action (edit, EDIT_UNDO_COLUMN, 1);
         edit->column_highlight = 0;
         edit_mark_current_line_cmd (edit);
         break;
@@ -3813,7 +3927,7 @@ edit_execute_cmd (WEdit * edit, long command, int char_for_insertion)
         if (!option_persistent_selections && edit->mark2 >= 0)
         {
             if (edit->column_highlight)
-                edit_push_undo_action (edit, COLUMN_ON);
+                edit_push_undo_action (edit, EDIT_UNDO_COLUMN, 1);
             edit->column_highlight = 0;
             edit_mark_cmd (edit, TRUE);
         }
@@ -47,11 +47,16 @@ extern int option_save_mode;
 extern gboolean option_save_position;
 extern gboolean option_syntax_highlighting;
 extern gboolean option_group_undo;
+extern int option_max_undo;
+extern gboolean option_undo_spill;
 extern char *option_backup_ext;
 extern char *option_filesize_threshold;
+extern char *option_filesize_lazy;
+extern char *option_filesize_pieces;
 extern char *option_stop_format_chars;
 
 extern gboolean edit_confirm_save;
+extern gboolean option_save_sync;
 
 extern gboolean visible_tabs;
 extern gboolean visible_tws;
@@ -33,15 +33,21 @@
 
 #include <ctype.h>              /* isdigit() */
 #include <stdlib.h>
+#include <stdint.h>             /* SIZE_MAX */
 #include <string.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>           /* struct iovec */
+#include <unistd.h>
 
 #include "lib/global.h"
 
+#include "lib/util.h"           /* count_newlines(), mc_mmap_read() */
 #include "lib/vfs/vfs.h"
 
 #include "edit-impl.h"
 #include "editbuffer.h"
+#include "editpieces.h"
 
 /* --------------------------------------------------------------------------------------------- */
 /*-
@@ -74,6 +80,19 @@
  * See also:
  * http://en.wikipedia.org/wiki/Gap_buffer
  * http://stackoverflow.com/questions/4199694/data-structure-for-text-editor
+ *
+ * A big file can be loaded lazily: then the buffers of b1 and b2 are pieces of a read-only
+ * mapping of the file as long as they are not modified, and a buffer is copied to memory of
+ * its own on the first write to it.
+ *
+ * A buffer can keep its text in a piece table instead (see editpieces.c), then b1 and b2 stay
+ * empty and the cursor is only an offset: moving it copies nothing, and a change takes the same
+ * time anywhere in the file.
+ *
+ * The line index of the gap buffer is the running sums of the line breaks in the buffers of b1
+ * (lines1) and of b2 (lines2). Only the last buffer of b1 or b2 ever changes, so the sums are
+ * updated in O(1), and finding the line of an offset or the offset of a line takes a binary
+ * search and a scan of one buffer. A piece table is its own line index.
  */
 
 /*** global variables ****************************************************************************/
@@ -96,6 +115,13 @@
 /* Buffer mask (used to find cursor position relative to the buffer) */
 #define M_EDIT_BUF_SIZE (EDIT_BUF_SIZE - 1)
 
+/* Number of bytes of a mapped file whose lines are counted in one step */
+#define EDIT_COUNT_LINES_STEP (4 * 1024 * 1024)
+
+/* Lines that are longer or farther than these are looked up in the line index */
+#define EDIT_LINE_WALK 1024
+#define EDIT_LINE_JUMP 16
+
 /*** file scope type declarations ****************************************************************/
 
 /*** file scope variables ************************************************************************/
@@ -119,6 +145,13 @@ edit_buffer_get_byte_ptr (const edit_buffer_t * buf, off_t byte_index)
     if (byte_index >= (buf->curs1 + buf->curs2) || byte_index < 0)
         return NULL;
 
+    if (buf->pieces != NULL)
+    {
+        off_t len;
+
+        return (char *) edit_pieces_get_span (buf->pieces, byte_index, &len);
+    }
+
     if (byte_index >= buf->curs1)
     {
         off_t p;
@@ -132,6 +165,538 @@ edit_buffer_get_byte_ptr (const edit_buffer_t * buf, off_t byte_index)
     return (char *) b + (byte_index & M_EDIT_BUF_SIZE);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Check whether a buffer is a piece of the file mapping rather than memory of its own */
+
+static inline gboolean
+edit_buffer_is_mapped (const edit_buffer_t * buf, const void *b)
+{
+    return (buf->map != NULL && (const char *) b >= buf->map
+            && (const char *) b < buf->map + buf->map_size);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_buffer_free_page (gpointer b, gpointer buf)
+{
+    if (!edit_buffer_is_mapped ((const edit_buffer_t *) buf, b))
+        g_free (b);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get a new buffer for the EDIT_BUF_SIZE bytes from @first to @last of b1 or b2. If these bytes
+ * are contiguous in the file mapping, the buffer is that piece of the mapping.
+ */
+
+static void *
+edit_buffer_new_page (const edit_buffer_t * buf, off_t first, off_t last)
+{
+    const char *p, *q;
+
+    p = edit_buffer_get_byte_ptr (buf, first);
+    if (p != NULL && edit_buffer_is_mapped (buf, p))
+    {
+        q = edit_buffer_get_byte_ptr (buf, last);
+        if (q == p + EDIT_BUF_SIZE - 1 && edit_buffer_is_mapped (buf, q))
+            return (void *) p;
+    }
+
+    return g_malloc0 (EDIT_BUF_SIZE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get the last buffer of b1 or b2 to write to it, a piece of the file mapping is copied first */
+
+static char *
+edit_buffer_own_last_page (edit_buffer_t * buf, GPtrArray * pages)
+{
+    void **b;
+
+    b = &g_ptr_array_index (pages, pages->len - 1);
+    if (edit_buffer_is_mapped (buf, *b))
+    {
+        void *copy;
+
+        copy = g_malloc (EDIT_BUF_SIZE);
+        memcpy (copy, *b, EDIT_BUF_SIZE);
+        *b = copy;
+    }
+
+    return (char *) *b;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Count the '\n' bytes between two offsets without the line index */
+
+static long
+edit_buffer_scan_lines (const edit_buffer_t * buf, off_t first, off_t last)
+{
+    long lines = 0;
+
+    while (first < last)
+    {
+        const char *p;
+        off_t len;
+
+        p = edit_buffer_get_span (buf, first, &len);
+        if (p == NULL)
+            break;
+
+        len = MIN (len, last - first);
+        lines += (long) count_newlines (p, (size_t) len);
+        first += len;
+    }
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find the @n-th '\n' byte from @first on, there must be so many */
+
+static off_t
+edit_buffer_find_newline (const edit_buffer_t * buf, off_t first, long n)
+{
+    while (TRUE)
+    {
+        const char *p, *q, *end;
+        off_t len;
+
+        p = edit_buffer_get_span (buf, first, &len);
+        if (p == NULL)
+            return first;
+
+        for (q = p, end = p + len; (q = memchr (q, '\n', (size_t) (end - q))) != NULL; q++)
+            if (--n == 0)
+                return first + (q - p);
+
+        first += len;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** A buffer was added to b1 or b2, the sum of line breaks with it is that without it */
+
+static void
+edit_buffer_index_push (GArray * index)
+{
+    if (index != NULL)
+    {
+        long lines;
+
+        lines = (index->len == 0) ? 0 : g_array_index (index, long, index->len - 1);
+        g_array_append_val (index, lines);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** The last buffer of b1 or b2 was removed */
+
+static void
+edit_buffer_index_pop (GArray * index)
+{
+    if (index != NULL)
+        g_array_set_size (index, index->len - 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Line breaks were added to or removed from the last buffer of b1 or b2 */
+
+static void
+edit_buffer_index_add (GArray * index, long lines)
+{
+    if (index != NULL && lines != 0)
+        g_array_index (index, long, index->len - 1) += lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline long
+edit_buffer_index_total (const GArray * index)
+{
+    return (index->len == 0) ? 0 : g_array_index (index, long, index->len - 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find the first buffer with at least @lines line breaks in it and in those before it */
+
+static guint
+edit_buffer_index_search (const GArray * index, long lines)
+{
+    guint lo = 0, hi = index->len - 1;
+
+    while (lo < hi)
+    {
+        guint mid;
+
+        mid = lo + (hi - lo) / 2;
+        if (g_array_index (index, long, mid) < lines)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_buffer_index_free (edit_buffer_t * buf)
+{
+    if (buf->lines1 != NULL)
+        g_array_free (buf->lines1, TRUE);
+    if (buf->lines2 != NULL)
+        g_array_free (buf->lines2, TRUE);
+
+    buf->lines1 = NULL;
+    buf->lines2 = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Count the line breaks in all buffers of b1 and b2 */
+
+static void
+edit_buffer_index_build (edit_buffer_t * buf)
+{
+    off_t size = buf->curs1 + buf->curs2;
+    long lines = 0;
+    guint i;
+
+    edit_buffer_index_free (buf);
+
+    buf->lines1 = g_array_sized_new (FALSE, FALSE, sizeof (long), buf->b1->len);
+    for (i = 0; i < buf->b1->len; i++)
+    {
+        off_t first;
+
+        first = (off_t) i << S_EDIT_BUF_SIZE;
+        lines += edit_buffer_scan_lines (buf, first, MIN (first + EDIT_BUF_SIZE, buf->curs1));
+        g_array_append_val (buf->lines1, lines);
+    }
+
+    lines = 0;
+    buf->lines2 = g_array_sized_new (FALSE, FALSE, sizeof (long), buf->b2->len);
+    for (i = 0; i < buf->b2->len; i++)
+    {
+        off_t last;
+
+        last = size - ((off_t) i << S_EDIT_BUF_SIZE);
+        lines += edit_buffer_scan_lines (buf, MAX (last - EDIT_BUF_SIZE, buf->curs1), last);
+        g_array_append_val (buf->lines2, lines);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Count the line breaks before @offset with the line index of the gap buffer */
+
+static long
+edit_buffer_index_lines_before (const edit_buffer_t * buf, off_t offset)
+{
+    off_t size = buf->curs1 + buf->curs2;
+    off_t first, last;
+    long lines1, lines2, before, with;
+    guint i;
+
+    lines1 = edit_buffer_index_total (buf->lines1);
+    lines2 = edit_buffer_index_total (buf->lines2);
+
+    if (offset >= size)
+        return lines1 + lines2;
+
+    if (offset <= buf->curs1)
+    {
+        i = (guint) (offset >> S_EDIT_BUF_SIZE);
+        if (i >= buf->b1->len)
+            return lines1;
+
+        first = (off_t) i << S_EDIT_BUF_SIZE;
+        last = MIN (first + EDIT_BUF_SIZE, buf->curs1);
+        before = (i == 0) ? 0 : g_array_index (buf->lines1, long, i - 1);
+        with = g_array_index (buf->lines1, long, i);
+
+        /* scan the shorter part of the buffer */
+        if (offset - first <= last - offset)
+            return before + edit_buffer_scan_lines (buf, first, offset);
+        return with - edit_buffer_scan_lines (buf, offset, last);
+    }
+
+    /* count the line breaks from the offset to the end */
+    i = (guint) ((size - 1 - offset) >> S_EDIT_BUF_SIZE);
+    last = size - ((off_t) i << S_EDIT_BUF_SIZE);
+    first = MAX (last - EDIT_BUF_SIZE, buf->curs1);
+    before = (i == 0) ? 0 : g_array_index (buf->lines2, long, i - 1);
+    with = g_array_index (buf->lines2, long, i);
+
+    if (last - offset <= offset - first)
+        return lines1 + lines2 - before - edit_buffer_scan_lines (buf, offset, last);
+    return lines1 + lines2 - with + edit_buffer_scan_lines (buf, first, offset);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find the offset after the @line-th line break with the line index of the gap buffer */
+
+static off_t
+edit_buffer_index_line_offset (const edit_buffer_t * buf, long line)
+{
+    off_t size = buf->curs1 + buf->curs2;
+    long lines1, lines2, before, after;
+    off_t first, last;
+    guint i;
+
+    lines1 = edit_buffer_index_total (buf->lines1);
+    lines2 = edit_buffer_index_total (buf->lines2);
+
+    if (line > lines1 + lines2)
+        return size;
+
+    if (line <= lines1)
+    {
+        i = edit_buffer_index_search (buf->lines1, line);
+        before = (i == 0) ? 0 : g_array_index (buf->lines1, long, i - 1);
+        return edit_buffer_find_newline (buf, (off_t) i << S_EDIT_BUF_SIZE, line - before) + 1;
+    }
+
+    /* the buffers of b2 are summed up from the end */
+    after = lines1 + lines2 - line;
+    i = edit_buffer_index_search (buf->lines2, after + 1);
+    before = (i == 0) ? 0 : g_array_index (buf->lines2, long, i - 1);
+    last = size - ((off_t) i << S_EDIT_BUF_SIZE);
+    first = MAX (last - EDIT_BUF_SIZE, buf->curs1);
+
+    return edit_buffer_find_newline (buf, first,
+                                     g_array_index (buf->lines2, long, i) - after) + 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline gboolean
+edit_buffer_has_index (const edit_buffer_t * buf)
+{
+    if (buf->pieces != NULL)
+        return !edit_buffer_lines_pending (buf);
+
+    return (buf->lines1 != NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Count the line breaks before @offset, the buffer must have its line index */
+
+static long
+edit_buffer_lines_before (const edit_buffer_t * buf, off_t offset)
+{
+    if (buf->pieces != NULL)
+        return edit_pieces_count_lines (buf->pieces, 0, offset);
+
+    return edit_buffer_index_lines_before (buf, offset);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find the beginning of a line, the buffer must have its line index */
+
+static off_t
+edit_buffer_line_offset (const edit_buffer_t * buf, long line)
+{
+    if (line <= 0)
+        return 0;
+
+    if (buf->pieces != NULL)
+        return edit_pieces_line_offset (buf->pieces, line);
+
+    return edit_buffer_index_line_offset (buf, line);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Move the cursor right by @delta bytes: the bytes after the cursor go from b2 to b1 */
+
+static long
+edit_buffer_move_gap_right (edit_buffer_t * buf, off_t delta)
+{
+    long lines = 0;
+
+    for (delta = MIN (delta, buf->curs2); delta > 0;)
+    {
+        off_t i, len;
+        const char *src;
+        char *dst;
+        long n;
+
+        i = buf->curs1 & M_EDIT_BUF_SIZE;
+        if (i == 0)
+        {
+            g_ptr_array_add (buf->b1, edit_buffer_new_page (buf, buf->curs1,
+                                                            buf->curs1 + EDIT_BUF_SIZE - 1));
+            edit_buffer_index_push (buf->lines1);
+        }
+
+        /* bytes of the last buffer of b2 */
+        src = edit_buffer_get_span (buf, buf->curs1, &len);
+        len = MIN (MIN (len, delta), EDIT_BUF_SIZE - i);
+        dst = (char *) g_ptr_array_index (buf->b1, buf->curs1 >> S_EDIT_BUF_SIZE) + i;
+
+        /* the bytes of a piece of the file mapping can be there already */
+        if (dst != src)
+        {
+            dst = edit_buffer_own_last_page (buf, buf->b1) + i;
+            memcpy (dst, src, (size_t) len);
+        }
+        n = (long) count_newlines (dst, (size_t) len);
+        edit_buffer_index_add (buf->lines1, n);
+        edit_buffer_index_add (buf->lines2, -n);
+        lines += n;
+
+        buf->curs1 += len;
+        buf->curs2 -= len;
+        delta -= len;
+
+        /* free the buffer emptied */
+        if ((buf->curs2 & M_EDIT_BUF_SIZE) == 0)
+        {
+            edit_buffer_free_page (g_ptr_array_remove_index (buf->b2, buf->b2->len - 1), buf);
+            edit_buffer_index_pop (buf->lines2);
+        }
+    }
+
+    buf->curs_line += lines;
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Move the cursor left by @delta bytes: the bytes before the cursor go from b1 to b2 */
+
+static long
+edit_buffer_move_gap_left (edit_buffer_t * buf, off_t delta)
+{
+    long lines = 0;
+
+    for (delta = MIN (delta, buf->curs1); delta > 0;)
+    {
+        off_t i, len;
+        const char *src;
+        char *dst;
+        long n;
+
+        i = buf->curs2 & M_EDIT_BUF_SIZE;
+        if (i == 0)
+        {
+            g_ptr_array_add (buf->b2, edit_buffer_new_page (buf, buf->curs1 - EDIT_BUF_SIZE,
+                                                            buf->curs1 - 1));
+            edit_buffer_index_push (buf->lines2);
+        }
+
+        /* bytes of the last buffer of b1 */
+        len = MIN (MIN (((buf->curs1 - 1) & M_EDIT_BUF_SIZE) + 1, delta), EDIT_BUF_SIZE - i);
+        src = edit_buffer_get_byte_ptr (buf, buf->curs1 - len);
+        dst = (char *) g_ptr_array_index (buf->b2, buf->curs2 >> S_EDIT_BUF_SIZE)
+            + EDIT_BUF_SIZE - i - len;
+
+        /* the bytes of a piece of the file mapping can be there already */
+        if (dst != src)
+        {
+            dst = edit_buffer_own_last_page (buf, buf->b2) + EDIT_BUF_SIZE - i - len;
+            memcpy (dst, src, (size_t) len);
+        }
+        n = (long) count_newlines (dst, (size_t) len);
+        edit_buffer_index_add (buf->lines2, n);
+        edit_buffer_index_add (buf->lines1, -n);
+        lines += n;
+
+        buf->curs1 -= len;
+        buf->curs2 += len;
+        delta -= len;
+
+        /* free the buffer emptied */
+        if ((buf->curs1 & M_EDIT_BUF_SIZE) == 0)
+        {
+            edit_buffer_free_page (g_ptr_array_remove_index (buf->b1, buf->b1->len - 1), buf);
+            edit_buffer_index_pop (buf->lines1);
+        }
+    }
+
+    buf->curs_line -= lines;
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Move the cursor in a piece table: nothing is copied, only the lines passed over are counted */
+
+static long
+edit_buffer_pieces_move (edit_buffer_t * buf, off_t delta)
+{
+    off_t to;
+    long lines;
+
+    to = CLAMP (buf->curs1 + delta, 0, buf->size);
+
+    if (to >= buf->curs1)
+    {
+        lines = edit_buffer_count_lines (buf, buf->curs1, to);
+        buf->curs_line += lines;
+    }
+    else
+    {
+        lines = edit_buffer_count_lines (buf, to, buf->curs1);
+        buf->curs_line -= lines;
+    }
+
+    buf->curs2 -= to - buf->curs1;
+    buf->curs1 = to;
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Load file into a piece table, the blocks that are read become its pieces */
+
+static off_t
+edit_buffer_read_pieces (edit_buffer_t * buf, int fd, off_t size,
+                         edit_buffer_read_file_status_msg_t * sm, gboolean * aborted)
+{
+    off_t ret = 0;
+    status_msg_t *s = STATUS_MSG (sm);
+    unsigned short update_cnt = 0;
+
+    while (ret < size)
+    {
+        char *b;
+        off_t sz;
+
+        b = g_malloc (EDIT_BUF_SIZE);
+        sz = mc_read (fd, b, MIN (EDIT_BUF_SIZE, size - ret));
+        if (sz <= 0)
+        {
+            g_free (b);
+            return (ret == 0 ? sz : ret);
+        }
+
+        buf->lines += edit_pieces_append_block (buf->pieces, b, sz);
+        buf->curs2 += sz;
+        ret += sz;
+
+        if (s != NULL && s->update != NULL)
+        {
+            update_cnt = (update_cnt + 1) & 0xf;
+            if (update_cnt == 0)
+            {
+                if (sm->buf == NULL)
+                    sm->buf = buf;
+
+                sm->loaded = ret;
+                if (s->update (s) == B_CANCEL)
+                {
+                    *aborted = TRUE;
+                    return (-1);
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -152,6 +717,34 @@ edit_buffer_init (edit_buffer_t * buf, off_t size)
 
     buf->size = size;
     buf->lines = 0;
+
+    buf->map = NULL;
+    buf->map_size = 0;
+    buf->map_fd = -1;
+    buf->map_mtime = 0;
+    buf->map_counted = 0;
+
+    buf->pieces = NULL;
+
+    buf->lines1 = g_array_new (FALSE, FALSE, sizeof (long));
+    buf->lines2 = g_array_new (FALSE, FALSE, sizeof (long));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Keep the text of an empty buffer in a piece table rather than in the gap buffer.
+ *
+ * @param buf pointer to editor buffer, just initialized
+ */
+
+void
+edit_buffer_use_pieces (edit_buffer_t * buf)
+{
+    if (buf->pieces == NULL)
+        buf->pieces = edit_pieces_new ();
+
+    /* the piece table is its own line index */
+    edit_buffer_index_free (buf);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -166,15 +759,71 @@ edit_buffer_clean (edit_buffer_t * buf)
 {
     if (buf->b1 != NULL)
     {
-        g_ptr_array_foreach (buf->b1, (GFunc) g_free, NULL);
+        g_ptr_array_foreach (buf->b1, edit_buffer_free_page, buf);
         g_ptr_array_free (buf->b1, TRUE);
     }
 
     if (buf->b2 != NULL)
     {
-        g_ptr_array_foreach (buf->b2, (GFunc) g_free, NULL);
+        g_ptr_array_foreach (buf->b2, edit_buffer_free_page, buf);
         g_ptr_array_free (buf->b2, TRUE);
     }
+
+    edit_pieces_free (buf->pieces);
+    buf->pieces = NULL;
+
+    edit_buffer_index_free (buf);
+
+    if (buf->map_fd != -1)
+    {
+        mc_munmap_read ((void *) buf->map, buf->map_size);
+        (void) close (buf->map_fd);
+        buf->map_fd = -1;
+    }
+    else
+        g_free ((char *) buf->map);
+    buf->map = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+  * Get the bytes from specified index on that are contiguous in memory.
+  * Pages of both b1 and b2 keep their bytes in file order, so a span ends at the end of
+  * a page or at the cursor. In a piece table, a span ends at the end of a piece.
+  *
+  * @param buf pointer to editor buffer
+  * @param byte_index byte index
+  * @param len number of bytes in the span
+  *
+  * @return NULL if byte_index is negative or larger than file size; pointer to byte otherwise.
+  */
+
+const char *
+edit_buffer_get_span (const edit_buffer_t * buf, off_t byte_index, off_t * len)
+{
+    const char *p;
+
+    if (buf->pieces != NULL)
+    {
+        if (byte_index < 0)
+        {
+            *len = 0;
+            return NULL;
+        }
+
+        return edit_pieces_get_span (buf->pieces, byte_index, len);
+    }
+
+    p = edit_buffer_get_byte_ptr (buf, byte_index);
+
+    if (p == NULL)
+        *len = 0;
+    else if (byte_index >= buf->curs1)
+        *len = ((buf->curs1 + buf->curs2 - byte_index - 1) & M_EDIT_BUF_SIZE) + 1;
+    else
+        *len = MIN (EDIT_BUF_SIZE - (byte_index & M_EDIT_BUF_SIZE), buf->curs1 - byte_index);
+
+    return p;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -216,6 +865,7 @@ int
 edit_buffer_get_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length)
 {
     gchar *str = NULL;
+    off_t len;
     gunichar res;
     gunichar ch;
     gchar *next_ch = NULL;
@@ -226,14 +876,15 @@ edit_buffer_get_utf (const edit_buffer_t * buf, off_t byte_index, int *char_leng
         return '\n';
     }
 
-    str = edit_buffer_get_byte_ptr (buf, byte_index);
+    str = (gchar *) edit_buffer_get_span (buf, byte_index, &len);
     if (str == NULL)
     {
         *char_length = 0;
         return 0;
     }
 
-    res = g_utf8_get_char_validated (str, -1);
+    /* the span can end at the end of a file mapping */
+    res = g_utf8_get_char_validated (str, (gssize) len);
     if (res == (gunichar) (-2) || res == (gunichar) (-1))
     {
         /* Retry with explicit bytes to make sure it's not a buffer boundary */
@@ -329,16 +980,17 @@ edit_buffer_get_prev_utf (const edit_buffer_t * buf, off_t byte_index, int *char
 long
 edit_buffer_count_lines (const edit_buffer_t * buf, off_t first, off_t last)
 {
-    long lines = 0;
-
     first = MAX (first, 0);
     last = MIN (last, buf->size);
 
-    while (first < last)
-        if (edit_buffer_get_byte (buf, first++) == '\n')
-            lines++;
+    if (first >= last)
+        return 0;
 
-    return lines;
+    /* the bytes of a long range are not scanned */
+    if (last - first > EDIT_BUF_SIZE && edit_buffer_has_index (buf))
+        return edit_buffer_lines_before (buf, last) - edit_buffer_lines_before (buf, first);
+
+    return edit_buffer_scan_lines (buf, first, last);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -354,11 +1006,15 @@ edit_buffer_count_lines (const edit_buffer_t * buf, off_t first, off_t last)
 off_t
 edit_buffer_get_bol (const edit_buffer_t * buf, off_t current)
 {
+    off_t walk;
+
     if (current <= 0)
         return 0;
 
-    for (; edit_buffer_get_byte (buf, current - 1) != '\n'; current--)
-        ;
+    /* the beginning of a long line is looked up in the line index */
+    for (walk = 0; edit_buffer_get_byte (buf, current - 1) != '\n'; current--, walk++)
+        if (walk == EDIT_LINE_WALK && current <= buf->size && edit_buffer_has_index (buf))
+            return edit_buffer_line_offset (buf, edit_buffer_lines_before (buf, current));
 
     return current;
 }
@@ -376,13 +1032,39 @@ edit_buffer_get_bol (const edit_buffer_t * buf, off_t current)
 off_t
 edit_buffer_get_eol (const edit_buffer_t * buf, off_t current)
 {
+    off_t walk = 0;
+
     if (current >= buf->size)
         return buf->size;
 
-    for (; edit_buffer_get_byte (buf, current) != '\n'; current++)
-        ;
+    while (TRUE)
+    {
+        const char *p, *q;
+        off_t len;
+
+        /* the end of a long line is looked up in the line index */
+        if (walk >= EDIT_LINE_WALK && edit_buffer_has_index (buf))
+        {
+            long line;
+
+            line = edit_buffer_lines_before (buf, current) + 1;
+            if (line > edit_buffer_lines_before (buf, buf->size))
+                return buf->size;
+
+            return edit_buffer_line_offset (buf, line) - 1;
+        }
+
+        p = edit_buffer_get_span (buf, current, &len);
+        if (p == NULL)
+            return current;
 
-    return current;
+        q = memchr (p, '\n', (size_t) len);
+        if (q != NULL)
+            return current + (q - p);
+
+        current += len;
+        walk += len;
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -498,15 +1180,27 @@ edit_buffer_insert (edit_buffer_t * buf, int c)
     void *b;
     off_t i;
 
+    if (buf->pieces != NULL)
+    {
+        char ch = (char) c;
+
+        edit_buffer_insert_bytes (buf, &ch, 1);
+        return;
+    }
+
     i = buf->curs1 & M_EDIT_BUF_SIZE;
 
     /* add a new buffer if we've reached the end of the last one */
     if (i == 0)
+    {
         g_ptr_array_add (buf->b1, g_malloc0 (EDIT_BUF_SIZE));
+        edit_buffer_index_push (buf->lines1);
+    }
 
     /* perform the insertion */
-    b = g_ptr_array_index (buf->b1, buf->curs1 >> S_EDIT_BUF_SIZE);
+    b = edit_buffer_own_last_page (buf, buf->b1);
     *((unsigned char *) b + i) = (unsigned char) c;
+    edit_buffer_index_add (buf->lines1, c == '\n' ? 1 : 0);
 
     /* update cursor position */
     buf->curs1++;
@@ -530,15 +1224,27 @@ edit_buffer_insert_ahead (edit_buffer_t * buf, int c)
     void *b;
     off_t i;
 
+    if (buf->pieces != NULL)
+    {
+        char ch = (char) c;
+
+        edit_buffer_insert_bytes_ahead (buf, &ch, 1);
+        return;
+    }
+
     i = buf->curs2 & M_EDIT_BUF_SIZE;
 
     /* add a new buffer if we've reached the end of the last one */
     if (i == 0)
+    {
         g_ptr_array_add (buf->b2, g_malloc0 (EDIT_BUF_SIZE));
+        edit_buffer_index_push (buf->lines2);
+    }
 
     /* perform the insertion */
-    b = g_ptr_array_index (buf->b2, buf->curs2 >> S_EDIT_BUF_SIZE);
+    b = edit_buffer_own_last_page (buf, buf->b2);
     *((unsigned char *) b + EDIT_BUF_SIZE - 1 - i) = (unsigned char) c;
+    edit_buffer_index_add (buf->lines2, c == '\n' ? 1 : 0);
 
     /* update cursor position */
     buf->curs2++;
@@ -564,6 +1270,13 @@ edit_buffer_delete (edit_buffer_t * buf)
     off_t prev;
     off_t i;
 
+    if (buf->pieces != NULL)
+    {
+        c = (unsigned char) edit_buffer_get_current_byte (buf);
+        edit_buffer_delete_range (buf, 1);
+        return c;
+    }
+
     prev = buf->curs2 - 1;
 
     b = g_ptr_array_index (buf->b2, prev >> S_EDIT_BUF_SIZE);
@@ -577,8 +1290,11 @@ edit_buffer_delete (edit_buffer_t * buf)
         j = buf->b2->len - 1;
         b = g_ptr_array_index (buf->b2, j);
         g_ptr_array_remove_index (buf->b2, j);
-        g_free (b);
+        edit_buffer_free_page (b, buf);
+        edit_buffer_index_pop (buf->lines2);
     }
+    else
+        edit_buffer_index_add (buf->lines2, c == '\n' ? -1 : 0);
 
     buf->curs2 = prev;
 
@@ -605,6 +1321,15 @@ edit_buffer_backspace (edit_buffer_t * buf)
     off_t prev;
     off_t i;
 
+    if (buf->pieces != NULL)
+    {
+        c = (unsigned char) edit_buffer_get_previous_byte (buf);
+        edit_pieces_delete (buf->pieces, buf->curs1 - 1, 1);
+        buf->curs1--;
+        buf->size--;
+        return c;
+    }
+
     prev = buf->curs1 - 1;
 
     b = g_ptr_array_index (buf->b1, prev >> S_EDIT_BUF_SIZE);
@@ -618,8 +1343,11 @@ edit_buffer_backspace (edit_buffer_t * buf)
         j = buf->b1->len - 1;
         b = g_ptr_array_index (buf->b1, j);
         g_ptr_array_remove_index (buf->b1, j);
-        g_free (b);
+        edit_buffer_free_page (b, buf);
+        edit_buffer_index_pop (buf->lines1);
     }
+    else
+        edit_buffer_index_add (buf->lines1, c == '\n' ? -1 : 0);
 
     buf->curs1 = prev;
 
@@ -629,6 +1357,193 @@ edit_buffer_backspace (edit_buffer_t * buf)
     return c;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Move the cursor by a number of bytes. The bytes passed over are copied between b1 and b2
+ * by pieces as large as the buffers allow, and the line of the cursor is updated.
+ *
+ * @param buf pointer to editor buffer
+ * @param delta number of bytes, the cursor moves right if it is positive and left if it is
+ *              negative, but not beyond the file bounds
+ *
+ * @return number of lines the cursor has moved by
+ */
+
+long
+edit_buffer_move_gap (edit_buffer_t * buf, off_t delta)
+{
+    if (buf->pieces != NULL)
+        return edit_buffer_pieces_move (buf, delta);
+
+    return (delta < 0) ? edit_buffer_move_gap_left (buf, -delta)
+        : edit_buffer_move_gap_right (buf, delta);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Insert a block of bytes at the cursor position and move right, like edit_buffer_insert() does
+ * for each byte.
+ *
+ * @param buf pointer to editor buffer
+ * @param data bytes to insert
+ * @param len number of bytes
+ *
+ * @return number of lines inserted
+ */
+
+long
+edit_buffer_insert_bytes (edit_buffer_t * buf, const char *data, off_t len)
+{
+    long lines = 0;
+
+    if (buf->pieces != NULL)
+    {
+        lines = edit_pieces_insert (buf->pieces, buf->curs1, data, len);
+        buf->curs1 += len;
+        buf->size += len;
+        return lines;
+    }
+
+    while (len > 0)
+    {
+        off_t i, n;
+        char *dst;
+        long nl;
+
+        i = buf->curs1 & M_EDIT_BUF_SIZE;
+        if (i == 0)
+        {
+            g_ptr_array_add (buf->b1, g_malloc0 (EDIT_BUF_SIZE));
+            edit_buffer_index_push (buf->lines1);
+        }
+
+        n = MIN (len, EDIT_BUF_SIZE - i);
+        dst = edit_buffer_own_last_page (buf, buf->b1) + i;
+
+        memcpy (dst, data, (size_t) n);
+        nl = (long) count_newlines (dst, (size_t) n);
+        edit_buffer_index_add (buf->lines1, nl);
+        lines += nl;
+
+        buf->curs1 += n;
+        buf->size += n;
+        data += n;
+        len -= n;
+    }
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Insert a block of bytes at the cursor position and stay before them, like
+ * edit_buffer_insert_ahead() does for each byte from the last one to the first one.
+ *
+ * @param buf pointer to editor buffer
+ * @param data bytes to insert
+ * @param len number of bytes
+ *
+ * @return number of lines inserted
+ */
+
+long
+edit_buffer_insert_bytes_ahead (edit_buffer_t * buf, const char *data, off_t len)
+{
+    long lines = 0;
+
+    if (buf->pieces != NULL)
+    {
+        lines = edit_pieces_insert (buf->pieces, buf->curs1, data, len);
+        buf->curs2 += len;
+        buf->size += len;
+        return lines;
+    }
+
+    while (len > 0)
+    {
+        off_t i, n;
+        char *dst;
+        long nl;
+
+        i = buf->curs2 & M_EDIT_BUF_SIZE;
+        if (i == 0)
+        {
+            g_ptr_array_add (buf->b2, g_malloc0 (EDIT_BUF_SIZE));
+            edit_buffer_index_push (buf->lines2);
+        }
+
+        /* the last bytes go first */
+        n = MIN (len, EDIT_BUF_SIZE - i);
+        dst = edit_buffer_own_last_page (buf, buf->b2) + EDIT_BUF_SIZE - i - n;
+
+        memcpy (dst, data + len - n, (size_t) n);
+        nl = (long) count_newlines (dst, (size_t) n);
+        edit_buffer_index_add (buf->lines2, nl);
+        lines += nl;
+
+        buf->curs2 += n;
+        buf->size += n;
+        len -= n;
+    }
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Delete a block of bytes at the cursor position, like edit_buffer_delete() does for each byte.
+ *
+ * @param buf pointer to editor buffer
+ * @param len number of bytes, no more than there are after the cursor are deleted
+ *
+ * @return number of lines deleted
+ */
+
+long
+edit_buffer_delete_range (edit_buffer_t * buf, off_t len)
+{
+    long lines = 0;
+
+    len = MIN (len, buf->curs2);
+
+    if (buf->pieces != NULL)
+    {
+        if (len > 0)
+        {
+            lines = edit_pieces_delete (buf->pieces, buf->curs1, len);
+            buf->curs2 -= len;
+            buf->size -= len;
+        }
+        return lines;
+    }
+
+    for (; len > 0;)
+    {
+        const char *p;
+        off_t n;
+        long nl;
+
+        p = edit_buffer_get_span (buf, buf->curs1, &n);
+        n = MIN (n, len);
+        nl = (long) count_newlines (p, (size_t) n);
+        edit_buffer_index_add (buf->lines2, -nl);
+        lines += nl;
+
+        buf->curs2 -= n;
+        buf->size -= n;
+        len -= n;
+
+        /* free the buffer emptied */
+        if ((buf->curs2 & M_EDIT_BUF_SIZE) == 0)
+        {
+            edit_buffer_free_page (g_ptr_array_remove_index (buf->b2, buf->b2->len - 1), buf);
+            edit_buffer_index_pop (buf->lines2);
+        }
+    }
+
+    return lines;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Calculate forward offset with specified number of lines.
@@ -651,6 +1566,18 @@ edit_buffer_get_forward_offset (const edit_buffer_t * buf, off_t current, long l
 
     lines = MAX (lines, 0);
 
+    /* far lines are looked up in the line index */
+    if (lines > EDIT_LINE_JUMP && current >= 0 && current <= buf->size
+        && edit_buffer_has_index (buf))
+    {
+        long line, last;
+
+        line = edit_buffer_lines_before (buf, current);
+        last = edit_buffer_lines_before (buf, buf->size);
+
+        return (line == last) ? current : edit_buffer_line_offset (buf, MIN (line + lines, last));
+    }
+
     while (lines-- != 0)
     {
         long next;
@@ -679,6 +1606,17 @@ off_t
 edit_buffer_get_backward_offset (const edit_buffer_t * buf, off_t current, long lines)
 {
     lines = MAX (lines, 0);
+
+    /* far lines are looked up in the line index */
+    if (lines > EDIT_LINE_JUMP && current >= 0 && current <= buf->size
+        && edit_buffer_has_index (buf))
+    {
+        long line;
+
+        line = edit_buffer_lines_before (buf, current) - lines;
+        return edit_buffer_line_offset (buf, MAX (line, 0));
+    }
+
     current = edit_buffer_get_bol (buf, current);
 
     while (lines-- != 0 && current != 0)
@@ -712,6 +1650,16 @@ edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
     *aborted = FALSE;
 
     buf->lines = 0;
+
+    if (buf->pieces != NULL)
+    {
+        buf->curs2 = 0;
+        return edit_buffer_read_pieces (buf, fd, size, sm, aborted);
+    }
+
+    /* the line index is built when the buffers are complete */
+    edit_buffer_index_free (buf);
+
     buf->curs2 = size;
     i = buf->curs2 >> S_EDIT_BUF_SIZE;
 
@@ -799,9 +1747,203 @@ edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
         }
     }
 
+    if (ret == size)
+        edit_buffer_index_build (buf);
+
     return ret;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Load file into editor buffer lazily. The whole buffers are pieces of a read-only mapping of
+ * the file that are copied only when they are modified, and the lines are counted later by
+ * edit_buffer_count_file_lines().
+ *
+ * The mapping survives the truncation of the file, and the buffer keeps a descriptor of the file
+ * to see whether it changes: see edit_buffer_map_changed().
+ *
+ * @param buf pointer to editor buffer
+ * @param fd descriptor of a local file, the buffer keeps a duplicate of it
+ * @param size file size
+ *
+ * @return TRUE on success, FALSE if the file cannot be mapped
+ */
+
+gboolean
+edit_buffer_map_file (edit_buffer_t * buf, int fd, off_t size)
+{
+    struct stat st;
+    void *data;
+    int map_fd;
+    off_t p;
+
+    if (size <= 0 || (uintmax_t) size > SIZE_MAX || fstat (fd, &st) == -1)
+        return FALSE;
+
+    map_fd = dup (fd);
+    if (map_fd == -1)
+        return FALSE;
+
+    data = mc_mmap_read (fd, (size_t) size, FALSE);
+    if (data == NULL)
+    {
+        (void) close (map_fd);
+        return FALSE;
+    }
+
+    buf->map = (const char *) data;
+    buf->map_size = (size_t) size;
+    buf->map_fd = map_fd;
+    buf->map_mtime = st.st_mtime;
+    buf->map_counted = 0;
+
+    buf->lines = 0;
+    buf->curs2 = size;
+
+    /* a piece table takes the pieces in order and counts nothing yet */
+    if (buf->pieces != NULL)
+    {
+        edit_pieces_append_uncounted (buf->pieces, (const char *) data, size);
+        return TRUE;
+    }
+
+    /* the line index is built when the lines are counted */
+    edit_buffer_index_free (buf);
+
+    /* b2 takes the pieces of the mapping from the end of the file to the beginning... */
+    for (p = size; p >= EDIT_BUF_SIZE; p -= EDIT_BUF_SIZE)
+        g_ptr_array_add (buf->b2, (char *) data + p - EDIT_BUF_SIZE);
+
+    /* ...and the beginning itself that is shorter than a buffer */
+    if (p != 0)
+    {
+        char *b;
+
+        b = g_malloc0 (EDIT_BUF_SIZE);
+        memcpy (b + EDIT_BUF_SIZE - p, data, (size_t) p);
+        g_ptr_array_add (buf->b2, b);
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the file loaded by edit_buffer_map_file() has been changed by another program.
+ * The text that is still in the mapping is not the text that was loaded then: the pages of
+ * a truncated file read as zeros, and the pages that are written in place show the new bytes.
+ *
+ * @param buf pointer to editor buffer
+ *
+ * @return TRUE if the file has been changed, truncated or removed
+ */
+
+gboolean
+edit_buffer_map_changed (const edit_buffer_t * buf)
+{
+    struct stat st;
+
+    if (buf->map_fd == -1)
+        return FALSE;
+
+    if (mc_mmap_read_faulted (buf->map))
+        return TRUE;
+
+    return (fstat (buf->map_fd, &st) == -1 || st.st_size != (off_t) buf->map_size
+            || st.st_mtime != buf->map_mtime);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Copy the text that is still in the mapping of the file to memory of its own, so that the text
+ * does not change with the file anymore.
+ *
+ * @param buf pointer to editor buffer
+ *
+ * @return FALSE if there is not enough memory, the mapping is kept then
+ */
+
+gboolean
+edit_buffer_map_detach (edit_buffer_t * buf)
+{
+    char *copy;
+    guint i;
+
+    if (buf->map_fd == -1)
+        return TRUE;
+
+    copy = g_try_malloc (buf->map_size);
+    if (copy == NULL)
+        return FALSE;
+
+    memcpy (copy, buf->map, buf->map_size);
+
+    if (buf->pieces != NULL)
+        edit_pieces_rebase (buf->pieces, buf->map, (off_t) buf->map_size, copy);
+
+    for (i = 0; i < buf->b1->len; i++)
+        if (edit_buffer_is_mapped (buf, g_ptr_array_index (buf->b1, i)))
+            g_ptr_array_index (buf->b1, i) =
+                copy + ((const char *) g_ptr_array_index (buf->b1, i) - buf->map);
+
+    for (i = 0; i < buf->b2->len; i++)
+        if (edit_buffer_is_mapped (buf, g_ptr_array_index (buf->b2, i)))
+            g_ptr_array_index (buf->b2, i) =
+                copy + ((const char *) g_ptr_array_index (buf->b2, i) - buf->map);
+
+    mc_munmap_read ((void *) buf->map, buf->map_size);
+    (void) close (buf->map_fd);
+    buf->map_fd = -1;
+    buf->map = copy;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count the lines of a file loaded by edit_buffer_map_file(). The count is added to the number of
+ * lines of the buffer, so it does not matter if the buffer has been modified meanwhile.
+ * The line index is built when all lines are counted.
+ *
+ * @param buf pointer to editor buffer
+ * @param all count all the lines that are left rather than a piece of them
+ *
+ * @return TRUE if there are more lines to count
+ */
+
+gboolean
+edit_buffer_count_file_lines (edit_buffer_t * buf, gboolean all)
+{
+    size_t len;
+
+    if (!edit_buffer_lines_pending (buf))
+        return FALSE;
+
+    len = buf->map_size - buf->map_counted;
+    if (!all)
+        len = MIN (len, EDIT_COUNT_LINES_STEP);
+
+    if (buf->pieces != NULL)
+    {
+        off_t counted;
+
+        buf->lines += edit_pieces_count_uncounted (buf->pieces, (off_t) len, &counted);
+        len = (size_t) counted;
+    }
+    else
+        buf->lines += (long) count_newlines (buf->map + buf->map_counted, len);
+
+    buf->map_counted += len;
+
+    if (edit_buffer_lines_pending (buf))
+        return TRUE;
+
+    if (buf->pieces == NULL)
+        edit_buffer_index_build (buf);
+
+    return FALSE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Write editor buffer content to file
@@ -820,6 +1962,24 @@ edit_buffer_write_file (edit_buffer_t * buf, int fd)
     off_t data_size, sz;
     void *b;
 
+    /* write the pieces in order */
+    if (buf->pieces != NULL)
+    {
+        for (i = 0; i < buf->size; i += data_size)
+        {
+            b = (void *) edit_buffer_get_span (buf, i, &data_size);
+            sz = mc_write (fd, b, data_size);
+            if (sz >= 0)
+                ret += sz;
+            else if (i == 0)
+                ret = sz;
+            if (sz != data_size)
+                break;
+        }
+
+        return ret;
+    }
+
     /* write all fulfilled parts of b1 from begin to end */
     if (buf->b1->len != 0)
     {
@@ -876,6 +2036,38 @@ edit_buffer_write_file (edit_buffer_t * buf, int fd)
     return ret;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the text as spans of memory, in the order of the text. The spans of a piece table stay
+ * valid until the buffer is cleaned, the others only until the next change.
+ *
+ * @param buf pointer to editor buffer
+ *
+ * @return array of struct iovec
+ */
+
+GArray *
+edit_buffer_get_spans (const edit_buffer_t * buf)
+{
+    GArray *spans;
+    off_t i, len;
+
+    spans = g_array_new (FALSE, FALSE, sizeof (struct iovec));
+
+    for (i = 0; i < buf->size; i += len)
+    {
+        struct iovec span;
+
+        span.iov_base = (void *) edit_buffer_get_span (buf, i, &len);
+        if (span.iov_base == NULL)
+            break;
+        span.iov_len = (size_t) len;
+        g_array_append_val (spans, span);
+    }
+
+    return spans;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Calculate percentage of specified character offset
@@ -20,6 +20,14 @@ typedef struct edit_buffer_struct
     off_t size;                 /* file size */
     long lines;                 /* total lines in the file */
     long curs_line;             /* line number of the cursor. */
+    const char *map;            /* read-only mapping of a lazily loaded file, or NULL */
+    size_t map_size;
+    int map_fd;                 /* the mapped file, or -1 if map is a copy of its own */
+    time_t map_mtime;           /* modification time of the mapped file */
+    size_t map_counted;         /* the lines of the mapping before this offset are counted */
+    struct edit_pieces_struct *pieces;  /* the text is kept in a piece table rather than in b1/b2 */
+    GArray *lines1;             /* line breaks in each buffer of b1 and in those before it */
+    GArray *lines2;             /* line breaks in each buffer of b2 and in those before it */
 } edit_buffer_t;
 
 typedef struct edit_buffer_read_file_status_msg_struct
@@ -36,9 +44,11 @@ typedef struct edit_buffer_read_file_status_msg_struct
 /*** declarations of public functions ************************************************************/
 
 void edit_buffer_init (edit_buffer_t * buf, off_t size);
+void edit_buffer_use_pieces (edit_buffer_t * buf);
 void edit_buffer_clean (edit_buffer_t * buf);
 
 int edit_buffer_get_byte (const edit_buffer_t * buf, off_t byte_index);
+const char *edit_buffer_get_span (const edit_buffer_t * buf, off_t byte_index, off_t * len);
 #ifdef HAVE_CHARSET
 int edit_buffer_get_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length);
 int edit_buffer_get_prev_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length);
@@ -55,6 +65,10 @@ void edit_buffer_insert (edit_buffer_t * buf, int c);
 void edit_buffer_insert_ahead (edit_buffer_t * buf, int c);
 int edit_buffer_delete (edit_buffer_t * buf);
 int edit_buffer_backspace (edit_buffer_t * buf);
+long edit_buffer_move_gap (edit_buffer_t * buf, off_t delta);
+long edit_buffer_insert_bytes (edit_buffer_t * buf, const char *data, off_t len);
+long edit_buffer_insert_bytes_ahead (edit_buffer_t * buf, const char *data, off_t len);
+long edit_buffer_delete_range (edit_buffer_t * buf, off_t len);
 
 off_t edit_buffer_get_forward_offset (const edit_buffer_t * buf, off_t current, long lines,
                                       off_t upto);
@@ -62,12 +76,33 @@ off_t edit_buffer_get_backward_offset (const edit_buffer_t * buf, off_t current,
 
 off_t edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
                              edit_buffer_read_file_status_msg_t * sm, gboolean * aborted);
+gboolean edit_buffer_map_file (edit_buffer_t * buf, int fd, off_t size);
+gboolean edit_buffer_map_changed (const edit_buffer_t * buf);
+gboolean edit_buffer_map_detach (edit_buffer_t * buf);
+gboolean edit_buffer_count_file_lines (edit_buffer_t * buf, gboolean all);
 off_t edit_buffer_write_file (edit_buffer_t * buf, int fd);
+GArray *edit_buffer_get_spans (const edit_buffer_t * buf);
 
 int edit_buffer_calc_percent (const edit_buffer_t * buf, off_t offset);
 
 /*** inline functions ****************************************************************************/
 
+/**
+ * Check whether the lines of a lazily loaded file are not counted yet.
+ *
+ * @param buf editor buffer
+ *
+ * @return TRUE if edit_buffer_count_file_lines() has more to do
+ */
+
+static inline gboolean
+edit_buffer_lines_pending (const edit_buffer_t * buf)
+{
+    return (buf->map_counted < buf->map_size);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static inline int
 edit_buffer_get_current_byte (const edit_buffer_t * buf)
 {
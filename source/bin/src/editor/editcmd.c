@@ -70,6 +70,7 @@
 #include "edit-impl.h"
 #include "editwidget.h"
 #include "editsearch.h"
+#include "editwriter.h"
 #include "etags.h"
 
 /*** global variables ****************************************************************************/
@@ -80,6 +81,9 @@ int search_create_bookmark = FALSE;
 /* queries on a save */
 gboolean edit_confirm_save = TRUE;
 
+/* flush the saved file to the disk */
+gboolean option_save_sync = FALSE;
+
 /* whether we need to drop selection on copy to buffer */
 gboolean option_drop_selection_on_copy = TRUE;
 
@@ -89,8 +93,21 @@ gboolean option_drop_selection_on_copy = TRUE;
 
 #define TEMP_BUF_LEN 1024
 
+/* how long an idle step waits for a file that is written in the background */
+#define EDIT_SAVE_WAIT_INTERVAL (G_USEC_PER_SEC / 100)  /* 10 ms */
+
 /*** file scope type declarations ****************************************************************/
 
+/* a file that is written in the background, and where it goes then */
+struct edit_save_struct
+{
+    edit_writer_t *writer;
+    vfs_path_t *real_filename_vpath;
+    vfs_path_t *savename_vpath;
+    int save_mode;
+    off_t size;
+};
+
 /*** file scope variables ************************************************************************/
 
 static unsigned long edit_save_mode_radio_id, edit_save_mode_input_id;
@@ -120,6 +137,39 @@ edit_save_mode_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Make a backup of the file if it is asked for, and replace the file by the written one */
+
+static gboolean
+edit_save_put_in_place (const vfs_path_t * real_filename_vpath,
+                        const vfs_path_t * savename_vpath, int this_save_mode)
+{
+    if (this_save_mode == EDIT_DO_BACKUP)
+    {
+        char *tmp_store_filename;
+        vfs_path_element_t *last_vpath_element;
+        vfs_path_t *tmp_vpath;
+        gboolean ok;
+
+        g_assert (option_backup_ext != NULL);
+
+        /* add backup extension to the path */
+        tmp_vpath = vfs_path_clone (real_filename_vpath);
+        last_vpath_element = (vfs_path_element_t *) vfs_path_get_by_index (tmp_vpath, -1);
+        tmp_store_filename = last_vpath_element->path;
+        last_vpath_element->path = g_strdup_printf ("%s%s", tmp_store_filename, option_backup_ext);
+        g_free (tmp_store_filename);
+
+        ok = (mc_rename (real_filename_vpath, tmp_vpath) != -1);
+        vfs_path_free (tmp_vpath, TRUE);
+        if (!ok)
+            return FALSE;
+    }
+
+    return (this_save_mode == EDIT_QUICK_SAVE
+            || mc_rename (savename_vpath, real_filename_vpath) != -1);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 /*  If 0 (quick save) then  a) create/truncate <filename> file,
@@ -128,7 +178,9 @@ edit_save_mode_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm
    b) rename <tempnam> to <filename>;
    if 2 (do backups) then  a) save to <tempnam>,
    b) rename <filename> to <filename.backup_ext>,
-   c) rename <tempnam> to <filename>. */
+   c) rename <tempnam> to <filename>.
+   The text of a piece table is written to a local file in the background, and the renames are
+   done by edit_save_finish() when it is written. */
 
 /* returns 0 on error, -1 on abort */
 
@@ -145,6 +197,9 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
     const vfs_path_element_t *vpath_element;
     struct stat sb;
 
+    /* the previous save must be in place before the file is looked at */
+    edit_save_finish (edit, TRUE);
+
     vpath_element = vfs_path_get_by_index (filename_vpath, 0);
     if (vpath_element == NULL)
         return 0;
@@ -176,6 +231,12 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
             mc_close (fd);
     }
 
+    /* A lazily loaded file is read while it is written, so it must not be truncated:
+       the new contents go to another file that replaces it. */
+    if (this_save_mode == EDIT_QUICK_SAVE && edit->buffer.map_fd != -1
+        && vfs_file_is_local (real_filename_vpath))
+        this_save_mode = EDIT_SAFE_SAVE;
+
     rv = mc_stat (real_filename_vpath, &sb);
     if (rv == 0)
     {
@@ -285,6 +346,48 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
         }
         g_free (p);
     }
+    else if (edit->lb == LB_ASIS && vfs_file_is_local (savename_vpath))
+    {                           /* do not change line breaks, write many spans at once */
+        const vfs_path_element_t *path_element;
+        GArray *spans;
+        int error;
+
+        mc_close (fd);
+
+        path_element = vfs_path_get_by_index (savename_vpath, -1);
+        fd = open (path_element->path, O_WRONLY | O_BINARY);
+        if (fd == -1)
+            goto error_save;
+
+        spans = edit_buffer_get_spans (&edit->buffer);
+
+        /* the spans of a piece table do not change, the user can go on while they are written */
+        if (edit->buffer.pieces != NULL)
+        {
+            struct edit_save_struct *save;
+
+            save = g_new (struct edit_save_struct, 1);
+            save->writer = edit_writer_start (fd, spans, option_save_sync);
+            save->real_filename_vpath = real_filename_vpath;
+            save->savename_vpath = savename_vpath;
+            save->save_mode = this_save_mode;
+            save->size = edit->buffer.size;
+            edit->save = save;
+
+            widget_idle (WIDGET (WIDGET (edit)->owner), TRUE);
+            return 1;
+        }
+
+        filelen = edit_writer_write (fd, spans, option_save_sync, &error);
+        g_array_free (spans, TRUE);
+
+        if (close (fd) != 0 || filelen != edit->buffer.size)
+            goto error_save;
+
+        /* Update the file information, especially the mtime. */
+        if (mc_stat (savename_vpath, &edit->stat1) == -1)
+            goto error_save;
+    }
     else if (edit->lb == LB_ASIS)
     {                           /* do not change line breaks */
         filelen = edit_buffer_write_file (&edit->buffer, fd);
@@ -330,29 +433,7 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
     if (filelen != edit->buffer.size)
         goto error_save;
 
-    if (this_save_mode == EDIT_DO_BACKUP)
-    {
-        char *tmp_store_filename;
-        vfs_path_element_t *last_vpath_element;
-        vfs_path_t *tmp_vpath;
-        gboolean ok;
-
-        g_assert (option_backup_ext != NULL);
-
-        /* add backup extension to the path */
-        tmp_vpath = vfs_path_clone (real_filename_vpath);
-        last_vpath_element = (vfs_path_element_t *) vfs_path_get_by_index (tmp_vpath, -1);
-        tmp_store_filename = last_vpath_element->path;
-        last_vpath_element->path = g_strdup_printf ("%s%s", tmp_store_filename, option_backup_ext);
-        g_free (tmp_store_filename);
-
-        ok = (mc_rename (real_filename_vpath, tmp_vpath) != -1);
-        vfs_path_free (tmp_vpath, TRUE);
-        if (!ok)
-            goto error_save;
-    }
-
-    if (this_save_mode != EDIT_QUICK_SAVE && mc_rename (savename_vpath, real_filename_vpath) == -1)
+    if (!edit_save_put_in_place (real_filename_vpath, savename_vpath, this_save_mode))
         goto error_save;
 
     vfs_path_free (real_filename_vpath, TRUE);
@@ -534,7 +615,7 @@ edit_block_delete (WEdit * edit)
         edit_mark_cmd (edit, FALSE);
 
     /* Warning message with a query to continue or cancel the operation */
-    if ((end_mark - start_mark) > option_max_undo / 2 &&
+    if (!option_undo_spill && (end_mark - start_mark) > (off_t) option_max_undo * 1024 / 2 &&
         edit_query_dialog2 (_("Warning"),
                             ("Block is large, you may not be able to undo this action"),
                             _("C&ontinue"), _("&Cancel")) != 0)
@@ -573,12 +654,7 @@ edit_block_delete (WEdit * edit)
                 edit->over_col = curs_pos - line_width;
         }
         else
-        {
-            off_t count;
-
-            for (count = start_mark; count < end_mark; count++)
-                edit_delete (edit, TRUE);
-        }
+            edit_delete_block (edit, end_mark - start_mark);
     }
 
     edit_set_markers (edit, 0, 0, 0, 0);
@@ -877,6 +953,7 @@ edit_save_mode_cmd (void)
                          &edit_save_mode_input_id, FALSE, FALSE, INPUT_COMPLETE_NONE),
             QUICK_SEPARATOR (TRUE),
             QUICK_CHECKBOX (N_("Check &POSIX new line"), &option_check_nl_at_eof, NULL),
+            QUICK_CHECKBOX (N_("S&ync the file to disk"), &option_save_sync, NULL),
             QUICK_BUTTONS_OK_CANCEL,
             QUICK_END
             /* *INDENT-ON* */
@@ -896,6 +973,84 @@ edit_save_mode_cmd (void)
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Put the file that is written in the background in place when it is written.
+ *
+ * @param edit editor object
+ * @param wait wait until the file is written
+ *
+ * @return TRUE if the file is still written
+ */
+
+gboolean
+edit_save_finish (WEdit * edit, gboolean wait)
+{
+    struct edit_save_struct *save = edit->save;
+    gint64 end_time;
+    off_t written;
+    int error;
+
+    if (save == NULL)
+        return FALSE;
+
+    end_time = wait ? -1 : g_get_monotonic_time () + EDIT_SAVE_WAIT_INTERVAL;
+    if (!edit_writer_wait (save->writer, end_time))
+        return TRUE;
+
+    written = edit_writer_free (save->writer, &error);
+
+    if (error == 0 && written != save->size)
+        error = ENOSPC;
+    if (error == 0)
+    {
+        /* Update the file information, especially the mtime. */
+        if (mc_stat (save->savename_vpath, &edit->stat1) == -1
+            || !edit_save_put_in_place (save->real_filename_vpath, save->savename_vpath,
+                                        save->save_mode))
+            error = errno;
+    }
+
+    if (error != 0)
+    {
+        edit->modified = 1;
+        errno = error;
+        edit_error_dialog (_("Save"), get_sys_error (_("Cannot save file")));
+    }
+
+    vfs_path_free (save->real_filename_vpath, TRUE);
+    vfs_path_free (save->savename_vpath, TRUE);
+    g_free (save);
+    edit->save = NULL;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the progress of the file that is written in the background.
+ *
+ * @param edit editor object
+ *
+ * @return percentage of the written text, or -1 if nothing is written
+ */
+
+int
+edit_save_get_progress (const WEdit * edit)
+{
+    off_t written;
+
+    if (edit->save == NULL)
+        return -1;
+
+    if (edit->save->size == 0)
+        return 100;
+
+    written = edit_writer_get_progress (edit->save->writer);
+
+    return (int) (written * 100 / edit->save->size);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 void
@@ -925,7 +1080,7 @@ edit_save_as_cmd (WEdit * edit)
         return FALSE;
 
     exp_vpath = edit_get_save_file_as (edit);
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
     if (exp_vpath != NULL && vfs_path_len (exp_vpath) != 0)
     {
@@ -1350,14 +1505,11 @@ edit_block_copy_cmd (WEdit * edit)
     }
     else
     {
-        int size_orig = size;
-
-        while (size-- != 0)
-            edit_insert_ahead (edit, copy_buf[size]);
+        edit_insert_block_ahead (edit, (const char *) copy_buf, size);
 
         /* Place cursor at the end of text selection */
         if (option_cursor_after_inserted_block)
-            edit_cursor_move (edit, size_orig);
+            edit_cursor_move (edit, size);
     }
 
     g_free (copy_buf);
@@ -1441,31 +1593,27 @@ edit_block_move_cmd (WEdit * edit)
     }
     else
     {
-        off_t count, count_orig;
+        off_t size;
 
         current = edit->buffer.curs1;
-        copy_buf = g_malloc0 (end_mark - start_mark);
+        copy_buf = edit_get_block (edit, start_mark, end_mark, &size);
         edit_cursor_move (edit, start_mark - edit->buffer.curs1);
         edit_scroll_screen_over_cursor (edit);
 
-        for (count = start_mark; count < end_mark; count++)
-            copy_buf[end_mark - count - 1] = edit_delete (edit, TRUE);
+        edit_delete_block (edit, size);
 
         edit_scroll_screen_over_cursor (edit);
         edit_cursor_move (edit,
                           current - edit->buffer.curs1 -
-                          (((current - edit->buffer.curs1) > 0) ? end_mark - start_mark : 0));
+                          (((current - edit->buffer.curs1) > 0) ? size : 0));
         edit_scroll_screen_over_cursor (edit);
-        count_orig = count;
-        while (count-- > start_mark)
-            edit_insert_ahead (edit, copy_buf[end_mark - count - 1]);
+        edit_insert_block_ahead (edit, (const char *) copy_buf, size);
 
-        edit_set_markers (edit, edit->buffer.curs1, edit->buffer.curs1 + end_mark - start_mark, 0,
-                          0);
+        edit_set_markers (edit, edit->buffer.curs1, edit->buffer.curs1 + size, 0, 0);
 
         /* Place cursor at the end of text selection */
         if (option_cursor_after_inserted_block)
-            edit_cursor_move (edit, count_orig - start_mark);
+            edit_cursor_move (edit, size);
     }
 
     edit_scroll_screen_over_cursor (edit);
@@ -1503,6 +1651,9 @@ edit_ok_to_exit (WEdit * edit)
     char *msg;
     int act;
 
+    /* a file that fails to be written in the background is modified again */
+    edit_save_finish (edit, TRUE);
+
     if (!edit->modified)
         return TRUE;
 
@@ -1749,7 +1900,7 @@ edit_save_block_cmd (WEdit * edit)
         input_expand_dialog (_("Save block"), _("Enter file name:"),
                              MC_HISTORY_EDIT_SAVE_BLOCK, tmp, INPUT_COMPLETE_FILENAMES);
     g_free (tmp);
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
     if (exp != NULL && *exp != '\0')
     {
@@ -1781,7 +1932,7 @@ edit_insert_file_cmd (WEdit * edit)
                                MC_HISTORY_EDIT_INSERT_FILE, tmp, INPUT_COMPLETE_FILENAMES);
     g_free (tmp);
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
     if (exp != NULL && *exp != '\0')
     {
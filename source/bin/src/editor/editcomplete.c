@@ -42,6 +42,7 @@
 #include "editwidget.h"
 #include "edit-impl.h"
 #include "editsearch.h"
+#include "editwords.h"
 
 #include "editcomplete.h"
 
@@ -49,8 +50,22 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* the words this many bytes around the cursor are offered first, the nearest at the top */
+#define EDIT_COMPLETE_NEAR (8 * 1024)
+
+/* the most completions that are taken from a word index */
+#define EDIT_COMPLETE_MAX 1024
+
 /*** file scope type declarations ****************************************************************/
 
+/* a completion that is found in a word index */
+typedef struct
+{
+    GString *word;
+    guint count;                /* occurrences in the text */
+    off_t distance;             /* from the cursor, or -1 if the word is not near it */
+} edit_completion_t;
+
 /*** file scope variables ************************************************************************/
 
 /* --------------------------------------------------------------------------------------------- */
@@ -97,6 +112,76 @@ edit_collect_completions_get_current_word (edit_search_status_msg_t * esm, mc_se
     return temp;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add a completion to the list unless it is there already.
+ *
+ * @return TRUE if the completion is taken by the list
+ */
+
+static gboolean
+edit_collect_completion_add (gboolean active_buffer, GQueue ** compl, GString * temp,
+                             gsize word_len, const GString * current_word, int *max_width)
+{
+    int width;
+
+    if (current_word != NULL && g_string_equal (current_word, temp))
+        return FALSE;
+
+    if (*compl == NULL)
+        *compl = g_queue_new ();
+    else
+    {
+        GList *l;
+
+        for (l = g_queue_peek_head_link (*compl); l != NULL; l = g_list_next (l))
+        {
+            GString *s = (GString *) l->data;
+
+            /* skip if already added */
+            if (strncmp (s->str + word_len, temp->str + word_len,
+                         MAX (temp->len, s->len) - word_len) == 0)
+                break;
+        }
+
+        if (l != NULL)
+        {
+            /* resort completion in main buffer only:
+             * these completions must be at the top of list in the completion dialog */
+            if (!active_buffer && l != g_queue_peek_tail_link (*compl))
+            {
+                /* move to the end */
+                g_queue_unlink (*compl, l);
+                g_queue_push_tail_link (*compl, l);
+            }
+
+            return FALSE;
+        }
+    }
+
+#ifdef HAVE_CHARSET
+    {
+        GString *recoded;
+
+        recoded = str_convert_to_display (temp->str);
+        if (recoded->len != 0)
+            mc_g_string_copy (temp, recoded);
+
+        g_string_free (recoded, TRUE);
+    }
+#endif
+    if (active_buffer)
+        g_queue_push_tail (*compl, temp);
+    else
+        g_queue_push_head (*compl, temp);
+
+    /* note the maximal length needed for the completion dialog */
+    width = str_term_width1 (temp->str);
+    *max_width = MAX (*max_width, width);
+
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * collect the possible completions from one buffer
@@ -115,7 +200,6 @@ edit_collect_completion_from_one_buffer (gboolean active_buffer, GQueue ** compl
     while (mc_search_run (srch, (void *) esm, start + 1, last_byte, &len))
     {
         gsize i;
-        int width;
 
         if (temp == NULL)
             temp = g_string_sized_new (8);
@@ -143,67 +227,176 @@ edit_collect_completion_from_one_buffer (gboolean active_buffer, GQueue ** compl
         if (temp->len == 0)
             continue;
 
-        if (current_word != NULL && g_string_equal (current_word, temp))
-            continue;
-
-        if (*compl == NULL)
-            *compl = g_queue_new ();
-        else
+        if (edit_collect_completion_add (active_buffer, compl, temp, word_len, current_word,
+                                         max_width))
         {
-            GList *l;
+            start += len;
+            temp = NULL;
+        }
+    }
 
-            for (l = g_queue_peek_head_link (*compl); l != NULL; l = g_list_next (l))
-            {
-                GString *s = (GString *) l->data;
+    if (temp != NULL)
+        g_string_free (temp, TRUE);
+}
 
-                /* skip if already added */
-                if (strncmp (s->str + word_len, temp->str + word_len,
-                             MAX (len, s->len) - word_len) == 0)
-                    break;
-            }
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_collect_completion_from_index_cb (const GString * word, guint count, gpointer data)
+{
+    GArray *found = (GArray *) data;
+    edit_completion_t c;
+
+    c.word = mc_g_string_dup (word);
+    c.count = count;
+    c.distance = -1;
+    g_array_append_val (found, c);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** The nearest words first, then the most frequent ones */
+
+static int
+edit_collect_completion_cmp (gconstpointer a, gconstpointer b)
+{
+    const edit_completion_t *ca = (const edit_completion_t *) a;
+    const edit_completion_t *cb = (const edit_completion_t *) b;
+
+    if (ca->distance != cb->distance)
+    {
+        if (ca->distance < 0)
+            return 1;
+        if (cb->distance < 0)
+            return -1;
+        return (ca->distance < cb->distance) ? -1 : 1;
+    }
+
+    if (ca->count != cb->count)
+        return (ca->count > cb->count) ? -1 : 1;
+
+    return strcmp (ca->word->str, cb->word->str);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the completions that are near the cursor.
+ */
+
+static void
+edit_collect_completion_rank_near (const WEdit * edit, GArray * found)
+{
+    const edit_buffer_t *buf = &edit->buffer;
+    GHashTable *words;
+    GString *word;
+    off_t start, end, i;
+    guint k;
+
+    if (found->len == 0)
+        return;
+
+    words = g_hash_table_new (g_str_hash, g_str_equal);
+    for (k = 0; k < found->len; k++)
+    {
+        edit_completion_t *c = &g_array_index (found, edit_completion_t, k);
+
+        g_hash_table_insert (words, c->word->str, c);
+    }
+
+    /* begin and end between the words */
+    start = MAX (buf->curs1 - EDIT_COMPLETE_NEAR, 0);
+    end = MIN (buf->curs1 + EDIT_COMPLETE_NEAR, buf->size);
+    while (start > 0 && start < end
+           && edit_words_is_word_byte (edit_buffer_get_byte (buf, start - 1)))
+        start++;
+    while (end < buf->size && end > start
+           && edit_words_is_word_byte (edit_buffer_get_byte (buf, end)))
+        end--;
 
-            if (l != NULL)
+    word = g_string_sized_new (32);
+
+    for (i = start; i <= end; i++)
+    {
+        int ch;
+
+        ch = (i < end) ? edit_buffer_get_byte (buf, i) : ' ';
+        if (edit_words_is_word_byte (ch))
+            g_string_append_c (word, (char) ch);
+        else if (word->len != 0)
+        {
+            edit_completion_t *c;
+
+            c = (edit_completion_t *) g_hash_table_lookup (words, word->str);
+            if (c != NULL)
             {
-                /* resort completion in main buffer only:
-                 * these completions must be at the top of list in the completion dialog */
-                if (!active_buffer && l != g_queue_peek_tail_link (*compl))
-                {
-                    /* move to the end */
-                    g_queue_unlink (*compl, l);
-                    g_queue_push_tail_link (*compl, l);
-                }
+                off_t distance;
 
-                continue;
+                distance = i - (off_t) word->len - buf->curs1;
+                distance = ABS (distance);
+                if (c->distance < 0 || distance < c->distance)
+                    c->distance = distance;
             }
+
+            g_string_set_size (word, 0);
         }
+    }
 
-#ifdef HAVE_CHARSET
-        {
-            GString *recoded;
+    g_string_free (word, TRUE);
+    g_hash_table_destroy (words);
+}
 
-            recoded = str_convert_to_display (temp->str);
-            if (recoded->len != 0)
-                mc_g_string_copy (temp, recoded);
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Collect the possible completions from the word index of one buffer, it is made at the first
+ * time. The completions are ranked by the distance from the cursor in the active buffer, and by
+ * their frequency.
+ *
+ * @return FALSE if the buffer has too many different words for the index
+ */
 
-            g_string_free (recoded, TRUE);
-        }
-#endif
-        if (active_buffer)
-            g_queue_push_tail (*compl, temp);
-        else
-            g_queue_push_head (*compl, temp);
+static gboolean
+edit_collect_completion_from_index (gboolean active_buffer, GQueue ** compl, WEdit * edit,
+                                    const GString * prefix, const GString * current_word,
+                                    int *max_width)
+{
+    GArray *found;
+    guint i, n;
 
-        start += len;
+    if (edit->words == NULL)
+        edit->words = edit_words_new (&edit->buffer);
 
-        /* note the maximal length needed for the completion dialog */
-        width = str_term_width1 (temp->str);
-        *max_width = MAX (*max_width, width);
+    found = g_array_new (FALSE, FALSE, sizeof (edit_completion_t));
 
-        temp = NULL;
+    if (!edit_words_complete (edit->words, prefix->str, prefix->len,
+                              edit_collect_completion_from_index_cb, found))
+    {
+        g_array_free (found, TRUE);
+        return FALSE;
     }
 
-    if (temp != NULL)
-        g_string_free (temp, TRUE);
+    if (active_buffer)
+        edit_collect_completion_rank_near (edit, found);
+
+    g_array_sort (found, edit_collect_completion_cmp);
+
+    n = MIN (found->len, EDIT_COMPLETE_MAX);
+
+    for (i = 0; i < found->len; i++)
+    {
+        edit_completion_t *c;
+
+        /* the dialog shows the tail of the list first: the active buffer puts the best one there,
+           the other buffers add theirs from the head */
+        c = &g_array_index (found, edit_completion_t, (active_buffer && i < n) ? n - 1 - i : i);
+
+        if (i >= n
+            || !edit_collect_completion_add (active_buffer, compl, c->word, prefix->len,
+                                             current_word, max_width))
+            g_string_free (c->word, TRUE);
+    }
+
+    g_array_free (found, TRUE);
+
+    return TRUE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -218,9 +411,10 @@ edit_collect_completions (WEdit * edit, off_t word_start, gsize word_len,
     GQueue *compl = NULL;
     mc_search_t *srch;
     off_t last_byte;
-    GString *current_word;
+    GString *prefix, *current_word;
     gboolean entire_file, all_files;
     edit_search_status_msg_t esm;
+    gsize i;
 
 #ifdef HAVE_CHARSET
     srch = mc_search_new (match_expr, cp_source);
@@ -239,6 +433,7 @@ edit_collect_completions (WEdit * edit, off_t word_start, gsize word_len,
     srch->search_type = MC_SEARCH_T_REGEX;
     srch->is_case_sensitive = TRUE;
     srch->search_fn = edit_search_cmd_callback;
+    srch->get_span = edit_search_span_callback;
     srch->update_fn = edit_search_update_callback;
 
     esm.first = TRUE;
@@ -250,11 +445,18 @@ edit_collect_completions (WEdit * edit, off_t word_start, gsize word_len,
 
     current_word = edit_collect_completions_get_current_word (&esm, srch, word_start);
 
+    prefix = g_string_sized_new (word_len);
+    for (i = 0; i < word_len; i++)
+        g_string_append_c (prefix, edit_buffer_get_byte (&edit->buffer, word_start + i));
+
     *max_width = 0;
 
-    /* collect completions from current buffer at first */
-    edit_collect_completion_from_one_buffer (TRUE, &compl, srch, &esm, word_start, word_len,
-                                             last_byte, current_word, max_width);
+    /* collect completions from current buffer at first, the word index has all of its words */
+    if (!entire_file
+        || !edit_collect_completion_from_index (TRUE, &compl, edit, prefix, current_word,
+                                                max_width))
+        edit_collect_completion_from_one_buffer (TRUE, &compl, srch, &esm, word_start, word_len,
+                                                 last_byte, current_word, max_width);
 
     /* collect completions from other buffers */
     all_files =
@@ -283,6 +485,10 @@ edit_collect_completions (WEdit * edit, off_t word_start, gsize word_len,
             if (e == edit)
                 continue;
 
+            if (edit_collect_completion_from_index (FALSE, &compl, e, prefix, current_word,
+                                                    max_width))
+                continue;
+
             /* search in entire file */
             word_start = 0;
             last_byte = e->buffer.size;
@@ -298,6 +504,7 @@ edit_collect_completions (WEdit * edit, off_t word_start, gsize word_len,
 
     status_msg_deinit (STATUS_MSG (&esm));
     mc_search_free (srch);
+    g_string_free (prefix, TRUE);
     if (current_word != NULL)
         g_string_free (current_word, TRUE);
 
@@ -473,3 +680,43 @@ edit_complete_word_cmd (WEdit * edit)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Take the words that touch a change out of the word index of the buffer, if it has one.
+ *
+ * @param edit editor object
+ * @param offset where the text changes
+ * @param len number of bytes that are deleted there, 0 for an insertion
+ */
+
+void
+edit_complete_change_begin (WEdit * edit, off_t offset, off_t len)
+{
+    if (edit->words != NULL)
+        edit_words_change_begin (edit->words, &edit->buffer, offset, len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Put the words of the place of a change back into the word index of the buffer.
+ *
+ * @param edit editor object
+ * @param len number of bytes that are inserted
+ */
+
+void
+edit_complete_change_end (WEdit * edit, off_t len)
+{
+    if (edit->words != NULL)
+        edit_words_change_end (edit->words, &edit->buffer, len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+edit_complete_free_words (WEdit * edit)
+{
+    edit_words_free (edit->words);
+    edit->words = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
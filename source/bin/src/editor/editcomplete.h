@@ -16,6 +16,10 @@ char *edit_completion_dialog_show (const WEdit * edit, GQueue * compl, int max_w
 
 void edit_complete_word_cmd (WEdit * edit);
 
+void edit_complete_change_begin (WEdit * edit, off_t offset, off_t len);
+void edit_complete_change_end (WEdit * edit, off_t len);
+void edit_complete_free_words (WEdit * edit);
+
 /*** inline functions ****************************************************************************/
 
 #endif /* MC__EDIT_COMPLETE_H */
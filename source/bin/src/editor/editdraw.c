@@ -102,12 +102,43 @@ printwstr (const char *s, int len)
         tty_printf ("%-*.*s", len, len, s);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Print the number of lines for the status line, it is unknown while it is being counted */
+
+static const char *
+status_lines (const WEdit * edit, char *s, size_t len)
+{
+    if (edit_buffer_lines_pending (&edit->buffer))
+        return "?";
+
+    g_snprintf (s, len, "%ld", edit->buffer.lines + 1);
+    return s;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Print the progress of the file that is written in the background for the status line */
+
+static const char *
+status_save (const WEdit * edit, char *s, size_t len)
+{
+    int percent;
+
+    percent = edit_save_get_progress (edit);
+    if (percent < 0)
+        return "";
+
+    g_snprintf (s, len, " %s:%d%%", _("Save"), percent);
+    return s;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static inline void
 status_string (WEdit * edit, char *s, int w)
 {
     char byte_str[16];
+    char lines_str[BUF_TINY];
+    char save_str[BUF_TINY];
 
     /*
      * If we are at the end of file, print <EOF>,
@@ -145,22 +176,23 @@ status_string (WEdit * edit, char *s, int w)
     /* The field lengths just prevent the status line from shortening too much */
     if (simple_statusbar)
         g_snprintf (s, w,
-                    "%c%c%c%c %3ld %5ld/%ld %6ld/%ld %s %s",
+                    "%c%c%c%c %3ld %5ld/%s %6ld/%ld %s %s%s",
                     edit->mark1 != edit->mark2 ? (edit->column_highlight ? 'C' : 'B') : '-',
                     edit->modified ? 'M' : '-',
                     macro_index < 0 ? '-' : 'R',
                     edit->overwrite == 0 ? '-' : 'O',
                     edit->curs_col + edit->over_col,
                     edit->buffer.curs_line + 1,
-                    edit->buffer.lines + 1, (long) edit->buffer.curs1, (long) edit->buffer.size,
+                    status_lines (edit, lines_str, sizeof (lines_str)), (long) edit->buffer.curs1,
+                    (long) edit->buffer.size,
                     byte_str,
 #ifdef HAVE_CHARSET
                     mc_global.source_codepage >= 0 ? get_codepage_id (mc_global.source_codepage) :
 #endif
-                    "");
+                    "", status_save (edit, save_str, sizeof (save_str)));
     else
         g_snprintf (s, w,
-                    "[%c%c%c%c] %2ld L:[%3ld+%2ld %3ld/%3ld] *(%-4ld/%4ldb) %s  %s",
+                    "[%c%c%c%c] %2ld L:[%3ld+%2ld %3ld/%3s] *(%-4ld/%4ldb) %s  %s%s",
                     edit->mark1 != edit->mark2 ? (edit->column_highlight ? 'C' : 'B') : '-',
                     edit->modified ? 'M' : '-',
                     macro_index < 0 ? '-' : 'R',
@@ -169,12 +201,13 @@ status_string (WEdit * edit, char *s, int w)
                     edit->start_line + 1,
                     edit->curs_row,
                     edit->buffer.curs_line + 1,
-                    edit->buffer.lines + 1, (long) edit->buffer.curs1, (long) edit->buffer.size,
+                    status_lines (edit, lines_str, sizeof (lines_str)), (long) edit->buffer.curs1,
+                    (long) edit->buffer.size,
                     byte_str,
 #ifdef HAVE_CHARSET
                     mc_global.source_codepage >= 0 ? get_codepage_id (mc_global.source_codepage) :
 #endif
-                    "");
+                    "", status_save (edit, save_str, sizeof (save_str)));
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -292,10 +325,12 @@ edit_status_window (WEdit * edit)
 
     if (cols > 30)
     {
+        char lines_str[BUF_TINY];
+
         edit_move (2, w->lines - 1);
-        tty_printf ("%3ld %5ld/%ld %6ld/%ld",
-                    edit->curs_col + edit->over_col,
-                    edit->buffer.curs_line + 1, edit->buffer.lines + 1, (long) edit->buffer.curs1,
+        tty_printf ("%3ld %5ld/%s %6ld/%ld",
+                    edit->curs_col + edit->over_col, edit->buffer.curs_line + 1,
+                    status_lines (edit, lines_str, sizeof (lines_str)), (long) edit->buffer.curs1,
                     (long) edit->buffer.size);
     }
 
@@ -510,6 +545,7 @@ edit_draw_this_line (WEdit * edit, off_t b, long row, long start_col, long end_c
     int abn_style;
     int book_mark = 0;
     char line_stat[LINE_STATE_WIDTH + 1] = "\0";
+    long last_line;
 
     if (row > w->lines - 1 - EDIT_TEXT_VERTICAL_OFFSET - 2 * (edit->fullscreen ? 0 : 1))
         return;
@@ -536,12 +572,15 @@ edit_draw_this_line (WEdit * edit, off_t b, long row, long start_col, long end_c
     col = (int) edit_move_forward3 (edit, b, 0, q);
     start_col_real = col + edit->start_col;
 
+    /* all the rows of the screen are text while the lines are being counted */
+    last_line = edit_buffer_lines_pending (&edit->buffer) ? G_MAXLONG : edit->buffer.lines;
+
     if (option_line_state)
     {
         long cur_line;
 
         cur_line = edit->start_line + row;
-        if (cur_line <= edit->buffer.lines)
+        if (cur_line <= last_line)
             g_snprintf (line_stat, sizeof (line_stat), "%7ld ", cur_line + 1);
         else
         {
@@ -561,7 +600,7 @@ edit_draw_this_line (WEdit * edit, off_t b, long row, long start_col, long end_c
 
         eval_marks (edit, &m1, &m2);
 
-        if (row <= edit->buffer.lines - edit->start_line)
+        if (row <= last_line - edit->start_line)
         {
             off_t tws = 0;
 
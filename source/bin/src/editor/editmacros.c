@@ -168,7 +168,7 @@ edit_store_macro_cmd (WEdit * edit)
     if (macros_config == NULL)
         return FALSE;
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
     skeyname = lookup_key_by_code (hotkey);
 
@@ -351,7 +351,7 @@ edit_repeat_macro_cmd (WEdit * edit)
     {
         int i, j;
 
-        edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+        edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
         edit->force |= REDRAW_PAGE;
 
         for (j = 0; j < count_repeat; j++)
@@ -0,0 +1,750 @@
+/*
+   Editor piece table.
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: editor piece table.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <sys/types.h>
+
+#include "lib/global.h"
+#include "lib/util.h"           /* count_newlines() */
+
+#include "editpieces.h"
+
+/* --------------------------------------------------------------------------------------------- */
+/*-
+ * The text is a sequence of pieces, and every piece refers to bytes that never move: the blocks
+ * of the file that was read, the mapping of the file, or the blocks of the added text. Changes
+ * only split, drop and add pieces, so inserting and deleting take the same time at any offset.
+ *
+ * The pieces are the nodes of a treap ordered by their position in the text. Each node keeps the
+ * number of bytes and of line breaks of its subtree, so finding the piece of an offset, counting
+ * the line breaks before an offset and finding the offset of a line take O(log n) steps. A change
+ * splits the treap at its offsets and merges the parts back.
+ *
+ * The added text is appended to the last block, so the pieces of the bytes that are typed one
+ * after another grow instead of multiplying.
+ *
+ * The line breaks of a mapped file are counted later: its pieces are uncounted until
+ * edit_pieces_count_uncounted() comes to them. A change counts the uncounted pieces it cuts or
+ * deletes at once, and they are left out of the later count. The line breaks of the subtrees are
+ * summed up again when all pieces are counted.
+ */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* the largest piece, and the size of the blocks of the added text */
+#ifndef EDIT_PIECE_SIZE
+#define EDIT_PIECE_SIZE (64 * 1024)
+#endif
+
+#define piece_size(t) ((t) == NULL ? 0 : (t)->size)
+#define piece_lines(t) ((t) == NULL ? 0 : (t)->lines)
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct edit_piece_struct edit_piece_t;
+
+struct edit_piece_struct
+{
+    const char *data;           /* the bytes of the piece */
+    off_t len;
+    long nl;                    /* line breaks of the piece */
+    off_t size;                 /* bytes of the subtree */
+    long lines;                 /* line breaks of the subtree */
+    guint slot;                 /* 1 + place in the uncounted pieces, 0 if nl is counted */
+    guint32 prio;               /* a parent has no lesser priority than its children */
+    edit_piece_t *left;
+    edit_piece_t *right;
+};
+
+struct edit_pieces_struct
+{
+    edit_piece_t *root;
+
+    GPtrArray *blocks;          /* memory of the read and the added text */
+    char *add;                  /* free part of the last block of the added text */
+    off_t add_free;
+
+    GPtrArray *uncounted;       /* pieces whose line breaks are not counted yet, in order */
+    guint uncounted_next;
+    long early_lines;           /* line breaks of the uncounted pieces counted by the changes */
+    off_t early_len;            /* and their bytes, edit_pieces_count_uncounted() reports them */
+
+    /* the last piece that was found: the text is mostly read in order */
+    edit_piece_t *cache;
+    off_t cache_offset;
+};
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_piece_t *
+edit_piece_new (const char *data, off_t len, long nl)
+{
+    edit_piece_t *t;
+
+    t = g_new0 (edit_piece_t, 1);
+    t->data = data;
+    t->len = len;
+    t->nl = nl;
+    t->size = len;
+    t->lines = nl;
+    t->prio = g_random_int ();
+
+    return t;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_piece_free (edit_piece_t * t)
+{
+    if (t != NULL)
+    {
+        edit_piece_free (t->left);
+        edit_piece_free (t->right);
+        g_free (t);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_piece_rebase (edit_piece_t * t, const char *old, off_t len, const char *data)
+{
+    for (; t != NULL; t = t->right)
+    {
+        edit_piece_rebase (t->left, old, len, data);
+        if (t->data >= old && t->data < old + len)
+            t->data = data + (t->data - old);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline void
+edit_piece_update (edit_piece_t * t)
+{
+    t->size = piece_size (t->left) + t->len + piece_size (t->right);
+    t->lines = piece_lines (t->left) + t->nl + piece_lines (t->right);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_piece_update_all (edit_piece_t * t)
+{
+    if (t != NULL)
+    {
+        edit_piece_update_all (t->left);
+        edit_piece_update_all (t->right);
+        edit_piece_update (t);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_piece_t *
+edit_piece_merge (edit_piece_t * a, edit_piece_t * b)
+{
+    if (a == NULL)
+        return b;
+    if (b == NULL)
+        return a;
+
+    if (a->prio > b->prio)
+    {
+        a->right = edit_piece_merge (a->right, b);
+        edit_piece_update (a);
+        return a;
+    }
+
+    b->left = edit_piece_merge (a, b->left);
+    edit_piece_update (b);
+    return b;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split the treap into the first @k bytes and the rest. A piece that spans @k is cut in two.
+ */
+
+static void
+edit_piece_split (edit_piece_t * t, off_t k, edit_piece_t ** l, edit_piece_t ** r)
+{
+    off_t left_size;
+
+    if (t == NULL)
+    {
+        *l = *r = NULL;
+        return;
+    }
+
+    left_size = piece_size (t->left);
+
+    if (k <= left_size)
+    {
+        edit_piece_split (t->left, k, l, &t->left);
+        *r = t;
+    }
+    else if (k >= left_size + t->len)
+    {
+        edit_piece_split (t->right, k - left_size - t->len, &t->right, r);
+        *l = t;
+    }
+    else
+    {
+        off_t head = k - left_size;
+        edit_piece_t *tail;
+        long nl;
+
+        /* count the line breaks of the shorter part */
+        if (head <= t->len / 2)
+            nl = (long) count_newlines (t->data, (size_t) head);
+        else
+            nl = t->nl - (long) count_newlines (t->data + head, (size_t) (t->len - head));
+
+        /* the tail takes the place of the piece in the right part */
+        tail = edit_piece_new (t->data + head, t->len - head, t->nl - nl);
+        tail->prio = t->prio;
+        tail->right = t->right;
+        edit_piece_update (tail);
+
+        t->len = head;
+        t->nl = nl;
+        t->right = NULL;
+
+        *l = t;
+        *r = tail;
+    }
+
+    edit_piece_update (t);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_piece_t *
+edit_pieces_find (const edit_pieces_t * pt, off_t offset, off_t * start)
+{
+    edit_piece_t *t = pt->root;
+    off_t base = 0;
+
+    while (t != NULL)
+    {
+        off_t left_size;
+
+        left_size = piece_size (t->left);
+
+        if (offset < base + left_size)
+            t = t->left;
+        else if (offset < base + left_size + t->len)
+        {
+            *start = base + left_size;
+            break;
+        }
+        else
+        {
+            base += left_size + t->len;
+            t = t->right;
+        }
+    }
+
+    return t;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Count the line breaks before @offset */
+
+static long
+edit_pieces_lines_before (const edit_pieces_t * pt, off_t offset)
+{
+    const edit_piece_t *t = pt->root;
+    long lines = 0;
+
+    while (t != NULL)
+    {
+        off_t left_size;
+
+        left_size = piece_size (t->left);
+
+        if (offset < left_size)
+            t = t->left;
+        else if (offset < left_size + t->len)
+            return lines + piece_lines (t->left)
+                + (long) count_newlines (t->data, (size_t) (offset - left_size));
+        else
+        {
+            lines += piece_lines (t->left) + t->nl;
+            offset -= left_size + t->len;
+            t = t->right;
+        }
+    }
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_piece_t *
+edit_pieces_append (edit_pieces_t * pt, const char *data, off_t len, long nl)
+{
+    edit_piece_t *t;
+
+    t = edit_piece_new (data, len, nl);
+    pt->root = edit_piece_merge (pt->root, t);
+
+    return t;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Count the line breaks of an uncounted piece that is about to change */
+
+static void
+edit_pieces_count_piece (edit_pieces_t * pt, edit_piece_t * t)
+{
+    if (t == NULL || t->slot == 0)
+        return;
+
+    t->nl = (long) count_newlines (t->data, (size_t) t->len);
+    g_ptr_array_index (pt->uncounted, t->slot - 1) = NULL;
+    t->slot = 0;
+
+    pt->early_lines += t->nl;
+    pt->early_len += t->len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Count the line breaks of a subtree that is deleted, its sums may be out of date */
+
+static long
+edit_pieces_count_tree (edit_pieces_t * pt, edit_piece_t * t)
+{
+    if (t == NULL)
+        return 0;
+
+    edit_pieces_count_piece (pt, t);
+
+    return edit_pieces_count_tree (pt, t->left) + t->nl + edit_pieces_count_tree (pt, t->right);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Copy the added text to the last block. The text must fit in one block. */
+
+static const char *
+edit_pieces_store (edit_pieces_t * pt, const char *data, off_t len)
+{
+    char *p;
+
+    if (len > pt->add_free)
+    {
+        pt->add = g_malloc (EDIT_PIECE_SIZE);
+        pt->add_free = EDIT_PIECE_SIZE;
+        g_ptr_array_add (pt->blocks, pt->add);
+    }
+
+    p = pt->add;
+    memcpy (p, data, len);
+    pt->add += len;
+    pt->add_free -= len;
+
+    return p;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append the text to the last piece of @t if that piece ends where the added text goes on.
+ *
+ * @return TRUE if the text was appended
+ */
+
+static gboolean
+edit_pieces_extend (edit_pieces_t * pt, edit_piece_t * t, const char *data, off_t len, long nl)
+{
+    edit_piece_t *last;
+
+    if (t == NULL || len > pt->add_free)
+        return FALSE;
+
+    for (last = t; last->right != NULL; last = last->right)
+        ;
+
+    if (last->data + last->len != pt->add || last->len + len > EDIT_PIECE_SIZE)
+        return FALSE;
+
+    edit_pieces_store (pt, data, len);
+    last->len += len;
+    last->nl += nl;
+
+    for (; t != NULL; t = t->right)
+    {
+        t->size += len;
+        t->lines += nl;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+edit_pieces_t *
+edit_pieces_new (void)
+{
+    edit_pieces_t *pt;
+
+    pt = g_new0 (edit_pieces_t, 1);
+    pt->blocks = g_ptr_array_new_with_free_func (g_free);
+
+    return pt;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+edit_pieces_free (edit_pieces_t * pt)
+{
+    if (pt == NULL)
+        return;
+
+    edit_piece_free (pt->root);
+    g_ptr_array_free (pt->blocks, TRUE);
+    if (pt->uncounted != NULL)
+        g_ptr_array_free (pt->uncounted, TRUE);
+    g_free (pt);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append a block of the file that is read to the end of the text.
+ *
+ * @param pt piece table
+ * @param block memory allocated by g_malloc(), the table takes it
+ * @param len bytes in @block
+ *
+ * @return number of line breaks in @block
+ */
+
+long
+edit_pieces_append_block (edit_pieces_t * pt, char *block, off_t len)
+{
+    long lines = 0;
+    off_t i;
+
+    g_ptr_array_add (pt->blocks, block);
+
+    for (i = 0; i < len; i += EDIT_PIECE_SIZE)
+    {
+        off_t n;
+        long nl;
+
+        n = MIN (EDIT_PIECE_SIZE, len - i);
+        nl = (long) count_newlines (block + i, (size_t) n);
+        edit_pieces_append (pt, block + i, n, nl);
+        lines += nl;
+    }
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append the memory that outlives the table, the mapping of a file, to the end of the text.
+ * Its line breaks are counted by edit_pieces_count_uncounted().
+ */
+
+void
+edit_pieces_append_uncounted (edit_pieces_t * pt, const char *data, off_t len)
+{
+    off_t i;
+
+    if (pt->uncounted == NULL)
+        pt->uncounted = g_ptr_array_new ();
+
+    for (i = 0; i < len; i += EDIT_PIECE_SIZE)
+    {
+        edit_piece_t *t;
+
+        t = edit_pieces_append (pt, data + i, MIN (EDIT_PIECE_SIZE, len - i), 0);
+        g_ptr_array_add (pt->uncounted, t);
+        t->slot = pt->uncounted->len;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Let the pieces that refer to some memory refer to a copy of it instead.
+ *
+ * @param pt piece table
+ * @param old the memory, the mapping of the file
+ * @param len bytes of @old
+ * @param data the copy of @old, the caller keeps it until the table is freed
+ */
+
+void
+edit_pieces_rebase (edit_pieces_t * pt, const char *old, off_t len, const char *data)
+{
+    edit_piece_rebase (pt->root, old, len, data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count the line breaks of the next uncounted pieces, at least @len bytes of them if there are.
+ * The pieces that the changes have counted meanwhile are added.
+ *
+ * @param pt piece table
+ * @param len bytes to count
+ * @param counted where the number of counted bytes is stored
+ *
+ * @return number of line breaks in the counted pieces
+ */
+
+long
+edit_pieces_count_uncounted (edit_pieces_t * pt, off_t len, off_t * counted)
+{
+    long lines;
+
+    lines = pt->early_lines;
+    *counted = pt->early_len;
+    pt->early_lines = 0;
+    pt->early_len = 0;
+
+    if (pt->uncounted == NULL)
+        return lines;
+
+    while (*counted < len && pt->uncounted_next < pt->uncounted->len)
+    {
+        edit_piece_t *t;
+
+        t = g_ptr_array_index (pt->uncounted, pt->uncounted_next++);
+        if (t != NULL)
+        {
+            t->nl = (long) count_newlines (t->data, (size_t) t->len);
+            t->slot = 0;
+            lines += t->nl;
+            *counted += t->len;
+        }
+    }
+
+    if (pt->uncounted_next == pt->uncounted->len)
+    {
+        edit_piece_update_all (pt->root);
+        g_ptr_array_free (pt->uncounted, TRUE);
+        pt->uncounted = NULL;
+        pt->uncounted_next = 0;
+    }
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the bytes that follow @offset in the same piece.
+ *
+ * @param pt piece table
+ * @param offset byte offset in the text
+ * @param len where the number of the bytes is stored
+ *
+ * @return pointer to the byte at @offset, NULL if @offset is out of the text
+ */
+
+const char *
+edit_pieces_get_span (const edit_pieces_t * pt, off_t offset, off_t * len)
+{
+    edit_pieces_t *cache = (edit_pieces_t *) pt;
+    edit_piece_t *t = pt->cache;
+    off_t start = pt->cache_offset;
+
+    if (t == NULL || offset < start || offset >= start + t->len)
+    {
+        t = edit_pieces_find (pt, offset, &start);
+        if (t == NULL)
+        {
+            *len = 0;
+            return NULL;
+        }
+
+        cache->cache = t;
+        cache->cache_offset = start;
+    }
+
+    *len = t->len - (offset - start);
+    return t->data + (offset - start);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count the line breaks between two offsets. All pieces must be counted.
+ *
+ * @param pt piece table
+ * @param first first offset
+ * @param last offset after the last byte, not less than @first
+ *
+ * @return number of line breaks in [first, last)
+ */
+
+long
+edit_pieces_count_lines (const edit_pieces_t * pt, off_t first, off_t last)
+{
+    return edit_pieces_lines_before (pt, last) - edit_pieces_lines_before (pt, first);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the beginning of a line. All pieces must be counted.
+ *
+ * @param pt piece table
+ * @param line number of the line, that is of the line breaks before it
+ *
+ * @return offset after the @line-th line break, the size of the text if there are less
+ */
+
+off_t
+edit_pieces_line_offset (const edit_pieces_t * pt, long line)
+{
+    const edit_piece_t *t = pt->root;
+    off_t offset = 0;
+
+    while (t != NULL)
+    {
+        long left_lines;
+
+        left_lines = piece_lines (t->left);
+
+        if (line <= left_lines)
+            t = t->left;
+        else if (line <= left_lines + t->nl)
+        {
+            const char *p = t->data;
+
+            for (line -= left_lines; (p = memchr (p, '\n', t->data + t->len - p)) != NULL; p++)
+                if (--line == 0)
+                    break;
+
+            return offset + piece_size (t->left) + (p - t->data) + 1;
+        }
+        else
+        {
+            line -= left_lines + t->nl;
+            offset += piece_size (t->left) + t->len;
+            t = t->right;
+        }
+    }
+
+    return offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Insert bytes into the text.
+ *
+ * @param pt piece table
+ * @param offset offset of the first inserted byte
+ * @param data bytes to insert
+ * @param len number of bytes
+ *
+ * @return number of inserted line breaks
+ */
+
+long
+edit_pieces_insert (edit_pieces_t * pt, off_t offset, const char *data, off_t len)
+{
+    edit_piece_t *l, *r, *m = NULL;
+    off_t start;
+    long lines = 0;
+
+    pt->cache = NULL;
+
+    /* a piece that is cut needs its line breaks */
+    edit_pieces_count_piece (pt, edit_pieces_find (pt, offset, &start));
+    edit_piece_split (pt->root, offset, &l, &r);
+
+    while (len > 0)
+    {
+        off_t n;
+        long nl;
+
+        n = MIN (EDIT_PIECE_SIZE, len);
+        nl = (long) count_newlines (data, (size_t) n);
+
+        /* typed text goes on in the piece before it */
+        if (m != NULL || !edit_pieces_extend (pt, l, data, n, nl))
+        {
+            const char *p;
+
+            p = edit_pieces_store (pt, data, n);
+            m = edit_piece_merge (m, edit_piece_new (p, n, nl));
+        }
+
+        lines += nl;
+        data += n;
+        len -= n;
+    }
+
+    pt->root = edit_piece_merge (edit_piece_merge (l, m), r);
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Delete bytes from the text.
+ *
+ * @param pt piece table
+ * @param offset offset of the first deleted byte
+ * @param len number of bytes
+ *
+ * @return number of deleted line breaks
+ */
+
+long
+edit_pieces_delete (edit_pieces_t * pt, off_t offset, off_t len)
+{
+    edit_piece_t *l, *m, *r;
+    off_t start;
+    long lines;
+
+    pt->cache = NULL;
+
+    /* the pieces that are cut need their line breaks */
+    edit_pieces_count_piece (pt, edit_pieces_find (pt, offset, &start));
+    edit_pieces_count_piece (pt, edit_pieces_find (pt, offset + len, &start));
+    edit_piece_split (pt->root, offset, &l, &r);
+    edit_piece_split (r, len, &m, &r);
+    lines = (pt->uncounted != NULL) ? edit_pieces_count_tree (pt, m) : piece_lines (m);
+    edit_piece_free (m);
+    pt->root = edit_piece_merge (l, r);
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
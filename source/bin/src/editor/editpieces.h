@@ -0,0 +1,37 @@
+/** \file
+ *  \brief Header: piece table for the text of WEdit
+ */
+
+#ifndef MC__EDIT_PIECES_H
+#define MC__EDIT_PIECES_H
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct edit_pieces_struct edit_pieces_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+edit_pieces_t *edit_pieces_new (void);
+void edit_pieces_free (edit_pieces_t * pt);
+
+long edit_pieces_append_block (edit_pieces_t * pt, char *block, off_t len);
+void edit_pieces_append_uncounted (edit_pieces_t * pt, const char *data, off_t len);
+void edit_pieces_rebase (edit_pieces_t * pt, const char *old, off_t len, const char *data);
+long edit_pieces_count_uncounted (edit_pieces_t * pt, off_t len, off_t * counted);
+
+const char *edit_pieces_get_span (const edit_pieces_t * pt, off_t offset, off_t * len);
+long edit_pieces_count_lines (const edit_pieces_t * pt, off_t first, off_t last);
+off_t edit_pieces_line_offset (const edit_pieces_t * pt, long line);
+
+long edit_pieces_insert (edit_pieces_t * pt, off_t offset, const char *data, off_t len);
+long edit_pieces_delete (edit_pieces_t * pt, off_t offset, off_t len);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__EDIT_PIECES_H */
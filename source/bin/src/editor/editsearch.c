@@ -580,7 +580,7 @@ edit_do_search (WEdit * edit)
     /* This shouldn't happen */
     assert (edit->search != NULL);
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
     esm.first = TRUE;
     esm.edit = edit;
@@ -687,6 +687,7 @@ edit_search_init (WEdit * edit, const char *str)
     edit->search->is_case_sensitive = edit_search_options.case_sens;
     edit->search->whole_words = edit_search_options.whole_words;
     edit->search->search_fn = edit_search_cmd_callback;
+    edit->search->get_span = edit_search_span_callback;
     edit->search->update_fn = edit_search_update_callback;
 
     return TRUE;
@@ -713,6 +714,25 @@ edit_search_cmd_callback (const void *user_data, gsize char_offset, int *current
     return MC_SEARCH_CB_OK;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Give the search engine a whole page of the buffer at once.
+ */
+
+mc_search_cbret_t
+edit_search_span_callback (const void *user_data, gsize offset, const char **ptr, gsize * len)
+{
+    WEdit *edit = ((const edit_search_status_msg_t *) user_data)->edit;
+    off_t span_len;
+
+    *ptr = edit_buffer_get_span (&edit->buffer, (off_t) offset, &span_len);
+    if (*ptr == NULL)
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *len = (gsize) span_len;
+    return MC_SEARCH_CB_OK;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 mc_search_cbret_t
@@ -834,7 +854,7 @@ edit_replace_cmd (WEdit * edit, gboolean again)
         disp1 = edit_replace_cmd__conv_to_display (saved1 != NULL ? saved1 : "");
         disp2 = edit_replace_cmd__conv_to_display (saved2 != NULL ? saved2 : "");
 
-        edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+        edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
         edit_dialog_replace_show (edit, disp1, disp2, &input1, &input2);
 
@@ -910,7 +930,6 @@ edit_replace_cmd (WEdit * edit, gboolean again)
 
         if (edit->search_start >= 0 && edit->search_start < edit->buffer.size)
         {
-            gsize i;
             GString *repl_str;
 
             edit->found_start = edit->search_start;
@@ -971,11 +990,8 @@ edit_replace_cmd (WEdit * edit, gboolean again)
             }
 
             /* delete then insert new */
-            for (i = 0; i < len; i++)
-                edit_delete (edit, TRUE);
-
-            for (i = 0; i < repl_str->len; i++)
-                edit_insert (edit, repl_str->str[i]);
+            edit_delete_block (edit, len);
+            edit_insert_block (edit, repl_str->str, (off_t) repl_str->len);
 
             edit->found_len = repl_str->len;
             g_string_free (repl_str, TRUE);
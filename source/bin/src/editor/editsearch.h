@@ -25,6 +25,8 @@ void edit_search_deinit (WEdit * edit);
 
 mc_search_cbret_t edit_search_cmd_callback (const void *user_data, gsize char_offset,
                                             int *current_char);
+mc_search_cbret_t edit_search_span_callback (const void *user_data, gsize offset,
+                                             const char **ptr, gsize * len);
 mc_search_cbret_t edit_search_update_callback (const void *user_data, gsize char_offset);
 int edit_search_status_update_cb (status_msg_t * sm);
 
@@ -0,0 +1,515 @@
+/*
+   Editor undo and redo journal.
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: editor undo and redo journal.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+
+#include "lib/vfs/vfs.h"        /* mc_mkstemps() */
+
+#include "editundo.h"
+
+/* --------------------------------------------------------------------------------------------- */
+/*-
+ * The journal is a stack of records. Each record is the reverse of one change of the buffer, of
+ * the cursor or of the markers, and every key press starts with an EDIT_UNDO_KEY_PRESS record.
+ * Undo pops the records down to the key press and replays them.
+ *
+ * Records of the same action that follow each other are merged, so typing a word, deleting a
+ * block or moving the cursor by many bytes takes one record. The text that an undo has to insert
+ * back is kept in an append-only arena. A record refers to its text by the arena offset, and the
+ * text of the top record is always at the end of the arena, so merging a record appends to the
+ * arena and popping a record truncates it.
+ *
+ * The records and the arena in memory must fit in the budget. When they do not, the oldest key
+ * presses are dropped, or, if the spill is enabled, the arena is moved to a temporary file first.
+ */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* the temporary file may take this many budgets */
+#define EDIT_UNDO_SPILL_FACTOR 16
+
+#define edit_undo_top(undo) \
+    (&g_array_index ((undo)->records, edit_undo_record_t, (undo)->records->len - 1))
+
+/*** file scope type declarations ****************************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static inline gboolean
+edit_undo_has_text (edit_undo_action_t action)
+{
+    return (action == EDIT_UNDO_INSERT || action == EDIT_UNDO_INSERT_AHEAD
+            || action == EDIT_UNDO_MARKERS);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline off_t
+edit_undo_text_end (const edit_undo_t * undo)
+{
+    return undo->arena_offset + (off_t) undo->arena->len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the journal fits in the budget.
+ *
+ * @param undo journal
+ * @param records number of records
+ * @param start arena offset of the oldest text
+ * @param budget budget in bytes
+ *
+ * @return TRUE if the memory and the temporary file are within the budget
+ */
+
+static gboolean
+edit_undo_fits (const edit_undo_t * undo, guint records, off_t start, gsize budget)
+{
+    const gsize size = records * sizeof (edit_undo_record_t);
+    const off_t end = edit_undo_text_end (undo);
+
+    if (size + (gsize) (end - MAX (start, undo->arena_offset)) > budget)
+        return FALSE;
+
+    return (!undo->spill || size + (gsize) (end - start) <= budget * EDIT_UNDO_SPILL_FACTOR);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Move the arena to the temporary file.
+ *
+ * @return TRUE on success, FALSE if the text has to stay in memory
+ */
+
+static gboolean
+edit_undo_spill (edit_undo_t * undo)
+{
+    const guint8 *p = undo->arena->data;
+    gsize len = undo->arena->len;
+
+    if (undo->spill_fd == -1)
+    {
+        vfs_path_t *vpath = NULL;
+
+        undo->spill_fd = mc_mkstemps (&vpath, "mcundo", NULL);
+        if (vpath != NULL)
+        {
+            /* the file is only reached by its descriptor */
+            unlink (vfs_path_as_str (vpath));
+            vfs_path_free (vpath, TRUE);
+        }
+        if (undo->spill_fd == -1)
+        {
+            undo->spill = FALSE;
+            return FALSE;
+        }
+        undo->spill_offset = undo->arena_offset;
+    }
+
+    if (lseek (undo->spill_fd, undo->arena_offset - undo->spill_offset, SEEK_SET) == -1)
+    {
+        undo->spill = FALSE;
+        return FALSE;
+    }
+
+    while (len != 0)
+    {
+        ssize_t n;
+
+        n = write (undo->spill_fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            /* no room for the text, so it is dropped when it does not fit */
+            undo->spill = FALSE;
+            return FALSE;
+        }
+
+        p += n;
+        len -= (gsize) n;
+    }
+
+    undo->arena_offset += (off_t) undo->arena->len;
+    g_byte_array_set_size (undo->arena, 0);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_undo_read (const edit_undo_t * undo, off_t offset, char *buf, off_t len)
+{
+    if (offset < undo->arena_offset)
+    {
+        off_t n;
+
+        /* the head of the text is in the temporary file */
+        n = MIN (len, undo->arena_offset - offset);
+        len -= n;
+
+        if (lseek (undo->spill_fd, offset - undo->spill_offset, SEEK_SET) != -1)
+            while (n > 0)
+            {
+                ssize_t r;
+
+                r = read (undo->spill_fd, buf, (size_t) n);
+                if (r < 0 && errno == EINTR)
+                    continue;
+                if (r <= 0)
+                    break;
+
+                buf += r;
+                offset += r;
+                n -= r;
+            }
+
+        /* the text that cannot be read back is lost */
+        memset (buf, 0, (size_t) n);
+        buf += n;
+        offset += n;
+    }
+
+    if (len > 0)
+        memcpy (buf, undo->arena->data + (offset - undo->arena_offset), (size_t) len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Bring the journal back into the budget. The oldest key presses are dropped down to three
+ * quarters of the budget, so the trimming does not happen on every push. If the current key
+ * press alone does not fit, the whole journal is dropped and the rest of the key press is not
+ * recorded.
+ */
+
+static void
+edit_undo_trim (edit_undo_t * undo)
+{
+    const gsize target = undo->budget / 4 * 3;
+    off_t start;
+    guint i;
+
+    if (edit_undo_fits (undo, undo->records->len, undo->start, undo->budget))
+        return;
+
+    if (undo->spill && undo->arena->len >= undo->budget / 2 && edit_undo_spill (undo)
+        && edit_undo_fits (undo, undo->records->len, undo->start, undo->budget))
+        return;
+
+    start = undo->start;
+
+    for (i = 0; i < undo->records->len; i++)
+    {
+        const edit_undo_record_t *r = &g_array_index (undo->records, edit_undo_record_t, i);
+
+        if (i != 0 && r->action == EDIT_UNDO_KEY_PRESS
+            && edit_undo_fits (undo, undo->records->len - i, start, target))
+            break;
+
+        /* the arena is contiguous, the text of the next record follows */
+        if (edit_undo_has_text (r->action))
+            start = r->text + r->value;
+    }
+
+    if (i == undo->records->len)
+    {
+        edit_undo_clear (undo);
+        undo->lost = TRUE;
+        return;
+    }
+
+    g_array_remove_range (undo->records, 0, i);
+    undo->start = start;
+
+    if (start > undo->arena_offset)
+    {
+        g_byte_array_remove_range (undo->arena, 0, (guint) (start - undo->arena_offset));
+        undo->arena_offset = start;
+    }
+
+    /* nothing in the temporary file is needed anymore, reuse it from the beginning */
+    if (start >= undo->arena_offset)
+        undo->spill_offset = undo->arena_offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Initialize the journal.
+ *
+ * @param undo journal
+ * @param budget memory that the records and their text may take, in bytes
+ * @param spill if TRUE, the text over the budget goes to a temporary file
+ */
+
+void
+edit_undo_init (edit_undo_t * undo, gsize budget, gboolean spill)
+{
+    undo->records = g_array_new (FALSE, FALSE, sizeof (edit_undo_record_t));
+    undo->arena = g_byte_array_new ();
+    undo->arena_offset = 0;
+    undo->start = 0;
+    undo->budget = budget;
+    undo->spill = spill;
+    undo->spill_fd = -1;
+    undo->spill_offset = 0;
+    undo->lost = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Clean the journal.
+ *
+ * @param undo journal
+ */
+
+void
+edit_undo_clean (edit_undo_t * undo)
+{
+    /* not initialized */
+    if (undo->records == NULL)
+        return;
+
+    g_array_free (undo->records, TRUE);
+    g_byte_array_free (undo->arena, TRUE);
+    if (undo->spill_fd != -1)
+        close (undo->spill_fd);
+
+    undo->records = NULL;
+    undo->arena = NULL;
+    undo->spill_fd = -1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Drop all records of the journal.
+ *
+ * @param undo journal
+ */
+
+void
+edit_undo_clear (edit_undo_t * undo)
+{
+    g_array_set_size (undo->records, 0);
+    g_byte_array_set_size (undo->arena, 0);
+    undo->arena_offset = 0;
+    undo->start = 0;
+    undo->spill_offset = 0;
+    undo->lost = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Push an action without text onto the journal.
+ *
+ * @param undo journal
+ * @param action action that reverses the change
+ * @param value see edit_undo_action_t
+ */
+
+void
+edit_undo_push (edit_undo_t * undo, edit_undo_action_t action, off_t value)
+{
+    if (action == EDIT_UNDO_KEY_PRESS)
+        undo->lost = FALSE;
+    else if (undo->lost || (action == EDIT_UNDO_CURSOR && value == 0))
+        return;
+
+    if (undo->records->len != 0 && edit_undo_top (undo)->action == action)
+    {
+        edit_undo_record_t *top = edit_undo_top (undo);
+
+        switch (action)
+        {
+        case EDIT_UNDO_KEY_PRESS:
+            /* no need to push multiple do-nothings */
+            if (top->value == value)
+                return;
+            break;
+        case EDIT_UNDO_CURSOR:
+            top->value += value;
+            if (top->value == 0)
+                g_array_set_size (undo->records, undo->records->len - 1);
+            return;
+        case EDIT_UNDO_COLUMN:
+            /* the older state is restored last */
+            return;
+        default:
+            top->value += value;
+            return;
+        }
+    }
+
+    {
+        edit_undo_record_t r;
+
+        r.action = action;
+        r.value = value;
+        r.text = 0;
+        g_array_append_val (undo->records, r);
+    }
+
+    edit_undo_trim (undo);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Push an action with text onto the journal.
+ *
+ * @param undo journal
+ * @param action EDIT_UNDO_INSERT, EDIT_UNDO_INSERT_AHEAD or EDIT_UNDO_MARKERS
+ * @param text text in the order of the file. Text pushed for EDIT_UNDO_INSERT goes before the
+ *             text of the previous push, and text pushed for EDIT_UNDO_INSERT_AHEAD goes after.
+ * @param len length of the text
+ */
+
+void
+edit_undo_push_text (edit_undo_t * undo, edit_undo_action_t action, const char *text, off_t len)
+{
+    guint8 *p;
+    off_t i;
+
+    if (undo->lost || len <= 0)
+        return;
+
+    if (undo->records->len != 0 && edit_undo_top (undo)->action == action)
+    {
+        /* the older markers are restored last */
+        if (action == EDIT_UNDO_MARKERS)
+            return;
+
+        edit_undo_top (undo)->value += len;
+    }
+    else
+    {
+        edit_undo_record_t r;
+
+        r.action = action;
+        r.value = len;
+        r.text = edit_undo_text_end (undo);
+        g_array_append_val (undo->records, r);
+    }
+
+    g_byte_array_set_size (undo->arena, undo->arena->len + (guint) len);
+    p = undo->arena->data + undo->arena->len - len;
+
+    /* the text to insert before the cursor is kept backwards, so that it grows at the end */
+    if (action == EDIT_UNDO_INSERT)
+        for (i = 0; i < len; i++)
+            p[i] = (guint8) text[len - 1 - i];
+    else
+        memcpy (p, text, (size_t) len);
+
+    edit_undo_trim (undo);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the top record of the journal.
+ *
+ * @param undo journal
+ *
+ * @return the top record, NULL if the journal is empty
+ */
+
+const edit_undo_record_t *
+edit_undo_peek (const edit_undo_t * undo)
+{
+    return (undo->records->len == 0 ? NULL : edit_undo_top (undo));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Pop the top record of the journal.
+ *
+ * @param undo journal
+ * @param record the record popped. If the journal is empty, its action is EDIT_UNDO_NONE.
+ *
+ * @return newly allocated text of the record in the order of the file, NULL if it has no text
+ */
+
+char *
+edit_undo_pop (edit_undo_t * undo, edit_undo_record_t * record)
+{
+    char *text;
+
+    if (undo->records->len == 0)
+    {
+        record->action = EDIT_UNDO_NONE;
+        record->value = 0;
+        record->text = 0;
+        return NULL;
+    }
+
+    *record = *edit_undo_top (undo);
+    g_array_set_size (undo->records, undo->records->len - 1);
+
+    if (!edit_undo_has_text (record->action))
+        return NULL;
+
+    text = g_malloc ((gsize) record->value);
+    edit_undo_read (undo, record->text, text, record->value);
+
+    /* the text of the top record is at the end of the arena */
+    if (record->text >= undo->arena_offset)
+        g_byte_array_set_size (undo->arena, (guint) (record->text - undo->arena_offset));
+    else
+    {
+        g_byte_array_set_size (undo->arena, 0);
+        undo->arena_offset = record->text;
+    }
+
+    if (record->action == EDIT_UNDO_INSERT)
+    {
+        off_t i;
+
+        for (i = 0; i < record->value / 2; i++)
+        {
+            const char c = text[i];
+
+            text[i] = text[record->value - 1 - i];
+            text[record->value - 1 - i] = c;
+        }
+    }
+
+    return text;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,66 @@
+/** \file
+ *  \brief Header: undo and redo journal for WEdit
+ */
+
+#ifndef MC__EDIT_UNDO_H
+#define MC__EDIT_UNDO_H
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/* Actions that are recorded in the journal to reverse an editing command */
+typedef enum
+{
+    EDIT_UNDO_NONE = 0,         /* the journal is empty */
+    EDIT_UNDO_KEY_PRESS,        /* start of the actions of a key press, value is start_display */
+    EDIT_UNDO_CURSOR,           /* move the cursor by value bytes */
+    EDIT_UNDO_INSERT,           /* insert the text before the cursor */
+    EDIT_UNDO_INSERT_AHEAD,     /* insert the text after the cursor */
+    EDIT_UNDO_BACKSPACE,        /* delete value bytes before the cursor */
+    EDIT_UNDO_BACKSPACE_BR,     /* the same, after a space or a control char was typed */
+    EDIT_UNDO_DELETE,           /* delete value bytes after the cursor */
+    EDIT_UNDO_DELETE_BR,        /* the same, after a space or a control char was inserted */
+    EDIT_UNDO_MARKERS,          /* restore mark1, mark2 and end_mark_curs */
+    EDIT_UNDO_COLUMN            /* switch the column highlighting to value */
+} edit_undo_action_t;
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct edit_undo_record_struct
+{
+    edit_undo_action_t action;
+    off_t value;                /* see edit_undo_action_t, or the length of the text */
+    off_t text;                 /* offset of the text in the arena */
+} edit_undo_record_t;
+
+typedef struct edit_undo_struct
+{
+    GArray *records;            /* edit_undo_record_t, the last one is the top */
+    GByteArray *arena;          /* the text of the records that is kept in memory */
+    off_t arena_offset;         /* arena offset of arena->data[0] */
+    off_t start;                /* arena offset of the text of the oldest record */
+    gsize budget;               /* memory taken by the records and the arena, in bytes */
+    gboolean spill;             /* move the old text to a temporary file instead of dropping it */
+    int spill_fd;               /* temporary file with the text before arena_offset, or -1 */
+    off_t spill_offset;         /* arena offset of the first byte of the temporary file */
+    gboolean lost;              /* the current key press did not fit in the budget */
+} edit_undo_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+void edit_undo_init (edit_undo_t * undo, gsize budget, gboolean spill);
+void edit_undo_clean (edit_undo_t * undo);
+void edit_undo_clear (edit_undo_t * undo);
+
+void edit_undo_push (edit_undo_t * undo, edit_undo_action_t action, off_t value);
+void edit_undo_push_text (edit_undo_t * undo, edit_undo_action_t action, const char *text,
+                          off_t len);
+const edit_undo_record_t *edit_undo_peek (const edit_undo_t * undo);
+char *edit_undo_pop (edit_undo_t * undo, edit_undo_record_t * record);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__EDIT_UNDO_H */
@@ -836,8 +836,19 @@ edit_dialog_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, v
         return MSG_HANDLED;
 
     case MSG_IDLE:
-        widget_idle (w, FALSE);
-        return send_message (g->current->data, NULL, MSG_IDLE, 0, NULL);
+        {
+            GList *l;
+
+            widget_idle (w, FALSE);
+
+            /* the files of the other windows are written in the background too */
+            for (l = g->widgets; l != NULL; l = g_list_next (l))
+                if (l != g->current && edit_widget_is_editor (CONST_WIDGET (l->data))
+                    && edit_save_finish ((WEdit *) l->data, FALSE))
+                    widget_idle (w, TRUE);
+
+            return send_message (g->current->data, NULL, MSG_IDLE, 0, NULL);
+        }
 
     default:
         return dlg_default_callback (w, sender, msg, parm, data);
@@ -952,6 +963,9 @@ edit_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *da
     case MSG_DRAW:
         e->force |= REDRAW_COMPLETELY;
         edit_update_screen (e);
+        /* count the lines and scan the syntax of a big file while the user does nothing */
+        if (edit_buffer_lines_pending (&e->buffer) || edit_syntax_prescan_pending (e))
+            widget_idle (WIDGET (w->owner), TRUE);
         return MSG_HANDLED;
 
     case MSG_KEY:
@@ -972,6 +986,10 @@ edit_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *da
                 ret = MSG_HANDLED;
             }
 
+            /* a change drops the syntax checkpoints after it, scan them again later */
+            if (edit_syntax_prescan_pending (e) || e->save != NULL)
+                widget_idle (WIDGET (w->owner), TRUE);
+
             return ret;
         }
 
@@ -994,6 +1012,12 @@ edit_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *da
         }
 
     case MSG_IDLE:
+        /* one step at a time: the lines first, then the syntax; the saved file meanwhile */
+        if (edit_save_finish (e, FALSE))
+            widget_idle (WIDGET (w->owner), TRUE);
+        edit_check_mapped_file (e);
+        if (edit_count_file_lines (e, FALSE) || edit_syntax_prescan (e))
+            widget_idle (WIDGET (w->owner), TRUE);
         edit_update_screen (e);
         return MSG_HANDLED;
 
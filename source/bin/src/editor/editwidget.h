@@ -132,26 +132,20 @@ struct WEdit
     edit_book_mark_t *book_mark;
     GArray *serialized_bookmarks;
 
-    /* undo stack and pointers */
-    unsigned long undo_stack_pointer;
-    long *undo_stack;
-    unsigned long undo_stack_size;
-    unsigned long undo_stack_size_mask;
-    unsigned long undo_stack_bottom;
+    /* undo and redo journals */
+    edit_undo_t undo;
     unsigned int undo_stack_disable:1;  /* If not 0, don't save events in the undo stack */
 
-    unsigned long redo_stack_pointer;
-    long *redo_stack;
-    unsigned long redo_stack_size;
-    unsigned long redo_stack_size_mask;
-    unsigned long redo_stack_bottom;
+    edit_undo_t redo;
     unsigned int redo_stack_reset:1;    /* If 1, need clear redo stack */
 
     struct stat stat1;          /* Result of mc_fstat() on the file */
     unsigned int skip_detach_prompt:1;  /* Do not prompt whether to detach a file anymore */
+    struct edit_save_struct *save;      /* file written in the background, or NULL */
+    gint64 map_checked;         /* when the lazily loaded file was checked for changes */
 
     /* syntax higlighting */
-    GSList *syntax_marker;
+    GArray *syntax_marker;      /* checkpoints of the rules, sorted by offset */
     GPtrArray *rules;
     off_t last_get_rule;
     edit_syntax_rule_t rule;
@@ -161,6 +155,9 @@ struct WEdit
 
     /* line break */
     LineBreaks lb;
+
+    /* word completion */
+    struct edit_words_struct *words;    /* index of the words of the text, or NULL */
 };
 
 /*** global variables defined in .c file *********************************************************/
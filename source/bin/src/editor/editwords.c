@@ -0,0 +1,422 @@
+/*
+   Editor word index for the word completion.
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: editor word index for the word completion.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <sys/types.h>
+
+#include "lib/global.h"
+
+#include "editwords.h"
+
+/* --------------------------------------------------------------------------------------------- */
+/*-
+ * The words of the text are kept in a prefix trie with the number of their occurrences, so the
+ * completions of a prefix are the words below its node and no text is searched for them.
+ *
+ * A word is a run of the bytes that are neither spaces nor the breaks of the completion.  Only
+ * the words that touch a change can change with it: edit_words_change_begin() takes them out
+ * of the index before the change, and edit_words_change_end() puts the words of the same place
+ * back after it.
+ *
+ * A child is found through a hash table of the edges, as the keywords of the syntax rules are,
+ * and the children of a node are linked for the completions.  The nodes are never freed, the
+ * counts of the forgotten words just go down to zero.  A node keeps the occurrences of its whole
+ * subtree too, so the empty subtrees are not walked.  When the text has too many different words
+ * the index gives up and the text is searched again.
+ */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* the longer words are not indexed */
+#define EDIT_WORDS_MAX_LEN 64
+
+/* the words of a longer part of the text are counted in a batch */
+#define EDIT_WORDS_BATCH (64 * 1024)
+
+/* the index gives up when it has so many nodes */
+#define EDIT_WORDS_MAX_NODES (4 * 1024 * 1024)
+
+/* bytes that break the words, as in the expression of edit_complete_word_cmd() */
+#define EDIT_WORDS_BREAKS ".=+[](),;:\"'-?/|\\{}*&^%$#@!"
+
+#define EDIT_WORDS_NODE(words, i) (&g_array_index ((words)->nodes, edit_words_node_t, (i)))
+
+/* key of the edge from a node to its child for a byte */
+#define EDIT_WORDS_EDGE(node, c) GUINT_TO_POINTER (((node) << 8) | (c))
+
+/*** file scope type declarations ****************************************************************/
+
+/* the node 0 is the root, and 0 is no node for the links */
+typedef struct
+{
+    guint32 child;              /* first child */
+    guint32 next;               /* next sibling */
+    guint32 count;              /* occurrences of the word that ends here */
+    guint32 words;              /* occurrences of the words of the subtree */
+    unsigned char c;            /* the last byte of the word */
+} edit_words_node_t;
+
+struct edit_words_struct
+{
+    GArray *nodes;              /* NULL if the index gave up */
+    GHashTable *edges;          /* EDIT_WORDS_EDGE() -> child */
+
+    /* the place that is changed, see edit_words_change_begin() */
+    off_t change_start;
+    off_t change_offset;
+    off_t change_tail;
+};
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static guint32
+edit_words_find (const edit_words_t * words, guint32 node, unsigned char c)
+{
+    return GPOINTER_TO_UINT (g_hash_table_lookup (words->edges, EDIT_WORDS_EDGE (node, c)));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Add a child to a node, or give the index up if it is too big */
+
+static guint32
+edit_words_add_child (edit_words_t * words, guint32 node, unsigned char c)
+{
+    edit_words_node_t *n;
+    guint32 i;
+
+    if (words->nodes->len >= EDIT_WORDS_MAX_NODES)
+    {
+        g_array_free (words->nodes, TRUE);
+        words->nodes = NULL;
+        g_hash_table_destroy (words->edges);
+        words->edges = NULL;
+        return 0;
+    }
+
+    i = words->nodes->len;
+    g_array_set_size (words->nodes, i + 1);
+
+    n = EDIT_WORDS_NODE (words, i);
+    n->c = c;
+    n->next = EDIT_WORDS_NODE (words, node)->child;
+    EDIT_WORDS_NODE (words, node)->child = i;
+    g_hash_table_insert (words->edges, EDIT_WORDS_EDGE (node, c), GUINT_TO_POINTER (i));
+
+    return i;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Add occurrences of a word if delta is positive, or take them away if it is negative */
+
+static void
+edit_words_count (edit_words_t * words, const char *word, gsize len, int delta)
+{
+    guint32 node = 0;
+    gsize i;
+
+    if (words->nodes == NULL)
+        return;
+
+    EDIT_WORDS_NODE (words, 0)->words += delta;
+
+    for (i = 0; i < len; i++)
+    {
+        guint32 child;
+
+        child = edit_words_find (words, node, (unsigned char) word[i]);
+        if (child == 0 && delta > 0)
+            child = edit_words_add_child (words, node, (unsigned char) word[i]);
+        if (child == 0)
+            return;
+
+        node = child;
+        EDIT_WORDS_NODE (words, node)->words += delta;
+    }
+
+    EDIT_WORDS_NODE (words, node)->count += delta;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_words_count_batch (gpointer key, gpointer value, gpointer data)
+{
+    char *word = (char *) key;
+
+    edit_words_count ((edit_words_t *) data, word, strlen (word), GPOINTER_TO_INT (value));
+    g_free (word);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Count a word, or add it to a batch of words that are counted at once */
+
+static void
+edit_words_add (edit_words_t * words, GHashTable * batch, char *word, gsize len, int delta)
+{
+    gpointer key, value;
+
+    if (batch == NULL)
+    {
+        edit_words_count (words, word, len, delta);
+        return;
+    }
+
+    /* the keys are freed when the batch is counted */
+    word[len] = '\0';
+    if (g_hash_table_lookup_extended (batch, word, &key, &value))
+        g_hash_table_insert (batch, key, GINT_TO_POINTER (GPOINTER_TO_INT (value) + delta));
+    else
+        g_hash_table_insert (batch, g_strndup (word, len), GINT_TO_POINTER (delta));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count the words of a part of the text that begins and ends between words. The words of a big
+ * part repeat, so they are collected first and each different word goes through the trie once.
+ */
+
+static void
+edit_words_scan (edit_words_t * words, const edit_buffer_t * buf, off_t start, off_t end,
+                 int delta)
+{
+    char word[EDIT_WORDS_MAX_LEN + 1];
+    GHashTable *batch = NULL;
+    gsize len = 0;
+    off_t i, n;
+
+    if (end - start > EDIT_WORDS_BATCH)
+        batch = g_hash_table_new (g_str_hash, g_str_equal);
+
+    for (i = start; i < end && words->nodes != NULL; i += n)
+    {
+        const char *p;
+        off_t j;
+
+        p = edit_buffer_get_span (buf, i, &n);
+        if (p == NULL)
+            break;
+        n = MIN (n, end - i);
+
+        for (j = 0; j < n && words->nodes != NULL; j++)
+        {
+            if (edit_words_is_word_byte ((unsigned char) p[j]))
+            {
+                if (len < EDIT_WORDS_MAX_LEN)
+                    word[len] = p[j];
+                len++;
+            }
+            else
+            {
+                if (len != 0 && len <= EDIT_WORDS_MAX_LEN)
+                    edit_words_add (words, batch, word, len, delta);
+                len = 0;
+            }
+        }
+    }
+
+    if (words->nodes != NULL && len != 0 && len <= EDIT_WORDS_MAX_LEN)
+        edit_words_add (words, batch, word, len, delta);
+
+    if (batch != NULL)
+    {
+        g_hash_table_foreach (batch, edit_words_count_batch, words);
+        g_hash_table_destroy (batch);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_words_walk (const edit_words_t * words, guint32 node, GString * word, edit_words_fn fn,
+                 gpointer data)
+{
+    guint32 i;
+
+    for (i = EDIT_WORDS_NODE (words, node)->child; i != 0; i = EDIT_WORDS_NODE (words, i)->next)
+    {
+        const edit_words_node_t *n = EDIT_WORDS_NODE (words, i);
+
+        if (n->words == 0)
+            continue;
+
+        g_string_append_c (word, (char) n->c);
+        if (n->count != 0)
+            fn (word, n->count, data);
+        edit_words_walk (words, i, word, fn, data);
+        g_string_truncate (word, word->len - 1);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+edit_words_is_word_byte (int c)
+{
+    return (c > 0 && !g_ascii_isspace (c) && strchr (EDIT_WORDS_BREAKS, c) == NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Make the word index of a text.
+ *
+ * @param buf pointer to editor buffer
+ *
+ * @return the index, it has given up already if the text has too many different words
+ */
+
+edit_words_t *
+edit_words_new (const edit_buffer_t * buf)
+{
+    edit_words_t *words;
+
+    words = g_new0 (edit_words_t, 1);
+    words->nodes = g_array_sized_new (FALSE, TRUE, sizeof (edit_words_node_t), 1024);
+    g_array_set_size (words->nodes, 1);
+    words->edges = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    edit_words_scan (words, buf, 0, buf->size, 1);
+
+    return words;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+edit_words_free (edit_words_t * words)
+{
+    if (words == NULL)
+        return;
+
+    if (words->nodes != NULL)
+    {
+        g_array_free (words->nodes, TRUE);
+        g_hash_table_destroy (words->edges);
+    }
+    g_free (words);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Take the words that touch a change out of the index, before the change.
+ *
+ * @param words word index
+ * @param buf pointer to editor buffer
+ * @param offset where the text changes
+ * @param len number of bytes that are deleted there, 0 for an insertion
+ */
+
+void
+edit_words_change_begin (edit_words_t * words, const edit_buffer_t * buf, off_t offset,
+                         off_t len)
+{
+    off_t start, end;
+
+    if (words->nodes == NULL)
+        return;
+
+    /* a run longer than a word that is indexed can stop the search, it is not counted anyway */
+    for (start = offset; start > 0 && offset - start <= EDIT_WORDS_MAX_LEN
+         && edit_words_is_word_byte (edit_buffer_get_byte (buf, start - 1)); start--)
+        ;
+    for (end = offset + len; end < buf->size && end - (offset + len) <= EDIT_WORDS_MAX_LEN
+         && edit_words_is_word_byte (edit_buffer_get_byte (buf, end)); end++)
+        ;
+
+    edit_words_scan (words, buf, start, end, -1);
+
+    words->change_start = start;
+    words->change_offset = offset;
+    words->change_tail = end - (offset + len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Put the words of the place of a change back into the index, after the change.
+ *
+ * @param words word index
+ * @param buf pointer to editor buffer
+ * @param len number of bytes that are inserted at the offset of edit_words_change_begin()
+ */
+
+void
+edit_words_change_end (edit_words_t * words, const edit_buffer_t * buf, off_t len)
+{
+    if (words->nodes == NULL)
+        return;
+
+    edit_words_scan (words, buf, words->change_start,
+                     words->change_offset + len + words->change_tail, 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the words that are longer than a prefix and begin with it.
+ *
+ * @param words word index
+ * @param prefix the beginning of the words
+ * @param len length of the prefix
+ * @param fn function that gets each word and the number of its occurrences
+ * @param data data for the function
+ *
+ * @return FALSE if the index gave up
+ */
+
+gboolean
+edit_words_complete (const edit_words_t * words, const char *prefix, gsize len,
+                     edit_words_fn fn, gpointer data)
+{
+    GString *word;
+    guint32 node = 0;
+    gsize i;
+
+    if (words->nodes == NULL)
+        return FALSE;
+
+    for (i = 0; i < len; i++)
+    {
+        node = edit_words_find (words, node, (unsigned char) prefix[i]);
+        if (node == 0)
+            return TRUE;
+    }
+
+    word = g_string_new_len (prefix, len);
+    edit_words_walk (words, node, word, fn, data);
+    g_string_free (word, TRUE);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,39 @@
+/** \file
+ *  \brief Header: word index of the text of WEdit
+ */
+
+#ifndef MC__EDIT_WORDS_H
+#define MC__EDIT_WORDS_H
+
+#include "editbuffer.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* called for each word of the index that begins with a prefix */
+typedef void (*edit_words_fn) (const GString * word, guint count, gpointer data);
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct edit_words_struct edit_words_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+gboolean edit_words_is_word_byte (int c);
+
+edit_words_t *edit_words_new (const edit_buffer_t * buf);
+void edit_words_free (edit_words_t * words);
+
+void edit_words_change_begin (edit_words_t * words, const edit_buffer_t * buf, off_t offset,
+                              off_t len);
+void edit_words_change_end (edit_words_t * words, const edit_buffer_t * buf, off_t len);
+
+gboolean edit_words_complete (const edit_words_t * words, const char *prefix, gsize len,
+                              edit_words_fn fn, gpointer data);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__EDIT_WORDS_H */
@@ -0,0 +1,302 @@
+/*
+   Editor writing of the text to a local file.
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: editor writing of the text to a local file.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <limits.h>             /* IOV_MAX */
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "lib/global.h"
+
+#include "editwriter.h"
+
+/* --------------------------------------------------------------------------------------------- */
+/*-
+ * The text is given as spans of memory, see edit_buffer_get_spans(), and a batch of them is
+ * written with one writev() call.
+ *
+ * The spans of a piece table stay valid while the text is edited, so they can be written by a
+ * thread while the user goes on: edit_writer_start() takes them and the descriptor, and the
+ * editor looks at the progress and waits for the end from its idle steps.
+ */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* spans written at once */
+#if defined (IOV_MAX) && IOV_MAX < 64
+#define EDIT_WRITER_BATCH IOV_MAX
+#else
+#define EDIT_WRITER_BATCH 64
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+struct edit_writer_struct
+{
+    GThread *thread;
+    int fd;
+    GArray *spans;
+    gboolean sync;
+
+    GMutex lock;
+    GCond cond;
+    off_t written;              /* guarded by lock */
+    int error;                  /* guarded by lock */
+    gboolean done;              /* guarded by lock */
+};
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/** Write a batch of spans, a short write is continued where it stopped */
+
+static off_t
+edit_writer_batch (int fd, const struct iovec *spans, int n, int *error)
+{
+    struct iovec iov[EDIT_WRITER_BATCH];
+    off_t ret = 0;
+    int first = 0;
+
+    memcpy (iov, spans, n * sizeof (iov[0]));
+
+    while (first < n)
+    {
+        ssize_t sz;
+
+        sz = writev (fd, iov + first, n - first);
+        if (sz <= 0)
+        {
+            if (sz == -1 && errno == EINTR)
+                continue;
+
+            *error = (sz == 0) ? ENOSPC : errno;
+            break;
+        }
+
+        ret += sz;
+
+        for (; first < n && (size_t) sz >= iov[first].iov_len; first++)
+            sz -= iov[first].iov_len;
+        if (first < n)
+        {
+            iov[first].iov_base = (char *) iov[first].iov_base + sz;
+            iov[first].iov_len -= sz;
+        }
+    }
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Write the spans, and tell the progress to the writer if there is one */
+
+static off_t
+edit_writer_spans (edit_writer_t * w, int fd, const GArray * spans, gboolean sync, int *error)
+{
+    off_t ret = 0;
+    guint i;
+
+    *error = 0;
+
+    for (i = 0; i < spans->len && *error == 0; i += EDIT_WRITER_BATCH)
+    {
+        ret += edit_writer_batch (fd, &g_array_index (spans, struct iovec, i),
+                                  (int) MIN (spans->len - i, (guint) EDIT_WRITER_BATCH), error);
+
+        if (w != NULL)
+        {
+            g_mutex_lock (&w->lock);
+            w->written = ret;
+            g_cond_broadcast (&w->cond);
+            g_mutex_unlock (&w->lock);
+        }
+    }
+
+    if (*error == 0 && sync)
+    {
+#ifdef HAVE_FDATASYNC
+        if (fdatasync (fd) != 0)
+#else
+        if (fsync (fd) != 0)
+#endif
+            *error = errno;
+    }
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+edit_writer_thread (gpointer data)
+{
+    edit_writer_t *w = (edit_writer_t *) data;
+    off_t written;
+    int error;
+
+    written = edit_writer_spans (w, w->fd, w->spans, w->sync, &error);
+
+    /* closing a file of a network file system waits for the data too */
+    if (close (w->fd) != 0 && error == 0)
+        error = errno;
+
+    g_mutex_lock (&w->lock);
+    w->written = written;
+    w->error = error;
+    w->done = TRUE;
+    g_cond_broadcast (&w->cond);
+    g_mutex_unlock (&w->lock);
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write the text to a file.
+ *
+ * @param fd descriptor of a local file
+ * @param spans the text as an array of struct iovec
+ * @param sync flush the written data to the disk
+ * @param error errno of the failure, or 0
+ *
+ * @return number of written bytes
+ */
+
+off_t
+edit_writer_write (int fd, const GArray * spans, gboolean sync, int *error)
+{
+    return edit_writer_spans (NULL, fd, spans, sync, error);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write the text to a file in a thread. The memory of the spans must not change until
+ * edit_writer_free().
+ *
+ * @param fd descriptor of a local file, it is closed when the text is written
+ * @param spans the text as an array of struct iovec, it is freed with the writer
+ * @param sync flush the written data to the disk
+ *
+ * @return the writer
+ */
+
+edit_writer_t *
+edit_writer_start (int fd, GArray * spans, gboolean sync)
+{
+    edit_writer_t *w;
+
+    w = g_new0 (edit_writer_t, 1);
+    w->fd = fd;
+    w->spans = spans;
+    w->sync = sync;
+    g_mutex_init (&w->lock);
+    g_cond_init (&w->cond);
+
+    w->thread = g_thread_new ("edit-writer", edit_writer_thread, w);
+
+    return w;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait until the text is written, or until some time.
+ *
+ * @param w writer
+ * @param end_time monotonic time to give up at, or -1 to wait until the end
+ *
+ * @return TRUE if the text is written
+ */
+
+gboolean
+edit_writer_wait (edit_writer_t * w, gint64 end_time)
+{
+    gboolean done;
+
+    g_mutex_lock (&w->lock);
+    if (end_time < 0)
+        while (!w->done)
+            g_cond_wait (&w->cond, &w->lock);
+    else if (!w->done)
+        (void) g_cond_wait_until (&w->cond, &w->lock, end_time);
+    done = w->done;
+    g_mutex_unlock (&w->lock);
+
+    return done;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+off_t
+edit_writer_get_progress (edit_writer_t * w)
+{
+    off_t written;
+
+    g_mutex_lock (&w->lock);
+    written = w->written;
+    g_mutex_unlock (&w->lock);
+
+    return written;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait until the text is written and free the writer.
+ *
+ * @param w writer
+ * @param error errno of the failure, or 0
+ *
+ * @return number of written bytes
+ */
+
+off_t
+edit_writer_free (edit_writer_t * w, int *error)
+{
+    off_t written;
+
+    g_thread_join (w->thread);
+
+    written = w->written;
+    *error = w->error;
+
+    g_array_free (w->spans, TRUE);
+    g_mutex_clear (&w->lock);
+    g_cond_clear (&w->cond);
+    g_free (w);
+
+    return written;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,29 @@
+/** \file
+ *  \brief Header: writing of the text of WEdit to a local file
+ */
+
+#ifndef MC__EDIT_WRITER_H
+#define MC__EDIT_WRITER_H
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct edit_writer_struct edit_writer_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+off_t edit_writer_write (int fd, const GArray * spans, gboolean sync, int *error);
+
+edit_writer_t *edit_writer_start (int fd, GArray * spans, gboolean sync);
+gboolean edit_writer_wait (edit_writer_t * w, gint64 end_time);
+off_t edit_writer_get_progress (edit_writer_t * w);
+off_t edit_writer_free (edit_writer_t * w, int *error);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__EDIT_WRITER_H */
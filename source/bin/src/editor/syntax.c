@@ -74,6 +74,8 @@ gboolean option_auto_syntax = TRUE;
 
 /* bytes */
 #define SYNTAX_MARKER_DENSITY 512
+/* bytes scanned ahead of the screen in one idle step */
+#define SYNTAX_PRESCAN_STEP (64 * 1024)
 
 #define RULE_ON_LEFT_BORDER 1
 #define RULE_ON_RIGHT_BORDER 2
@@ -90,6 +92,9 @@ gboolean option_auto_syntax = TRUE;
 #define SYNTAX_KEYWORD(x) ((syntax_keyword_t *) (x))
 #define CONTEXT_RULE(x) ((context_rule_t *) (x))
 
+/* key of the edge of the keyword trie from a node by a byte */
+#define KEYWORD_EDGE(node, c) GUINT_TO_POINTER (((guint) (node) << 8) | (unsigned char) (c))
+
 #define ARGS_LEN 1024
 
 #define MAX_ENTRY_LEN 40
@@ -118,10 +123,13 @@ typedef struct
     gboolean between_delimiters;
     char *whole_word_chars_left;
     char *whole_word_chars_right;
-    char *keyword_first_chars;
     gboolean spelling;
     /* first word is word[1] */
     GPtrArray *keyword;
+    /* trie of the keywords by their bytes up to the first wildcard, the root is the node 0:
+       for each node, the GArray of the indexes of the keywords that end there or NULL */
+    GPtrArray *keyword_nodes;
+    GHashTable *keyword_edges;  /* KEYWORD_EDGE (node, byte) -> next node */
 } context_rule_t;
 
 typedef struct
@@ -160,7 +168,23 @@ context_rule_free (gpointer rule)
     g_free (r->right);
     g_free (r->whole_word_chars_left);
     g_free (r->whole_word_chars_right);
-    g_free (r->keyword_first_chars);
+
+    if (r->keyword_nodes != NULL)
+    {
+        guint i;
+
+        for (i = 0; i < r->keyword_nodes->len; i++)
+        {
+            GArray *ends;
+
+            ends = (GArray *) g_ptr_array_index (r->keyword_nodes, i);
+            if (ends != NULL)
+                g_array_free (ends, TRUE);
+        }
+
+        g_ptr_array_free (r->keyword_nodes, TRUE);
+        g_hash_table_destroy (r->keyword_edges);
+    }
 
     if (r->keyword != NULL)
     {
@@ -171,6 +195,52 @@ context_rule_free (gpointer rule)
     g_free (r);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Build the trie of the keywords of a context */
+
+static void
+context_rule_compile_keywords (gpointer rule)
+{
+    context_rule_t *r = CONTEXT_RULE (rule);
+    guint j;
+
+    r->keyword_nodes = g_ptr_array_new ();
+    g_ptr_array_add (r->keyword_nodes, NULL);
+    r->keyword_edges = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    for (j = 1; j < r->keyword->len; j++)
+    {
+        const unsigned char *p;
+        guint node = 0;
+        GArray *ends;
+
+        /* the bytes before a wildcard are compared as they are */
+        p = (const unsigned char *) SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, j))->keyword;
+        for (; *p > SYNTAX_TOKEN_BRACE; p++)
+        {
+            gpointer next;
+
+            next = g_hash_table_lookup (r->keyword_edges, KEYWORD_EDGE (node, *p));
+            if (next == NULL)
+            {
+                next = GUINT_TO_POINTER (r->keyword_nodes->len);
+                g_ptr_array_add (r->keyword_nodes, NULL);
+                g_hash_table_insert (r->keyword_edges, KEYWORD_EDGE (node, *p), next);
+            }
+
+            node = GPOINTER_TO_UINT (next);
+        }
+
+        ends = (GArray *) g_ptr_array_index (r->keyword_nodes, node);
+        if (ends == NULL)
+        {
+            ends = g_array_new (FALSE, FALSE, sizeof (guint));
+            g_ptr_array_index (r->keyword_nodes, node) = ends;
+        }
+        g_array_append_val (ends, j);
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static gint
@@ -353,13 +423,70 @@ compare_word_to_right (const WEdit * edit, off_t i, const char *text,
 
 /* --------------------------------------------------------------------------------------------- */
 
-static const char *
-xx_strchr (const WEdit * edit, const unsigned char *s, int char_byte)
+/**
+ * Find the keyword of a context that matches at an offset. Only the keywords whose bytes up to
+ * the first wildcard are found by walking the trie from there are compared in full.
+ *
+ * @param edit editor object
+ * @param r context rule
+ * @param i offset in the text
+ * @param keyword index of the keyword that matches
+ *
+ * @return the end of the first keyword in the order of the syntax file that matches, or -1
+ */
+
+static off_t
+context_rule_match_keyword (const WEdit * edit, const context_rule_t * r, off_t i, int *keyword)
 {
-    while (*s >= '\005' && xx_tolower (edit, *s) != char_byte)
-        s++;
+    guint node = 0;
+    guint best = G_MAXUINT;
+    off_t best_end = -1;
+    off_t j;
 
-    return (const char *) s;
+    if (r->keyword_nodes == NULL)
+        return -1;
+
+    for (j = i;; j++)
+    {
+        GArray *ends;
+        int c;
+        gpointer next;
+
+        /* the indexes of a node are sorted, only an earlier keyword than one found may win */
+        ends = (GArray *) g_ptr_array_index (r->keyword_nodes, node);
+        if (ends != NULL)
+        {
+            guint n;
+
+            for (n = 0; n < ends->len && g_array_index (ends, guint, n) < best; n++)
+            {
+                syntax_keyword_t *k;
+                off_t e;
+
+                k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, g_array_index (ends, guint, n)));
+                e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
+                                           k->whole_word_chars_right, k->line_start);
+                if (e > 0)
+                {
+                    best = g_array_index (ends, guint, n);
+                    best_end = e;
+                    break;
+                }
+            }
+        }
+
+        c = xx_tolower (edit, edit_buffer_get_byte (&edit->buffer, j));
+        next = g_hash_table_lookup (r->keyword_edges, KEYWORD_EDGE (node, c));
+        if (next == NULL)
+            break;
+
+        node = GPOINTER_TO_UINT (next);
+    }
+
+    if (best_end > 0)
+        *keyword = (int) best;
+
+    return best_end;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -430,42 +557,32 @@ apply_rules_going_right (WEdit * edit, off_t i)
     /* check to turn on a keyword */
     if (_rule.keyword == 0)
     {
-        const char *p;
+        int count;
+        off_t e;
 
         r = CONTEXT_RULE (g_ptr_array_index (edit->rules, _rule.context));
-        p = r->keyword_first_chars;
-
-        if (p != NULL)
-            while (*(p = xx_strchr (edit, (const unsigned char *) p + 1, c)) != '\0')
-            {
-                syntax_keyword_t *k;
-                int count;
-                off_t e;
+        e = context_rule_match_keyword (edit, r, i, &count);
+        if (e > 0)
+        {
+            syntax_keyword_t *k;
 
-                count = p - r->keyword_first_chars;
-                k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, count));
-                e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
-                                           k->whole_word_chars_right, k->line_start);
-                if (e > 0)
-                {
-                    /* when both context and keyword terminate with a newline,
-                       the context overflows to the next line and colorizes it incorrectly */
-                    if (e > i + 1 && _rule._context != 0
-                        && k->keyword[strlen (k->keyword) - 1] == '\n')
-                    {
-                        r = CONTEXT_RULE (g_ptr_array_index (edit->rules, _rule._context));
-                        if (r->right != NULL && r->right[0] != '\0'
-                            && r->right[strlen (r->right) - 1] == '\n')
-                            e--;
-                    }
+            k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, count));
 
-                    end = e;
-                    _rule.end = e;
-                    _rule.keyword = count;
-                    keyword_foundright = TRUE;
-                    break;
-                }
+            /* when both context and keyword terminate with a newline,
+               the context overflows to the next line and colorizes it incorrectly */
+            if (e > i + 1 && _rule._context != 0 && k->keyword[strlen (k->keyword) - 1] == '\n')
+            {
+                r = CONTEXT_RULE (g_ptr_array_index (edit->rules, _rule._context));
+                if (r->right != NULL && r->right[0] != '\0'
+                    && r->right[strlen (r->right) - 1] == '\n')
+                    e--;
             }
+
+            end = e;
+            _rule.end = e;
+            _rule.keyword = count;
+            keyword_foundright = TRUE;
+        }
     }
 
     /* check to turn on a context */
@@ -542,27 +659,15 @@ apply_rules_going_right (WEdit * edit, off_t i)
     /* check again to turn on a keyword if the context switched */
     if (contextchanged && _rule.keyword == 0)
     {
-        const char *p;
+        int count;
+        off_t e;
 
         r = CONTEXT_RULE (g_ptr_array_index (edit->rules, _rule.context));
-        p = r->keyword_first_chars;
-
-        while (*(p = xx_strchr (edit, (const unsigned char *) p + 1, c)) != '\0')
+        e = context_rule_match_keyword (edit, r, i, &count);
+        if (e > 0)
         {
-            syntax_keyword_t *k;
-            int count;
-            off_t e;
-
-            count = p - r->keyword_first_chars;
-            k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, count));
-            e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
-                                       k->whole_word_chars_right, k->line_start);
-            if (e > 0)
-            {
-                _rule.end = e;
-                _rule.keyword = count;
-                break;
-            }
+            _rule.end = e;
+            _rule.keyword = count;
         }
     }
 
@@ -571,66 +676,130 @@ apply_rules_going_right (WEdit * edit, off_t i)
 
 /* --------------------------------------------------------------------------------------------- */
 
-static void
-edit_get_rule (WEdit * edit, off_t byte_index)
+/**
+ * Find the last checkpoint at or before an offset.
+ *
+ * @param edit editor object
+ * @param byte_index offset in the text
+ *
+ * @return the checkpoint, or NULL if there is none
+ */
+
+static const syntax_marker_t *
+edit_syntax_find_marker (const WEdit * edit, off_t byte_index)
 {
-    off_t i;
+    const GArray *markers = edit->syntax_marker;
+    guint lo = 0, hi;
+
+    if (markers == NULL)
+        return NULL;
 
-    if (byte_index > edit->last_get_rule)
+    /* the checkpoints are sorted by offset */
+    hi = markers->len;
+    while (lo < hi)
     {
-        for (i = edit->last_get_rule + 1; i <= byte_index; i++)
-        {
-            off_t d = SYNTAX_MARKER_DENSITY;
+        guint mid;
+
+        mid = lo + (hi - lo) / 2;
+        if (g_array_index (markers, syntax_marker_t, mid).offset <= byte_index)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
 
-            apply_rules_going_right (edit, i);
+    return (lo == 0) ? NULL : &g_array_index (markers, syntax_marker_t, lo - 1);
+}
 
-            if (edit->syntax_marker != NULL)
-                d += ((syntax_marker_t *) edit->syntax_marker->data)->offset;
+/* --------------------------------------------------------------------------------------------- */
 
-            if (i > d)
-            {
-                syntax_marker_t *s;
+static const syntax_marker_t *
+edit_syntax_last_marker (const WEdit * edit)
+{
+    const GArray *markers = edit->syntax_marker;
 
-                s = g_new (syntax_marker_t, 1);
-                s->offset = i;
-                s->rule = edit->rule;
-                edit->syntax_marker = g_slist_prepend (edit->syntax_marker, s);
-            }
-        }
+    if (markers == NULL || markers->len == 0)
+        return NULL;
+
+    return &g_array_index (markers, syntax_marker_t, markers->len - 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Continue the scan from a checkpoint, or from the start of the text if it is NULL */
+
+static void
+edit_syntax_restore (WEdit * edit, const syntax_marker_t * s)
+{
+    if (s != NULL)
+    {
+        edit->rule = s->rule;
+        edit->last_get_rule = s->offset;
     }
-    else if (byte_index < edit->last_get_rule)
+    else
     {
-        while (TRUE)
-        {
-            syntax_marker_t *s;
+        memset (&edit->rule, 0, sizeof (edit->rule));
+        apply_rules_going_right (edit, -1);
+        edit->last_get_rule = -1;
+    }
+}
 
-            if (edit->syntax_marker == NULL)
-            {
-                memset (&edit->rule, 0, sizeof (edit->rule));
-                for (i = -1; i <= byte_index; i++)
-                    apply_rules_going_right (edit, i);
-                break;
-            }
+/* --------------------------------------------------------------------------------------------- */
+/** Apply the rules up to an offset, adding a checkpoint each SYNTAX_MARKER_DENSITY bytes */
 
-            s = (syntax_marker_t *) edit->syntax_marker->data;
+static void
+edit_syntax_scan (WEdit * edit, off_t byte_index)
+{
+    const syntax_marker_t *last;
+    off_t d = SYNTAX_MARKER_DENSITY;
+    off_t i;
 
-            if (byte_index >= s->offset)
-            {
-                edit->rule = s->rule;
-                for (i = s->offset + 1; i <= byte_index; i++)
-                    apply_rules_going_right (edit, i);
-                break;
-            }
+    last = edit_syntax_last_marker (edit);
+    if (last != NULL)
+        d += last->offset;
+
+    for (i = edit->last_get_rule + 1; i <= byte_index; i++)
+    {
+        apply_rules_going_right (edit, i);
+
+        /* only the scan past the last checkpoint adds new ones */
+        if (i > d)
+        {
+            syntax_marker_t s;
+
+            if (edit->syntax_marker == NULL)
+                edit->syntax_marker = g_array_new (FALSE, FALSE, sizeof (syntax_marker_t));
 
-            g_free (s);
-            edit->syntax_marker = g_slist_delete_link (edit->syntax_marker, edit->syntax_marker);
+            s.offset = i;
+            s.rule = edit->rule;
+            g_array_append_val (edit->syntax_marker, s);
+            d = i + SYNTAX_MARKER_DENSITY;
         }
     }
+
     edit->last_get_rule = byte_index;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
+static void
+edit_get_rule (WEdit * edit, off_t byte_index)
+{
+    /* start from the nearest checkpoint when going back or jumping far ahead */
+    if (byte_index < edit->last_get_rule)
+        edit_syntax_restore (edit, edit_syntax_find_marker (edit, byte_index));
+    else if (byte_index - edit->last_get_rule > SYNTAX_MARKER_DENSITY)
+    {
+        const syntax_marker_t *s;
+
+        s = edit_syntax_find_marker (edit, byte_index);
+        if (s != NULL && s->offset > edit->last_get_rule)
+            edit_syntax_restore (edit, s);
+    }
+
+    edit_syntax_scan (edit, byte_index);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 translate_rule_to_color (const WEdit * edit, const edit_syntax_rule_t * rule)
 {
@@ -1219,35 +1388,10 @@ edit_read_syntax_rules (WEdit * edit, FILE * f, char **args, int args_size)
 
     if (result == 0)
     {
-        size_t i;
-        GString *first_chars;
-
         if (edit->rules == NULL)
             return line;
 
-        first_chars = g_string_sized_new (32);
-
-        /* collect first character of keywords */
-        for (i = 0; i < edit->rules->len; i++)
-        {
-            size_t j;
-
-            g_string_set_size (first_chars, 0);
-            c = CONTEXT_RULE (g_ptr_array_index (edit->rules, i));
-
-            g_string_append_c (first_chars, (char) 1);
-            for (j = 1; j < c->keyword->len; j++)
-            {
-                syntax_keyword_t *k;
-
-                k = SYNTAX_KEYWORD (g_ptr_array_index (c->keyword, j));
-                g_string_append_c (first_chars, k->keyword[0]);
-            }
-
-            c->keyword_first_chars = g_strndup (first_chars->str, first_chars->len);
-        }
-
-        g_string_free (first_chars, TRUE);
+        g_ptr_array_foreach (edit->rules, (GFunc) context_rule_compile_keywords, NULL);
     }
 
     return result;
@@ -1463,6 +1607,95 @@ edit_get_syntax_color (WEdit * edit, off_t byte_index)
     return EDITOR_NORMAL_COLOR;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Drop the checkpoints that a change of the text at an offset makes stale: those after it, those
+ * in a keyword or a context whose end was found after it, and those close enough before it for a
+ * keyword that now matches to span them.
+ *
+ * @param edit editor object
+ * @param offset the first changed byte
+ */
+
+void
+edit_syntax_invalidate (WEdit * edit, off_t offset)
+{
+    GArray *markers = edit->syntax_marker;
+
+    if (edit->rules == NULL)
+        return;
+
+    if (markers != NULL)
+    {
+        guint n;
+
+        for (n = markers->len; n > 0; n--)
+        {
+            const syntax_marker_t *s;
+
+            s = &g_array_index (markers, syntax_marker_t, n - 1);
+            if (s->offset + SYNTAX_MARKER_DENSITY < offset && s->rule.end < offset)
+                break;
+        }
+
+        g_array_set_size (markers, n);
+    }
+
+    if (edit->last_get_rule + SYNTAX_MARKER_DENSITY >= offset || edit->rule.end >= offset)
+        edit_syntax_restore (edit, edit_syntax_last_marker (edit));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+edit_syntax_prescan_pending (const WEdit * edit)
+{
+    const syntax_marker_t *last;
+    off_t d = SYNTAX_MARKER_DENSITY;
+
+    if (edit->rules == NULL || !option_syntax_highlighting)
+        return FALSE;
+
+    last = edit_syntax_last_marker (edit);
+    if (last != NULL)
+        d += last->offset;
+
+    return (d < edit->buffer.size - 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add the checkpoints of the next SYNTAX_PRESCAN_STEP bytes after the last one while the user
+ * does nothing, so that a jump far into the file does not scan all the text before it.
+ *
+ * @param edit editor object
+ *
+ * @return TRUE if there is more text to scan
+ */
+
+gboolean
+edit_syntax_prescan (WEdit * edit)
+{
+    edit_syntax_rule_t rule;
+    off_t last_get_rule;
+
+    if (!edit_syntax_prescan_pending (edit))
+        return FALSE;
+
+    /* the state of the screen is kept */
+    rule = edit->rule;
+    last_get_rule = edit->last_get_rule;
+
+    edit_syntax_restore (edit, edit_syntax_last_marker (edit));
+    edit_syntax_scan (edit, MIN (edit->last_get_rule + SYNTAX_PRESCAN_STEP,
+                                 edit->buffer.size - 1));
+
+    edit->rule = rule;
+    edit->last_get_rule = last_get_rule;
+
+    return edit_syntax_prescan_pending (edit);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 void
@@ -1483,7 +1716,11 @@ edit_free_syntax_rules (WEdit * edit)
     g_ptr_array_foreach (edit->rules, (GFunc) context_rule_free, NULL);
     g_ptr_array_free (edit->rules, TRUE);
     edit->rules = NULL;
-    g_clear_slist (&edit->syntax_marker, g_free);
+    if (edit->syntax_marker != NULL)
+    {
+        g_array_free (edit->syntax_marker, TRUE);
+        edit->syntax_marker = NULL;
+    }
     tty_color_free_all_tmp ();
 }
 
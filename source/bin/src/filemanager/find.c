@@ -32,10 +32,17 @@
 #include <config.h>
 
 #include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #include "lib/global.h"
 
@@ -47,7 +54,7 @@
 #include "lib/vfs/vfs.h"
 #include "lib/strutil.h"
 #include "lib/widget.h"
-#include "lib/util.h"           /* canonicalize_pathname() */
+#include "lib/util.h"           /* canonicalize_pathname(), count_newlines(), mc_mmap_read() */
 
 #include "src/setup.h"          /* verbose */
 #include "src/history.h"        /* MC_HISTORY_SHARED_SEARCH */
@@ -56,6 +63,7 @@
 #include "cmd.h"                /* find_cmd(), view_file_at_line() */
 #include "boxes.h"
 #include "panelize.h"
+#include "findindex.h"
 
 /*** global variables ****************************************************************************/
 
@@ -64,6 +72,28 @@
 #define MAX_REFRESH_INTERVAL (G_USEC_PER_SEC / 20)      /* 50 ms */
 #define MIN_REFRESH_FILE_SIZE (256 * 1024)      /* 256 KB */
 
+/* Most threads reading local directories and searching in local files, each; they wait for
+   the disk more than for the CPU */
+#define FIND_WORKERS_MAX 8
+
+/* Most files waiting to be searched or to have their matches shown */
+#define FIND_JOBS_MAX 4096
+
+/* Number of files found by the walkers to be taken by the dialog at once */
+#define FIND_FILES_STEP 256
+
+/* Files up to this size are read rather than mapped, it is also the size of the first read */
+#define FIND_READ_SIZE (64 * 1024)
+
+/* Amount of data searched at once, the workers check for suspension between two such pieces */
+#define FIND_SCAN_SIZE (4 * 1024 * 1024)
+
+/* Size of the read buffer for files of other VFS */
+#define FIND_VFS_READ_SIZE (128 * 1024)
+
+/* How long the dialog waits for the workers when there is nothing else to do */
+#define FIND_WAIT_INTERVAL (G_USEC_PER_SEC / 100)       /* 10 ms */
+
 /*** file scope type declarations ****************************************************************/
 
 /* A couple of extra messages we need */
@@ -97,9 +127,11 @@ typedef struct
     /* file content options */
     gboolean content_case_sens;
     gboolean content_regexp;
+    gboolean content_multi;
     gboolean content_first_hit;
     gboolean content_whole_words;
     gboolean content_all_charsets;
+    gboolean content_use_index;
 
     /* whether use ignore dirs or not */
     gboolean ignore_dirs_enable;
@@ -114,6 +146,32 @@ typedef struct
     gsize end;
 } find_match_location_t;
 
+/* a match found by a worker */
+typedef struct
+{
+    int line;
+    gsize start;
+    gsize end;
+} find_hit_t;
+
+/* a local file to be searched by the workers */
+typedef struct
+{
+    char *directory;
+    char *filename;
+    GArray *hits;               /* find_hit_t, guarded by find_lock */
+    gboolean done;              /* guarded by find_lock */
+    guint shown;                /* number of the hits in the list already */
+} find_job_t;
+
+/* the files found in a local directory by a walker */
+typedef struct
+{
+    char *directory;
+    GPtrArray *files;           /* names of the files matching the pattern */
+    size_t ignored;             /* number of the entries ignored */
+} find_dir_t;
+
 /*** file scope variables ************************************************************************/
 
 /* button callbacks */
@@ -137,8 +195,10 @@ static WCheck *follow_sym_cbox;
 static WCheck *skip_hidden_cbox;
 static WCheck *content_case_sens_cbox;  /* "case sensitive" checkbox */
 static WCheck *content_regexp_cbox;     /* "find regular expression" checkbox */
+static WCheck *content_multi_cbox;      /* "multiple strings" checkbox */
 static WCheck *content_first_hit_cbox;  /* "First hit" checkbox" */
 static WCheck *content_whole_words_cbox;        /* "whole words" checkbox */
+static WCheck *content_use_index_cbox;  /* "use index" checkbox */
 #ifdef HAVE_CHARSET
 static WCheck *file_all_charsets_cbox;
 static WCheck *content_all_charsets_cbox;
@@ -160,7 +220,6 @@ static gint64 last_refresh;
 /* Where did we stop */
 static gboolean resuming;
 static int last_line;
-static int last_pos;
 static off_t last_off;
 static int last_i;
 
@@ -204,7 +263,7 @@ static WListbox *find_list;     /* Listbox with the file list */
 
 static find_file_options_t options = {
     TRUE, TRUE, TRUE, FALSE, FALSE, FALSE,
-    TRUE, FALSE, FALSE, FALSE, FALSE,
+    TRUE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE,
     FALSE, NULL
 };
 
@@ -213,6 +272,25 @@ static char *in_start_dir = INPUT_LAST_TEXT;
 static mc_search_t *search_file_handle = NULL;
 static mc_search_t *search_content_handle = NULL;
 
+/* Local directories are read by a pool of walker threads, which pass the files matching the
+   pattern to the dialog directory by directory. The content of local files is searched by a pool
+   of worker threads. The jobs are kept in the order the files were found, and the matches are
+   shown in that order as they come in. */
+static GThreadPool *find_walk_pool = NULL;
+static GQueue find_dirs = G_QUEUE_INIT; /* find_dir_t, guarded by find_lock */
+static guint find_walk_pending = 0;     /* directories queued or being read, guarded by find_lock */
+static GAsyncQueue *find_name_searches = NULL;  /* search handles of the walkers */
+static GThreadPool *find_pool = NULL;
+static GQueue find_jobs = G_QUEUE_INIT;
+static GAsyncQueue *find_searches = NULL;       /* search handles of the workers */
+static GMutex find_lock;
+static GCond find_cond;
+static FindProgressStatus find_state = FIND_CONT;       /* guarded by find_lock */
+static const find_job_t *find_status_job = NULL;        /* the file named in the status line */
+/* the workers skip the files the index tells not to match */
+static find_index_t *find_index = NULL;
+static find_index_query_t *find_index_query = NULL;
+
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -298,12 +376,16 @@ find_load_options (void)
         mc_config_get_bool (mc_global.main_config, "FindFile", "content_case_sens", TRUE);
     options.content_regexp =
         mc_config_get_bool (mc_global.main_config, "FindFile", "content_regexp", FALSE);
+    options.content_multi =
+        mc_config_get_bool (mc_global.main_config, "FindFile", "content_multi", FALSE);
     options.content_first_hit =
         mc_config_get_bool (mc_global.main_config, "FindFile", "content_first_hit", FALSE);
     options.content_whole_words =
         mc_config_get_bool (mc_global.main_config, "FindFile", "content_whole_words", FALSE);
     options.content_all_charsets =
         mc_config_get_bool (mc_global.main_config, "FindFile", "content_all_charsets", FALSE);
+    options.content_use_index =
+        mc_config_get_bool (mc_global.main_config, "FindFile", "content_use_index", FALSE);
     options.ignore_dirs_enable =
         mc_config_get_bool (mc_global.main_config, "FindFile", "ignore_dirs_enable", TRUE);
     options.ignore_dirs =
@@ -332,12 +414,16 @@ find_save_options (void)
                         options.content_case_sens);
     mc_config_set_bool (mc_global.main_config, "FindFile", "content_regexp",
                         options.content_regexp);
+    mc_config_set_bool (mc_global.main_config, "FindFile", "content_multi",
+                        options.content_multi);
     mc_config_set_bool (mc_global.main_config, "FindFile", "content_first_hit",
                         options.content_first_hit);
     mc_config_set_bool (mc_global.main_config, "FindFile", "content_whole_words",
                         options.content_whole_words);
     mc_config_set_bool (mc_global.main_config, "FindFile", "content_all_charsets",
                         options.content_all_charsets);
+    mc_config_set_bool (mc_global.main_config, "FindFile", "content_use_index",
+                        options.content_use_index);
     mc_config_set_bool (mc_global.main_config, "FindFile", "ignore_dirs_enable",
                         options.ignore_dirs_enable);
     mc_config_set_string (mc_global.main_config, "FindFile", "ignore_dirs", options.ignore_dirs);
@@ -428,6 +514,19 @@ find_toggle_enable_ignore_dirs (void)
     widget_disable (WIDGET (in_ignore), !ignore_dirs_cbox->state);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** The content is a regular expression or a list of strings: checking one clears the other */
+
+static void
+find_toggle_content_type (WCheck * checked, WCheck * other)
+{
+    if (checked->state && other->state)
+    {
+        other->state = FALSE;
+        widget_draw (WIDGET (other));
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static void
@@ -448,12 +547,14 @@ static void
 find_toggle_enable_content (void)
 {
     widget_disable (WIDGET (content_regexp_cbox), content_is_empty);
+    widget_disable (WIDGET (content_multi_cbox), content_is_empty);
     widget_disable (WIDGET (content_case_sens_cbox), content_is_empty);
 #ifdef HAVE_CHARSET
     widget_disable (WIDGET (content_all_charsets_cbox), content_is_empty);
 #endif
     widget_disable (WIDGET (content_whole_words_cbox), content_is_empty);
     widget_disable (WIDGET (content_first_hit_cbox), content_is_empty);
+    widget_disable (WIDGET (content_use_index_cbox), content_is_empty);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -493,6 +594,18 @@ find_parm_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, voi
             return MSG_HANDLED;
         }
 
+        if (sender == WIDGET (content_regexp_cbox))
+        {
+            find_toggle_content_type (content_regexp_cbox, content_multi_cbox);
+            return MSG_HANDLED;
+        }
+
+        if (sender == WIDGET (content_multi_cbox))
+        {
+            find_toggle_content_type (content_multi_cbox, content_regexp_cbox);
+            return MSG_HANDLED;
+        }
+
         return MSG_NOT_HANDLED;
 
     case MSG_VALIDATE:
@@ -569,9 +682,9 @@ find_parameters (WPanel * panel, char **start_dir, ssize_t * start_dir_len,
 
     /* Size of the find parameters window */
 #ifdef HAVE_CHARSET
-    const int lines = 19;
+    const int lines = 20;
 #else
-    const int lines = 18;
+    const int lines = 19;
 #endif
     int cols = 68;
 
@@ -592,12 +705,14 @@ find_parameters (WPanel * panel, char **start_dir, ssize_t * start_dir_len,
     const char *content_content_label = N_("Content:");
     const char *content_use_label = N_("Sea&rch for content");
     const char *content_regexp_label = N_("Re&gular expression");
+    const char *content_multi_label = N_("&Multiple strings");
     const char *content_case_label = N_("Case sens&itive");
 #ifdef HAVE_CHARSET
     const char *content_all_charsets_label = N_("A&ll charsets");
 #endif
     const char *content_whole_words_label = N_("&Whole words");
     const char *content_first_hit_label = N_("Fir&st hit");
+    const char *content_use_index_label = N_("Use in&dex");
 
     const char *buts[] = { N_("&Tree"), N_("&OK"), N_("&Cancel") };
 
@@ -625,12 +740,14 @@ find_parameters (WPanel * panel, char **start_dir, ssize_t * start_dir_len,
         content_content_label = _(content_content_label);
         content_use_label = _(content_use_label);
         content_regexp_label = _(content_regexp_label);
+        content_multi_label = _(content_multi_label);
         content_case_label = _(content_case_label);
 #ifdef HAVE_CHARSET
         content_all_charsets_label = _(content_all_charsets_label);
 #endif
         content_whole_words_label = _(content_whole_words_label);
         content_first_hit_label = _(content_first_hit_label);
+        content_use_index_label = _(content_use_index_label);
 
         for (i = 0; i < G_N_ELEMENTS (buts); i++)
             buts[i] = _(buts[i]);
@@ -653,12 +770,14 @@ find_parameters (WPanel * panel, char **start_dir, ssize_t * start_dir_len,
     cw = max (cw, str_term_width1 (content_content_label) + 4);
     cw = max (cw, str_term_width1 (content_use_label) + 4);
     cw = max (cw, str_term_width1 (content_regexp_label) + 4);
+    cw = max (cw, str_term_width1 (content_multi_label) + 4);
     cw = max (cw, str_term_width1 (content_case_label) + 4);
 #ifdef HAVE_CHARSET
     cw = max (cw, str_term_width1 (content_all_charsets_label) + 4);
 #endif
     cw = max (cw, str_term_width1 (content_whole_words_label) + 4);
     cw = max (cw, str_term_width1 (content_first_hit_label) + 4);
+    cw = max (cw, str_term_width1 (content_use_index_label) + 4);
 
     /* button width */
     b0 = str_term_width1 (buts[0]) + 3;
@@ -751,6 +870,11 @@ find_parameters (WPanel * panel, char **start_dir, ssize_t * start_dir_len,
     content_regexp_cbox = check_new (y2++, x2, options.content_regexp, content_regexp_label);
     group_add_widget (g, content_regexp_cbox);
 
+    content_multi_cbox =
+        check_new (y2++, x2, options.content_multi && !options.content_regexp,
+                   content_multi_label);
+    group_add_widget (g, content_multi_cbox);
+
     content_case_sens_cbox = check_new (y2++, x2, options.content_case_sens, content_case_label);
     group_add_widget (g, content_case_sens_cbox);
 
@@ -764,6 +888,10 @@ find_parameters (WPanel * panel, char **start_dir, ssize_t * start_dir_len,
         check_new (y2++, x2, options.content_first_hit, content_first_hit_label);
     group_add_widget (g, content_first_hit_cbox);
 
+    content_use_index_cbox =
+        check_new (y2++, x2, options.content_use_index, content_use_index_label);
+    group_add_widget (g, content_use_index_cbox);
+
     /* buttons */
     y1 = max (y1, y2);
     x1 = (cols - b12) / 2;
@@ -814,8 +942,10 @@ find_parameters (WPanel * panel, char **start_dir, ssize_t * start_dir_len,
 #endif
             options.content_case_sens = content_case_sens_cbox->state;
             options.content_regexp = content_regexp_cbox->state;
+            options.content_multi = content_multi_cbox->state;
             options.content_first_hit = content_first_hit_cbox->state;
             options.content_whole_words = content_whole_words_cbox->state;
+            options.content_use_index = content_use_index_cbox->state;
             options.find_recurs = recursively_cbox->state;
             options.follow_symlinks = follow_sym_cbox->state;
             options.file_pattern = file_pattern_cbox->state;
@@ -991,12 +1121,467 @@ check_find_events (WDialog * h)
     return FIND_CONT;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Move the reading position of @fd to @offset, by reading the data if the file cannot seek */
+
+static void
+find_skip_data (int fd, off_t offset, char *buf, size_t size)
+{
+    if (mc_lseek (fd, offset, SEEK_SET) == offset)
+        return;
+
+    while (offset > 0)
+    {
+        ssize_t n;
+
+        n = mc_read (fd, buf, (size_t) MIN ((off_t) size, offset));
+        if (n <= 0)
+            break;
+        offset -= n;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_t *
+find_content_search_new (void)
+{
+    mc_search_t *search;
+
+    search = mc_search_new (content_pattern, NULL);
+    if (search != NULL)
+    {
+        if (options.content_regexp)
+            search->search_type = MC_SEARCH_T_REGEX;
+        else if (options.content_multi)
+            search->search_type = MC_SEARCH_T_MULTI;
+        else
+            search->search_type = MC_SEARCH_T_NORMAL;
+        search->is_case_sensitive = options.content_case_sens;
+        search->whole_words = options.content_whole_words;
+#ifdef HAVE_CHARSET
+        search->is_all_charsets = options.content_all_charsets;
+#endif
+    }
+
+    return search;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_job_free (gpointer data)
+{
+    find_job_t *job = (find_job_t *) data;
+
+    g_free (job->directory);
+    g_free (job->filename);
+    g_array_free (job->hits, TRUE);
+    g_free (job);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait while the search is suspended.
+ *
+ * @return FALSE if the search is aborted
+ */
+
+static gboolean
+find_worker_wait (void)
+{
+    gboolean ret;
+
+    g_mutex_lock (&find_lock);
+    while (find_state == FIND_SUSPEND)
+        g_cond_wait (&find_cond, &find_lock);
+    ret = find_state == FIND_CONT;
+    g_mutex_unlock (&find_lock);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search the lines in @buf, which holds the data of the file at @offset and ends with a line end
+ * unless it is the end of the file. The line at @offset is number @line. As in search_content(),
+ * a NUL byte ends a string to search in and a line gives one match at most.
+ *
+ * @return FALSE if the search in the file is over
+ */
+
+static gboolean
+find_worker_scan (find_job_t * job, mc_search_t * search, const char *buf, gsize len,
+                  off_t offset, int *line)
+{
+    gsize pos = 0, counted = 0;
+
+    while (pos < len)
+    {
+        const char *p;
+        gsize end, match, found_len;
+        find_hit_t hit;
+
+        p = memchr (buf + pos, '\0', len - pos);
+        end = p != NULL ? (gsize) (p - buf) : len;
+
+        if (end == pos || !mc_search_run (search, buf, pos, end - 1, &found_len))
+        {
+            pos = end + 1;
+            continue;
+        }
+
+        match = search->normal_offset;
+        *line += (int) count_newlines (buf + counted, match - counted);
+        counted = match;
+
+        hit.line = *line;
+        hit.start = (gsize) offset + match + 1; /* off by one: ticket 3280 */
+        hit.end = hit.start + found_len;
+
+        g_mutex_lock (&find_lock);
+        g_array_append_val (job->hits, hit);
+        g_cond_broadcast (&find_cond);
+        g_mutex_unlock (&find_lock);
+
+        if (options.content_first_hit)
+            return FALSE;
+
+        p = memchr (buf + match, '\n', len - match);
+        pos = p != NULL ? (gsize) (p - buf) + 1 : len;
+    }
+
+    *line += (int) count_newlines (buf + counted, len - counted);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_MMAP
+static gboolean
+find_worker_grep_mapped (find_job_t * job, mc_search_t * search, find_index_builder_t * builder,
+                         const char *data, gsize size)
+{
+    gsize pos = 0;
+    int line = 1;
+    gboolean searching = TRUE;
+
+    while (pos < size && find_worker_wait ())
+    {
+        gsize end = pos + MIN (size - pos, FIND_SCAN_SIZE);
+
+        if (end < size)
+        {
+            const char *nl;
+
+            nl = memchr (data + end, '\n', size - end);
+            end = nl != NULL ? (gsize) (nl - data) + 1 : size;
+        }
+
+        if (builder != NULL)
+            find_index_builder_feed (builder, data + pos, end - pos);
+
+        if (searching)
+            searching = find_worker_scan (job, search, data + pos, end - pos, (off_t) pos, &line);
+
+        if (!searching && builder == NULL)
+            break;
+
+        pos = end;
+    }
+
+    return (pos == size);
+}
+#endif /* HAVE_MMAP */
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+find_worker_grep_read (find_job_t * job, mc_search_t * search, find_index_builder_t * builder,
+                       int fd)
+{
+    gsize size = FIND_READ_SIZE, len = 0;
+    char *buf;
+    off_t offset = 0;
+    int line = 1;
+    gboolean searching = TRUE, whole = FALSE;
+
+    buf = g_malloc (size);
+
+    while (find_worker_wait ())
+    {
+        ssize_t n;
+        gsize end;
+
+        n = read (fd, buf + len, MIN (size - len, FIND_SCAN_SIZE));
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            if (searching && len != 0)
+                (void) find_worker_scan (job, search, buf, len, offset, &line);
+            whole = n == 0;
+            break;
+        }
+
+        if (builder != NULL)
+            find_index_builder_feed (builder, buf + len, (gsize) n);
+
+        /* the rest of the file is only indexed */
+        if (!searching)
+            continue;
+
+        len += (gsize) n;
+
+        /* search whole lines, the rest goes with the next data */
+        for (end = len; end > 0 && buf[end - 1] != '\n'; end--)
+            ;
+
+        if (end == 0)
+        {
+            if (len == size)
+            {
+                size *= 2;
+                buf = g_realloc (buf, size);
+            }
+            continue;
+        }
+
+        searching = find_worker_scan (job, search, buf, end, offset, &line);
+        if (!searching && builder == NULL)
+            break;
+
+        memmove (buf, buf + end, len - end);
+        len -= end;
+        offset += (off_t) end;
+    }
+
+    g_free (buf);
+
+    return whole;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search a local file: a small one is read, a large one is mapped if possible. If @builder is
+ * not NULL, all the content of the file is fed to it, even after the search is over.
+ *
+ * @return TRUE if the whole file has been read
+ */
+
+static gboolean
+find_worker_grep (find_job_t * job, mc_search_t * search, find_index_builder_t * builder, int fd,
+                  off_t file_size)
+{
+#ifdef HAVE_MMAP
+    const size_t size = (size_t) file_size;
+
+    if (file_size > FIND_READ_SIZE && (off_t) size == file_size)
+    {
+        char *map;
+
+        /* a file that is truncated while it is searched reads as zeros rather than
+           raising SIGBUS */
+        map = mc_mmap_read (fd, size, FALSE);
+        if (map != NULL)
+        {
+            gboolean whole;
+
+#ifdef MADV_SEQUENTIAL
+            (void) madvise (map, size, MADV_SEQUENTIAL);
+#endif
+            whole = find_worker_grep_mapped (job, search, builder, map, size);
+            /* the index must not get the zeros */
+            if (mc_mmap_read_faulted (map))
+                whole = FALSE;
+            mc_munmap_read (map, size);
+            return whole;
+        }
+    }
+#else
+    (void) file_size;
+#endif /* HAVE_MMAP */
+
+    return find_worker_grep_read (job, search, builder, fd);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Search a file in a worker thread of find_pool */
+
+static void
+find_worker (gpointer data, gpointer user_data)
+{
+    find_job_t *job = (find_job_t *) data;
+
+    (void) user_data;
+
+    if (find_worker_wait ())
+    {
+        char *path;
+        int fd;
+        struct stat st;
+
+        path = g_build_filename (job->directory, job->filename, (char *) NULL);
+        /* don't hang on a FIFO, it is skipped anyway */
+        fd = open (path, O_RDONLY | O_NONBLOCK);
+
+        if (fd != -1)
+        {
+            gboolean fresh = TRUE;
+
+            if (fstat (fd, &st) == 0 && S_ISREG (st.st_mode)
+                && (find_index == NULL
+                    || find_index_lookup (find_index, path, &st, find_index_query, &fresh)))
+            {
+                mc_search_t *search;
+                find_index_builder_t *builder;
+                gboolean whole;
+
+                builder = fresh ? NULL : find_index_builder_new ();
+
+                search = (mc_search_t *) g_async_queue_pop (find_searches);
+                whole = find_worker_grep (job, search, builder, fd, st.st_size);
+                g_async_queue_push (find_searches, search);
+
+                if (whole && builder != NULL)
+                    find_index_update (find_index, path, &st, builder);
+                else
+                    find_index_builder_free (builder);
+            }
+
+            close (fd);
+        }
+
+        g_free (path);
+    }
+
+    g_mutex_lock (&find_lock);
+    job->done = TRUE;
+    g_cond_broadcast (&find_cond);
+    g_mutex_unlock (&find_lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_jobs_set_state (FindProgressStatus state)
+{
+    g_mutex_lock (&find_lock);
+    find_state = state;
+    g_cond_broadcast (&find_cond);
+    g_mutex_unlock (&find_lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_job_add (const char *directory, const char *filename)
+{
+    find_job_t *job;
+
+    job = g_new0 (find_job_t, 1);
+    job->directory = g_strdup (directory);
+    job->filename = g_strdup (filename);
+    job->hits = g_array_new (FALSE, FALSE, sizeof (find_hit_t));
+
+    g_queue_push_tail (&find_jobs, job);
+    g_thread_pool_push (find_pool, job, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Show the matches found by the workers, file by file in the order the files were found.
+ * The matches of the first file not done yet are shown as they come in.
+ */
+
+static void
+find_jobs_collect (WDialog * h)
+{
+    find_job_t *job;
+
+    while ((job = (find_job_t *) g_queue_peek_head (&find_jobs)) != NULL)
+    {
+        GArray *hits = NULL;
+        gboolean done;
+        guint i;
+
+        g_mutex_lock (&find_lock);
+        done = job->done;
+        if (job->hits->len > job->shown)
+        {
+            hits = g_array_sized_new (FALSE, FALSE, sizeof (find_hit_t),
+                                      job->hits->len - job->shown);
+            g_array_append_vals (hits, &g_array_index (job->hits, find_hit_t, job->shown),
+                                 job->hits->len - job->shown);
+            job->shown = job->hits->len;
+        }
+        g_mutex_unlock (&find_lock);
+
+        if (job != find_status_job)
+        {
+            gint64 tv;
+
+            /* the name of the file having the matches must be seen */
+            tv = g_get_real_time ();
+            if (hits != NULL || (tv - last_refresh) > MAX_REFRESH_INTERVAL)
+            {
+                char buffer[BUF_MEDIUM];
+
+                g_snprintf (buffer, sizeof (buffer), _("Grepping in %s"), job->filename);
+                status_update (str_trunc (buffer, WIDGET (h)->cols - 8));
+                last_refresh = tv;
+                find_status_job = job;
+            }
+        }
+
+        for (i = 0; hits != NULL && i < hits->len; i++)
+        {
+            const find_hit_t *hit = &g_array_index (hits, find_hit_t, i);
+            char result[BUF_MEDIUM];
+
+            g_snprintf (result, sizeof (result), "%d:%s", hit->line, job->filename);
+            find_add_match (job->directory, result, hit->start, hit->end);
+        }
+
+        if (hits != NULL)
+            g_array_free (hits, TRUE);
+
+        if (!done)
+            break;
+
+        if (job == find_status_job)
+            find_status_job = NULL;
+        find_job_free (g_queue_pop_head (&find_jobs));
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Give the walkers and the workers some time when there is nothing else to do but wait for them */
+
+static void
+find_jobs_wait (void)
+{
+    const find_job_t *job;
+    gint64 end_time;
+
+    job = (const find_job_t *) g_queue_peek_head (&find_jobs);
+    end_time = g_get_monotonic_time () + FIND_WAIT_INTERVAL;
+
+    g_mutex_lock (&find_lock);
+    if ((g_queue_is_empty (&find_dirs) || g_queue_get_length (&find_jobs) >= FIND_JOBS_MAX)
+        && (job == NULL || (!job->done && job->hits->len == job->shown)))
+        (void) g_cond_wait_until (&find_cond, &find_lock, end_time);
+    g_mutex_unlock (&find_lock);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * search_content:
  *
  * Search the content_pattern string in the DIRECTORY/FILE.
  * It will add the found entries to the find listbox.
+ * Used for files of other VFS, the content of local files is searched by find_pool.
  *
  * returns FALSE if do_search should look for another file
  *         TRUE if do_search should exit and proceed to the event handler
@@ -1006,7 +1591,8 @@ static gboolean
 search_content (WDialog * h, const char *directory, const char *filename)
 {
     struct stat s;
-    char buffer[BUF_4K] = "";   /* raw input buffer */
+    char buffer[BUF_MEDIUM] = "";
+    char *data;                 /* raw input buffer */
     int file_fd;
     gboolean ret_val = FALSE;
     vfs_path_t *vpath;
@@ -1055,14 +1641,17 @@ search_content (WDialog * h, const char *directory, const char *filename)
         int strbuf_size = 0;
         int i = -1;             /* compensate for a newline we'll add when we first enter the loop */
 
+        data = g_malloc (FIND_VFS_READ_SIZE);
+
         if (resuming)
         {
             /* We've been previously suspended, start from the previous position */
             resuming = FALSE;
             line = last_line;
-            pos = last_pos;
             off = last_off;
             i = last_i;
+            /* the file is open again, go on after the last line searched */
+            find_skip_data (file_fd, off + i + 1, data, FIND_VFS_READ_SIZE);
         }
 
         while (!ret_val)
@@ -1078,12 +1667,12 @@ search_content (WDialog * h, const char *directory, const char *filename)
                 if (pos >= n_read)
                 {
                     pos = 0;
-                    n_read = mc_read (file_fd, buffer, sizeof (buffer));
+                    n_read = mc_read (file_fd, data, FIND_VFS_READ_SIZE);
                     if (n_read <= 0)
                         break;
                 }
 
-                ch = buffer[pos++];
+                ch = data[pos++];
                 if (ch == '\0')
                 {
                     /* skip possible leading zero(s) */
@@ -1163,7 +1752,6 @@ search_content (WDialog * h, const char *directory, const char *filename)
                 case FIND_SUSPEND:
                     resuming = TRUE;
                     last_line = line;
-                    last_pos = pos;
                     last_off = off;
                     last_i = i;
                     ret_val = TRUE;
@@ -1175,6 +1763,7 @@ search_content (WDialog * h, const char *directory, const char *filename)
         }
 
         g_free (strbuf);
+        g_free (data);
     }
 
     tty_disable_interrupt_key ();
@@ -1263,6 +1852,367 @@ find_rotate_dash (const WDialog * h, gboolean show)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static void
+find_finished (WDialog * h)
+{
+    running = FALSE;
+    if (ignore_count == 0)
+        status_update (_("Finished"));
+    else
+    {
+        char msg[BUF_SMALL];
+
+        g_snprintf (msg, sizeof (msg),
+                    ngettext ("Finished (ignored %zu directory)",
+                              "Finished (ignored %zu directories)", ignore_count), ignore_count);
+        status_update (msg);
+    }
+    if (verbose)
+        find_rotate_dash (h, FALSE);
+    stop_idle (h);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_t *
+find_file_search_new (void)
+{
+    mc_search_t *search;
+
+    search = mc_search_new (find_pattern, NULL);
+    search->search_type = options.file_pattern ? MC_SEARCH_T_GLOB : MC_SEARCH_T_REGEX;
+    search->is_case_sensitive = options.file_case_sens;
+#ifdef HAVE_CHARSET
+    search->is_all_charsets = options.file_all_charsets;
+#endif
+    search->is_entire_line = options.file_pattern;
+
+    return search;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_dir_free (gpointer data)
+{
+    find_dir_t *d = (find_dir_t *) data;
+
+    g_free (d->directory);
+    g_ptr_array_free (d->files, TRUE);
+    g_free (d);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Queue a local directory to be read by a walker. Called from the walkers too. */
+
+static void
+find_walk_push (char *directory)
+{
+    g_mutex_lock (&find_lock);
+    if (find_state == FIND_ABORT)
+        g_free (directory);
+    else
+    {
+        find_walk_pending++;
+        g_thread_pool_push (find_walk_pool, directory, NULL);
+    }
+    g_mutex_unlock (&find_lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Tell whether the entry @dp of the directory @fd is a directory to descend into. The type in the
+ * entry is used if the file system gives it, so that most entries cost no stat() call.
+ */
+
+static gboolean
+find_walk_is_dir (int fd, const char *directory, const struct dirent *dp)
+{
+    struct stat st;
+    int res;
+
+#ifdef DT_DIR
+    if (dp->d_type == DT_DIR)
+        return TRUE;
+    if (dp->d_type != DT_UNKNOWN && (dp->d_type != DT_LNK || !options.follow_symlinks))
+        return FALSE;
+#endif
+
+#ifdef AT_SYMLINK_NOFOLLOW
+    (void) directory;
+    res = fstatat (fd, dp->d_name, &st, options.follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW);
+#else
+    {
+        char *path;
+
+        (void) fd;
+        path = g_build_filename (directory, dp->d_name, (char *) NULL);
+        res = options.follow_symlinks ? stat (path, &st) : lstat (path, &st);
+        g_free (path);
+    }
+#endif
+
+    return (res == 0 && S_ISDIR (st.st_mode));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read a local directory in a walker: queue its subdirectories and collect the files matching
+ * the pattern. The rules are the ones of do_search().
+ */
+
+static void
+find_walk_dir (find_dir_t * d)
+{
+    mc_search_t *search;
+    DIR *dirp;
+    struct dirent *dp;
+    int fd, count = 0;
+
+    /* handle absolute ignore dirs here */
+    if (find_ignore_dir_search (d->directory))
+    {
+        d->ignored++;
+        return;
+    }
+
+    dirp = opendir (d->directory);
+    if (dirp == NULL)
+        return;
+
+    fd = dirfd (dirp);
+    search = (mc_search_t *) g_async_queue_pop (find_name_searches);
+
+    while ((dp = readdir (dirp)) != NULL)
+    {
+        const char *name = dp->d_name;
+        gsize found_len;
+
+        if (DIR_IS_DOT (name) || DIR_IS_DOTDOT (name) || !str_is_valid_string (name)
+            || (options.skip_hidden && name[0] == '.'))
+            continue;
+
+        if (options.find_recurs)
+        {
+            /* handle relative ignore dirs here */
+            if (options.ignore_dirs_enable && find_ignore_dir_search (name))
+                d->ignored++;
+            else if (find_walk_is_dir (fd, d->directory, dp))
+                find_walk_push (mc_build_filename (d->directory, name, (char *) NULL));
+        }
+
+        if (mc_search_run (search, name, 0, strlen (name), &found_len))
+            g_ptr_array_add (d->files, g_strdup (name));
+
+        /* a huge directory does not hold up the suspension */
+        if ((++count & 0xff) == 0 && !find_worker_wait ())
+            break;
+    }
+
+    g_async_queue_push (find_name_searches, search);
+    closedir (dirp);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Read a directory in a walker thread of find_walk_pool */
+
+static void
+find_walker (gpointer data, gpointer user_data)
+{
+    find_dir_t *d;
+
+    (void) user_data;
+
+    d = g_new0 (find_dir_t, 1);
+    d->directory = (char *) data;
+    d->files = g_ptr_array_new_with_free_func (g_free);
+
+    if (find_worker_wait ())
+        find_walk_dir (d);
+
+    g_mutex_lock (&find_lock);
+    g_queue_push_tail (&find_dirs, d);
+    find_walk_pending--;
+    g_cond_broadcast (&find_cond);
+    g_mutex_unlock (&find_lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start the walkers, and the workers if the content of the files is searched. @root is the
+ * start directory, its index is used if the user wants it.
+ */
+
+static void
+find_jobs_start (const char *root)
+{
+    guint i, n;
+
+    n = (guint) CLAMP (g_get_num_processors (), 2, FIND_WORKERS_MAX);
+
+    find_state = FIND_CONT;
+    find_status_job = NULL;
+    find_walk_pending = 0;
+
+    /* the patterns are compiled here, each thread uses its own handle */
+    find_name_searches = g_async_queue_new_full ((GDestroyNotify) mc_search_free);
+    for (i = 0; i < n; i++)
+    {
+        mc_search_t *search;
+
+        search = find_file_search_new ();
+        (void) mc_search_prepare (search);
+        g_async_queue_push (find_name_searches, search);
+    }
+
+    find_walk_pool = g_thread_pool_new (find_walker, NULL, (gint) n, FALSE, NULL);
+
+    if (content_pattern == NULL)
+        return;
+
+    find_searches = g_async_queue_new_full ((GDestroyNotify) mc_search_free);
+    for (i = 0; i < n; i++)
+    {
+        mc_search_t *search;
+
+        search = find_content_search_new ();
+        (void) mc_search_prepare (search);
+        g_async_queue_push (find_searches, search);
+    }
+
+    if (options.content_use_index)
+    {
+        find_index = find_index_get (root);
+#ifdef HAVE_CHARSET
+        /* the strings may be in any charset */
+        if (!options.content_all_charsets)
+#endif
+            find_index_query =
+                find_index_query_new (content_pattern,
+                                      options.content_regexp ? MC_SEARCH_T_REGEX :
+                                      options.content_multi ? MC_SEARCH_T_MULTI :
+                                      MC_SEARCH_T_NORMAL, options.content_case_sens);
+    }
+
+    find_pool = g_thread_pool_new (find_worker, NULL, (gint) n, FALSE, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Stop the walkers and the workers, and drop what they have not done yet */
+
+static void
+find_jobs_stop (void)
+{
+    if (find_walk_pool == NULL)
+        return;
+
+    find_jobs_set_state (FIND_ABORT);
+
+    /* the directories still queued are only freed */
+    g_thread_pool_free (find_walk_pool, FALSE, TRUE);
+    find_walk_pool = NULL;
+    g_queue_clear_full (&find_dirs, find_dir_free);
+    g_async_queue_unref (find_name_searches);
+    find_name_searches = NULL;
+
+    if (find_pool != NULL)
+    {
+        g_thread_pool_free (find_pool, TRUE, TRUE);
+        find_pool = NULL;
+        g_queue_clear_full (&find_jobs, find_job_free);
+        g_async_queue_unref (find_searches);
+        find_searches = NULL;
+    }
+
+    if (find_index != NULL)
+    {
+        find_index_save (find_index);
+        find_index = NULL;
+        find_index_query_free (find_index_query);
+        find_index_query = NULL;
+    }
+
+    find_status_job = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search in a local directory: the walkers and the workers do the job, the dialog shows what
+ * they have found.
+ */
+
+static int
+do_search_local (WDialog * h)
+{
+    vfs_path_t *vpath;
+    guint count = 0;
+    gboolean walking;
+
+    /* the start directory */
+    while ((vpath = pop_directory ()) != NULL)
+    {
+        find_walk_push (g_strdup (vfs_path_as_str (vpath)));
+        vfs_path_free (vpath, TRUE);
+    }
+
+    if (find_pool != NULL)
+        find_jobs_collect (h);
+
+    while (count < FIND_FILES_STEP
+           && (find_pool == NULL || g_queue_get_length (&find_jobs) < FIND_JOBS_MAX))
+    {
+        find_dir_t *d;
+        guint i;
+
+        g_mutex_lock (&find_lock);
+        d = (find_dir_t *) g_queue_pop_head (&find_dirs);
+        g_mutex_unlock (&find_lock);
+
+        if (d == NULL)
+            break;
+
+        ignore_count += d->ignored;
+
+        if (verbose)
+            status_update (str_trunc (d->directory, WIDGET (h)->cols - 8));
+
+        for (i = 0; i < d->files->len; i++)
+        {
+            const char *name = (const char *) g_ptr_array_index (d->files, i);
+
+            if (find_pool != NULL)
+                find_job_add (d->directory, name);
+            else
+                find_add_match (d->directory, name, 0, 0);
+        }
+
+        count += d->files->len + 1;
+        find_dir_free (d);
+    }
+
+    if (count != 0)
+    {
+        if (verbose)
+            find_rotate_dash (h, TRUE);
+        return 1;
+    }
+
+    g_mutex_lock (&find_lock);
+    walking = find_walk_pending != 0 || !g_queue_is_empty (&find_dirs);
+    g_mutex_unlock (&find_lock);
+
+    if (!walking && g_queue_is_empty (&find_jobs))
+    {
+        find_finished (h);
+        return 0;
+    }
+
+    find_jobs_wait ();
+    return 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 do_search (WDialog * h)
 {
@@ -1285,6 +2235,9 @@ do_search (WDialog * h)
         return 1;
     }
 
+    if (find_walk_pool != NULL)
+        return do_search_local (h);
+
     for (count = 0; count < 32; count++)
     {
         while (dp == NULL)
@@ -1306,22 +2259,7 @@ do_search (WDialog * h)
                     tmp_vpath = pop_directory ();
                     if (tmp_vpath == NULL)
                     {
-                        running = FALSE;
-                        if (ignore_count == 0)
-                            status_update (_("Finished"));
-                        else
-                        {
-                            char msg[BUF_SMALL];
-
-                            g_snprintf (msg, sizeof (msg),
-                                        ngettext ("Finished (ignored %zu directory)",
-                                                  "Finished (ignored %zu directories)",
-                                                  ignore_count), ignore_count);
-                            status_update (msg);
-                        }
-                        if (verbose)
-                            find_rotate_dash (h, FALSE);
-                        stop_idle (h);
+                        find_finished (h);
                         return 0;
                     }
 
@@ -1616,6 +2554,9 @@ start_stop (WButton * button, int action)
     widget_idle (WIDGET (find_dlg), running);
     is_start = !is_start;
 
+    if (find_walk_pool != NULL)
+        find_jobs_set_state (running ? FIND_CONT : FIND_SUSPEND);
+
     status_update (is_start ? _("Stopped") : _("Searching"));
     button_set_text (button, fbuts[is_start ? 3 : 2].text);
 
@@ -1725,35 +2666,29 @@ setup_gui (void)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Run the search. A local directory @root is searched in parallel, @root is NULL for a directory
+ * of other VFS.
+ */
+
 static int
-run_process (void)
+run_process (const char *root)
 {
     int ret;
 
-    search_content_handle = mc_search_new (content_pattern, NULL);
-    if (search_content_handle)
-    {
-        search_content_handle->search_type =
-            options.content_regexp ? MC_SEARCH_T_REGEX : MC_SEARCH_T_NORMAL;
-        search_content_handle->is_case_sensitive = options.content_case_sens;
-        search_content_handle->whole_words = options.content_whole_words;
-#ifdef HAVE_CHARSET
-        search_content_handle->is_all_charsets = options.content_all_charsets;
-#endif
-    }
-    search_file_handle = mc_search_new (find_pattern, NULL);
-    search_file_handle->search_type = options.file_pattern ? MC_SEARCH_T_GLOB : MC_SEARCH_T_REGEX;
-    search_file_handle->is_case_sensitive = options.file_case_sens;
-#ifdef HAVE_CHARSET
-    search_file_handle->is_all_charsets = options.file_all_charsets;
-#endif
-    search_file_handle->is_entire_line = options.file_pattern;
+    search_content_handle = find_content_search_new ();
+    search_file_handle = find_file_search_new ();
 
     resuming = FALSE;
 
+    if (root != NULL)
+        find_jobs_start (root);
+
     widget_idle (WIDGET (find_dlg), TRUE);
     ret = dlg_run (find_dlg);
 
+    find_jobs_stop ();
+
     mc_search_free (search_file_handle);
     search_file_handle = NULL;
     mc_search_free (search_content_handle);
@@ -1781,14 +2716,20 @@ do_find (WPanel * panel, const char *start_dir, ssize_t start_dir_len, const cha
 {
     int return_value = 0;
     char *dir_tmp = NULL, *file_tmp = NULL;
+    vfs_path_t *start_vpath;
+    char *root = NULL;
 
     setup_gui ();
 
     init_find_vars ();
     parse_ignore_dirs (ignore_dirs);
-    push_directory (vfs_path_from_str (start_dir));
+    start_vpath = vfs_path_from_str (start_dir);
+    if (vfs_file_is_local (start_vpath))
+        root = g_strdup (vfs_path_as_str (start_vpath));
+    push_directory (start_vpath);
 
-    return_value = run_process ();
+    return_value = run_process (root);
+    g_free (root);
 
     /* Clear variables */
     init_find_vars ();
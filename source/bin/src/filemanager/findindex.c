@@ -0,0 +1,808 @@
+/*
+   Find file command for the Midnight Commander
+   Trigram index of file contents
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file findindex.c
+ *  \brief Source: trigram index of file contents for Find File
+ *
+ *  The index tells which files of a directory tree may contain the strings searched for, so
+ *  that the other files are not read at all. For each file it keeps the size and the mtime the
+ *  file had when it was indexed, and the sorted set of the trigrams of its content: all the
+ *  sequences of three bytes, with ASCII letters in lower case. The set is kept as the differences
+ *  of the trigrams that follow each other, each in as few bytes as it needs, 7 bits in a byte.
+ *
+ *  A string of three bytes or more may be in a file only if all its trigrams are in the set of
+ *  the file. A file that is not in the index, or whose size or mtime has changed, is searched
+ *  and indexed again while it is searched. So the index is built by the searches themselves,
+ *  a file at a time, and never tells about a file that has changed.
+ *
+ *  There is an index for each start directory of the search. The last one used is kept in
+ *  memory, and it is saved in the cache directory after each search that has changed it. The
+ *  saved index begins with the sizes, the mtimes and the places of the trigrams of its files,
+ *  that is all that is read when it is opened: the trigrams are read through a mapping of the
+ *  file by the lookups that need them.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/mcconfig.h"       /* mc_config_get_cache_path() */
+
+#include "findindex.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define FIND_INDEX_MAGIC "MC find index 2\n"
+#define FIND_INDEX_MAGIC_LEN (sizeof (FIND_INDEX_MAGIC) - 1)
+
+#define FIND_INDEX_DIR "findindex"
+
+/* A file with more trigrams is always searched */
+#define FIND_INDEX_TRIGRAMS_MAX (256 * 1024)
+
+/* The trigrams of a file are collected in an array up to this number, then in a bitmap */
+#define FIND_INDEX_ARRAY_MAX (64 * 1024)
+
+#define FIND_INDEX_BITMAP_WORDS ((1 << 24) / 32)
+
+/* A file not looked up by so many searches is dropped from the index */
+#define FIND_INDEX_KEEP_RUNS 16
+
+/* The number of trigrams of a file that is always searched */
+#define FIND_INDEX_ALL G_MAXUINT32
+
+#define FIND_INDEX_FOLD(c) ((guint32) (guchar) g_ascii_tolower (c))
+
+/* ASCII letters that some non-ASCII letters are equal to when the case is ignored in UTF-8,
+   e.g. U+0130 and i, U+212A and k, U+017F and s */
+#define FIND_INDEX_FOLD_OTHERS "iksIKS"
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    gint64 size;
+    gint64 mtime;
+    guint32 run;                /* the last search that looked the file up */
+    guint32 n;                  /* number of trigrams or FIND_INDEX_ALL */
+    const guint8 *trigrams;     /* encoded, in the mapping of the saved index or in own */
+    guint32 len;                /* length of the encoded trigrams */
+    guint8 *own;                /* trigrams that are not saved yet */
+} find_index_file_t;
+
+struct find_index_struct
+{
+    char *root;
+    char *path;                 /* where the index is saved */
+    GHashTable *files;          /* full path -> find_index_file_t */
+    GMappedFile *mapped;        /* the saved index, NULL if there is none */
+    guint32 run;                /* number of the current search */
+    gboolean changed;
+    GMutex lock;                /* the index is used by the workers of Find File */
+};
+
+struct find_index_query_struct
+{
+    GPtrArray *alternatives;    /* sorted trigrams of each string, any of them may be found */
+};
+
+struct find_index_builder_struct
+{
+    guint32 last;               /* the last two bytes fed */
+    gsize fed;                  /* number of the bytes fed */
+    GArray *trigrams;           /* as they come, while there are few of them */
+    guint32 *bitmap;            /* a bit for each trigram, when there are many */
+};
+
+/*** file scope variables ************************************************************************/
+
+static find_index_t *find_index_last = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+find_index_trigram_cmp (const void *a, const void *b)
+{
+    const guint32 x = *(const guint32 *) a;
+    const guint32 y = *(const guint32 *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_sort_unique (GArray * a)
+{
+    guint i, n = 0;
+
+    g_array_sort (a, find_index_trigram_cmp);
+
+    for (i = 0; i < a->len; i++)
+        if (n == 0 || g_array_index (a, guint32, i) != g_array_index (a, guint32, n - 1))
+            g_array_index (a, guint32, n++) = g_array_index (a, guint32, i);
+
+    g_array_set_size (a, n);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gint64
+find_index_mtime (const struct stat *st)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return (gint64) st->st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000) + st->st_mtim.tv_nsec;
+#else
+    return (gint64) st->st_mtime;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_file_free (gpointer data)
+{
+    find_index_file_t *f = (find_index_file_t *) data;
+
+    g_free (f->own);
+    g_free (f);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_array_free (gpointer data)
+{
+    g_array_free ((GArray *) data, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_encode (GByteArray * buf, guint32 * prev, guint32 trigram)
+{
+    guint32 d = trigram - *prev;
+    guint8 b;
+
+    for (; d >= 0x80; d >>= 7)
+    {
+        b = (guint8) (d | 0x80);
+        g_byte_array_append (buf, &b, 1);
+    }
+    b = (guint8) d;
+    g_byte_array_append (buf, &b, 1);
+
+    *prev = trigram;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the next trigram of an encoded set.
+ *
+ * @return FALSE at the end of the set, or if the set is broken
+ */
+
+static gboolean
+find_index_decode (const guint8 ** p, const guint8 * end, guint32 * trigram)
+{
+    guint32 d = 0;
+    int shift;
+
+    for (shift = 0; *p < end && shift < 32; shift += 7)
+    {
+        const guint8 b = *(*p)++;
+
+        d |= (guint32) (b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+        {
+            *trigram += d;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Tell whether the trigrams of a file have all the sorted trigrams of @a */
+
+static gboolean
+find_index_has_all (const find_index_file_t * f, const GArray * a)
+{
+    const guint8 *p, *end;
+    guint32 t = 0;
+    gboolean more;
+    guint i;
+
+    if (f->len == 0)
+        return (a->len == 0);
+
+    p = f->trigrams;
+    end = f->trigrams + f->len;
+    more = find_index_decode (&p, end, &t);
+
+    for (i = 0; i < a->len; i++)
+    {
+        const guint32 wanted = g_array_index (a, guint32, i);
+
+        while (more && t < wanted)
+            more = find_index_decode (&p, end, &t);
+
+        if (!more || t != wanted)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+find_index_match (const find_index_file_t * f, const find_index_query_t * query)
+{
+    guint i;
+
+    for (i = 0; i < query->alternatives->len; i++)
+        if (find_index_has_all (f, (const GArray *) g_ptr_array_index (query->alternatives, i)))
+            return TRUE;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static GArray *
+find_index_trigrams_of (const char *s, gboolean case_sens)
+{
+    const guchar *p = (const guchar *) s;
+    const size_t len = strlen (s);
+    GArray *a;
+    size_t i;
+
+    a = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+    for (i = 0; i + 2 < len; i++)
+    {
+        guint32 t;
+
+        /* the index does not know the case of non-ASCII letters, nor which of them are equal
+           to some ASCII ones */
+        if (!case_sens && (p[i] >= 0x80 || p[i + 1] >= 0x80 || p[i + 2] >= 0x80
+                           || strchr (FIND_INDEX_FOLD_OTHERS, p[i]) != NULL
+                           || strchr (FIND_INDEX_FOLD_OTHERS, p[i + 1]) != NULL
+                           || strchr (FIND_INDEX_FOLD_OTHERS, p[i + 2]) != NULL))
+            continue;
+
+        t = (FIND_INDEX_FOLD (p[i]) << 16) | (FIND_INDEX_FOLD (p[i + 1]) << 8)
+            | FIND_INDEX_FOLD (p[i + 2]);
+        g_array_append_val (a, t);
+    }
+
+    find_index_sort_unique (a);
+
+    return a;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_builder_to_bitmap (find_index_builder_t * builder)
+{
+    guint i;
+
+    builder->bitmap = g_new0 (guint32, FIND_INDEX_BITMAP_WORDS);
+
+    for (i = 0; i < builder->trigrams->len; i++)
+    {
+        const guint32 t = g_array_index (builder->trigrams, guint32, i);
+
+        builder->bitmap[t >> 5] |= 1U << (t & 31);
+    }
+
+    g_array_free (builder->trigrams, TRUE);
+    builder->trigrams = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Take the trigrams out of @builder into the file @f and free @builder.
+ */
+
+static void
+find_index_builder_finish (find_index_builder_t * builder, find_index_file_t * f)
+{
+    GByteArray *buf;
+    guint32 prev = 0;
+
+    f->n = 0;
+    buf = g_byte_array_new ();
+
+    if (builder->bitmap == NULL)
+    {
+        guint i;
+
+        find_index_sort_unique (builder->trigrams);
+        for (i = 0; i < builder->trigrams->len; i++)
+            find_index_encode (buf, &prev, g_array_index (builder->trigrams, guint32, i));
+        f->n = builder->trigrams->len;
+    }
+    else
+    {
+        guint32 w;
+
+        for (w = 0; w < FIND_INDEX_BITMAP_WORDS && f->n <= FIND_INDEX_TRIGRAMS_MAX; w++)
+        {
+            guint32 bits = builder->bitmap[w];
+            guint32 t;
+
+            for (t = w << 5; bits != 0; bits >>= 1, t++)
+                if ((bits & 1) != 0)
+                {
+                    find_index_encode (buf, &prev, t);
+                    f->n++;
+                }
+        }
+    }
+
+    find_index_builder_free (builder);
+
+    if (f->n > FIND_INDEX_TRIGRAMS_MAX)
+    {
+        g_byte_array_free (buf, TRUE);
+        f->n = FIND_INDEX_ALL;
+        f->len = 0;
+        f->own = NULL;
+    }
+    else
+    {
+        f->len = buf->len;
+        f->own = g_byte_array_free (buf, FALSE);
+    }
+
+    f->trigrams = f->own;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+find_index_take (const char *data, gsize len, gsize * pos, void *dest, gsize size)
+{
+    if (len - *pos < size)
+        return FALSE;
+
+    memcpy (dest, data + *pos, size);
+    *pos += size;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the sizes, the mtimes and the places of the trigrams of the files from the saved index.
+ * The trigrams themselves stay in the mapping of the file until a lookup needs them.
+ */
+
+static gboolean
+find_index_read (find_index_t * index)
+{
+    const char *data;
+    gsize len, pos = FIND_INDEX_MAGIC_LEN;
+    guint64 start;
+    guint32 count, i;
+    gboolean ok;
+
+    index->mapped = g_mapped_file_new (index->path, FALSE, NULL);
+    if (index->mapped == NULL)
+        return FALSE;
+
+    data = g_mapped_file_get_contents (index->mapped);
+    len = g_mapped_file_get_length (index->mapped);
+
+    ok = data != NULL && len >= pos && memcmp (data, FIND_INDEX_MAGIC, pos) == 0
+        && find_index_take (data, len, &pos, &index->run, sizeof (index->run))
+        && find_index_take (data, len, &pos, &count, sizeof (count))
+        && find_index_take (data, len, &pos, &start, sizeof (start)) && start <= len;
+
+    for (i = 0; ok && i < count; i++)
+    {
+        find_index_file_t *f;
+        guint32 name_len;
+        guint64 offset;
+        char *name;
+
+        ok = find_index_take (data, len, &pos, &name_len, sizeof (name_len))
+            && len - pos >= name_len;
+        if (!ok)
+            break;
+
+        name = g_strndup (data + pos, name_len);
+        pos += name_len;
+
+        f = g_new0 (find_index_file_t, 1);
+        g_hash_table_replace (index->files, name, f);
+
+        ok = find_index_take (data, len, &pos, &f->size, sizeof (f->size))
+            && find_index_take (data, len, &pos, &f->mtime, sizeof (f->mtime))
+            && find_index_take (data, len, &pos, &f->run, sizeof (f->run))
+            && find_index_take (data, len, &pos, &f->n, sizeof (f->n))
+            && find_index_take (data, len, &pos, &offset, sizeof (offset))
+            && find_index_take (data, len, &pos, &f->len, sizeof (f->len))
+            && (f->n == FIND_INDEX_ALL || f->n <= FIND_INDEX_TRIGRAMS_MAX)
+            && offset <= len - start && f->len <= len - start - offset;
+
+        if (ok)
+            f->trigrams = (const guint8 *) data + start + offset;
+        else
+            f->n = FIND_INDEX_ALL;
+    }
+
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_free (find_index_t * index)
+{
+    g_free (index->root);
+    g_free (index->path);
+    g_hash_table_destroy (index->files);
+    if (index->mapped != NULL)
+        g_mapped_file_unref (index->mapped);
+    g_mutex_clear (&index->lock);
+    g_free (index);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the index of the directory tree at @root to be used by a new search. It is read from
+ * the cache directory unless it is in memory already.
+ */
+
+find_index_t *
+find_index_get (const char *root)
+{
+    find_index_t *index;
+    char *checksum, *name;
+
+    if (find_index_last != NULL)
+    {
+        if (strcmp (find_index_last->root, root) == 0)
+        {
+            find_index_last->run++;
+            return find_index_last;
+        }
+
+        find_index_save (find_index_last);
+        find_index_free (find_index_last);
+    }
+
+    index = g_new0 (find_index_t, 1);
+    index->root = g_strdup (root);
+    index->files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, find_index_file_free);
+    g_mutex_init (&index->lock);
+
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, root, -1);
+    name = g_strconcat (checksum, ".idx", (char *) NULL);
+    index->path = g_build_filename (mc_config_get_cache_path (), FIND_INDEX_DIR, name,
+                                    (char *) NULL);
+    g_free (name);
+    g_free (checksum);
+
+    if (!find_index_read (index))
+    {
+        g_hash_table_remove_all (index->files);
+        if (index->mapped != NULL)
+        {
+            g_mapped_file_unref (index->mapped);
+            index->mapped = NULL;
+        }
+        index->run = 0;
+    }
+
+    index->run++;
+    find_index_last = index;
+
+    return index;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Save the index if it has changed. The files not looked up for a long time are dropped.
+ */
+
+void
+find_index_save (find_index_t * index)
+{
+    GByteArray *head;
+    GHashTableIter iter;
+    gpointer key, value;
+    guint64 start, offset = 0;
+    guint32 count;
+    char *dir, *tmp;
+    FILE *out;
+    gboolean ok;
+
+    if (!index->changed)
+        return;
+
+    g_hash_table_iter_init (&iter, index->files);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+        if (index->run - ((find_index_file_t *) value)->run > FIND_INDEX_KEEP_RUNS)
+            g_hash_table_iter_remove (&iter);
+
+    /* the files first, then their trigrams in the same order */
+    head = g_byte_array_new ();
+    count = g_hash_table_size (index->files);
+
+    g_hash_table_iter_init (&iter, index->files);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+        const find_index_file_t *f = (const find_index_file_t *) value;
+        const guint32 name_len = (guint32) strlen ((const char *) key);
+
+        g_byte_array_append (head, (const guint8 *) &name_len, sizeof (name_len));
+        g_byte_array_append (head, (const guint8 *) key, name_len);
+        g_byte_array_append (head, (const guint8 *) &f->size, sizeof (f->size));
+        g_byte_array_append (head, (const guint8 *) &f->mtime, sizeof (f->mtime));
+        g_byte_array_append (head, (const guint8 *) &f->run, sizeof (f->run));
+        g_byte_array_append (head, (const guint8 *) &f->n, sizeof (f->n));
+        g_byte_array_append (head, (const guint8 *) &offset, sizeof (offset));
+        g_byte_array_append (head, (const guint8 *) &f->len, sizeof (f->len));
+        offset += f->len;
+    }
+
+    start = FIND_INDEX_MAGIC_LEN + sizeof (index->run) + sizeof (count) + sizeof (start)
+        + head->len;
+    g_byte_array_prepend (head, (const guint8 *) &start, sizeof (start));
+    g_byte_array_prepend (head, (const guint8 *) &count, sizeof (count));
+    g_byte_array_prepend (head, (const guint8 *) &index->run, sizeof (index->run));
+    g_byte_array_prepend (head, (const guint8 *) FIND_INDEX_MAGIC, FIND_INDEX_MAGIC_LEN);
+
+    /* the mapping of the old file stays valid while the new one replaces it */
+    dir = g_path_get_dirname (index->path);
+    tmp = g_strconcat (index->path, ".tmp", (char *) NULL);
+    out = g_mkdir_with_parents (dir, 0700) == 0 ? fopen (tmp, "wb") : NULL;
+    ok = out != NULL && fwrite (head->data, 1, head->len, out) == head->len;
+
+    g_hash_table_iter_init (&iter, index->files);
+    while (ok && g_hash_table_iter_next (&iter, NULL, &value))
+    {
+        const find_index_file_t *f = (const find_index_file_t *) value;
+
+        ok = f->len == 0 || fwrite (f->trigrams, 1, f->len, out) == f->len;
+    }
+
+    if (out != NULL)
+        ok = fclose (out) == 0 && ok;
+    if (ok)
+        ok = rename (tmp, index->path) == 0;
+    if (ok)
+        index->changed = FALSE;
+    else if (out != NULL)
+        unlink (tmp);
+
+    g_free (tmp);
+    g_free (dir);
+    g_byte_array_free (head, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Make a query of the index for a content pattern of Find File.
+ *
+ * @return NULL if the index cannot tell which files do not match the pattern
+ */
+
+find_index_query_t *
+find_index_query_new (const char *pattern, mc_search_type_t type, gboolean case_sens)
+{
+    find_index_query_t *query;
+    gchar **strings, **s;
+
+    if (type == MC_SEARCH_T_NORMAL)
+    {
+        strings = g_new0 (gchar *, 2);
+        strings[0] = g_strdup (pattern);
+    }
+    else if (type == MC_SEARCH_T_MULTI)
+        strings = mc_search_multi_split (pattern);
+    else
+        return NULL;
+
+    query = g_new (find_index_query_t, 1);
+    query->alternatives = g_ptr_array_new_with_free_func (find_index_array_free);
+
+    for (s = strings; *s != NULL; s++)
+    {
+        GArray *a;
+
+        a = find_index_trigrams_of (*s, case_sens);
+        if (a->len == 0)
+        {
+            /* the string may be in any file */
+            g_array_free (a, TRUE);
+            g_ptr_array_set_size (query->alternatives, 0);
+            break;
+        }
+
+        g_ptr_array_add (query->alternatives, a);
+    }
+
+    g_strfreev (strings);
+
+    if (query->alternatives->len == 0)
+    {
+        find_index_query_free (query);
+        query = NULL;
+    }
+
+    return query;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+find_index_query_free (find_index_query_t * query)
+{
+    if (query != NULL)
+    {
+        g_ptr_array_free (query->alternatives, TRUE);
+        g_free (query);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Look up the file at @path with the status @st in the index.
+ *
+ * @param query the strings searched for, NULL if any file may match
+ * @param fresh set to TRUE if the file is indexed as it is now, if not it should be indexed
+ *              by find_index_update() while it is searched
+ *
+ * @return FALSE if the file does not match the query
+ */
+
+gboolean
+find_index_lookup (find_index_t * index, const char *path, const struct stat *st,
+                   const find_index_query_t * query, gboolean * fresh)
+{
+    find_index_file_t *f;
+    gboolean ret = TRUE;
+
+    g_mutex_lock (&index->lock);
+
+    f = (find_index_file_t *) g_hash_table_lookup (index->files, path);
+    *fresh = f != NULL && f->size == (gint64) st->st_size && f->mtime == find_index_mtime (st);
+
+    if (*fresh)
+    {
+        f->run = index->run;
+        if (query != NULL && f->n != FIND_INDEX_ALL)
+            ret = find_index_match (f, query);
+    }
+
+    g_mutex_unlock (&index->lock);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Store the trigrams collected by @builder from the whole content of the file at @path with the
+ * status @st. @builder is freed.
+ */
+
+void
+find_index_update (find_index_t * index, const char *path, const struct stat *st,
+                   find_index_builder_t * builder)
+{
+    find_index_file_t *f;
+
+    f = g_new (find_index_file_t, 1);
+    f->size = (gint64) st->st_size;
+    f->mtime = find_index_mtime (st);
+    find_index_builder_finish (builder, f);
+
+    g_mutex_lock (&index->lock);
+    f->run = index->run;
+    g_hash_table_replace (index->files, g_strdup (path), f);
+    index->changed = TRUE;
+    g_mutex_unlock (&index->lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+find_index_builder_t *
+find_index_builder_new (void)
+{
+    find_index_builder_t *builder;
+
+    builder = g_new0 (find_index_builder_t, 1);
+    builder->trigrams = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+    return builder;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Collect the trigrams of the next piece of the content of a file.
+ */
+
+void
+find_index_builder_feed (find_index_builder_t * builder, const char *buf, gsize len)
+{
+    guint32 t = builder->last;
+    gsize i = 0;
+
+    /* the first two bytes of the file only start a trigram */
+    for (; i < len && builder->fed < 2; i++, builder->fed++)
+        t = (t << 8) | FIND_INDEX_FOLD (buf[i]);
+
+    for (; i < len; i++)
+    {
+        t = ((t << 8) | FIND_INDEX_FOLD (buf[i])) & 0xffffff;
+
+        if (builder->bitmap != NULL)
+            builder->bitmap[t >> 5] |= 1U << (t & 31);
+        else
+        {
+            g_array_append_val (builder->trigrams, t);
+
+            if (builder->trigrams->len >= FIND_INDEX_ARRAY_MAX)
+            {
+                /* the repeated ones may be many */
+                find_index_sort_unique (builder->trigrams);
+                if (builder->trigrams->len >= FIND_INDEX_ARRAY_MAX / 2)
+                    find_index_builder_to_bitmap (builder);
+            }
+        }
+    }
+
+    builder->last = t;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+find_index_builder_free (find_index_builder_t * builder)
+{
+    if (builder != NULL)
+    {
+        if (builder->trigrams != NULL)
+            g_array_free (builder->trigrams, TRUE);
+        g_free (builder->bitmap);
+        g_free (builder);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,44 @@
+/** \file findindex.h
+ *  \brief Header: trigram index of file contents for Find File
+ */
+
+#ifndef MC__FINDINDEX_H
+#define MC__FINDINDEX_H
+
+#include <sys/stat.h>
+
+#include "lib/search.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct find_index_struct find_index_t;
+typedef struct find_index_query_struct find_index_query_t;
+typedef struct find_index_builder_struct find_index_builder_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+find_index_t *find_index_get (const char *root);
+void find_index_save (find_index_t * index);
+
+find_index_query_t *find_index_query_new (const char *pattern, mc_search_type_t type,
+                                          gboolean case_sens);
+void find_index_query_free (find_index_query_t * query);
+
+gboolean find_index_lookup (find_index_t * index, const char *path, const struct stat *st,
+                            const find_index_query_t * query, gboolean * fresh);
+void find_index_update (find_index_t * index, const char *path, const struct stat *st,
+                        find_index_builder_t * builder);
+
+find_index_builder_t *find_index_builder_new (void);
+void find_index_builder_feed (find_index_builder_t * builder, const char *buf, gsize len);
+void find_index_builder_free (find_index_builder_t * builder);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__FINDINDEX_H */
@@ -523,6 +523,7 @@ static const global_keymap_ini_t default_viewer_keymap[] = {
 #endif
     {"Shell", "ctrl-o"},
     {"Ruler", "alt-r"},
+    {"Follow", "shift-f"},
     {"SearchForward", "slash"},
     {"SearchBackward", "question"},
     {"SearchForwardContinue", "ctrl-s"},
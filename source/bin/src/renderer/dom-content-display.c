@@ -168,6 +168,13 @@
  */
 #define MAX_BACKWARDS_WALK_IN_PARAGRAPH (100 * 1000)
 
+/*
+ * The line index is never extended over more than this many bytes at once. Jumping far ahead
+ * (e.g. to the bottom of a huge text node) scans only around the target instead.
+ */
+#define LINE_INDEX_MAX_GAP (1024 * 1024)
+#define LINE_INDEX_PREALLOC 256
+
 /*** file scope type declarations ****************************************************************/
 
 /*** file scope variables ************************************************************************/
@@ -256,7 +263,7 @@ domcnt_char_display (const WDOMContent * view, int c, char *s)
 static gboolean
 domcnt_get_byte (WDOMContent * view, off_t byte_index, int *retval)
 {
-    char *p;
+    const char *p;
 
     if (retval != NULL)
         *retval = -1;
@@ -271,6 +278,119 @@ domcnt_get_byte (WDOMContent * view, off_t byte_index, int *retval)
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Returns the offset of the line start following the line which contains @current.
+ * A line ends with LF, CR LF or a lone CR; the text is scanned with memchr() rather than
+ * byte by byte.
+ */
+
+static off_t
+domcnt_scan_eol (const WDOMContent * view, off_t current)
+{
+    const gchar *p = view->text + current;
+    const gchar *end = view->text + view->text_len;
+    const gchar *nl, *cr;
+
+    nl = memchr (p, '\n', end - p);
+    cr = memchr (p, '\r', (nl != NULL ? nl : end) - p);
+
+    if (cr != NULL)
+    {
+        /* CR LF is a single line break */
+        if (cr + 1 == nl)
+            return nl + 1 - view->text;
+        return cr + 1 - view->text;
+    }
+
+    if (nl != NULL)
+        return nl + 1 - view->text;
+
+    return (off_t) view->text_len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+domcnt_line_index_prepare (WDOMContent * view)
+{
+    const off_t first = 0;
+
+    if (view->line_index == NULL)
+        view->line_index = g_array_sized_new (FALSE, FALSE, sizeof (off_t), LINE_INDEX_PREALLOC);
+
+    if (view->line_index->len == 0)
+    {
+        g_array_append_val (view->line_index, first);
+        view->line_index_end = 0;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Extend the line index until it covers @offset. The index is built lazily: only the part of
+ * the text the user actually walks through is indexed, and it is not extended over a gap larger
+ * than LINE_INDEX_MAX_GAP (e.g. when jumping to the bottom), the callers fall back to scanning
+ * the text around the offset in that case.
+ *
+ * @return TRUE if @offset is covered by the index
+ */
+
+static gboolean
+domcnt_line_index_extend (WDOMContent * view, off_t offset)
+{
+    domcnt_line_index_prepare (view);
+
+    if (offset < view->line_index_end)
+        return TRUE;
+
+    if (view->line_index_end >= (off_t) view->text_len)
+        return FALSE;
+
+    if (offset - view->line_index_end > LINE_INDEX_MAX_GAP)
+        return FALSE;
+
+    while (view->line_index_end <= offset && view->line_index_end < (off_t) view->text_len)
+    {
+        view->line_index_end = domcnt_scan_eol (view, view->line_index_end);
+        g_array_append_val (view->line_index, view->line_index_end);
+    }
+
+    return offset < view->line_index_end;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** returns the index of the indexed line containing @offset, which must be covered by the index */
+
+static guint
+domcnt_line_index_lookup (const WDOMContent * view, off_t offset)
+{
+    const off_t *starts = &g_array_index (view->line_index, off_t, 0);
+    guint lo = 0, hi = view->line_index->len - 1;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo + 1) / 2;
+
+        if (starts[mid] <= offset)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return lo;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+domcnt_line_index_reset (WDOMContent * view)
+{
+    if (view->line_index != NULL)
+        g_array_set_size (view->line_index, 0);
+    view->line_index_end = 0;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** returns index of the first char in the line
  * it is constant for all line characters
@@ -279,30 +399,32 @@ domcnt_get_byte (WDOMContent * view, off_t byte_index, int *retval)
 off_t
 domcnt_bol (WDOMContent * view, off_t current, off_t limit)
 {
-    int c;
+    const gchar *text = view->text;
     off_t filesize = view->text_len;
 
     if (current <= 0)
         return 0;
-    if (current > filesize)
+    if (current >= filesize)
         return filesize;
-    if (!domcnt_get_byte (view, current, &c))
-        return current;
-    if (c == '\n')
+
+    if (domcnt_line_index_extend (view, current))
     {
-        if (!domcnt_get_byte (view, current - 1, &c))
-            return current;
-        if (c == '\r')
-            current--;
+        off_t start;
+
+        start = g_array_index (view->line_index, off_t, domcnt_line_index_lookup (view, current));
+        return MIN (current, MAX (start, limit));
     }
+
+    if (text[current] == '\n' && text[current - 1] == '\r')
+        current--;
+
     while (current > 0 && current > limit)
     {
-        if (!domcnt_get_byte (view, current - 1, &c))
-            break;
-        if (c == '\r' || c == '\n')
+        if (text[current - 1] == '\r' || text[current - 1] == '\n')
             break;
         current--;
     }
+
     return current;
 }
 
@@ -314,36 +436,26 @@ domcnt_bol (WDOMContent * view, off_t current, off_t limit)
 off_t
 domcnt_eol (WDOMContent * view, off_t current)
 {
-    int c, prev_ch = 0;
-
     if (current < 0)
         return 0;
+    if (current >= (off_t) view->text_len)
+        return current;
 
-    while (TRUE)
-    {
-        if (!domcnt_get_byte (view, current, &c))
-            break;
-        if (c == '\n')
-        {
-            current++;
-            break;
-        }
-        else if (prev_ch == '\r')
-        {
-            break;
-        }
-        current++;
-        prev_ch = c;
-    }
-    return current;
+    /* walking down line by line from the indexed part grows the index */
+    if (domcnt_line_index_extend (view, current))
+        return g_array_index (view->line_index, off_t,
+                              domcnt_line_index_lookup (view, current) + 1);
+
+    return domcnt_scan_eol (view, current);
 }
 
+/* --------------------------------------------------------------------------------------------- */
 /* Invalid UTF-8 is reported as negative integers (one for each byte),
  * see ticket 3783. */
 static gboolean
 domcnt_get_utf (WDOMContent * view, off_t byte_index, int *ch, int *ch_len)
 {
-    gchar *str = NULL;
+    const gchar *str = NULL;
     int res;
     gchar utf8buf[UTF8_CHAR_LEN + 1];
 
@@ -356,7 +468,8 @@ domcnt_get_utf (WDOMContent * view, off_t byte_index, int *ch, int *ch_len)
     if (str == NULL)
         return FALSE;
 
-    res = g_utf8_get_char_validated (str, -1);
+    /* the text may refer to node data directly, which is not null-terminated */
+    res = g_utf8_get_char_validated (str, view->text_len - byte_index);
     if (res < 0)
     {
         /* Retry with explicit bytes to make sure it's not a buffer boundary */
@@ -385,7 +498,7 @@ domcnt_get_utf (WDOMContent * view, off_t byte_index, int *ch, int *ch_len)
     }
     else
     {
-        gchar *next_ch = NULL;
+        const gchar *next_ch = NULL;
 
         *ch = res;
         /* Calculate UTF-8 char length */
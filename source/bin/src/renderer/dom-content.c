@@ -90,6 +90,40 @@ domcnt_show_content (WDOMContent * domcnt)
     }
 }
 
+static void
+domcnt_release_text (WDOMContent *domcnt)
+{
+    if (domcnt->own_text) {
+        g_free (domcnt->own_text);
+        domcnt->own_text = NULL;
+    }
+
+    domcnt->text = NULL;
+    domcnt->text_len = 0;
+    domcnt_line_index_reset (domcnt);
+}
+
+static bool
+domcnt_reset_view (WDOMContent *domcnt)
+{
+    domcnt->dpy_start = 0;
+    domcnt->dpy_paragraph_skip_lines = 0;
+    domcnt->dpy_wrap_dirty = FALSE;
+    domcnt->dpy_text_column = 0;
+    domcnt->force_max = -1;
+    domcnt->mode_flags.wrap = TRUE;
+    domcnt->mode_flags.nroff = FALSE;
+    domcnt_formatter_state_init (&domcnt->dpy_state_top, 0);
+
+    if (domcnt->text) {
+        domcnt->dpy_start = domcnt_bol (domcnt, 0, 0);
+        domcnt->dpy_wrap_dirty = TRUE;
+    }
+
+    domcnt_show_content (domcnt);
+    return domcnt->text != NULL;
+}
+
 static cb_ret_t
 domcnt_execute_cmd (WDOMContent * domcnt, long command)
 {
@@ -198,8 +232,9 @@ domcnt_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *
         return domcnt_execute_cmd (domcnt, parm);
 
     case MSG_DESTROY:
-        if (domcnt->text)
-            g_free (domcnt->text);
+        domcnt_release_text (domcnt);
+        if (domcnt->line_index)
+            g_array_free (domcnt->line_index, TRUE);
         return MSG_HANDLED;
 
     default:
@@ -280,33 +315,29 @@ dom_content_new (int y, int x, int lines, int cols,
 bool
 dom_content_load (WDOMContent *domcnt, GString *string)
 {
-    if (domcnt->text) {
-        g_free (domcnt->text);
-        domcnt->text = NULL;
-        domcnt->text_len = 0;
-    }
+    domcnt_release_text (domcnt);
 
     if (string) {
         /* take the owner of string */
         domcnt->text_len = string->len;
-        domcnt->text = g_string_free (string, FALSE);
+        domcnt->own_text = g_string_free (string, FALSE);
+        domcnt->text = domcnt->own_text;
     }
 
-    domcnt->dpy_start = 0;
-    domcnt->dpy_paragraph_skip_lines = 0;
-    domcnt->dpy_wrap_dirty = FALSE;
-    domcnt->dpy_text_column = 0;
-    domcnt->force_max = -1;
-    domcnt->mode_flags.wrap = TRUE;
-    domcnt->mode_flags.nroff = FALSE;
-    domcnt_formatter_state_init (&domcnt->dpy_state_top, 0);
+    return domcnt_reset_view (domcnt);
+}
 
-    if (domcnt->text) {
-        domcnt->dpy_start = domcnt_bol (domcnt, 0, 0);
-        domcnt->dpy_wrap_dirty = TRUE;
+/* Show the data without copying it; the caller must keep the data alive
+   until another content is loaded or NULL is loaded. */
+bool
+dom_content_load_data (WDOMContent *domcnt, const gchar *data, gsize len)
+{
+    domcnt_release_text (domcnt);
+
+    if (data) {
+        domcnt->text = data;
+        domcnt->text_len = len;
     }
 
-    domcnt_show_content (domcnt);
-    return domcnt->text != NULL;
+    return domcnt_reset_view (domcnt);
 }
-
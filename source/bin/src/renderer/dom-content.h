@@ -63,8 +63,12 @@ struct WDOMContent
     const char *title;
     const char *show_eof;
 
-    gchar *text;
+    const gchar *text;          /* The text shown; may refer to the DOM node data directly */
     gsize text_len;
+    gchar *own_text;            /* The text if owned by the widget, otherwise NULL */
+
+    GArray *line_index;         /* Offsets of the line starts known so far (off_t) */
+    off_t line_index_end;       /* The text has been indexed up to this offset */
 
     struct viewport data_area;  /* Where the text is displayed */
 
@@ -91,6 +95,9 @@ typedef struct WDOMContent WDOMContent;
 WDOMContent *dom_content_new (int y, int x, int lines, int cols,
         const char* title, const char *show_eof);
 bool dom_content_load (WDOMContent *domcnt, GString *string);
+bool dom_content_load_data (WDOMContent *domcnt, const gchar *data, gsize len);
+
+void domcnt_line_index_reset (WDOMContent * view);
 
 off_t domcnt_bol (WDOMContent * view, off_t current, off_t limit);
 off_t domcnt_eol (WDOMContent * view, off_t current);
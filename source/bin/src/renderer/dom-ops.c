@@ -211,6 +211,8 @@ bool dom_cleanup_user_data(pcdom_document_t *dom_doc)
     if (user->title)
         free(user->title);
 
+    dom_tree_forget_state(dom_doc);
+
     free(user);
     dom_doc->user = NULL;
     return true;
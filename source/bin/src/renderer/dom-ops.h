@@ -20,6 +20,7 @@ struct my_dom_user_data {
     struct sorted_array *sa;    // handle to element map
     char                *title; // the title
     WDOMTree            *tree;  // the DOMTree widget
+    struct dom_tree_state *tree_state;  // the cached view state of the tree
 };
 
 bool dom_prepare_user_data(pcdom_document_t *dom_doc, bool with_handle);
@@ -93,10 +93,20 @@ struct WDOMTree {
     GString *search_buffer;     /* Current search string */
     GString *xpath_buffer;      /* XPath string */
 
+    gchar *title;           /* The title of the panel or NULL */
+
     bool searching;         /* Are we on searching mode? */
     bool is_panel;          /* panel or plain widget flag */
 };
 
+struct dom_tree_state {
+    struct list_head entries;       /* the materialized entries */
+    tree_entry *selected;
+    tree_entry *topmost;
+
+    unsigned int nr_entries;
+};
+
 /*** file scope variables */
 
 /*** file scope functions */
@@ -481,10 +491,13 @@ back_ptr (WDOMTree *tree, tree_entry *ptr, int *count)
     return container_of (p, tree_entry, list);
 }
 
+/* The character data of text, comment and CDATA nodes is shown without
+   copying it; the content widget is reset when the tree is unloaded. */
 static void
 set_entry_content(const tree_entry *entry, WDOMContent *dom_cnt)
 {
     GString *buff = NULL;
+    pcdom_character_data_t *char_data = NULL;
 
     switch (entry->node->type) {
         case PCDOM_NODE_TYPE_DOCUMENT_TYPE:
@@ -495,16 +508,10 @@ set_entry_content(const tree_entry *entry, WDOMContent *dom_cnt)
 
         case PCDOM_NODE_TYPE_COMMENT:
         {
-            const unsigned char *name;
-            size_t len;
             pcdom_comment_t *comment;
 
             comment = pcdom_interface_comment (entry->node);
-            name = comment->char_data.data.data;
-            len = comment->char_data.data.length;
-
-            buff = g_string_new ("");
-            g_string_append_len (buff, (const gchar *)name, len);
+            char_data = &comment->char_data;
             break;
         }
 
@@ -521,31 +528,19 @@ set_entry_content(const tree_entry *entry, WDOMContent *dom_cnt)
 
         case PCDOM_NODE_TYPE_TEXT:
         {
-            const unsigned char *name;
-            size_t len;
             pcdom_text_t *text;
 
             text = pcdom_interface_text (entry->node);
-            name = text->char_data.data.data;
-            len = text->char_data.data.length;
-
-            buff = g_string_new ("");
-            g_string_append_len (buff, (const gchar *)name, len);
+            char_data = &text->char_data;
             break;
         }
 
         case PCDOM_NODE_TYPE_CDATA_SECTION:
         {
-            const unsigned char *name;
-            size_t len;
             pcdom_cdata_section_t *cdata_section;
 
             cdata_section = pcdom_interface_cdata_section (entry->node);
-            name = cdata_section->text.char_data.data.data;
-            len = cdata_section->text.char_data.data.length;
-
-            buff = g_string_new ("");
-            g_string_append_len (buff, (const gchar *)name, len);
+            char_data = &cdata_section->text.char_data;
             break;
         }
 
@@ -553,11 +548,28 @@ set_entry_content(const tree_entry *entry, WDOMContent *dom_cnt)
             break;
     }
 
-    if (buff) {
+    if (char_data) {
+        dom_content_load_data (dom_cnt,
+                (const gchar *)char_data->data.data, char_data->data.length);
+    }
+    else if (buff) {
         dom_content_load (dom_cnt, buff);
     }
 }
 
+/* update other widgets */
+static void
+tree_notify_selected (WDOMTree * tree)
+{
+    execute_hooks (select_element_hook, tree->selected->node);
+    WDialog *h = DIALOG (WIDGET (tree)->owner);
+    WDOMViewInfo* info = h->data;
+    if (info && info->dom_cnt) {
+        set_entry_content(tree->selected, info->dom_cnt);
+        info->cnt_owner = tree;
+    }
+}
+
 static inline void
 tree_set_selected(WDOMTree * tree, tree_entry *new_selected, bool adjust_topmost)
 {
@@ -592,12 +604,7 @@ tree_set_selected(WDOMTree * tree, tree_entry *new_selected, bool adjust_topmost
             }
         }
 
-        /* update other widgets */
-        execute_hooks (select_element_hook, tree->selected->node);
-        WDialog *h = DIALOG (WIDGET (tree)->owner);
-        WDOMViewInfo* info = h->data;
-        if (info->dom_cnt)
-            set_entry_content(tree->selected, info->dom_cnt);
+        tree_notify_selected (tree);
     }
 }
 
@@ -1122,7 +1129,8 @@ tree_frame (WDialog * h, WDOMTree * tree)
 
     if (tree->is_panel)
     {
-        const char *title = _("DOM Tree");
+        const char *title = tree->title ?
+            str_trunc (tree->title, w->cols - 4) : _("DOM Tree");
         const int len = str_term_width1 (title);
 
         tty_draw_box (w->y, w->x, w->lines, w->cols, FALSE);
@@ -1147,16 +1155,22 @@ tree_frame (WDialog * h, WDOMTree * tree)
 }
 
 static void
-tree_unload (WDOMTree * tree)
+tree_free_entries (struct list_head *entries)
 {
     tree_entry *p, *n;
 
-    list_for_each_entry_safe (p, n, &tree->entries, list) {
+    list_for_each_entry_safe (p, n, entries, list) {
         if (p->normalized_text)
             g_free (p->normalized_text);
         list_del (&p->list);
         g_free (p);
     }
+}
+
+static void
+tree_unload (WDOMTree * tree)
+{
+    tree_free_entries (&tree->entries);
 
     tree->selected = NULL;
     tree->topmost = NULL;
@@ -1175,6 +1189,58 @@ tree_destroy (WDOMTree * tree)
 
     g_string_free (tree->search_buffer, TRUE);
     g_string_free (tree->xpath_buffer, TRUE);
+    g_free (tree->title);
+}
+
+/* move the entries of the tree to the state cache of its document */
+static void
+tree_stash (WDOMTree * tree)
+{
+    struct my_dom_user_data *user;
+    struct dom_tree_state *state;
+
+    if (tree->doc == NULL || tree->nr_entries == 0 ||
+            (user = tree->doc->user) == NULL) {
+        tree_unload (tree);
+        return;
+    }
+
+    dom_tree_forget_state (tree->doc);
+
+    state = g_new0 (struct dom_tree_state, 1);
+    INIT_LIST_HEAD (&state->entries);
+    list_splice_init (&tree->entries, &state->entries);
+    state->selected = tree->selected;
+    state->topmost = tree->topmost;
+    state->nr_entries = tree->nr_entries;
+    user->tree_state = state;
+
+    tree->selected = NULL;
+    tree->topmost = NULL;
+    tree->nr_entries = 0;
+
+    execute_hooks (select_element_hook, NULL);
+
+    g_string_truncate (tree->search_buffer, 0);
+    g_string_truncate (tree->xpath_buffer, 0);
+}
+
+/* take the cached entries of the document back */
+static void
+tree_restore (WDOMTree * tree, pcdom_document_t *doc)
+{
+    struct my_dom_user_data *user = doc->user;
+    struct dom_tree_state *state = user->tree_state;
+
+    list_splice_init (&state->entries, &tree->entries);
+    tree->selected = state->selected;
+    tree->topmost = state->topmost;
+    tree->nr_entries = state->nr_entries;
+    tree->doc = doc;
+
+    user->tree_state = NULL;
+    user->tree = tree;
+    g_free (state);
 }
 
 static cb_ret_t
@@ -1295,6 +1361,49 @@ dom_tree_new (int y, int x, int lines, int cols, bool is_panel)
     return tree;
 }
 
+void
+dom_tree_set_title (WDOMTree *tree, const char *title)
+{
+    g_free (tree->title);
+    tree->title = title ? g_strdup (title) : NULL;
+    widget_draw (WIDGET (tree));
+}
+
+void
+dom_tree_unload (WDOMTree *tree, bool keep_state)
+{
+    WDialog *h = DIALOG (WIDGET (tree)->owner);
+    WDOMViewInfo* info = h ? h->data : NULL;
+
+    /* the content may show the selection of the other tree */
+    if (info && info->dom_cnt && info->cnt_owner == tree) {
+        dom_content_load (info->dom_cnt, NULL);
+        info->cnt_owner = NULL;
+    }
+
+    if (keep_state)
+        tree_stash (tree);
+    else
+        tree_unload (tree);
+
+    tree->doc = NULL;
+}
+
+void
+dom_tree_forget_state (pcdom_document_t *doc)
+{
+    struct my_dom_user_data *user = doc->user;
+    struct dom_tree_state *state;
+
+    if (user == NULL || user->tree_state == NULL)
+        return;
+
+    state = user->tree_state;
+    tree_free_entries (&state->entries);
+    g_free (state);
+    user->tree_state = NULL;
+}
+
 static pchtml_action_t
 my_tree_walker(pcdom_node_t *node, void *ctx)
 {
@@ -1461,13 +1570,26 @@ dom_tree_load (WDOMTree *tree, pcdom_document_t *doc,
         .last               = NULL,
     };
 
-    if (tree->nr_entries > 0)
-        tree_unload (tree);
+    /* keep the view state of another document for switching back;
+       the content widget may refer to the data of a node in the old tree */
+    dom_tree_unload (tree, tree->doc != doc);
 
     /* use the user-defined pointer of document for
        whether it is the first time to load the tree. */
     struct my_dom_user_data *user = doc->user;
 
+    if (user->tree_state) {
+        if (highlight == NULL) {
+            tree_restore (tree, doc);
+            tree_notify_selected (tree);
+            show_tree (tree);
+            return true;
+        }
+
+        /* the document changed, the cached entries are stale */
+        dom_tree_forget_state (doc);
+    }
+
     if (user->tree == NULL) {
         ctxt.is_first_time = true;
     }
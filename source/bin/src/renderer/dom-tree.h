@@ -44,6 +44,10 @@
 
 typedef struct WDOMTree WDOMTree;
 
+/* The view state (materialized entries, selected and topmost entry) of a tree
+   kept for a document which is not shown, so switching back is instant. */
+struct dom_tree_state;
+
 /*** global variables defined in .c file */
 extern hook_t *select_element_hook;
 
@@ -54,6 +58,12 @@ WDOMTree *dom_tree_new (int y, int x, int lines, int cols, bool is_panel);
 bool dom_tree_load (WDOMTree *tree, pcdom_document_t *doc,
         pcdom_element_t* selected);
 
+void dom_tree_unload (WDOMTree *tree, bool keep_state);
+
+void dom_tree_forget_state (pcdom_document_t *doc);
+
+void dom_tree_set_title (WDOMTree *tree, const char *title);
+
 WDOMTree *find_dom_tree (const WDialog * h);
 
 /*** inline functions */
@@ -61,9 +61,73 @@ static WDOMViewInfo view_info;
 
 /*** file scope functions */
 
+static void
+layout_pane (Widget *pane, int x, int cols)
+{
+    widget_set_size (pane, pane->y, x, pane->lines, cols);
+}
+
+/* In the split layout the two trees are side by side in the left two
+   thirds of the window; the panes of the selected element are narrowed
+   to the third on the right. */
+static void
+layout_trees (WDOMViewInfo *info)
+{
+    Widget *vw = WIDGET (info->dlg);
+    int tree_lines = vw->lines - 2;
+    int trees_cols = vw->cols / 2;
+
+    if (info->file_window2) {
+        int left_cols = vw->cols / 3;
+
+        trees_cols = vw->cols * 2 / 3;
+        widget_set_size (WIDGET (info->dom_tree),
+                vw->y + 1, vw->x, tree_lines, left_cols);
+        widget_set_size (WIDGET (info->dom_tree2),
+                vw->y + 1, vw->x + left_cols,
+                tree_lines, trees_cols - left_cols);
+        widget_show (WIDGET (info->dom_tree2));
+    }
+    else {
+        widget_hide (WIDGET (info->dom_tree2));
+        widget_set_size (WIDGET (info->dom_tree),
+                vw->y + 1, vw->x, tree_lines, trees_cols);
+    }
+
+    layout_pane (WIDGET (info->ele_attrs), vw->x + trees_cols,
+            vw->cols - trees_cols);
+    layout_pane (WIDGET (info->dom_cnt), vw->x + trees_cols,
+            vw->cols - trees_cols);
+    layout_pane (WIDGET (info->srv_info), vw->x + trees_cols,
+            vw->cols - trees_cols);
+}
+
+/* Leave the split layout. Pass @keep_state as false if the document
+   in the split tree is about to be destroyed. */
+static void
+unsplit_view (bool keep_state)
+{
+    if (view_info.file_window2 == NULL)
+        return;
+
+    dom_tree_unload (view_info.dom_tree2, keep_state);
+    dom_tree_set_title (view_info.dom_tree2, NULL);
+
+    free (view_info.file_window2);
+    view_info.file_window2 = NULL;
+    view_info.dom_doc2 = NULL;
+
+    layout_trees (&view_info);
+}
+
 static inline void
 set_view_info(const char *filewin, pcdom_document_t *dom_doc)
 {
+    /* a document is never shown in both trees */
+    if (filewin && view_info.file_window2 &&
+            strcmp (filewin, view_info.file_window2) == 0)
+        unsplit_view (true);
+
     if (view_info.file_window)
         free(view_info.file_window);
     view_info.file_window = filewin ? strdup(filewin) : NULL;
@@ -133,8 +197,10 @@ switch_dom(const char* name, pcdom_document_t *dom_doc)
     return succeed;
 }
 
-static void
-on_switch_command(WDOMViewInfo * info)
+/* Let the user choose a DOM other than the current one;
+   return its name or NULL */
+static const char *
+select_dom(const char *title)
 {
     const int nr_doms = number_of_doms ();
     int lines, cols;
@@ -148,14 +214,14 @@ on_switch_command(WDOMViewInfo * info)
     if (nr_doms <= 1) {
         GString *buff = g_string_new ("There is only one DOM!");
         dom_content_load(view_info.srv_info, buff);
-        return;
+        return NULL;
     }
 
     lines = MIN ((size_t) (LINES * 2 / 3), nr_doms);
     cols = COLS * 2 / 3;
 
     listbox = create_listbox_window (lines, cols,
-            _("DOM Viewer"), "[DOM selector]");
+            title, "[DOM selector]");
 
     kvlist_for_each(kv, name, data) {
         listbox_add_item (listbox->list,
@@ -165,15 +231,50 @@ on_switch_command(WDOMViewInfo * info)
 
     name = run_listbox_with_data (listbox, view_info.file_window);
 
-    if (name != NULL && strcmp (name, view_info.file_window)) {
+    if (name != NULL && strcmp (name, view_info.file_window))
+        return name;
+
+    return NULL;
+}
+
+static void
+on_switch_command(WDOMViewInfo * info)
+{
+    const char *name;
 
-        data = kvlist_get (kv, name);
+    name = select_dom (_("DOM Viewer"));
+    if (name != NULL) {
+        void *data = kvlist_get (&file2dom_map, name);
         pchtml_html_document_t *html_doc = *(pchtml_html_document_t **)data;
 
         switch_dom(name, pcdom_interface_document(html_doc));
     }
 }
 
+static void
+on_split_command(WDOMViewInfo * info)
+{
+    const char *name;
+
+    if (info->file_window2) {
+        unsplit_view (true);
+        return;
+    }
+
+    name = select_dom (_("Split View"));
+    if (name != NULL) {
+        void *data = kvlist_get (&file2dom_map, name);
+        pchtml_html_document_t *html_doc = *(pchtml_html_document_t **)data;
+
+        info->file_window2 = strdup (name);
+        info->dom_doc2 = pcdom_interface_document (html_doc);
+
+        layout_trees (info);
+        dom_tree_set_title (info->dom_tree2, info->file_window2);
+        dom_tree_load (info->dom_tree2, info->dom_doc2, NULL);
+    }
+}
+
 static void
 on_reload_command(WDOMViewInfo * info)
 {
@@ -211,6 +312,7 @@ on_close_command(WDOMViewInfo * info)
     if (data) {
         pchtml_html_document_t *html_doc = *(pchtml_html_document_t **)data;
         kvlist_delete (kv, view_info.file_window);
+        dom_tree_unload (view_info.dom_tree, false);
 
         if (view_info.file_window[0] == '@') {
             // TODO: close the window and notify the runner.
@@ -226,14 +328,7 @@ on_close_command(WDOMViewInfo * info)
         kvlist_for_each(kv, name, data) {
             html_doc = *(pchtml_html_document_t **)data;
 
-            set_view_info(name, pcdom_interface_document (html_doc));
-
-            bool succeed = dom_tree_load (view_info.dom_tree,
-                    view_info.dom_doc, NULL);
-            if (succeed) {
-                hline_set_textv (view_info.caption, " %s ",
-                        view_info.file_window);
-            }
+            switch_dom(name, pcdom_interface_document (html_doc));
             break;
         }
     }
@@ -262,6 +357,9 @@ on_quit_command(WDOMViewInfo * info)
     const char* name;
     void *next, *data;
 
+    unsplit_view (false);
+    dom_tree_unload (info->dom_tree, false);
+
     kvlist_for_each_safe (kv, name, next, data) {
         pchtml_html_document_t *html_doc = *(pchtml_html_document_t **)data;
 
@@ -303,6 +401,10 @@ domview_execute_cmd (WDOMViewInfo * info, Widget * sender, long command)
         }
         break;
 
+    case CK_UserMenu:   /* F2 */
+        on_split_command (info);
+        break;
+
     case CK_View:
         on_switch_command (info);
         break;
@@ -343,7 +445,7 @@ domview_dialog_callback (Widget * w, Widget * sender,
         {
             WButtonBar *b = find_buttonbar (h);
             buttonbar_set_label (  b, 1,  Q_ ("ButtonBar|Help"), w->keymap, w);
-            buttonbar_clear_label (b, 2,  w);
+            buttonbar_set_label (  b, 2,  Q_ ("ButtonBar|Split"), w->keymap, w);
             buttonbar_set_label (  b, 3,  Q_ ("ButtonBar|Switch"), w->keymap, w);
             buttonbar_set_label (  b, 4,  Q_ ("ButtonBar|Reload"), w->keymap, w);
             buttonbar_set_label (  b, 5,  Q_ ("ButtonBar|SaveTo"), w->keymap, w);
@@ -388,9 +490,23 @@ domview_dialog_callback (Widget * w, Widget * sender,
         /* Handle shortcuts. */
         return domview_execute_cmd (&view_info, sender, parm);
 
+    case MSG_RESIZE:
+        {
+            cb_ret_t ret = dlg_default_callback (w, sender, msg, parm, data);
+            if (view_info.file_window2)
+                layout_trees (&view_info);
+            return ret;
+        }
+
     case MSG_DESTROY:
         view_info.dlg = NULL;
         view_info.caption = NULL;
+        view_info.dom_tree2 = NULL;
+        if (view_info.file_window2) {
+            free (view_info.file_window2);
+            view_info.file_window2 = NULL;
+            view_info.dom_doc2 = NULL;
+        }
         return MSG_HANDLED;
 
     default:
@@ -510,6 +626,13 @@ domview_create_dialog (WDOMViewInfo *info)
     group_add_widget_autopos (g, info->dom_tree,
             WPOS_KEEP_LEFT | WPOS_KEEP_VERT, NULL);
 
+    /* shown in split layout only, on the right of dom_tree */
+    info->dom_tree2 = dom_tree_new (vw->y + 1, vw->x + vw->cols / 3,
+            left_lines - 1, vw->cols * 2 / 3 - vw->cols / 3, TRUE);
+    group_add_widget_autopos (g, info->dom_tree2,
+            WPOS_KEEP_LEFT | WPOS_KEEP_VERT, NULL);
+    widget_hide (WIDGET (info->dom_tree2));
+
     info->ele_attrs = dom_ele_attrs_new (vw->y + 1, vw->x + half_cols,
             attr_lines, vw->cols - half_cols);
     group_add_widget_autopos (g, info->ele_attrs,
@@ -520,6 +643,7 @@ domview_create_dialog (WDOMViewInfo *info)
             vw->x + vw->cols / 2,
             cnt_lines, vw->cols - half_cols,
             _("Content"), NULL);
+    info->cnt_owner = NULL;
     group_add_widget_autopos (g, info->dom_cnt,
             WPOS_KEEP_RIGHT | WPOS_KEEP_BOTTOM, NULL);
 
@@ -685,10 +809,16 @@ domview_detach_window_dom(const char *endpoint, const char* win_id)
         g_string_append (buff, " detached");
         dom_content_load(view_info.srv_info, buff);
 
+        if (view_info.file_window2 &&
+                strcmp(view_info.file_window2, winname) == 0) {
+            unsplit_view (false);
+        }
+
         if (strcmp(view_info.file_window, winname) == 0) {
             const char *name;
             void *data;
 
+            dom_tree_unload (view_info.dom_tree, false);
             set_view_info(NULL, NULL);
             kvlist_for_each(&file2dom_map, name, data) {
                 set_view_info(name, *(pcdom_document_t **)data);
@@ -743,10 +873,16 @@ domview_detach_all_doms(const char *endpoint)
         g_string_append (buff, " detached");
         dom_content_load(view_info.srv_info, buff);
 
+        if (view_info.file_window2 &&
+                is_window_of_endpoint(view_info.file_window2, endpoint)) {
+            unsplit_view (false);
+        }
+
         if (is_window_of_endpoint(view_info.file_window, endpoint)) {
             const char *name;
             void *data;
 
+            dom_tree_unload (view_info.dom_tree, false);
             set_view_info(NULL, NULL);
             kvlist_for_each(&file2dom_map, name, data) {
                 set_view_info(name, *(pcdom_document_t **)data);
@@ -780,6 +916,8 @@ domview_reload_window_dom(const char *endpoint, const char* win_id,
         return false;
     }
 
+    pcdom_document_t *dom_doc = *data;
+
     if (view_info.dlg) {
 
         GString *buff = g_string_new (endpoint);
@@ -789,14 +927,18 @@ domview_reload_window_dom(const char *endpoint, const char* win_id,
         dom_content_load(view_info.srv_info, buff);
 
         if (strcmp(view_info.file_window, winname) == 0) {
-            pcdom_document_t *dom_doc;
-            dom_doc = *data;
-
             set_view_info(winname, dom_doc);
             return dom_tree_load(view_info.dom_tree, dom_doc, element);
         }
+
+        if (view_info.file_window2 &&
+                strcmp(view_info.file_window2, winname) == 0) {
+            return dom_tree_load(view_info.dom_tree2, dom_doc, element);
+        }
     }
 
+    /* not shown: the cached view state of the document is stale */
+    dom_tree_forget_state(dom_doc);
     return true;
 }
 
@@ -27,11 +27,16 @@ typedef struct WDOMViewInfo {
     char *            file_window;      /* current file or window */
     pcdom_document_t *dom_doc;          /* current DOM document */
 
+    char *            file_window2;     /* file or window in the split tree */
+    pcdom_document_t *dom_doc2;         /* DOM document in the split tree */
+
     WDialog         *dlg;
     WHLine          *caption;
     WDOMTree        *dom_tree;
+    WDOMTree        *dom_tree2;         /* the right tree in split layout */
     WEleAttrs       *ele_attrs;
     WDOMContent     *dom_cnt;
+    WDOMTree        *cnt_owner;         /* the tree whose selection dom_cnt shows */
     WDOMContent     *srv_info;
 } WDOMViewInfo;
 
@@ -354,8 +354,10 @@ static const struct
     { "editor_line_state", &option_line_state },
     { "editor_simple_statusbar", &simple_statusbar },
     { "editor_check_new_line", &option_check_nl_at_eof },
+    { "editor_save_sync", &option_save_sync },
     { "editor_show_right_margin", &show_right_margin },
     { "editor_group_undo", &option_group_undo },
+    { "editor_undo_spill", &option_undo_spill },
     { "editor_state_full_filename", &option_state_full_filename },
 #endif /* USE_INTERNAL_EDIT */
     { "editor_ask_filename_before_edit", &editor_ask_filename_before_edit },
@@ -393,6 +395,7 @@ static const struct
 #ifdef USE_INTERNAL_EDIT
     { "editor_word_wrap_line_length", &option_word_wrap_line_length },
     { "editor_option_save_mode", &option_save_mode },
+    { "editor_max_undo", &option_max_undo },
 #endif /* USE_INTERNAL_EDIT */
     { NULL, NULL }
 };
@@ -406,6 +409,8 @@ static const struct
 #ifdef USE_INTERNAL_EDIT
     { "editor_backup_extension", &option_backup_ext, "~" },
     { "editor_filesize_threshold", &option_filesize_threshold, "64M" },
+    { "editor_filesize_lazy", &option_filesize_lazy, "16M" },
+    { "editor_filesize_pieces", &option_filesize_pieces, "64M" },
     { "editor_stop_format_chars", &option_stop_format_chars, "-+*\\,.;:&>" },
 #endif
     { "mcview_eof", &mcview_show_eof, "" },
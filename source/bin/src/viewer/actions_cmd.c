@@ -533,6 +533,9 @@ mcview_execute_cmd (WView * view, long command)
     case CK_Ruler:
         mcview_display_toggle_ruler (view);
         break;
+    case CK_Follow:
+        mcview_follow_toggle (view);
+        break;
     case CK_Bookmark:
         view->dpy_start = view->marks[view->marker];
         view->dpy_paragraph_skip_lines = 0;     /* TODO: remember this value in the marker? */
@@ -781,6 +784,13 @@ mcview_dialog_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm,
             mcview_update (view);
         return MSG_HANDLED;
 
+    case MSG_IDLE:
+        /* build the line index while the user does nothing */
+        view = (WView *) widget_find_by_type (w, mcview_callback);
+        if (view == NULL || !mcview_lineidx_step (view))
+            widget_idle (w, FALSE);
+        return MSG_HANDLED;
+
     default:
         return dlg_default_callback (w, sender, msg, parm, data);
     }
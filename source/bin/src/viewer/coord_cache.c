@@ -63,17 +63,41 @@
 /*** file scope macro definitions ****************************************************************/
 
 #define VIEW_COORD_CACHE_GRANUL 1024
-#define CACHE_CAPACITY_DELTA 64
+#define CACHE_CAPACITY_MIN 64
 
 /*** file scope type declarations ****************************************************************/
 
-typedef gboolean (*cmp_func_t) (const coord_cache_entry_t * a, const coord_cache_entry_t * b);
+typedef gboolean (*cmp_func_t) (const coord_cache_entry_t * a, const coord_cache_t * cache,
+                                size_t i);
 
 /*** file scope variables ************************************************************************/
 
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+static inline void
+mcview_ccache_get (const coord_cache_t * cache, size_t i, coord_cache_entry_t * entry)
+{
+    entry->cc_offset = cache->offset[i];
+    entry->cc_line = cache->line[i];
+    entry->cc_column = cache->column[i];
+    entry->cc_nroff_column = cache->nroff_column[i];
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mcview_ccache_resize (coord_cache_t * cache, size_t capacity)
+{
+    cache->capacity = capacity;
+    cache->offset = g_renew (off_t, cache->offset, capacity);
+    cache->line = g_renew (off_t, cache->line, capacity);
+    cache->column = g_renew (off_t, cache->column, capacity);
+    cache->nroff_column = g_renew (off_t, cache->nroff_column, capacity);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 /* insert new cache entry into the cache */
 static void
 mcview_ccache_add_entry (coord_cache_t * cache, size_t pos, const coord_cache_entry_t * entry)
@@ -85,41 +109,46 @@ mcview_ccache_add_entry (coord_cache_t * cache, size_t pos, const coord_cache_en
 
     /* increase cache capacity if needed */
     if (cache->size == cache->capacity)
-    {
-        cache->capacity += CACHE_CAPACITY_DELTA;
-        cache->cache = g_realloc (cache->cache, cache->capacity * sizeof (*cache->cache));
-    }
+        mcview_ccache_resize (cache, cache->capacity * 2);
 
     /* insert new entry */
     if (pos != cache->size)
-        memmove (cache->cache[pos + 1], cache->cache[pos],
-                 (cache->size - pos) * sizeof (*cache->cache));
-#if GLIB_CHECK_VERSION(2, 68, 0)
-    cache->cache[pos] = g_memdup2 (entry, sizeof (*entry));
-#else
-    cache->cache[pos] = g_memdup (entry, sizeof (*entry));
-#endif
+    {
+        const size_t n = (cache->size - pos) * sizeof (off_t);
+
+        memmove (&cache->offset[pos + 1], &cache->offset[pos], n);
+        memmove (&cache->line[pos + 1], &cache->line[pos], n);
+        memmove (&cache->column[pos + 1], &cache->column[pos], n);
+        memmove (&cache->nroff_column[pos + 1], &cache->nroff_column[pos], n);
+    }
+
+    cache->offset[pos] = entry->cc_offset;
+    cache->line[pos] = entry->cc_line;
+    cache->column[pos] = entry->cc_column;
+    cache->nroff_column[pos] = entry->cc_nroff_column;
     cache->size++;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-mcview_coord_cache_entry_less_offset (const coord_cache_entry_t * a, const coord_cache_entry_t * b)
+mcview_coord_cache_entry_less_offset (const coord_cache_entry_t * a, const coord_cache_t * cache,
+                                      size_t i)
 {
-    return (a->cc_offset < b->cc_offset);
+    return (a->cc_offset < cache->offset[i]);
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-mcview_coord_cache_entry_less_plain (const coord_cache_entry_t * a, const coord_cache_entry_t * b)
+mcview_coord_cache_entry_less_plain (const coord_cache_entry_t * a, const coord_cache_t * cache,
+                                     size_t i)
 {
-    if (a->cc_line < b->cc_line)
+    if (a->cc_line < cache->line[i])
         return TRUE;
 
-    if (a->cc_line == b->cc_line)
-        return (a->cc_column < b->cc_column);
+    if (a->cc_line == cache->line[i])
+        return (a->cc_column < cache->column[i]);
 
     return FALSE;
 }
@@ -128,47 +157,90 @@ mcview_coord_cache_entry_less_plain (const coord_cache_entry_t * a, const coord_
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-mcview_coord_cache_entry_less_nroff (const coord_cache_entry_t * a, const coord_cache_entry_t * b)
+mcview_coord_cache_entry_less_nroff (const coord_cache_entry_t * a, const coord_cache_t * cache,
+                                     size_t i)
 {
-    if (a->cc_line < b->cc_line)
+    if (a->cc_line < cache->line[i])
         return TRUE;
 
-    if (a->cc_line == b->cc_line)
-        return (a->cc_nroff_column < b->cc_nroff_column);
+    if (a->cc_line == cache->line[i])
+        return (a->cc_nroff_column < cache->nroff_column[i]);
 
     return FALSE;
 }
 
 
 /* --------------------------------------------------------------------------------------------- */
-/** Find and return the index of the last cache entry that is
- * smaller than ''coord'', according to the criterion ''sort_by''. */
+/** Find and return the index of the last cache entry that is not greater
+ * than ''coord'', according to the criterion ''cmp_func''. */
 
 static inline size_t
 mcview_ccache_find (WView * view, const coord_cache_entry_t * coord, cmp_func_t cmp_func)
 {
-    size_t base = 0;
-    size_t limit = view->coord_cache->size;
+    const coord_cache_t *cache = view->coord_cache;
+    size_t lo = 1;
+    size_t hi = cache->size;
 
-    g_assert (limit != 0);
+    g_assert (hi != 0);
 
-    while (limit > 1)
+    /* the first entry is at offset 0 and never greater */
+    if (cmp_func == mcview_coord_cache_entry_less_offset)
     {
-        size_t i;
-
-        i = base + limit / 2;
-        if (cmp_func (coord, view->coord_cache->cache[i]))
+        /* plain binary search over the offset column */
+        while (lo < hi)
         {
-            /* continue the search in the lower half of the cache */
+            size_t mid = lo + (hi - lo) / 2;
+
+            if (coord->cc_offset < cache->offset[mid])
+                hi = mid;
+            else
+                lo = mid + 1;
         }
-        else
+    }
+    else
+    {
+        while (lo < hi)
         {
-            /* continue the search in the upper half of the cache */
-            base = i;
+            size_t mid = lo + (hi - lo) / 2;
+
+            if (cmp_func (coord, cache, mid))
+                hi = mid;
+            else
+                lo = mid + 1;
         }
-        limit = (limit + 1) / 2;
     }
-    return base;
+
+    return lo - 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Add the line start nearest to ''coord'' known to the line index to the cache,
+ * so that the lookup does not have to scan from the last cached entry. */
+
+static void
+mcview_ccache_seed (WView * view, const coord_cache_entry_t * coord, enum ccache_type lookup_what)
+{
+    coord_cache_entry_t entry;
+    gboolean found;
+    size_t i;
+
+    if (lookup_what == CCACHE_OFFSET)
+        found = mcview_lineidx_lookup_line (view, coord->cc_line, &entry.cc_offset, &entry.cc_line);
+    else
+        found =
+            mcview_lineidx_lookup_offset (view, coord->cc_offset, &entry.cc_offset, &entry.cc_line);
+
+    if (!found)
+        return;
+
+    entry.cc_column = 0;
+    entry.cc_nroff_column = 0;
+
+    i = mcview_ccache_find (view, &entry, mcview_coord_cache_entry_less_offset);
+
+    /* not worth it if the cache has an entry nearby */
+    if (entry.cc_offset - view->coord_cache->offset[i] >= VIEW_COORD_CACHE_GRANUL)
+        mcview_ccache_add_entry (view->coord_cache, i + 1, &entry);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -180,10 +252,8 @@ coord_cache_new (void)
 {
     coord_cache_t *cache;
 
-    cache = g_new (coord_cache_t, 1);
-    cache->size = 0;
-    cache->capacity = CACHE_CAPACITY_DELTA;
-    cache->cache = g_malloc0 (cache->capacity * sizeof (*cache->cache));
+    cache = g_new0 (coord_cache_t, 1);
+    mcview_ccache_resize (cache, CACHE_CAPACITY_MIN);
 
     return cache;
 }
@@ -195,12 +265,10 @@ coord_cache_free (coord_cache_t * cache)
 {
     if (cache != NULL)
     {
-        size_t i;
-
-        for (i = 0; i < cache->size; i++)
-            g_free (cache->cache[i]);
-
-        g_free (cache->cache);
+        g_free (cache->offset);
+        g_free (cache->line);
+        g_free (cache->column);
+        g_free (cache->nroff_column);
         g_free (cache);
     }
 }
@@ -234,10 +302,9 @@ mcview_ccache_dump (WView * view)
                         "  line %8" PRIuMAX "  column %8" PRIuMAX
                         "  nroff_column %8" PRIuMAX "\n",
                         (unsigned int) i,
-                        (uintmax_t) cache->cache[i]->cc_offset,
-                        (uintmax_t) cache->cache[i]->cc_line,
-                        (uintmax_t) cache->cache[i]->cc_column,
-                        (uintmax_t) cache->cache[i]->cc_nroff_column);
+                        (uintmax_t) cache->offset[i],
+                        (uintmax_t) cache->line[i],
+                        (uintmax_t) cache->column[i], (uintmax_t) cache->nroff_column[i]);
     }
     (void) fprintf (f, "\n");
 
@@ -324,14 +391,16 @@ mcview_ccache_lookup (WView * view, coord_cache_entry_t * coord, enum ccache_typ
 
     tty_enable_interrupt_key ();
 
+    mcview_ccache_seed (view, coord, lookup_what);
+
   retry:
     /* find the two neighbor entries in the cache */
     i = mcview_ccache_find (view, coord, cmp_func);
     /* now i points to the lower neighbor in the cache */
 
-    current = *cache->cache[i];
-    if (i + 1 < view->coord_cache->size)
-        limit = cache->cache[i + 1]->cc_offset;
+    mcview_ccache_get (cache, i, &current);
+    if (i + 1 < cache->size)
+        limit = cache->offset[i + 1];
     else
         limit = current.cc_offset + VIEW_COORD_CACHE_GRANUL;
 
@@ -432,7 +501,7 @@ mcview_ccache_lookup (WView * view, coord_cache_entry_t * coord, enum ccache_typ
             entry = next;
     }
 
-    if (i + 1 == cache->size && entry.cc_offset != cache->cache[i]->cc_offset)
+    if (i + 1 == cache->size && entry.cc_offset != cache->offset[i])
     {
         mcview_ccache_add_entry (cache, cache->size, &entry);
 
@@ -54,6 +54,13 @@
 
 #include <config.h>
 
+#include <fcntl.h>
+#include <stdint.h>             /* SIZE_MAX */
+#include <unistd.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 #include "lib/global.h"
 #include "lib/vfs/vfs.h"
 #include "lib/util.h"
@@ -65,6 +72,14 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+#ifdef HAVE_MMAP
+/* How much of a freshly mapped file to prefetch */
+#define VIEW_MMAP_PREFETCH (256 * 1024)
+#endif /* HAVE_MMAP */
+
+/* The longest span of a mapped file that is given to the search engine at once */
+#define VIEW_SPAN_MAX (1024 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 /*** file scope variables ************************************************************************/
@@ -87,6 +102,104 @@ mcview_set_datasource_stdio_pipe (WView * view, mc_pipe_t * p)
     mcview_growbuf_init (view);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mcview_file_blocks_invalidate (WView * view)
+{
+    int i;
+
+    for (i = 0; i < VIEW_FILE_CACHE_BLOCKS; i++)
+        view->ds_file_blocks[i].len = 0;
+
+    view->ds_file_datalen = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_MMAP
+static void
+mcview_mmap_unmap (WView * view)
+{
+    if (view->ds_mmap_data != NULL)
+        mc_munmap_read (view->ds_mmap_data, view->ds_mmap_len);
+    view->ds_mmap_data = NULL;
+    view->ds_mmap_len = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * (Re)map the first @size bytes of the file. An empty file is not mapped at all.
+ *
+ * @return FALSE if the mapping failed, the old mapping is gone in that case
+ */
+
+static gboolean
+mcview_mmap_map (WView * view, off_t size)
+{
+    void *data;
+
+    mcview_mmap_unmap (view);
+    view->ds_file_filesize = 0;
+
+    if (size <= 0)
+        return TRUE;
+
+    if ((uintmax_t) size > SIZE_MAX)
+        return FALSE;
+
+    /* a file truncated by another process reads as zeros rather than raising SIGBUS */
+    data = mc_mmap_read (view->ds_mmap_fd, (size_t) size, TRUE);
+    if (data == NULL)
+        return FALSE;
+
+    view->ds_mmap_data = (byte *) data;
+    view->ds_mmap_len = (size_t) size;
+    view->ds_file_filesize = size;
+
+#ifdef MADV_WILLNEED
+    /* the first screen is displayed right away */
+    (void) madvise (data, MIN (view->ds_mmap_len, VIEW_MMAP_PREFETCH), MADV_WILLNEED);
+#endif
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Switch a mapped file that cannot be mapped anymore over to plain reads */
+
+static void
+mcview_mmap_fallback (WView * view)
+{
+    struct stat st;
+    int fd;
+
+    mcview_mmap_unmap (view);
+
+    fd = view->ds_mmap_fd;
+    view->ds_mmap_fd = -1;
+
+    if (fd == -1 || fstat (fd, &st) == -1)
+    {
+        if (fd != -1)
+            (void) close (fd);
+        view->datasource = DS_NONE;
+        return;
+    }
+
+    (void) close (fd);
+
+    fd = mc_open (view->filename_vpath, O_RDONLY | O_NONBLOCK);
+    if (fd == -1)
+    {
+        view->datasource = DS_NONE;
+        return;
+    }
+
+    mcview_set_datasource_file (view, fd, &st);
+}
+#endif /* HAVE_MMAP */
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -108,6 +221,7 @@ mcview_get_filesize (WView * view)
     case DS_VFS_PIPE:
         return mcview_growbuf_filesize (view);
     case DS_FILE:
+    case DS_MMAP:
         return view->ds_file_filesize;
     case DS_STRING:
         return view->ds_string_len;
@@ -121,11 +235,27 @@ mcview_get_filesize (WView * view)
 void
 mcview_update_filesize (WView * view)
 {
-    if (view->datasource == DS_FILE)
+    struct stat st;
+
+    switch (view->datasource)
     {
-        struct stat st;
+    case DS_FILE:
         if (mc_fstat (view->ds_file_fd, &st) != -1)
             view->ds_file_filesize = st.st_size;
+        break;
+#ifdef HAVE_MMAP
+    case DS_MMAP:
+        /* The pages beyond the end of a truncated file read as zeros,
+           so the mapping must follow the size of the file */
+        if (fstat (view->ds_mmap_fd, &st) != -1
+            && (st.st_size != view->ds_file_filesize
+                || mc_mmap_read_faulted (view->ds_mmap_data))
+            && !mcview_mmap_map (view, st.st_size))
+            mcview_mmap_fallback (view);
+        break;
+#endif
+    default:
+        break;
     }
 }
 
@@ -150,6 +280,7 @@ gboolean
 mcview_get_utf (WView * view, off_t byte_index, int *ch, int *ch_len)
 {
     gchar *str = NULL;
+    gssize max_len = -1;
     int res;
     gchar utf8buf[UTF8_CHAR_LEN + 1];
 
@@ -162,6 +293,14 @@ mcview_get_utf (WView * view, off_t byte_index, int *ch, int *ch_len)
     case DS_FILE:
         str = mcview_get_ptr_file (view, byte_index);
         break;
+    case DS_MMAP:
+        /* the mapping is not NUL-terminated */
+        if (byte_index >= 0 && byte_index < view->ds_file_filesize)
+        {
+            str = (gchar *) (view->ds_mmap_data + byte_index);
+            max_len = (gssize) MIN (view->ds_file_filesize - byte_index, UTF8_CHAR_LEN);
+        }
+        break;
     case DS_STRING:
         str = mcview_get_ptr_string (view, byte_index);
         break;
@@ -175,7 +314,7 @@ mcview_get_utf (WView * view, off_t byte_index, int *ch, int *ch_len)
     if (str == NULL)
         return FALSE;
 
-    res = g_utf8_get_char_validated (str, -1);
+    res = g_utf8_get_char_validated (str, max_len);
 
     if (res < 0)
     {
@@ -228,6 +367,48 @@ mcview_get_ptr_string (WView * view, off_t byte_index)
     return NULL;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get a pointer to the data at @byte_index and the number of contiguous bytes available there.
+ */
+
+char *
+mcview_get_span (WView * view, off_t byte_index, size_t * len)
+{
+    char *p = NULL;
+
+    *len = 0;
+
+    switch (view->datasource)
+    {
+    case DS_STDIO_PIPE:
+    case DS_VFS_PIPE:
+        p = mcview_get_span_growing_buffer (view, byte_index, len);
+        break;
+    case DS_MMAP:
+        if (byte_index >= 0 && byte_index < view->ds_file_filesize)
+        {
+            p = (char *) view->ds_mmap_data + byte_index;
+            *len = (size_t) MIN (view->ds_file_filesize - byte_index, VIEW_SPAN_MAX);
+        }
+        break;
+    case DS_FILE:
+        p = mcview_get_ptr_file (view, byte_index);
+        if (p != NULL)
+            *len = view->ds_file_datalen - (size_t) (byte_index - view->ds_file_offset);
+        break;
+    case DS_STRING:
+        p = mcview_get_ptr_string (view, byte_index);
+        if (p != NULL)
+            *len = view->ds_string_len - (size_t) byte_index;
+        break;
+    default:
+        break;
+    }
+
+    return p;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 gboolean
@@ -270,9 +451,11 @@ mcview_set_byte (WView * view, off_t offset, byte b)
     (void) &b;
 
     g_assert (offset < mcview_get_filesize (view));
-    g_assert (view->datasource == DS_FILE);
+    g_assert (view->datasource == DS_FILE || view->datasource == DS_MMAP);
 
-    view->ds_file_datalen = 0;  /* just force reloading */
+    /* A shared mapping sees the change by itself */
+    if (view->datasource == DS_FILE)
+        mcview_file_blocks_invalidate (view);   /* just force reloading */
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -282,8 +465,10 @@ void
 mcview_file_load_data (WView * view, off_t byte_index)
 {
     off_t blockoffset;
+    file_block_t *block = NULL;
     ssize_t res;
     size_t bytes_read;
+    int i;
 
     g_assert (view->datasource == DS_FILE);
 
@@ -294,6 +479,40 @@ mcview_file_load_data (WView * view, off_t byte_index)
         return;
 
     blockoffset = mcview_offset_rounddown (byte_index, view->ds_file_datasize);
+
+    /* Look for the block in memory, otherwise reuse the least recently used one.
+       A block that holds the right offset but too few bytes is read again. */
+    for (i = 0; i < VIEW_FILE_CACHE_BLOCKS; i++)
+    {
+        file_block_t *b = &view->ds_file_blocks[i];
+
+        if (b->len != 0 && b->offset == blockoffset)
+        {
+            block = b;
+            break;
+        }
+
+        if (block == NULL || b->stamp < block->stamp)
+            block = b;
+    }
+
+    block->stamp = ++view->ds_file_clock;
+
+    view->ds_file_offset = blockoffset;
+    if (block->len != 0 && block->offset == blockoffset
+        && mcview_already_loaded (blockoffset, byte_index, block->len))
+    {
+        view->ds_file_data = block->data;
+        view->ds_file_datalen = block->len;
+        return;
+    }
+
+    if (block->data == NULL)
+        block->data = g_malloc (view->ds_file_datasize);
+    block->offset = blockoffset;
+    block->len = 0;
+    view->ds_file_data = block->data;
+
     if (mc_lseek (view->ds_file_fd, blockoffset, SEEK_SET) == -1)
         goto error;
 
@@ -309,16 +528,16 @@ mcview_file_load_data (WView * view, off_t byte_index)
             break;
         bytes_read += (size_t) res;
     }
-    view->ds_file_offset = blockoffset;
     if ((off_t) bytes_read > view->ds_file_filesize - view->ds_file_offset)
     {
         /* the file has grown in the meantime -- stick to the old size */
-        view->ds_file_datalen = view->ds_file_filesize - view->ds_file_offset;
+        block->len = view->ds_file_filesize - view->ds_file_offset;
     }
     else
     {
-        view->ds_file_datalen = bytes_read;
+        block->len = bytes_read;
     }
+    view->ds_file_datalen = block->len;
     return;
 
   error:
@@ -348,10 +567,26 @@ mcview_close_datasource (WView * view)
         mcview_growbuf_free (view);
         break;
     case DS_FILE:
-        (void) mc_close (view->ds_file_fd);
-        view->ds_file_fd = -1;
-        MC_PTR_FREE (view->ds_file_data);
+        {
+            int i;
+
+            (void) mc_close (view->ds_file_fd);
+            view->ds_file_fd = -1;
+            for (i = 0; i < VIEW_FILE_CACHE_BLOCKS; i++)
+                g_free (view->ds_file_blocks[i].data);
+            MC_PTR_FREE (view->ds_file_blocks);
+            view->ds_file_data = NULL;
+            view->ds_file_datalen = 0;
+        }
+        break;
+#ifdef HAVE_MMAP
+    case DS_MMAP:
+        mcview_mmap_unmap (view);
+        if (view->ds_mmap_fd != -1)
+            (void) close (view->ds_mmap_fd);
+        view->ds_mmap_fd = -1;
         break;
+#endif
     case DS_STRING:
         MC_PTR_FREE (view->ds_string_data);
         break;
@@ -370,9 +605,123 @@ mcview_set_datasource_file (WView * view, int fd, const struct stat *st)
     view->ds_file_fd = fd;
     view->ds_file_filesize = st->st_size;
     view->ds_file_offset = 0;
-    view->ds_file_data = g_malloc (4096);
+    view->ds_file_blocks = g_new0 (file_block_t, VIEW_FILE_CACHE_BLOCKS);
+    view->ds_file_clock = 0;
+    view->ds_file_data = NULL;
     view->ds_file_datalen = 0;
-    view->ds_file_datasize = 4096;
+    view->ds_file_datasize = VIEW_FILE_BLOCK_SIZE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Map a local file into memory instead of reading it block by block.
+ *
+ * @param view the viewer
+ * @param vpath the file name
+ * @param fd VFS descriptor of the opened file, closed on success
+ * @param st the status of @fd
+ *
+ * @return TRUE on success, FALSE if the file cannot be mapped. The caller still owns @fd
+ *         in the latter case.
+ */
+
+gboolean
+mcview_set_datasource_mmap (WView * view, const vfs_path_t * vpath, int fd, const struct stat *st)
+{
+#ifdef HAVE_MMAP
+    struct stat lst;
+    int local_fd;
+
+    if (!vfs_file_is_local (vpath))
+        return FALSE;
+
+    local_fd = open (vfs_path_as_str (vpath), O_RDONLY);
+    if (local_fd == -1)
+        return FALSE;
+
+    /* make sure it is the same file that was opened via VFS */
+    if (fstat (local_fd, &lst) == -1 || lst.st_dev != st->st_dev || lst.st_ino != st->st_ino)
+    {
+        (void) close (local_fd);
+        return FALSE;
+    }
+
+    view->ds_mmap_fd = local_fd;
+    view->ds_mmap_data = NULL;
+    view->ds_mmap_len = 0;
+    if (!mcview_mmap_map (view, lst.st_size))
+    {
+        (void) close (local_fd);
+        view->ds_mmap_fd = -1;
+        return FALSE;
+    }
+
+    (void) mc_close (fd);
+    view->datasource = DS_MMAP;
+    return TRUE;
+#else
+    (void) view;
+    (void) vpath;
+    (void) fd;
+    (void) st;
+
+    return FALSE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Follow a mapped file that has been truncated by another process meanwhile, e.g. a log rotated
+ * by copytruncate. Until then its pages past the new end read as zeros.
+ */
+
+void
+mcview_datasource_check (WView * view)
+{
+#ifdef HAVE_MMAP
+    struct stat st;
+
+    if (view->datasource != DS_MMAP || fstat (view->ds_mmap_fd, &st) == -1)
+        return;
+
+    if (st.st_size >= view->ds_file_filesize && !mc_mmap_read_faulted (view->ds_mmap_data))
+        return;
+
+    if (!mcview_mmap_map (view, st.st_size))
+        mcview_mmap_fallback (view);
+
+    /* nothing known about the lines of the old text applies to the new one */
+    coord_cache_free (view->coord_cache);
+    view->coord_cache = NULL;
+    mcview_lineidx_free (view);
+
+    if (view->dpy_start > mcview_get_filesize (view))
+    {
+        view->dpy_start = 0;
+        view->dpy_paragraph_skip_lines = 0;
+        mcview_state_machine_init (&view->dpy_state_top, 0);
+        view->dpy_wrap_dirty = FALSE;
+        view->hex_cursor = 0;
+    }
+#else
+    (void) view;
+#endif /* HAVE_MMAP */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Tell the kernel whether the mapped file is going to be read from start to end */
+
+void
+mcview_datasource_advise_sequential (WView * view, gboolean sequential)
+{
+#if defined(HAVE_MMAP) && defined(MADV_SEQUENTIAL) && defined(MADV_NORMAL)
+    if (view->datasource == DS_MMAP && view->ds_mmap_data != NULL)
+        (void) madvise (view->ds_mmap_data, view->ds_mmap_len,
+                        sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+#else
+    (void) view;
+    (void) sequential;
+#endif
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -90,7 +90,7 @@ mcview_set_buttonbar (WView * view)
     {
         if (view->hexedit_mode)
             buttonbar_set_label (b, 2, Q_ ("ButtonBar|View"), keymap, w);
-        else if (view->datasource == DS_FILE)
+        else if (view->datasource == DS_FILE || view->datasource == DS_MMAP)
             buttonbar_set_label (b, 2, Q_ ("ButtonBar|Edit"), keymap, w);
         else
             buttonbar_set_label (b, 2, "", keymap, WIDGET (view));
@@ -176,7 +176,7 @@ mcview_display_status (WView * view)
             size_trunc_len (buffer, BUF_TRUNC_LEN, mcview_get_filesize (view), 0,
                             panels_options.kilobyte_si);
             tty_printf ("%9" PRIuMAX "/%s%s %s", (uintmax_t) view->dpy_end,
-                        buffer, mcview_may_still_grow (view) ? "+" : " ",
+                        buffer, mcview_may_still_grow (view) || view->follow != NULL ? "+" : " ",
 #ifdef HAVE_CHARSET
                         mc_global.source_codepage >= 0 ?
                         get_codepage_id (mc_global.source_codepage) :
@@ -246,11 +246,18 @@ mcview_update (WView * view)
 void
 mcview_display (WView * view)
 {
+    mcview_datasource_check (view);
+
+    /* the output of a command is drawn as it arrives */
+    view->growbuf_nowait = TRUE;
+
     if (view->mode_flags.hex)
         mcview_display_hex (view);
     else
         mcview_display_text (view);
     mcview_display_status (view);
+
+    view->growbuf_nowait = FALSE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
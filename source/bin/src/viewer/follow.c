@@ -0,0 +1,377 @@
+/*
+   Internal file viewer for the Midnight Commander
+   Follow mode: keep showing the end of a growing file
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   In follow mode the viewer works like "tail -F": data appended to the file
+   is picked up without reloading it, the line index carries on from where it
+   stopped and the view is kept at the end of the file.
+
+   A local file is watched with inotify, together with its directory so that
+   a new file created under the same name is noticed. Files of other VFS and
+   systems without inotify are checked with stat() once a second.
+
+   If the file becomes shorter or the name refers to another file (e.g. after
+   the log was rotated), the file is opened again and shown from scratch.
+
+   The work is done from the idle hook, and only while the viewer is the topmost
+   dialog, so that nothing is drawn over a dialog box.
+ */
+
+#include <config.h>
+
+#include <fcntl.h>
+#include <string.h>             /* strcmp() */
+#include <unistd.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#include "lib/global.h"
+#include "lib/tty/key.h"        /* add_select_channel(), delete_select_channel() */
+#include "lib/vfs/vfs.h"
+#include "lib/widget.h"
+
+#include "internal.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* Interval between two checks of a file that cannot be watched, in microseconds */
+#define VIEW_FOLLOW_POLL_INTERVAL G_USEC_PER_SEC
+
+/*** file scope type declarations ****************************************************************/
+
+struct mcview_follow_struct
+{
+    dev_t dev;                  /* the file currently shown */
+    ino_t ino;
+    gboolean changed;           /* a notification has arrived */
+    gint64 next_poll;           /* when to check a file that is not watched */
+
+    int inotify_fd;             /* -1 if the file is polled */
+    int file_wd;
+    int dir_wd;
+    char *name;                 /* base name of the file, to filter the events of the directory */
+};
+
+/*** file scope variables ************************************************************************/
+
+/* The viewers in follow mode, all served by one idle hook */
+static GSList *follow_views = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_SYS_INOTIFY_H
+static int
+mcview_follow_notify (int fd, void *info)
+{
+    mcview_follow_t *f = (mcview_follow_t *) info;
+    union
+    {
+        struct inotify_event ev;
+        char buf[4096];
+    } u;
+    ssize_t len;
+
+    while ((len = read (fd, u.buf, sizeof (u.buf))) > 0)
+    {
+        const char *p;
+
+        for (p = u.buf; p < u.buf + len;
+             p += sizeof (struct inotify_event) + ((const struct inotify_event *) p)->len)
+        {
+            const struct inotify_event *ev = (const struct inotify_event *) p;
+
+            if (ev->wd == f->file_wd || (ev->wd == f->dir_wd && ev->len != 0
+                                         && strcmp (ev->name, f->name) == 0))
+                f->changed = TRUE;
+        }
+    }
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mcview_follow_watch_file (WView * view)
+{
+    mcview_follow_t *f = view->follow;
+
+    if (f->file_wd != -1)
+        (void) inotify_rm_watch (f->inotify_fd, f->file_wd);
+
+    f->file_wd = inotify_add_watch (f->inotify_fd, vfs_path_as_str (view->filename_vpath),
+                                    IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mcview_follow_watch (WView * view)
+{
+    mcview_follow_t *f = view->follow;
+    const char *path;
+    char *dir;
+
+    if (!vfs_file_is_local (view->filename_vpath))
+        return;
+
+    f->inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (f->inotify_fd == -1)
+        return;
+
+    mcview_follow_watch_file (view);
+
+    path = vfs_path_as_str (view->filename_vpath);
+    dir = g_path_get_dirname (path);
+    f->name = g_path_get_basename (path);
+    f->dir_wd = inotify_add_watch (f->inotify_fd, dir, IN_CREATE | IN_MOVED_TO);
+    g_free (dir);
+
+    if (f->file_wd == -1 && f->dir_wd == -1)
+    {
+        (void) close (f->inotify_fd);
+        f->inotify_fd = -1;
+        return;
+    }
+
+    add_select_channel (f->inotify_fd, mcview_follow_notify, f);
+}
+#endif /* HAVE_SYS_INOTIFY_H */
+
+/* --------------------------------------------------------------------------------------------- */
+/** Open the file again, e.g. if it was replaced by another one */
+
+static gboolean
+mcview_follow_reopen (WView * view)
+{
+    struct stat st;
+    int fd;
+
+    fd = mc_open (view->filename_vpath, O_RDONLY | O_NONBLOCK);
+    if (fd == -1)
+        return FALSE;
+
+    if (mc_fstat (fd, &st) == -1 || !S_ISREG (st.st_mode))
+    {
+        (void) mc_close (fd);
+        return FALSE;
+    }
+
+    mcview_close_datasource (view);
+    if (!mcview_set_datasource_mmap (view, view->filename_vpath, fd, &st))
+        mcview_set_datasource_file (view, fd, &st);
+
+    /* nothing known about the old file applies to the new one */
+    coord_cache_free (view->coord_cache);
+    view->coord_cache = NULL;
+    mcview_lineidx_free (view);
+    mcview_hexedit_free_change_list (view);
+
+    view->dpy_start = 0;
+    view->dpy_paragraph_skip_lines = 0;
+    mcview_state_machine_init (&view->dpy_state_top, 0);
+    view->dpy_wrap_dirty = FALSE;
+    view->hex_cursor = 0;
+
+    view->follow->dev = st.st_dev;
+    view->follow->ino = st.st_ino;
+
+#ifdef HAVE_SYS_INOTIFY_H
+    if (view->follow->inotify_fd != -1)
+        mcview_follow_watch_file (view);
+#endif
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Pick up the changes of the file. Return TRUE if there is something new to show. */
+
+static gboolean
+mcview_follow_update (WView * view)
+{
+    mcview_follow_t *f = view->follow;
+    struct stat st;
+    off_t filesize;
+
+    filesize = mcview_get_filesize (view);
+
+    if (mc_stat (view->filename_vpath, &st) == 0 && S_ISREG (st.st_mode)
+        && (st.st_dev != f->dev || st.st_ino != f->ino || st.st_size < filesize))
+        return mcview_follow_reopen (view);
+
+    /* the file has grown, or is gone but still may be written to */
+    mcview_update_filesize (view);
+    return (mcview_get_filesize (view) != filesize);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mcview_follow_view (WView * view)
+{
+    mcview_follow_t *f = view->follow;
+
+    if (!f->changed)
+    {
+        gint64 now;
+
+        if (f->inotify_fd != -1)
+            return;
+
+        now = g_get_monotonic_time ();
+        if (now < f->next_poll)
+            return;
+        f->next_poll = now + VIEW_FOLLOW_POLL_INTERVAL;
+        f->changed = TRUE;
+    }
+
+    /* the change is kept until the viewer is on top again */
+    if (!mcview_is_on_top (view))
+        return;
+
+    f->changed = FALSE;
+
+    if (mcview_follow_update (view))
+    {
+        mcview_lineidx_resume (view);
+        mcview_moveto_bottom (view);
+        view->dirty++;
+        mcview_display (view);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mcview_follow_hook (void *data, void *info)
+{
+    GSList *l;
+
+    (void) data;
+    (void) info;
+
+    for (l = follow_views; l != NULL; l = g_slist_next (l))
+        mcview_follow_view ((WView *) l->data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start following the file shown by @view.
+ *
+ * @return FALSE if the data does not come from a regular file
+ */
+
+gboolean
+mcview_follow_start (WView * view)
+{
+    mcview_follow_t *f;
+    struct stat st;
+
+    if (view->follow != NULL)
+        return TRUE;
+
+    if (view->filename_vpath == NULL || view->command != NULL
+        || mc_stat (view->filename_vpath, &st) == -1 || !S_ISREG (st.st_mode))
+        return FALSE;
+
+    f = g_new0 (mcview_follow_t, 1);
+    f->dev = st.st_dev;
+    f->ino = st.st_ino;
+    f->inotify_fd = -1;
+    f->file_wd = -1;
+    f->dir_wd = -1;
+    view->follow = f;
+
+    /* an empty file was read as a pipe */
+    if (view->datasource != DS_FILE && view->datasource != DS_MMAP && !mcview_follow_reopen (view))
+    {
+        view->follow = NULL;
+        g_free (f);
+        return FALSE;
+    }
+
+#ifdef HAVE_SYS_INOTIFY_H
+    mcview_follow_watch (view);
+#endif
+
+    if (follow_views == NULL)
+        add_hook (&idle_hook, mcview_follow_hook, NULL);
+    follow_views = g_slist_prepend (follow_views, view);
+
+    /* catch up with what was written since the file was loaded */
+    (void) mcview_follow_update (view);
+    mcview_lineidx_resume (view);
+    mcview_moveto_bottom (view);
+    view->dirty++;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+mcview_follow_stop (WView * view)
+{
+    mcview_follow_t *f = view->follow;
+
+    if (f == NULL)
+        return;
+
+    follow_views = g_slist_remove (follow_views, view);
+    if (follow_views == NULL)
+        delete_hook (&idle_hook, mcview_follow_hook);
+
+#ifdef HAVE_SYS_INOTIFY_H
+    if (f->inotify_fd != -1)
+    {
+        delete_select_channel (f->inotify_fd);
+        (void) close (f->inotify_fd);
+    }
+#endif
+
+    g_free (f->name);
+    g_free (f);
+    view->follow = NULL;
+    view->dirty++;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+mcview_follow_toggle (WView * view)
+{
+    if (view->follow != NULL)
+        mcview_follow_stop (view);
+    else if (!mcview_follow_start (view))
+        message (D_ERROR, MSG_ERROR, _("Follow mode works with regular files only"));
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -33,10 +33,24 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/*
+   Command output is drained from the event loop as it arrives, so the viewer
+   stays responsive while a slow command is still running; the display only
+   shows what has arrived so far and is redrawn when more comes in. Explicit
+   requests for more data (moving down, goto, search) still wait for it.
+
+   The data is kept in blocks of VIEW_PAGE_SIZE bytes. When more than
+   VIEW_GROWBUF_MEMORY_MAX bytes have been read, the oldest blocks are moved
+   to an unlinked temporary file and read back on demand.
+ */
+
 #include <config.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/select.h>
 
 #include "lib/global.h"
+#include "lib/tty/key.h"        /* add_select_channel(), delete_select_channel() */
 #include "lib/vfs/vfs.h"
 #include "lib/util.h"
 #include "lib/widget.h"         /* D_NORMAL */
@@ -44,19 +58,383 @@
 #include "internal.h"
 
 /* Block size for reading files in parts */
-#define VIEW_PAGE_SIZE ((size_t) 8192)
+#define VIEW_PAGE_SIZE ((size_t) 65536)
 
 /*** global variables ****************************************************************************/
 
 /*** file scope macro definitions ****************************************************************/
 
+/* Amount of data kept in memory, the older blocks are moved to a temporary file */
+#define VIEW_GROWBUF_MEMORY_MAX ((size_t) 64 * 1024 * 1024)
+
+/* Number of blocks read back from the temporary file that are kept in memory */
+#define VIEW_GROWBUF_SPILL_CACHE 4
+
+/* Number of bytes read from the pipe in the background at once */
+#define VIEW_GROWBUF_ASYNC_BUDGET ((size_t) 1024 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 /*** file scope variables ************************************************************************/
 
+/* forward declarations */
+static int mcview_growbuf_pipe_cb (int fd, void *info);
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+/** Check whether the command has written something that can be read without waiting */
+
+static gboolean
+mcview_growbuf_pipe_ready (WView * view)
+{
+    mc_pipe_t *sp = view->ds_stdio_pipe;
+    fd_set fds;
+    struct timeval tv = { 0, 0 };
+    int maxfd = -1;
+
+    FD_ZERO (&fds);
+    if (sp->out.fd >= 0)
+    {
+        FD_SET (sp->out.fd, &fds);
+        maxfd = sp->out.fd;
+    }
+    if (sp->err.fd >= 0)
+    {
+        FD_SET (sp->err.fd, &fds);
+        maxfd = MAX (maxfd, sp->err.fd);
+    }
+
+    return (maxfd >= 0 && select (maxfd + 1, &fds, NULL, NULL, &tv) > 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Start or stop draining the pipe from the event loop */
+
+static void
+mcview_growbuf_watch (WView * view, gboolean watch)
+{
+    mc_pipe_t *sp = view->ds_stdio_pipe;
+
+    /* a view that was switched to an error message is not watched again */
+    if (!view->growbuf_async || (watch && view->datasource != DS_STDIO_PIPE))
+        return;
+
+    if (watch)
+    {
+        if (sp->out.fd >= 0)
+            add_select_channel (sp->out.fd, mcview_growbuf_pipe_cb, view);
+        if (sp->err.fd >= 0)
+            add_select_channel (sp->err.fd, mcview_growbuf_pipe_cb, view);
+    }
+    else
+    {
+        if (sp->out.fd >= 0)
+            delete_select_channel (sp->out.fd);
+        if (sp->err.fd >= 0)
+            delete_select_channel (sp->err.fd);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mcview_growbuf_spill_io (int fd, off_t offset, byte * buf, size_t len, gboolean do_write)
+{
+    if (lseek (fd, offset, SEEK_SET) == -1)
+        return FALSE;
+
+    while (len != 0)
+    {
+        ssize_t n;
+
+        if (do_write)
+            n = write (fd, buf, len);
+        else
+            n = read (fd, buf, len);
+
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FALSE;
+
+        buf += n;
+        len -= (size_t) n;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Move the oldest blocks to the temporary file while there are too many of them in memory */
+
+static void
+mcview_growbuf_spill (WView * view)
+{
+    GPtrArray *blocks = view->growbuf_blockptr;
+
+    /* the last block is being filled */
+    while ((blocks->len - 1 - view->growbuf_spilled) * VIEW_PAGE_SIZE > VIEW_GROWBUF_MEMORY_MAX)
+    {
+        byte *block;
+
+        if (view->growbuf_spill_fd == -1)
+        {
+            vfs_path_t *tmp_vpath = NULL;
+            int fd;
+
+            fd = mc_mkstemps (&tmp_vpath, "mcview", NULL);
+            if (fd == -1)
+                return;
+
+            /* the file is gone as soon as it is closed */
+            (void) unlink (vfs_path_as_str (tmp_vpath));
+            vfs_path_free (tmp_vpath, TRUE);
+            view->growbuf_spill_fd = fd;
+        }
+
+        block = (byte *) g_ptr_array_index (blocks, view->growbuf_spilled);
+        if (!mcview_growbuf_spill_io (view->growbuf_spill_fd,
+                                      (off_t) view->growbuf_spilled * VIEW_PAGE_SIZE, block,
+                                      VIEW_PAGE_SIZE, TRUE))
+            return;
+
+        g_free (block);
+        g_ptr_array_index (blocks, view->growbuf_spilled) = NULL;
+        view->growbuf_spilled++;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get a block that was moved to the temporary file */
+
+static byte *
+mcview_growbuf_spill_load (WView * view, off_t pageno)
+{
+    const off_t offset = pageno * (off_t) VIEW_PAGE_SIZE;
+    file_block_t *block = NULL;
+    int i;
+
+    if (view->growbuf_spill_cache == NULL)
+        view->growbuf_spill_cache = g_new0 (file_block_t, VIEW_GROWBUF_SPILL_CACHE);
+
+    for (i = 0; i < VIEW_GROWBUF_SPILL_CACHE; i++)
+    {
+        file_block_t *b = &view->growbuf_spill_cache[i];
+
+        if (b->len != 0 && b->offset == offset)
+        {
+            b->stamp = ++view->growbuf_spill_clock;
+            return b->data;
+        }
+
+        /* the caller of mcview_get_span_growing_buffer() may still read the pinned block */
+        if (i != view->growbuf_spill_pinned && (block == NULL || b->stamp < block->stamp))
+            block = b;
+    }
+
+    if (block->data == NULL)
+        block->data = g_malloc (VIEW_PAGE_SIZE);
+
+    block->len = 0;
+    if (!mcview_growbuf_spill_io (view->growbuf_spill_fd, offset, block->data, VIEW_PAGE_SIZE,
+                                  FALSE))
+        return NULL;
+
+    block->offset = offset;
+    block->len = VIEW_PAGE_SIZE;
+    block->stamp = ++view->growbuf_spill_clock;
+    return block->data;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Read the output of the command into the free part @p of the last block */
+
+static ssize_t
+mcview_growbuf_read_pipe (WView * view, byte * p, size_t bytesfree)
+{
+    mc_pipe_t *sp = view->ds_stdio_pipe;
+    GError *error = NULL;
+    ssize_t nread = 0;
+
+    if (bytesfree > MC_PIPE_BUFSIZE)
+        bytesfree = MC_PIPE_BUFSIZE;
+
+    sp->out.len = bytesfree;
+    sp->err.len = MC_PIPE_BUFSIZE;
+
+    mc_pread (sp, &error);
+
+    if (error != NULL)
+    {
+        mcview_show_error (view, error->message);
+        g_error_free (error);
+        mcview_growbuf_done (view);
+        return -1;
+    }
+
+    if (sp->out.len > 0)
+    {
+        memmove (p, sp->out.buf, sp->out.len);
+        nread = sp->out.len;
+        view->growbuf_lastindex += nread;
+    }
+
+    if (view->pipe_first_err_msg && sp->err.len > 0)
+    {
+        /* ignore possible following errors */
+        /* reset this flag before call of mcview_show_error() to break
+         * endless recursion: mcview_growbuf_read_until() -> mcview_show_error() ->
+         * MSG_DRAW -> mcview_display() -> mcview_get_byte() -> mcview_growbuf_read_until()
+         */
+        view->pipe_first_err_msg = FALSE;
+
+        mcview_show_error (view, sp->err.buf);
+    }
+
+    if (nread == 0 && (sp->out.len == MC_PIPE_STREAM_EOF || sp->out.len == MC_PIPE_ERROR_READ))
+    {
+        if (sp->out.len == MC_PIPE_ERROR_READ)
+        {
+            char *err_msg;
+
+            err_msg = g_strdup_printf (_("Failed to read data from child stdout:\n%s"),
+                                       unix_error_string (sp->out.error));
+            mcview_show_error (view, err_msg);
+            g_free (err_msg);
+        }
+
+        /* when switch from parse to raw mode and back,
+         * do not close the already closed pipe after following loop:
+         * mcview_growbuf_read_until() -> mcview_show_error() ->
+         * MSG_DRAW -> mcview_display() -> mcview_get_byte() -> mcview_growbuf_read_until()
+         */
+        mcview_growbuf_done (view);
+
+        if (mcview_is_on_top (view))
+            mcview_display (view);
+        return -1;
+    }
+
+    return nread;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read one piece of data from the pipe into the growing buffer, waiting for it if needed.
+ *
+ * @return the number of bytes read, -1 if there is no more data
+ */
+
+static ssize_t
+mcview_growbuf_read_chunk (WView * view)
+{
+    ssize_t nread = 0;
+    byte *p;
+    size_t bytesfree;
+
+    if (view->growbuf_finished)
+        return -1;
+
+    if (view->growbuf_lastindex == VIEW_PAGE_SIZE)
+    {
+        /* Append a new block to the growing buffer */
+        byte *newblock = g_try_malloc (VIEW_PAGE_SIZE);
+        if (newblock == NULL)
+            return -1;
+
+        g_ptr_array_add (view->growbuf_blockptr, newblock);
+        view->growbuf_lastindex = 0;
+
+        mcview_growbuf_spill (view);
+    }
+
+    p = (byte *) g_ptr_array_index (view->growbuf_blockptr,
+                                    view->growbuf_blockptr->len - 1) + view->growbuf_lastindex;
+
+    bytesfree = VIEW_PAGE_SIZE - view->growbuf_lastindex;
+
+    if (view->datasource == DS_STDIO_PIPE)
+    {
+        const gboolean nested = view->growbuf_reading;
+
+        /* the data must be stored before anything else reads the pipe, e.g. the background
+           reader from the event loop of an error message, so the pipe is not watched meanwhile */
+        view->growbuf_reading = TRUE;
+        if (!nested)
+            mcview_growbuf_watch (view, FALSE);
+
+        nread = mcview_growbuf_read_pipe (view, p, bytesfree);
+
+        if (!nested)
+        {
+            view->growbuf_reading = FALSE;
+            mcview_growbuf_watch (view, TRUE);
+        }
+    }
+    else
+    {
+        g_assert (view->datasource == DS_VFS_PIPE);
+        do
+        {
+            nread = mc_read (view->ds_vfs_pipe, p, bytesfree);
+        }
+        while (nread == -1 && errno == EINTR);
+
+        if (nread <= 0)
+        {
+            mcview_growbuf_done (view);
+            return -1;
+        }
+
+        view->growbuf_lastindex += nread;
+    }
+
+    return nread;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Drain the pipe while the command is writing to it, called from the event loop */
+
+static int
+mcview_growbuf_pipe_cb (int fd, void *info)
+{
+    WView *view = (WView *) info;
+    off_t oldsize;
+    size_t budget = VIEW_GROWBUF_ASYNC_BUDGET;
+
+    if (view->datasource != DS_STDIO_PIPE || !view->growbuf_async)
+    {
+        /* the view was switched to an error message */
+        delete_select_channel (fd);
+        return 0;
+    }
+
+    oldsize = mcview_growbuf_filesize (view);
+
+    while (TRUE)
+    {
+        ssize_t nread;
+
+        nread = mcview_growbuf_read_chunk (view);
+        if (nread < 0 || (size_t) nread >= budget)
+            break;
+        budget -= (size_t) nread;
+
+        if (view->datasource != DS_STDIO_PIPE || !view->growbuf_async
+            || !mcview_growbuf_pipe_ready (view))
+            break;
+    }
+
+    if (view->growbuf_in_use && mcview_growbuf_filesize (view) != oldsize && mcview_is_on_top (view))
+    {
+        view->dirty++;
+        mcview_update (view);
+    }
+
+    return 0;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -68,6 +446,17 @@ mcview_growbuf_init (WView * view)
     view->growbuf_blockptr = g_ptr_array_new ();
     view->growbuf_lastindex = VIEW_PAGE_SIZE;
     view->growbuf_finished = FALSE;
+    view->growbuf_reading = FALSE;
+    view->growbuf_nowait = FALSE;
+    view->growbuf_spill_fd = -1;
+    view->growbuf_spilled = 0;
+    view->growbuf_spill_cache = NULL;
+    view->growbuf_spill_clock = 0;
+    view->growbuf_spill_pinned = -1;
+
+    /* the descriptor of a VFS pipe cannot be watched */
+    view->growbuf_async = (view->datasource == DS_STDIO_PIPE);
+    mcview_growbuf_watch (view, TRUE);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -79,6 +468,11 @@ mcview_growbuf_done (WView * view)
 
     if (view->datasource == DS_STDIO_PIPE)
     {
+        /* the pipe is not watched while it is read */
+        if (!view->growbuf_reading)
+            mcview_growbuf_watch (view, FALSE);
+        view->growbuf_async = FALSE;
+
         mc_pclose (view->ds_stdio_pipe, NULL);
         view->ds_stdio_pipe = NULL;
     }
@@ -100,6 +494,21 @@ mcview_growbuf_free (WView * view)
 
     (void) g_ptr_array_free (view->growbuf_blockptr, TRUE);
 
+    if (view->growbuf_spill_cache != NULL)
+    {
+        int i;
+
+        for (i = 0; i < VIEW_GROWBUF_SPILL_CACHE; i++)
+            g_free (view->growbuf_spill_cache[i].data);
+        MC_PTR_FREE (view->growbuf_spill_cache);
+    }
+
+    if (view->growbuf_spill_fd != -1)
+    {
+        (void) close (view->growbuf_spill_fd);
+        view->growbuf_spill_fd = -1;
+    }
+
     view->growbuf_blockptr = NULL;
     view->growbuf_in_use = FALSE;
 }
@@ -126,114 +535,11 @@ mcview_growbuf_filesize (WView * view)
 void
 mcview_growbuf_read_until (WView * view, off_t ofs)
 {
-    gboolean short_read = FALSE;
-
     g_assert (view->growbuf_in_use);
 
-    if (view->growbuf_finished)
-        return;
-
-    while (mcview_growbuf_filesize (view) < ofs || short_read)
-    {
-        ssize_t nread = 0;
-        byte *p;
-        size_t bytesfree;
-
-        if (view->growbuf_lastindex == VIEW_PAGE_SIZE)
-        {
-            /* Append a new block to the growing buffer */
-            byte *newblock = g_try_malloc (VIEW_PAGE_SIZE);
-            if (newblock == NULL)
-                return;
-
-            g_ptr_array_add (view->growbuf_blockptr, newblock);
-            view->growbuf_lastindex = 0;
-        }
-
-        p = (byte *) g_ptr_array_index (view->growbuf_blockptr,
-                                        view->growbuf_blockptr->len - 1) + view->growbuf_lastindex;
-
-        bytesfree = VIEW_PAGE_SIZE - view->growbuf_lastindex;
-
-        if (view->datasource == DS_STDIO_PIPE)
-        {
-            mc_pipe_t *sp = view->ds_stdio_pipe;
-            GError *error = NULL;
-
-            if (bytesfree > MC_PIPE_BUFSIZE)
-                bytesfree = MC_PIPE_BUFSIZE;
-
-            sp->out.len = bytesfree;
-            sp->err.len = MC_PIPE_BUFSIZE;
-
-            mc_pread (sp, &error);
-
-            if (error != NULL)
-            {
-                mcview_show_error (view, error->message);
-                g_error_free (error);
-                mcview_growbuf_done (view);
-                return;
-            }
-
-            if (view->pipe_first_err_msg && sp->err.len > 0)
-            {
-                /* ignore possible following errors */
-                /* reset this flag before call of mcview_show_error() to break
-                 * endless recursion: mcview_growbuf_read_until() -> mcview_show_error() ->
-                 * MSG_DRAW -> mcview_display() -> mcview_get_byte() -> mcview_growbuf_read_until()
-                 */
-                view->pipe_first_err_msg = FALSE;
-
-                mcview_show_error (view, sp->err.buf);
-            }
-
-            if (sp->out.len > 0)
-            {
-                memmove (p, sp->out.buf, sp->out.len);
-                nread = sp->out.len;
-            }
-            else if (sp->out.len == MC_PIPE_STREAM_EOF || sp->out.len == MC_PIPE_ERROR_READ)
-            {
-                if (sp->out.len == MC_PIPE_ERROR_READ)
-                {
-                    char *err_msg;
-
-                    err_msg = g_strdup_printf (_("Failed to read data from child stdout:\n%s"),
-                                               unix_error_string (sp->out.error));
-                    mcview_show_error (view, err_msg);
-                    g_free (err_msg);
-                }
-
-                /* when switch from parse to raw mode and back,
-                 * do not close the already closed pipe after following loop:
-                 * mcview_growbuf_read_until() -> mcview_show_error() ->
-                 * MSG_DRAW -> mcview_display() -> mcview_get_byte() -> mcview_growbuf_read_until()
-                 */
-                mcview_growbuf_done (view);
-
-                mcview_display (view);
-                return;
-            }
-        }
-        else
-        {
-            g_assert (view->datasource == DS_VFS_PIPE);
-            do
-            {
-                nread = mc_read (view->ds_vfs_pipe, p, bytesfree);
-            }
-            while (nread == -1 && errno == EINTR);
-
-            if (nread <= 0)
-            {
-                mcview_growbuf_done (view);
-                return;
-            }
-        }
-        short_read = ((size_t) nread < bytesfree);
-        view->growbuf_lastindex += nread;
-    }
+    while (!view->growbuf_finished && mcview_growbuf_filesize (view) < ofs)
+        if (mcview_growbuf_read_chunk (view) < 0)
+            break;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -267,6 +573,7 @@ char *
 mcview_get_ptr_growing_buffer (WView * view, off_t byte_index)
 {
     off_t pageno, pageindex;
+    byte *block;
 
     g_assert (view->growbuf_in_use);
 
@@ -276,15 +583,61 @@ mcview_get_ptr_growing_buffer (WView * view, off_t byte_index)
     pageno = byte_index / VIEW_PAGE_SIZE;
     pageindex = byte_index % VIEW_PAGE_SIZE;
 
-    mcview_growbuf_read_until (view, byte_index + 1);
+    /* the display does not wait for the data the background reader has not got yet */
+    if (!(view->growbuf_nowait && view->growbuf_async))
+        mcview_growbuf_read_until (view, byte_index + 1);
     if (view->growbuf_blockptr->len == 0)
         return NULL;
-    if (pageno < (off_t) view->growbuf_blockptr->len - 1)
-        return ((char *) g_ptr_array_index (view->growbuf_blockptr, pageno) + pageindex);
+    if (pageno > (off_t) view->growbuf_blockptr->len - 1)
+        return NULL;
     if (pageno == (off_t) view->growbuf_blockptr->len - 1
-        && pageindex < (off_t) view->growbuf_lastindex)
-        return ((char *) g_ptr_array_index (view->growbuf_blockptr, pageno) + pageindex);
-    return NULL;
+        && pageindex >= (off_t) view->growbuf_lastindex)
+        return NULL;
+
+    if (pageno < (off_t) view->growbuf_spilled)
+        block = mcview_growbuf_spill_load (view, pageno);
+    else
+        block = (byte *) g_ptr_array_index (view->growbuf_blockptr, pageno);
+
+    return (block == NULL ? NULL : (char *) block + pageindex);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get a pointer to the data at @byte_index and the number of bytes available in its page.
+ * The span stays valid until the next call, even if it was read back from the temporary file.
+ */
+
+char *
+mcview_get_span_growing_buffer (WView * view, off_t byte_index, size_t * len)
+{
+    char *p;
+    off_t pageno;
+
+    *len = 0;
+    view->growbuf_spill_pinned = -1;
+
+    p = mcview_get_ptr_growing_buffer (view, byte_index);
+    if (p != NULL)
+    {
+        pageno = byte_index / VIEW_PAGE_SIZE;
+        if (pageno < (off_t) view->growbuf_spilled)
+        {
+            int i;
+
+            for (i = 0; i < VIEW_GROWBUF_SPILL_CACHE; i++)
+                if (view->growbuf_spill_cache[i].len != 0
+                    && view->growbuf_spill_cache[i].offset == pageno * (off_t) VIEW_PAGE_SIZE)
+                    view->growbuf_spill_pinned = i;
+        }
+
+        if (pageno == (off_t) view->growbuf_blockptr->len - 1)
+            *len = view->growbuf_lastindex - (size_t) (byte_index % VIEW_PAGE_SIZE);
+        else
+            *len = VIEW_PAGE_SIZE - (size_t) (byte_index % VIEW_PAGE_SIZE);
+    }
+
+    return p;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -412,6 +412,9 @@ mcview_hexedit_save_changes (WView * view)
 
             view->change_list = NULL;
 
+            /* line breaks may have been changed */
+            mcview_lineidx_start (view);
+
             if (view->locked)
                 view->locked = unlock_file (view->filename_vpath);
 
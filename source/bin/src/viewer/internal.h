@@ -24,6 +24,10 @@
 
 typedef unsigned char byte;
 
+/* Size of a block of a VFS file read at once and number of such blocks kept in memory */
+#define VIEW_FILE_BLOCK_SIZE (32 * 1024)
+#define VIEW_FILE_CACHE_BLOCKS 16
+
 /* A width or height on the screen */
 typedef unsigned int screen_dimen;
 
@@ -36,6 +40,7 @@ enum view_ds
     DS_STDIO_PIPE,              /* Data comes from a pipe using popen/pclose */
     DS_VFS_PIPE,                /* Data comes from a piped-in VFS file */
     DS_FILE,                    /* Data comes from a VFS file */
+    DS_MMAP,                    /* Data comes from a memory-mapped local file */
     DS_STRING                   /* Data comes from a string in memory */
 };
 
@@ -62,6 +67,15 @@ struct hexedit_change_node
     byte value;
 };
 
+/* A block of a VFS file kept in memory */
+typedef struct
+{
+    off_t offset;               /* File offset of the block */
+    size_t len;                 /* Number of valid bytes in data, 0 if unused */
+    byte *data;                 /* VIEW_FILE_BLOCK_SIZE bytes, allocated on first use */
+    unsigned int stamp;         /* Time of last use for the LRU replacement */
+} file_block_t;
+
 struct area
 {
     screen_dimen top, left;
@@ -81,13 +95,21 @@ typedef struct
     off_t cc_nroff_column;
 } coord_cache_entry_t;
 
+/* The entries are stored column-wise and sorted by offset (and by line/column as well) */
 typedef struct
 {
     size_t size;
     size_t capacity;
-    coord_cache_entry_t **cache;
+    off_t *offset;
+    off_t *line;
+    off_t *column;
+    off_t *nroff_column;
 } coord_cache_t;
 
+typedef struct mcview_line_index_struct mcview_line_index_t;
+
+typedef struct mcview_follow_struct mcview_follow_t;
+
 /* TODO: find a better name. This is not actually a "state machine",
  * but a "state machine's state", but that sounds silly.
  * Could be parser_state, formatter_state... */
@@ -126,6 +148,13 @@ struct WView
     byte *ds_file_data;         /* Currently loaded data */
     size_t ds_file_datalen;     /* Number of valid bytes in file_data */
     size_t ds_file_datasize;    /* Number of allocated bytes in file_data */
+    file_block_t *ds_file_blocks;       /* The blocks kept in memory, file_data is one of them */
+    unsigned int ds_file_clock; /* Incremented on each block switch */
+
+    /* mmap data source: uses ds_file_filesize too */
+    int ds_mmap_fd;             /* Local descriptor of the mapped file */
+    byte *ds_mmap_data;         /* The mapping of the file */
+    size_t ds_mmap_len;         /* The length of the mapping */
 
     /* string data source */
     byte *ds_string_data;       /* The characters of the string */
@@ -133,10 +162,19 @@ struct WView
 
     /* Growing buffers information */
     gboolean growbuf_in_use;    /* Use the growing buffers? */
-    GPtrArray *growbuf_blockptr;        /* Pointer to the block pointers */
+    GPtrArray *growbuf_blockptr;        /* Pointer to the block pointers,
+                                           NULL for the blocks in growbuf_spill_fd */
     size_t growbuf_lastindex;   /* Number of bytes in the last page of the
                                    growing buffer */
     gboolean growbuf_finished;  /* TRUE when all data has been read. */
+    gboolean growbuf_async;     /* The pipe is drained from the event loop */
+    gboolean growbuf_reading;   /* A read from the pipe is in progress */
+    gboolean growbuf_nowait;    /* Do not wait for the data that has not arrived yet */
+    int growbuf_spill_fd;       /* Temporary file holding the oldest blocks, or -1 */
+    size_t growbuf_spilled;     /* Number of blocks moved to growbuf_spill_fd */
+    file_block_t *growbuf_spill_cache;  /* The spilled blocks read back */
+    unsigned int growbuf_spill_clock;   /* Incremented on each read of a spilled block */
+    int growbuf_spill_pinned;   /* The cached block of the last span, which is kept, or -1 */
 
     mcview_mode_flags_t mode_flags;
 
@@ -154,6 +192,8 @@ struct WView
 #endif
 
     coord_cache_t *coord_cache; /* Cache for mapping offsets to cursor positions */
+    mcview_line_index_t *line_index;    /* Line starts the coord_cache is seeded from */
+    mcview_follow_t *follow;    /* Follow mode state, NULL if the file is not followed */
 
     /* Display information */
     screen_dimen dpy_frame_size;        /* Size of the frame surrounding the real viewer */
@@ -254,12 +294,28 @@ void mcview_ccache_dump (WView * view);
 
 void mcview_ccache_lookup (WView * view, coord_cache_entry_t * coord, enum ccache_type lookup_what);
 
+/* lineindex.c: */
+void mcview_lineidx_free (WView * view);
+void mcview_lineidx_start (WView * view);
+void mcview_lineidx_resume (WView * view);
+gboolean mcview_lineidx_step (WView * view);
+gboolean mcview_lineidx_lookup_line (WView * view, off_t line, off_t * ret_offset,
+                                     off_t * ret_line);
+gboolean mcview_lineidx_lookup_offset (WView * view, off_t offset, off_t * ret_offset,
+                                       off_t * ret_line);
+
+/* follow.c: */
+gboolean mcview_follow_start (WView * view);
+void mcview_follow_stop (WView * view);
+void mcview_follow_toggle (WView * view);
+
 /* datasource.c: */
 void mcview_set_datasource_none (WView * view);
 off_t mcview_get_filesize (WView * view);
 void mcview_update_filesize (WView * view);
 char *mcview_get_ptr_file (WView * view, off_t byte_index);
 char *mcview_get_ptr_string (WView * view, off_t byte_index);
+char *mcview_get_span (WView * view, off_t byte_index, size_t * len);
 gboolean mcview_get_utf (WView * view, off_t byte_index, int *ch, int *ch_len);
 gboolean mcview_get_byte_string (WView * view, off_t byte_index, int *retval);
 gboolean mcview_get_byte_none (WView * view, off_t byte_index, int *retval);
@@ -267,6 +323,10 @@ void mcview_set_byte (WView * view, off_t offset, byte b);
 void mcview_file_load_data (WView * view, off_t byte_index);
 void mcview_close_datasource (WView * view);
 void mcview_set_datasource_file (WView * view, int fd, const struct stat *st);
+gboolean mcview_set_datasource_mmap (WView * view, const vfs_path_t * vpath, int fd,
+                                     const struct stat *st);
+void mcview_datasource_check (WView * view);
+void mcview_datasource_advise_sequential (WView * view, gboolean sequential);
 gboolean mcview_load_command_output (WView * view, const char *command);
 void mcview_set_datasource_vfs_pipe (WView * view, int fd);
 void mcview_set_datasource_string (WView * view, const char *s);
@@ -292,6 +352,7 @@ off_t mcview_growbuf_filesize (WView * view);
 void mcview_growbuf_read_until (WView * view, off_t ofs);
 gboolean mcview_get_byte_growing_buffer (WView * view, off_t byte_index, int *retval);
 char *mcview_get_ptr_growing_buffer (WView * view, off_t byte_index);
+char *mcview_get_span_growing_buffer (WView * view, off_t byte_index, size_t * len);
 
 /* hex.c: */
 void mcview_display_hex (WView * view);
@@ -345,6 +406,8 @@ int mcview_nroff_seq_prev (mcview_nroff_t * nroff);
 /* search.c: */
 gboolean mcview_search_init (WView * view);
 void mcview_search_deinit (WView * view);
+mc_search_cbret_t mcview_search_span_callback (const void *user_data, gsize offset,
+                                               const char **ptr, gsize * len);
 mc_search_cbret_t mcview_search_cmd_callback (const void *user_data, gsize char_offset,
                                               int *current_char);
 mc_search_cbret_t mcview_search_update_cmd_callback (const void *user_data, gsize char_offset);
@@ -372,6 +435,18 @@ mcview_is_in_panel (WView * view)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/** Is the viewer in the topmost dialog, i.e. can it be drawn without covering a dialog box? */
+
+static inline gboolean
+mcview_is_on_top (const WView * view)
+{
+    const Widget *owner = WIDGET (WIDGET (view)->owner);
+
+    return (owner != NULL && top_dlg != NULL && top_dlg->data == owner);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static inline gboolean
 mcview_may_still_grow (WView * view)
 {
@@ -410,6 +485,24 @@ mcview_get_byte_file (WView * view, off_t byte_index, int *retval)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static inline gboolean
+mcview_get_byte_mmap (WView * view, off_t byte_index, int *retval)
+{
+    g_assert (view->datasource == DS_MMAP);
+
+    if (byte_index >= 0 && byte_index < view->ds_file_filesize)
+    {
+        if (retval)
+            *retval = view->ds_mmap_data[byte_index];
+        return TRUE;
+    }
+    if (retval)
+        *retval = -1;
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static inline gboolean
 mcview_get_byte (WView * view, off_t offset, int *retval)
 {
@@ -420,6 +513,8 @@ mcview_get_byte (WView * view, off_t offset, int *retval)
         return mcview_get_byte_growing_buffer (view, offset, retval);
     case DS_FILE:
         return mcview_get_byte_file (view, offset, retval);
+    case DS_MMAP:
+        return mcview_get_byte_mmap (view, offset, retval);
     case DS_STRING:
         return mcview_get_byte_string (view, offset, retval);
     case DS_NONE:
@@ -166,6 +166,8 @@ mcview_init (WView * view)
     view->hexedit_lownibble = FALSE;
     view->locked = FALSE;
     view->coord_cache = NULL;
+    view->line_index = NULL;
+    view->follow = NULL;
 
     view->dpy_start = 0;
     view->dpy_paragraph_skip_lines = 0;
@@ -223,11 +225,13 @@ mcview_done (WView * view)
     view->workdir_vpath = NULL;
     MC_PTR_FREE (view->command);
 
+    mcview_follow_stop (view);
     mcview_close_datasource (view);
     /* the growing buffer is freed with the datasource */
 
     coord_cache_free (view->coord_cache);
     view->coord_cache = NULL;
+    mcview_lineidx_free (view);
 
     if (view->converter == INVALID_CONV)
         view->converter = str_cnv_from_term;
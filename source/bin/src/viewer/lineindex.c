@@ -0,0 +1,358 @@
+/*
+   Internal file viewer for the Midnight Commander
+   Line index built in the background
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   The line index records the start offset of every VIEW_LINE_INDEX_STEP-th
+   line of the file in two flat sorted arrays, so that both a line number and
+   an offset can be mapped to the nearest preceding line start by a binary
+   search. The coordinate cache is seeded with that line start and only
+   has to scan the few lines between it and the wanted position.
+
+   Line breaks are counted the way mcview_ccache_lookup() counts them: each
+   '\n' and each '\r' that is not followed by '\r' or '\n'. Only lines that
+   start after a '\n' are recorded because the coordinate cache cannot hold
+   entries that follow a '\r'.
+
+   The index is built in steps from the idle handler of the viewer dialog
+   and is extended synchronously when a lookup needs more of it.
+ */
+
+#include <config.h>
+
+#include <string.h>             /* memchr() */
+
+#include "lib/global.h"
+#include "lib/tty/tty.h"        /* tty_got_interrupt() */
+#include "lib/widget.h"
+
+#include "internal.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* Distance in lines between two recorded line starts */
+#ifndef VIEW_LINE_INDEX_STEP
+#define VIEW_LINE_INDEX_STEP 256
+#endif
+
+/* Number of bytes indexed in one step */
+#define VIEW_LINE_INDEX_BUDGET (4 * 1024 * 1024)
+
+#define VIEW_LINE_INDEX_CAPACITY_MIN 256
+
+/*** file scope type declarations ****************************************************************/
+
+struct mcview_line_index_struct
+{
+    off_t *offsets;             /* start offsets of the recorded lines */
+    off_t *lines;               /* line numbers of the recorded lines */
+    size_t size;
+    size_t capacity;
+
+    off_t scanned;              /* the data before this offset is indexed */
+    off_t line;                 /* number of the line containing offset 'scanned' */
+    off_t next_mark;            /* the first line number to be recorded next */
+    gboolean pending_cr;        /* the byte before 'scanned' is '\r' */
+};
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mcview_lineidx_is_usable (const WView * view)
+{
+    switch (view->datasource)
+    {
+    case DS_FILE:
+    case DS_MMAP:
+    case DS_STRING:
+        return TRUE;
+    default:
+        /* the growing buffer of a pipe is not indexed */
+        return FALSE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mcview_lineidx_add (mcview_line_index_t * idx, off_t offset, off_t line)
+{
+    if (idx->size == idx->capacity)
+    {
+        idx->capacity = MAX (idx->capacity * 2, VIEW_LINE_INDEX_CAPACITY_MIN);
+        idx->offsets = g_renew (off_t, idx->offsets, idx->capacity);
+        idx->lines = g_renew (off_t, idx->lines, idx->capacity);
+    }
+
+    idx->offsets[idx->size] = offset;
+    idx->lines[idx->size] = line;
+    idx->size++;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count the line breaks in @buf which holds the data at idx->scanned. The last byte is
+ * left for the next call if it is '\r', since its meaning depends on the byte after it.
+ */
+
+static void
+mcview_lineidx_scan (mcview_line_index_t * idx, const char *buf, size_t len)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+    const char *nl, *cr;
+
+    if (idx->pending_cr)
+    {
+        idx->pending_cr = FALSE;
+        if (*p != '\r' && *p != '\n')
+            idx->line++;
+    }
+
+    nl = memchr (p, '\n', len);
+    cr = memchr (p, '\r', len);
+
+    while (nl != NULL || cr != NULL)
+    {
+        if (cr != NULL && (nl == NULL || cr < nl))
+        {
+            if (cr + 1 == end)
+            {
+                idx->pending_cr = TRUE;
+                break;
+            }
+            if (cr[1] != '\r' && cr[1] != '\n')
+                idx->line++;
+            p = cr + 1;
+            cr = memchr (p, '\r', (size_t) (end - p));
+        }
+        else
+        {
+            idx->line++;
+            p = nl + 1;
+            if (idx->line >= idx->next_mark)
+            {
+                mcview_lineidx_add (idx, idx->scanned + (off_t) (p - buf), idx->line);
+                idx->next_mark = idx->line + VIEW_LINE_INDEX_STEP;
+            }
+            nl = memchr (p, '\n', (size_t) (end - p));
+        }
+    }
+
+    idx->scanned += (off_t) len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Index up to @budget bytes.
+ *
+ * @return TRUE if there is more data to index
+ */
+
+static gboolean
+mcview_lineidx_extend (WView * view, off_t budget)
+{
+    mcview_line_index_t *idx;
+    off_t filesize;
+
+    if (!mcview_lineidx_is_usable (view))
+        return FALSE;
+
+    filesize = mcview_get_filesize (view);
+
+    if (view->line_index == NULL)
+        view->line_index = g_new0 (mcview_line_index_t, 1);
+
+    idx = view->line_index;
+
+    /* the file was truncated */
+    if (idx->scanned > filesize)
+    {
+        mcview_lineidx_free (view);
+        view->line_index = idx = g_new0 (mcview_line_index_t, 1);
+    }
+
+    if (idx->size == 0 && idx->scanned == 0)
+        idx->next_mark = VIEW_LINE_INDEX_STEP;
+
+    while (budget > 0 && idx->scanned < filesize)
+    {
+        const char *p;
+        size_t len;
+
+        p = mcview_get_span (view, idx->scanned, &len);
+        if (p == NULL || len == 0)
+            return FALSE;
+
+        len = (size_t) MIN ((off_t) len, filesize - idx->scanned);
+        len = (size_t) MIN ((off_t) len, budget);
+        mcview_lineidx_scan (idx, p, len);
+        budget -= (off_t) len;
+    }
+
+    return (idx->scanned < filesize);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find the last recorded line start not greater than @key in the sorted array @a */
+
+static gboolean
+mcview_lineidx_bsearch (const off_t * a, size_t size, off_t key, size_t * pos)
+{
+    size_t lo = 0, hi = size;
+
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (a[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo == 0)
+        return FALSE;
+
+    *pos = lo - 1;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+void
+mcview_lineidx_free (WView * view)
+{
+    mcview_line_index_t *idx = view->line_index;
+
+    if (idx != NULL)
+    {
+        g_free (idx->offsets);
+        g_free (idx->lines);
+        g_free (idx);
+        view->line_index = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Throw the index away and start building it again in the background. This is done only in
+ * the standalone viewer, the idle state of the file manager is not ours.
+ */
+
+void
+mcview_lineidx_start (WView * view)
+{
+    mcview_lineidx_free (view);
+    mcview_lineidx_resume (view);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Go on building the index in the background, e.g. after the file has grown.
+ */
+
+void
+mcview_lineidx_resume (WView * view)
+{
+    Widget *owner = WIDGET (WIDGET (view)->owner);
+
+    /* a file of other VFS is not read entirely just in case, only when a lookup needs it */
+    if (owner != NULL && !mcview_is_in_panel (view)
+        && (view->datasource == DS_MMAP || view->datasource == DS_STRING))
+        widget_idle (owner, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Do a piece of the background work.
+ *
+ * @return TRUE if there is more work to do
+ */
+
+gboolean
+mcview_lineidx_step (WView * view)
+{
+    return mcview_lineidx_extend (view, VIEW_LINE_INDEX_BUDGET);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the last recorded line start at or before @line, indexing more data if needed.
+ *
+ * @return FALSE if there is no such line start
+ */
+
+gboolean
+mcview_lineidx_lookup_line (WView * view, off_t line, off_t * ret_offset, off_t * ret_line)
+{
+    mcview_line_index_t *idx;
+    size_t pos;
+
+    while (view->line_index == NULL || view->line_index->line < line)
+        if (!mcview_lineidx_extend (view, VIEW_LINE_INDEX_BUDGET) || tty_got_interrupt ())
+            break;
+
+    idx = view->line_index;
+    if (idx == NULL || !mcview_lineidx_bsearch (idx->lines, idx->size, line, &pos))
+        return FALSE;
+
+    *ret_offset = idx->offsets[pos];
+    *ret_line = idx->lines[pos];
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the last recorded line start at or before @offset, indexing more data if needed.
+ *
+ * @return FALSE if there is no such line start
+ */
+
+gboolean
+mcview_lineidx_lookup_offset (WView * view, off_t offset, off_t * ret_offset, off_t * ret_line)
+{
+    mcview_line_index_t *idx;
+    size_t pos;
+
+    while (view->line_index == NULL || view->line_index->scanned <= offset)
+        if (!mcview_lineidx_extend (view, VIEW_LINE_INDEX_BUDGET) || tty_got_interrupt ())
+            break;
+
+    idx = view->line_index;
+    if (idx == NULL || !mcview_lineidx_bsearch (idx->offsets, idx->size, offset, &pos))
+        return FALSE;
+
+    *ret_offset = idx->offsets[pos];
+    *ret_line = idx->lines[pos];
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -378,6 +378,8 @@ mcview_load (WView * view, const char *command, const char *file, int start_line
         }
         else
         {
+            gboolean decompressed = FALSE;
+
             if (view->mode_flags.magic)
             {
                 int type;
@@ -408,11 +410,14 @@ mcview_load (WView * view, const char *command, const char *file, int start_line
                         mc_close (fd);
                         fd = fd1;
                         mc_fstat (fd, &st);
+                        decompressed = TRUE;
                     }
                 }
             }
 
-            mcview_set_datasource_file (view, fd, &st);
+            /* Local files are mapped into memory, everything else is read block by block */
+            if (decompressed || !mcview_set_datasource_mmap (view, vpath, fd, &st))
+                mcview_set_datasource_file (view, fd, &st);
         }
         retval = TRUE;
     }
@@ -454,6 +459,9 @@ mcview_load (WView * view, const char *command, const char *file, int start_line
     else if (start_line > 0)
         mcview_moveto (view, start_line - 1, 0);
 
+    if (retval)
+        mcview_lineidx_start (view);
+
     view->search_start = search_start;
     view->search_end = search_end;
     view->hexedit_lownibble = FALSE;
@@ -58,6 +58,9 @@ mcview_search_options_t mcview_search_options = {
 
 /*** file scope macro definitions ****************************************************************/
 
+/* Size of the pieces the file is read in by the backward literal search */
+#define MCVIEW_SEARCH_CHUNK (64 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 typedef struct
@@ -134,47 +137,296 @@ mcview_search_update_steps (WView * view)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Backward search that tries every single offset. It is slow but it is the only one
+ * that copes with nroff sequences.
+ */
+
 static gboolean
-mcview_find (mcview_search_status_msg_t * ssm, off_t search_start, off_t search_end, gsize * len)
+mcview_find_backward_bytewise (mcview_search_status_msg_t * ssm, off_t search_start, gsize * len)
 {
     WView *view = ssm->view;
+    off_t search_end;
 
-    view->search_numNeedSkipChar = 0;
-    search_cb_char_curr_index = -1;
-
-    if (mcview_search_options.backwards)
+    search_end = mcview_get_filesize (view);
+    while (search_start >= 0)
     {
-        search_end = mcview_get_filesize (view);
-        while (search_start >= 0)
+        gboolean ok;
+
+        view->search_nroff_seq->index = search_start;
+        mcview_nroff_seq_info (view->search_nroff_seq);
+
+        if (search_end > search_start + (off_t) view->search->original_len
+            && mc_search_is_fixed_search_str (view->search))
+            search_end = search_start + view->search->original_len;
+
+        ok = mc_search_run (view->search, (void *) ssm, search_start, search_end, len);
+        if (ok && view->search->normal_offset == search_start)
         {
-            gboolean ok;
+            if (view->mode_flags.nroff)
+                view->search->normal_offset++;
+            return TRUE;
+        }
+
+        /* We abort the search in case of a pattern error, or if the user aborts
+           the search. In other words: in all cases except "string not found". */
+        if (!ok && view->search->error != MC_SEARCH_E_NOTFOUND)
+            return FALSE;
+
+        search_start--;
+    }
+
+    mc_search_set_error (view->search, MC_SEARCH_E_NOTFOUND, "%s", _(STR_E_NOTFOUND));
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the pattern is a plain byte string that can be matched without the regex
+ * engine. Case is ignored for ASCII letters only, so a case insensitive pattern must be ASCII.
+ */
+
+static gboolean
+mcview_search_is_literal (const mc_search_t * search)
+{
+    gsize i;
+
+    if (search->search_type != MC_SEARCH_T_NORMAL || search->whole_words
+        || search->original_len == 0)
+        return FALSE;
+
+#ifdef HAVE_CHARSET
+    if (search->is_all_charsets)
+        return FALSE;
+#endif
+
+    if (!search->is_case_sensitive)
+        for (i = 0; i < search->original_len; i++)
+            if ((guchar) search->original[i] >= 0x80)
+                return FALSE;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Copy @len bytes starting at @offset to @buf.
+ *
+ * @return number of bytes copied, less than @len at the end of data
+ */
+
+static size_t
+mcview_search_read (WView * view, off_t offset, byte * buf, size_t len)
+{
+    size_t i;
+
+    if (view->datasource == DS_MMAP)
+    {
+        if (offset >= view->ds_file_filesize)
+            return 0;
+        len = MIN (len, (size_t) (view->ds_file_filesize - offset));
+        memcpy (buf, view->ds_mmap_data + offset, len);
+        return len;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        int c;
+
+        if (!mcview_get_byte (view, offset + (off_t) i, &c))
+            break;
+        buf[i] = (byte) c;
+    }
+
+    return i;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Backward search of a literal string. The data is read backwards in chunks that overlap by
+ * the length of the pattern, each chunk is scanned from its end by Boyer-Moore-Horspool
+ * with the shift table built from the reversed pattern.
+ */
+
+static gboolean
+mcview_find_backward_literal (mcview_search_status_msg_t * ssm, off_t search_start, gsize * len)
+{
+    WView *view = ssm->view;
+    mc_search_t *search = view->search;
+    const size_t m = search->original_len;
+    byte fold[256];
+    size_t shift[256];
+    byte *needle, *buf;
+    size_t chunk, i;
+    off_t hi, lo;
+    gboolean found = FALSE;
+
+    for (i = 0; i < 256; i++)
+        fold[i] = search->is_case_sensitive ? (byte) i : (byte) g_ascii_tolower ((gchar) i);
+
+    needle = g_malloc (m);
+    for (i = 0; i < m; i++)
+        needle[i] = fold[(byte) search->original[i]];
+
+    /* the window moves to the left, so it is shifted by the first byte it covers */
+    for (i = 0; i < 256; i++)
+        shift[i] = m;
+    for (i = m - 1; i > 0; i--)
+        shift[needle[i]] = i;
+
+    chunk = MAX (MCVIEW_SEARCH_CHUNK, 2 * m);
+    buf = g_malloc (chunk);
+
+    /* the match may start at search_start at most */
+    hi = MIN (search_start + (off_t) m, mcview_get_filesize (view));
+
+    while (hi >= (off_t) m)
+    {
+        size_t n;
+        off_t pos;
 
-            view->search_nroff_seq->index = search_start;
-            mcview_nroff_seq_info (view->search_nroff_seq);
+        lo = MAX (hi - (off_t) chunk, 0);
+        n = mcview_search_read (view, lo, buf, (size_t) (hi - lo));
 
-            if (search_end > search_start + (off_t) view->search->original_len
-                && mc_search_is_fixed_search_str (view->search))
-                search_end = search_start + view->search->original_len;
+        for (pos = (off_t) n - (off_t) m; pos >= 0; pos -= (off_t) shift[fold[buf[pos]]])
+        {
+            for (i = 0; i < m && fold[buf[pos + i]] == needle[i]; i++)
+                ;
 
-            ok = mc_search_run (view->search, (void *) ssm, search_start, search_end, len);
-            if (ok && view->search->normal_offset == search_start)
+            if (i == m)
             {
-                if (view->mode_flags.nroff)
-                    view->search->normal_offset++;
-                return TRUE;
+                search->normal_offset = search->start_buffer = lo + pos;
+                found = TRUE;
+                break;
             }
+        }
 
-            /* We abort the search in case of a pattern error, or if the user aborts
-               the search. In other words: in all cases except "string not found". */
-            if (!ok && view->search->error != MC_SEARCH_E_NOTFOUND)
-                return FALSE;
+        if (found || lo == 0)
+            break;
 
-            search_start--;
+        if (search->update_fn != NULL
+            && search->update_fn ((void *) ssm, (gsize) lo) == MC_SEARCH_CB_ABORT)
+        {
+            g_free (buf);
+            g_free (needle);
+            mc_search_set_error (search, MC_SEARCH_E_ABORT, NULL);
+            return FALSE;
         }
 
-        mc_search_set_error (view->search, MC_SEARCH_E_NOTFOUND, "%s", _(STR_E_NOTFOUND));
+        /* keep the bytes a match crossing the chunk boundary needs */
+        hi = lo + (off_t) m - 1;
+    }
+
+    g_free (buf);
+    g_free (needle);
+
+    if (!found)
+    {
+        mc_search_set_error (search, MC_SEARCH_E_NOTFOUND, "%s", _(STR_E_NOTFOUND));
+        return FALSE;
+    }
+
+    if (len != NULL)
+        *len = m;
+    mc_search_set_error (search, MC_SEARCH_E_OK, NULL);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Backward search for patterns handled by the regex engine. Lines are visited from the one
+ * containing @search_start to the beginning of the file; each line is searched forward and the
+ * last match starting not after @search_start wins.
+ */
+
+static gboolean
+mcview_find_backward_lines (mcview_search_status_msg_t * ssm, off_t search_start, gsize * len)
+{
+    WView *view = ssm->view;
+    mc_search_t *search = view->search;
+    off_t filesize, limit, line_start, line_end;
+    int c;
+
+    filesize = mcview_get_filesize (view);
+    limit = MIN (search_start, filesize - 1);
+    if (limit < 0)
+    {
+        mc_search_set_error (search, MC_SEARCH_E_NOTFOUND, "%s", _(STR_E_NOTFOUND));
         return FALSE;
     }
+
+    /* the end of the line containing the starting point */
+    for (line_end = limit; line_end < filesize; line_end++)
+        if (mcview_get_byte (view, line_end, &c) && c == '\n')
+            break;
+    line_end = MIN (line_end + 1, filesize);
+
+    while (limit >= 0)
+    {
+        off_t from, best = -1;
+        gsize best_len = 0;
+
+        for (line_start = limit; line_start > 0; line_start--)
+            if (mcview_get_byte (view, line_start - 1, &c) && c == '\n')
+                break;
+
+        for (from = line_start; from <= limit;)
+        {
+            gsize match_len = 0;
+
+            if (!mc_search_run (search, (void *) ssm, from, line_end - 1, &match_len))
+            {
+                /* a pattern error or user abort */
+                if (search->error != MC_SEARCH_E_NOTFOUND)
+                    return FALSE;
+                break;
+            }
+
+            if (search->normal_offset > limit)
+                break;
+
+            best = search->normal_offset;
+            best_len = match_len;
+            from = best + 1;
+        }
+
+        if (best != -1)
+        {
+            search->normal_offset = search->start_buffer = best;
+            if (len != NULL)
+                *len = best_len;
+            mc_search_set_error (search, MC_SEARCH_E_OK, NULL);
+            return TRUE;
+        }
+
+        /* the previous line ends where this one starts */
+        line_end = line_start;
+        limit = line_start - 1;
+    }
+
+    mc_search_set_error (search, MC_SEARCH_E_NOTFOUND, "%s", _(STR_E_NOTFOUND));
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mcview_find (mcview_search_status_msg_t * ssm, off_t search_start, off_t search_end, gsize * len)
+{
+    WView *view = ssm->view;
+
+    view->search_numNeedSkipChar = 0;
+    search_cb_char_curr_index = -1;
+
+    if (mcview_search_options.backwards)
+    {
+        if (view->mode_flags.nroff)
+            return mcview_find_backward_bytewise (ssm, search_start, len);
+        if (mcview_search_is_literal (view->search))
+            return mcview_find_backward_literal (ssm, search_start, len);
+        return mcview_find_backward_lines (ssm, search_start, len);
+    }
+
     view->search_nroff_seq->index = search_start;
     mcview_nroff_seq_info (view->search_nroff_seq);
 
@@ -230,6 +482,7 @@ mcview_search_init (WView * view)
     view->search->is_case_sensitive = mcview_search_options.case_sens;
     view->search->whole_words = mcview_search_options.whole_words;
     view->search->search_fn = mcview_search_cmd_callback;
+    view->search->get_span = mcview_search_span_callback;
     view->search->update_fn = mcview_search_update_cmd_callback;
 
     return TRUE;
@@ -245,6 +498,30 @@ mcview_search_deinit (WView * view)
     mcview_nroff_seq_free (&view->search_nroff_seq);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Give the search engine the data of the file block, mmap'ed file or growing buffer page
+ * at @offset at once. The bytes are searched as they are only if nroff sequences are not
+ * interpreted.
+ */
+
+mc_search_cbret_t
+mcview_search_span_callback (const void *user_data, gsize offset, const char **ptr, gsize * len)
+{
+    WView *view = ((const mcview_search_status_msg_t *) user_data)->view;
+    size_t span_len;
+
+    if (view->mode_flags.nroff)
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *ptr = mcview_get_span (view, (off_t) offset, &span_len);
+    if (*ptr == NULL)
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *len = span_len;
+    return MC_SEARCH_CB_OK;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 mc_search_cbret_t
@@ -390,6 +667,9 @@ mcview_do_search (WView * view, off_t want_search_start)
     /* Compute the percent steps */
     mcview_search_update_steps (view);
 
+    /* a forward search reads the file straight through */
+    mcview_datasource_advise_sequential (view, !mcview_search_options.backwards);
+
     view->update_activate = search_start;
 
     vsm.first = TRUE;
@@ -423,6 +703,10 @@ mcview_do_search (WView * view, off_t want_search_start)
             break;
 
         search_start = growbufsize - view->search->original_len;
+
+        /* wait for the data the background reader has not got yet */
+        if (view->growbuf_in_use)
+            mcview_growbuf_read_until (view, growbufsize + 1);
     }
     while (search_start > 0 && mcview_may_still_grow (view));
 
@@ -470,6 +754,8 @@ mcview_do_search (WView * view, off_t want_search_start)
         }
     }
 
+    mcview_datasource_advise_sequential (view, FALSE);
+
     if (!found)
     {
         view->search_start = orig_search_start;
@@ -132,6 +132,7 @@ PURCMC_CHECK_HAVE_INCLUDE(HAVE_SYS_TIMEB_H sys/timeb.h)
 PURCMC_CHECK_HAVE_INCLUDE(HAVE_SYS_IOCTL_H sys/ioctl.h)
 PURCMC_CHECK_HAVE_INCLUDE(HAVE_SYS_SELECT_H sys/select.h)
 PURCMC_CHECK_HAVE_INCLUDE(HAVE_SYS_EPOLL_H sys/epoll.h)
+PURCMC_CHECK_HAVE_INCLUDE(HAVE_SYS_INOTIFY_H sys/inotify.h)
 PURCMC_CHECK_HAVE_INCLUDE(HAVE_SYS_MOUNT_H sys/mount.h)
 PURCMC_CHECK_HAVE_INCLUDE(HAVE_SYS_STATFS_H sys/statfs.h)
 PURCMC_CHECK_HAVE_INCLUDE(HAVE_SYS_STATVFS_H sys/statvfs.h)
@@ -169,6 +170,7 @@ PURCMC_CHECK_HAVE_FUNCTION(HAVE_STRVERSCMP strverscmp)
 PURCMC_CHECK_HAVE_FUNCTION(HAVE_UTIMENSAT utimensat)
 PURCMC_CHECK_HAVE_FUNCTION(HAVE_GET_PROCESS_STATS get_process_stats)
 PURCMC_CHECK_HAVE_FUNCTION(HAVE_POSIX_FALLOCATE posix_fallocate)
+PURCMC_CHECK_HAVE_FUNCTION(HAVE_FDATASYNC fdatasync)
 PURCMC_CHECK_HAVE_FUNCTION(HAVE_POSIX_OPENPT posix_openpt)
 PURCMC_CHECK_HAVE_FUNCTION(HAVE_GETPT getpt)
 PURCMC_CHECK_HAVE_FUNCTION(HAVE_GRANTPT grantpt)
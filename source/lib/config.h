@@ -88,6 +88,9 @@
 #if !HAVE(SYS_EPOLL_H)
 #undef HAVE_SYS_EPOLL_H
 #endif
+#if !HAVE(SYS_INOTIFY_H)
+#undef HAVE_SYS_INOTIFY_H
+#endif
 #if !HAVE(SYS_FS_S5PARAM_H)
 #undef HAVE_SYS_FS_S5PARAM_H
 #endif
@@ -135,6 +138,9 @@
 #undef HAVE_RESIZETERM
 #endif
 
+#if !HAVE(FDATASYNC)
+#undef HAVE_FDATASYNC
+#endif
 #if !HAVE(GETPT)
 #undef HAVE_GETPT
 #endif
@@ -169,6 +169,41 @@ mc_fhl_parse_get_extensions (mc_fhl_t * fhl, const gchar * group_name)
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * File names containing any of the listed strings, all found in one pass.
+ */
+
+static gboolean
+mc_fhl_parse_get_strings (mc_fhl_t * fhl, const gchar * group_name)
+{
+    mc_fhl_filter_t *mc_filter;
+    gchar **strings;
+    gchar *pattern;
+
+    strings = mc_config_get_string_list (fhl->config, group_name, "strings", NULL);
+    if (strings == NULL || strings[0] == NULL)
+    {
+        g_strfreev (strings);
+        return FALSE;
+    }
+
+    pattern = mc_search_multi_join ((const gchar * const *) strings);
+    g_strfreev (strings);
+
+    mc_filter = g_new0 (mc_fhl_filter_t, 1);
+    mc_filter->type = MC_FLHGH_T_FREGEXP;
+    mc_filter->search_condition = mc_search_new (pattern, DEFAULT_CHARSET);
+    mc_filter->search_condition->is_case_sensitive =
+        mc_config_get_bool (fhl->config, group_name, "strings_case", FALSE);
+    mc_filter->search_condition->search_type = MC_SEARCH_T_MULTI;
+
+    mc_fhl_parse_fill_color_info (mc_filter, fhl, group_name);
+    g_ptr_array_add (fhl->filters, (gpointer) mc_filter);
+    g_free (pattern);
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -246,6 +281,11 @@ mc_fhl_parse_ini_file (mc_fhl_t * fhl)
             /* parse extensions filter */
             mc_fhl_parse_get_extensions (fhl, *group_names);
         }
+        if (mc_config_has_param (fhl->config, *group_names, "strings"))
+        {
+            /* parse strings filter */
+            mc_fhl_parse_get_strings (fhl, *group_names);
+        }
     }
 
     g_strfreev (orig_group_names);
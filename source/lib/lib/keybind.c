@@ -354,6 +354,7 @@ static name_keymap_t command_names[] = {
     ADD_KEYMAP_NAME (NroffMode),
     ADD_KEYMAP_NAME (BookmarkGoto),
     ADD_KEYMAP_NAME (Ruler),
+    ADD_KEYMAP_NAME (Follow),
     ADD_KEYMAP_NAME (SearchForward),
     ADD_KEYMAP_NAME (SearchBackward),
     ADD_KEYMAP_NAME (SearchForwardContinue),
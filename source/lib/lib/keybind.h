@@ -326,6 +326,7 @@ enum
     CK_HexEditMode,
     CK_BookmarkGoto,
     CK_Ruler,
+    CK_Follow,
     CK_SearchForward,
     CK_SearchBackward,
     CK_SearchForwardContinue,
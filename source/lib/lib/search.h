@@ -18,6 +18,8 @@ typedef enum mc_search_cbret_t mc_search_cbret_t;
 typedef mc_search_cbret_t (*mc_search_fn) (const void *user_data, gsize char_offset,
                                            int *current_char);
 typedef mc_search_cbret_t (*mc_update_fn) (const void *user_data, gsize char_offset);
+typedef mc_search_cbret_t (*mc_search_span_fn) (const void *user_data, gsize offset,
+                                                const char **ptr, gsize * len);
 
 #define MC_SEARCH__NUM_REPLACE_ARGS 64
 
@@ -46,7 +48,8 @@ typedef enum
     MC_SEARCH_T_NORMAL,
     MC_SEARCH_T_REGEX,
     MC_SEARCH_T_HEX,
-    MC_SEARCH_T_GLOB
+    MC_SEARCH_T_GLOB,
+    MC_SEARCH_T_MULTI
 } mc_search_type_t;
 
 enum mc_search_cbret_t
@@ -87,6 +90,12 @@ typedef struct mc_search_struct
     /* function, used for updatin current search status. NULL if not used */
     mc_update_fn update_fn;
 
+    /* function, used for getting a contiguous piece of data at once. NULL if not used.
+     * It returns MC_SEARCH_CB_OK and the bytes available at the offset, or MC_SEARCH_CB_NOTFOUND.
+     * The bytes are valid until the next call. Set it only if search_fn returns the same bytes
+     * and never skips any */
+    mc_search_span_fn get_span;
+
     /* type of search */
     mc_search_type_t search_type;
 
@@ -95,6 +104,9 @@ typedef struct mc_search_struct
     /* some data for normal */
     off_t normal_offset;
 
+    /* index of the string found by the multi-string search */
+    gsize match_id;
+
     off_t start_buffer;
     /* some data for regexp */
     int num_results;
@@ -161,6 +173,9 @@ gboolean mc_search_is_fixed_search_str (const mc_search_t * lc_mc_search);
 
 gchar **mc_search_get_types_strings_array (size_t * num);
 
+gchar *mc_search_multi_join (const gchar * const *strings);
+gchar **mc_search_multi_split (const gchar * pattern);
+
 gboolean mc_search (const gchar * pattern, const gchar * pattern_charset, const gchar * str,
                     mc_search_type_t type);
 
@@ -23,12 +23,16 @@ typedef enum
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
+typedef struct mc_search_multi_struct mc_search_multi_t;
+
 typedef struct mc_search_cond_struct
 {
     GString *str;
     GString *upper;
     GString *lower;
     mc_search_regex_t *regex_handle;
+    mc_search_regex_t *regex_scan_handle;       /* the same for many lines at once, may be NULL */
+    mc_search_multi_t *multi;   /* automaton of the multi-string search, may be NULL */
     gchar *charset;
 } mc_search_cond_t;
 
@@ -44,6 +48,8 @@ gchar *mc_search__get_one_symbol (const char *charset, const char *str, gsize st
                                   gboolean * just_letters);
 GString *mc_search__tolower_case_str (const char *charset, const char *str, gsize str_len);
 GString *mc_search__toupper_case_str (const char *charset, const char *str, gsize str_len);
+gboolean mc_search__get_span_lines (mc_search_t * lc_mc_search, const void *user_data, gsize pos,
+                                    gsize end_search, const char **ptr, gsize * len);
 
 /* search/regex.c : */
 
@@ -60,6 +66,7 @@ void mc_search__cond_struct_new_init_normal (const char *charset, mc_search_t *
 gboolean mc_search__run_normal (mc_search_t * lc_mc_search, const void *user_data,
                                 gsize start_search, gsize end_search, gsize * found_len);
 GString *mc_search_normal_prepare_replace_str (mc_search_t * lc_mc_search, GString * replace_str);
+GString *mc_search__normal_translate_to_regex (const GString * astr);
 
 /* search/glob.c : */
 
@@ -77,6 +84,17 @@ gboolean mc_search__run_hex (mc_search_t * lc_mc_search, const void *user_data,
                              gsize start_search, gsize end_search, gsize * found_len);
 GString *mc_search_hex_prepare_replace_str (mc_search_t * lc_mc_search, GString * replace_str);
 
+/* search/multi.c : */
+
+void mc_search__cond_struct_new_init_multi (const char *charset, mc_search_t * lc_mc_search,
+                                            mc_search_cond_t * mc_search_cond);
+void mc_search__multi_free (mc_search_multi_t * m);
+gboolean mc_search__multi_find (const mc_search_multi_t * m, const char *buf, gsize buf_len,
+                                gsize * start, gsize * len, gsize * id);
+gboolean mc_search__run_multi (mc_search_t * lc_mc_search, const void *user_data,
+                               gsize start_search, gsize end_search, gsize * found_len);
+GString *mc_search_multi_prepare_replace_str (mc_search_t * lc_mc_search, GString * replace_str);
+
 /*** inline functions ****************************************************************************/
 
 #endif /* MC__SEARCH_INTERNAL_H */
@@ -233,6 +233,54 @@ mc_search__toupper_case_str (const char *charset, const char *str, gsize str_len
 #endif
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get whole lines of the data at @pos from the get_span callback, up to @end_search inclusive.
+ * The last line of the piece may be incomplete only at the end of the range or of the data.
+ *
+ * @return FALSE if there is no such piece, e.g. the line at @pos crosses the end of the span;
+ *         that line has to be collected through search_fn then
+ */
+
+gboolean
+mc_search__get_span_lines (mc_search_t * lc_mc_search, const void *user_data, gsize pos,
+                           gsize end_search, const char **ptr, gsize * len)
+{
+    const char *span, *next;
+    gsize span_len, next_len, n;
+
+    if (lc_mc_search->get_span == NULL || pos > end_search
+        || lc_mc_search->get_span (user_data, pos, &span, &span_len) != MC_SEARCH_CB_OK
+        || span_len == 0)
+        return FALSE;
+
+    if (span_len > end_search - pos)
+        n = end_search - pos + 1;
+    else
+    {
+        for (n = span_len; n > 0 && span[n - 1] != '\n'; n--)
+            ;
+
+        /* no line end in the span: that is fine only at the end of the data */
+        if (n == 0)
+        {
+            if (lc_mc_search->get_span (user_data, pos + span_len, &next, &next_len) ==
+                MC_SEARCH_CB_OK && next_len != 0)
+                return FALSE;
+
+            /* a span is valid until the next call only */
+            if (lc_mc_search->get_span (user_data, pos, &span, &span_len) != MC_SEARCH_CB_OK
+                || span_len == 0)
+                return FALSE;
+            n = MIN (span_len, end_search - pos + 1);
+        }
+    }
+
+    *ptr = span;
+    *len = n;
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 gchar **
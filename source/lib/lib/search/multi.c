@@ -0,0 +1,465 @@
+/*
+   Search text engine.
+   Search for any of several strings
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   The pattern is a list of strings separated by '|'. A '|' or '\' that is part
+   of a string is escaped by '\'. The search finds the leftmost occurrence of any
+   of the strings, the longest one if several start there, and reports its index
+   in the list in mc_search_t.match_id.
+
+   The strings are matched in one pass over the text by an Aho-Corasick automaton.
+   It is a full DFA: the failure links are resolved when it is built, so that each
+   byte of the text costs one table lookup. To keep the table small, the bytes are
+   mapped to classes first. All bytes that occur in none of the strings share one
+   class, and the two cases of an ASCII letter share one if case is ignored.
+
+   Whole words, and case ignored for non-ASCII strings, need the regex engine.
+   The strings are joined into one regex then, with a group for each string.
+ */
+
+#include <config.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+#include "lib/search.h"
+
+#include "internal.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define MULTI_SEPARATOR '|'
+#define MULTI_ESCAPE '\\'
+
+/*** file scope type declarations ****************************************************************/
+
+struct mc_search_multi_struct
+{
+    guint16 byte_class[256];    /* class 0 holds the bytes that occur in none of the strings */
+    guint num_classes;
+    guint num_states;
+    guint32 *next;              /* num_classes transitions of each state, state 0 is the root */
+    gint *out;                  /* index of the longest string that ends in each state, or -1 */
+    gsize *lengths;             /* lengths of the strings */
+    gsize max_len;
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+
+static void
+mc_search__multi_string_free (gpointer data)
+{
+    g_string_free ((GString *) data, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split the pattern into the strings. Empty strings are dropped.
+ */
+
+static GPtrArray *
+mc_search__multi_split (const GString * pattern)
+{
+    GPtrArray *strings;
+    GString *s;
+    gsize i;
+
+    strings = g_ptr_array_new_with_free_func (mc_search__multi_string_free);
+    s = g_string_sized_new (16);
+
+    for (i = 0; i <= pattern->len; i++)
+    {
+        const char c = i < pattern->len ? pattern->str[i] : MULTI_SEPARATOR;
+
+        if (c == MULTI_ESCAPE && i + 1 < pattern->len
+            && (pattern->str[i + 1] == MULTI_SEPARATOR || pattern->str[i + 1] == MULTI_ESCAPE))
+            g_string_append_c (s, pattern->str[++i]);
+        else if (c != MULTI_SEPARATOR)
+            g_string_append_c (s, c);
+        else if (s->len != 0)
+        {
+            g_ptr_array_add (strings, s);
+            s = g_string_sized_new (16);
+        }
+    }
+
+    g_string_free (s, TRUE);
+
+    return strings;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__multi_is_ascii (const GPtrArray * strings)
+{
+    guint i;
+
+    for (i = 0; i < strings->len; i++)
+    {
+        const GString *s = (const GString *) g_ptr_array_index (strings, i);
+        gsize j;
+
+        for (j = 0; j < s->len; j++)
+            if ((guchar) s->str[j] >= 0x80)
+                return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_multi_t *
+mc_search__multi_new (const GPtrArray * strings, gboolean case_sensitive)
+{
+    mc_search_multi_t *m;
+    guint32 *fail, *queue;
+    guint capacity, head, tail, c, i;
+
+    m = g_new0 (mc_search_multi_t, 1);
+    m->num_classes = 1;
+    capacity = 1;
+
+    for (i = 0; i < strings->len; i++)
+    {
+        const GString *s = (const GString *) g_ptr_array_index (strings, i);
+        gsize j;
+
+        for (j = 0; j < s->len; j++)
+        {
+            guchar b = (guchar) s->str[j];
+
+            if (!case_sensitive)
+                b = (guchar) g_ascii_tolower (b);
+
+            if (m->byte_class[b] == 0)
+            {
+                m->byte_class[b] = m->num_classes;
+                if (!case_sensitive)
+                    m->byte_class[(guchar) g_ascii_toupper (b)] = m->num_classes;
+                m->num_classes++;
+            }
+        }
+
+        capacity += s->len;
+    }
+
+    m->next = g_new0 (guint32, (gsize) capacity * m->num_classes);
+    m->out = g_new (gint, capacity);
+    m->lengths = g_new (gsize, strings->len);
+    m->num_states = 1;
+    m->out[0] = -1;
+
+    /* the trie of the strings */
+    for (i = 0; i < strings->len; i++)
+    {
+        const GString *s = (const GString *) g_ptr_array_index (strings, i);
+        guint32 state = 0;
+        gsize j;
+
+        for (j = 0; j < s->len; j++)
+        {
+            const guint cls = m->byte_class[(guchar) s->str[j]];
+            guint32 *t = &m->next[(gsize) state * m->num_classes + cls];
+
+            if (*t == 0)
+            {
+                m->out[m->num_states] = -1;
+                *t = m->num_states++;
+            }
+            state = *t;
+        }
+
+        /* the first of equal strings wins */
+        if (m->out[state] == -1)
+            m->out[state] = (gint) i;
+
+        m->lengths[i] = s->len;
+        m->max_len = MAX (m->max_len, s->len);
+    }
+
+    /* Resolve the failure links breadth first: the row of the failure state of a state
+       is complete when the state is visited since that state is closer to the root. */
+    fail = g_new0 (guint32, m->num_states);
+    queue = g_new (guint32, m->num_states);
+    head = tail = 0;
+
+    for (c = 0; c < m->num_classes; c++)
+        if (m->next[c] != 0)
+            queue[tail++] = m->next[c];
+
+    while (head < tail)
+    {
+        const guint32 state = queue[head++];
+        const guint32 *fail_row = &m->next[(gsize) fail[state] * m->num_classes];
+        guint32 *row = &m->next[(gsize) state * m->num_classes];
+
+        /* the longest string that is a suffix of the state */
+        if (m->out[state] == -1)
+            m->out[state] = m->out[fail[state]];
+
+        for (c = 0; c < m->num_classes; c++)
+            if (row[c] == 0)
+                row[c] = fail_row[c];
+            else
+            {
+                fail[row[c]] = fail_row[c];
+                queue[tail++] = row[c];
+            }
+    }
+
+    g_free (queue);
+    g_free (fail);
+
+    return m;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Join the strings into one regex with a group for each string.
+ */
+
+static GString *
+mc_search__multi_translate_to_regex (const GPtrArray * strings)
+{
+    GString *buff;
+    guint i;
+
+    buff = g_string_new ("(?:");
+
+    for (i = 0; i < strings->len; i++)
+    {
+        const GString *s = (const GString *) g_ptr_array_index (strings, i);
+        GString *tmp;
+
+        tmp = mc_search__normal_translate_to_regex (s);
+        if (i != 0)
+            g_string_append_c (buff, '|');
+        g_string_append_c (buff, '(');
+        g_string_append_len (buff, tmp->str, tmp->len);
+        g_string_append_c (buff, ')');
+        g_string_free (tmp, TRUE);
+    }
+
+    g_string_append_c (buff, ')');
+
+    return buff;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+void
+mc_search__cond_struct_new_init_multi (const char *charset, mc_search_t * lc_mc_search,
+                                       mc_search_cond_t * mc_search_cond)
+{
+    GPtrArray *strings;
+
+    strings = mc_search__multi_split (mc_search_cond->str);
+
+    if (strings->len == 0)
+        mc_search_set_error (lc_mc_search, MC_SEARCH_E_INPUT, "%s", _("No strings to search for"));
+    else if (!lc_mc_search->whole_words
+             && (lc_mc_search->is_case_sensitive || mc_search__multi_is_ascii (strings)))
+    {
+        mc_search_cond->multi = mc_search__multi_new (strings, lc_mc_search->is_case_sensitive);
+        lc_mc_search->is_utf8 = str_isutf8 (charset);
+    }
+    else
+    {
+        g_string_free (mc_search_cond->str, TRUE);
+        mc_search_cond->str = mc_search__multi_translate_to_regex (strings);
+        mc_search__cond_struct_new_init_regex (charset, lc_mc_search, mc_search_cond);
+    }
+
+    g_ptr_array_free (strings, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+mc_search__multi_free (mc_search_multi_t * m)
+{
+    if (m != NULL)
+    {
+        g_free (m->next);
+        g_free (m->out);
+        g_free (m->lengths);
+        g_free (m);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the leftmost occurrence of any of the strings in @buf, the longest one if several
+ * strings start there.
+ *
+ * @return TRUE if found, the position and the length of the match and the index of the string
+ *         are stored in @start, @len and @id
+ */
+
+gboolean
+mc_search__multi_find (const mc_search_multi_t * m, const char *buf, gsize buf_len,
+                       gsize * start, gsize * len, gsize * id)
+{
+    const guint32 *next = m->next;
+    const guint num_classes = m->num_classes;
+    gboolean found = FALSE;
+    gsize limit = buf_len;
+    guint32 state = 0;
+    gsize i;
+
+    for (i = 0; i < limit; i++)
+    {
+        gint o;
+
+        state = next[(gsize) state * num_classes + m->byte_class[(guchar) buf[i]]];
+        o = m->out[state];
+
+        if (o >= 0)
+        {
+            const gsize l = m->lengths[o];
+            const gsize s = i + 1 - l;
+
+            if (!found || s < *start || (s == *start && l > *len))
+            {
+                *start = s;
+                *len = l;
+                *id = (gsize) o;
+            }
+
+            /* a match that starts before this one ends within max_len bytes from its start */
+            if (!found)
+            {
+                found = TRUE;
+                limit = MIN (buf_len, s + m->max_len);
+            }
+        }
+    }
+
+    return found;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+mc_search__run_multi (mc_search_t * lc_mc_search, const void *user_data,
+                      gsize start_search, gsize end_search, gsize * found_len)
+{
+    mc_search_cond_t *mc_search_cond;
+    gboolean found;
+
+    /* the strings are found as a literal is found */
+    found = mc_search__run_normal (lc_mc_search, user_data, start_search, end_search, found_len);
+
+    /* the groups of the regex are numbered as the strings are, only the matched one is counted
+       among the last */
+    mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, 0);
+    if (found && mc_search_cond->regex_handle != NULL)
+        lc_mc_search->match_id = lc_mc_search->num_results > 1 ? lc_mc_search->num_results - 2 : 0;
+
+    return found;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+GString *
+mc_search_multi_prepare_replace_str (mc_search_t * lc_mc_search, GString * replace_str)
+{
+    (void) lc_mc_search;
+
+    return mc_g_string_dup (replace_str);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Make a pattern of the multi-string search from a NULL-terminated list of strings.
+ *
+ * @return newly allocated string
+ */
+
+gchar *
+mc_search_multi_join (const gchar * const *strings)
+{
+    GString *buff;
+
+    buff = g_string_sized_new (64);
+
+    for (; *strings != NULL; strings++)
+    {
+        const char *s;
+
+        if (buff->len != 0)
+            g_string_append_c (buff, MULTI_SEPARATOR);
+
+        for (s = *strings; *s != '\0'; s++)
+        {
+            if (*s == MULTI_SEPARATOR || *s == MULTI_ESCAPE)
+                g_string_append_c (buff, MULTI_ESCAPE);
+            g_string_append_c (buff, *s);
+        }
+    }
+
+    return g_string_free (buff, FALSE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split a pattern of the multi-string search into the strings, the reverse of
+ * mc_search_multi_join(). Empty strings are dropped.
+ *
+ * @return newly allocated NULL-terminated array of strings
+ */
+
+gchar **
+mc_search_multi_split (const gchar * pattern)
+{
+    GString *tmp;
+    GPtrArray *strings;
+    gchar **ret;
+    guint i;
+
+    tmp = g_string_new (pattern);
+    strings = mc_search__multi_split (tmp);
+    g_string_free (tmp, TRUE);
+
+    ret = g_new (gchar *, strings->len + 1);
+    for (i = 0; i < strings->len; i++)
+    {
+        const GString *s = (const GString *) g_ptr_array_index (strings, i);
+
+        ret[i] = g_strndup (s->str, s->len);
+    }
+    ret[i] = NULL;
+
+    g_ptr_array_free (strings, TRUE);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
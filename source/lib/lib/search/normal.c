@@ -42,7 +42,262 @@
 
 /*** file scope functions ************************************************************************/
 
-static GString *
+/* Find the first byte of @buf equal to @a or @b */
+
+static const char *
+mc_search__normal_memchr2 (const char *buf, char a, char b, gsize len)
+{
+    const char *end = buf + len;
+
+    if (a == b)
+        return memchr (buf, a, len);
+
+    for (; buf < end; buf++)
+        if (*buf == a || *buf == b)
+            return buf;
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compare a UTF-8 @needle which is in lower case already to the text at @str ignoring case.
+ *
+ * @return the length of the matched text or 0 if there is no match
+ */
+
+static gsize
+mc_search__normal_utf8_casecmp (const GString * needle, const char *str, const char *end)
+{
+    const char *n = needle->str;
+    const char *n_end = needle->str + needle->len;
+    const char *p = str;
+
+    while (n < n_end)
+    {
+        gunichar hc;
+
+        if (p >= end)
+            return 0;
+
+        hc = g_utf8_get_char_validated (p, end - p);
+        if (hc == (gunichar) (-1) || hc == (gunichar) (-2))
+            return 0;
+
+        if (g_unichar_tolower (hc) != g_utf8_get_char (n))
+            return 0;
+
+        p = g_utf8_next_char (p);
+        n = g_utf8_next_char (n);
+    }
+
+    return (gsize) (p - str);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the first occurrence of the literal pattern of @cond in @buf.
+ *
+ * The case sensitive pattern is located by memchr() of its first byte followed by memcmp().
+ * A case insensitive pattern has either upper and lower case variants of the same length
+ * which are compared byte by byte, or only the lower case variant for UTF-8 text that is
+ * compared character by character.
+ *
+ * @return TRUE if found, the position and the length of the match are stored in @start and @len
+ */
+
+static gboolean
+mc_search__normal_find (const mc_search_cond_t * cond, const char *buf, gsize buf_len,
+                        gsize * start, gsize * len)
+{
+    const char *end = buf + buf_len;
+    const char *p = buf;
+
+    if (cond->lower == NULL)
+    {
+        const char *needle = cond->str->str;
+        const gsize n = cond->str->len;
+
+        while ((gsize) (end - p) >= n)
+        {
+            p = memchr (p, needle[0], (gsize) (end - p) - n + 1);
+            if (p == NULL)
+                break;
+            if (memcmp (p + 1, needle + 1, n - 1) == 0)
+            {
+                *start = (gsize) (p - buf);
+                *len = n;
+                return TRUE;
+            }
+            p++;
+        }
+    }
+    else if (cond->upper != NULL)
+    {
+        const char *lower = cond->lower->str;
+        const char *upper = cond->upper->str;
+        const gsize n = cond->lower->len;
+
+        while ((gsize) (end - p) >= n)
+        {
+            gsize i;
+
+            p = mc_search__normal_memchr2 (p, lower[0], upper[0], (gsize) (end - p) - n + 1);
+            if (p == NULL)
+                break;
+            for (i = 1; i < n && (p[i] == lower[i] || p[i] == upper[i]); i++)
+                ;
+            if (i == n)
+            {
+                *start = (gsize) (p - buf);
+                *len = n;
+                return TRUE;
+            }
+            p++;
+        }
+    }
+    else
+    {
+        gunichar c;
+        char lead_lower, lead_upper;
+        gchar tmp[6];
+
+        /* the text can only match where the first character starts */
+        c = g_utf8_get_char (cond->lower->str);
+        lead_lower = cond->lower->str[0];
+        g_unichar_to_utf8 (g_unichar_toupper (c), tmp);
+        lead_upper = tmp[0];
+
+        while (p < end)
+        {
+            gsize n;
+
+            p = mc_search__normal_memchr2 (p, lead_lower, lead_upper, (gsize) (end - p));
+            if (p == NULL)
+                break;
+            n = mc_search__normal_utf8_casecmp (cond->lower, p, end);
+            if (n != 0)
+            {
+                *start = (gsize) (p - buf);
+                *len = n;
+                return TRUE;
+            }
+            p++;
+        }
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the earliest occurrence of any of the conditions in @buf.
+ */
+
+static gboolean
+mc_search__normal_find_conditions (mc_search_t * lc_mc_search, const char *buf, gsize buf_len,
+                                   gsize * start, gsize * len)
+{
+    gboolean found = FALSE;
+    gsize loop1;
+
+    for (loop1 = 0; loop1 < lc_mc_search->conditions->len; loop1++)
+    {
+        mc_search_cond_t *mc_search_cond;
+        gsize cond_start, cond_len, cond_id = 0;
+        gboolean cond_found;
+
+        mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, loop1);
+
+        if (mc_search_cond->multi != NULL)
+            cond_found = mc_search__multi_find (mc_search_cond->multi, buf, buf_len, &cond_start,
+                                                &cond_len, &cond_id);
+        else
+            cond_found =
+                mc_search__normal_find (mc_search_cond, buf, buf_len, &cond_start, &cond_len);
+
+        if (cond_found && (!found || cond_start < *start))
+        {
+            *start = cond_start;
+            *len = cond_len;
+            lc_mc_search->match_id = cond_id;
+            found = TRUE;
+        }
+    }
+
+    return found;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__normal_found (mc_search_t * lc_mc_search, gsize offset, gsize len, gsize * found_len)
+{
+    lc_mc_search->normal_offset = offset;
+    if (found_len != NULL)
+        *found_len = len;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Prepare the condition for literal search.
+ */
+
+static void
+mc_search__normal_init_literal (const char *charset, mc_search_t * lc_mc_search,
+                                mc_search_cond_t * mc_search_cond)
+{
+    GString *str = mc_search_cond->str;
+    gboolean is_ascii = TRUE;
+    gsize i;
+
+    lc_mc_search->is_utf8 = str_isutf8 (charset);
+
+    if (lc_mc_search->is_case_sensitive)
+        return;
+
+    for (i = 0; i < str->len && is_ascii; i++)
+        is_ascii = ((guchar) str->str[i] < 0x80);
+
+    if (!is_ascii && lc_mc_search->is_utf8 && mc_global.utf8_display
+        && g_utf8_validate (str->str, str->len, NULL))
+    {
+        const char *p;
+
+        /* compared character by character, see mc_search__normal_utf8_casecmp() */
+        mc_search_cond->lower = g_string_sized_new (str->len);
+        for (p = str->str; p < str->str + str->len; p = g_utf8_next_char (p))
+            g_string_append_unichar (mc_search_cond->lower, g_unichar_tolower (g_utf8_get_char (p)));
+        return;
+    }
+
+    if (!is_ascii)
+    {
+        mc_search_cond->lower = mc_search__tolower_case_str (charset, str->str, str->len);
+        mc_search_cond->upper = mc_search__toupper_case_str (charset, str->str, str->len);
+
+        if (mc_search_cond->lower->len == str->len && mc_search_cond->upper->len == str->len)
+            return;
+
+        /* a case mapping that changes the length: ignore case of ASCII letters only */
+        g_string_free (mc_search_cond->lower, TRUE);
+        g_string_free (mc_search_cond->upper, TRUE);
+    }
+
+    mc_search_cond->lower = g_string_new_len (str->str, str->len);
+    mc_search_cond->upper = g_string_new_len (str->str, str->len);
+    for (i = 0; i < str->len; i++)
+    {
+        mc_search_cond->lower->str[i] = g_ascii_tolower (str->str[i]);
+        mc_search_cond->upper->str[i] = g_ascii_toupper (str->str[i]);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+
+GString *
 mc_search__normal_translate_to_regex (const GString * astr)
 {
     const char *str = astr->str;
@@ -80,7 +335,7 @@ mc_search__normal_translate_to_regex (const GString * astr)
     return buff;
 }
 
-/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
 
 void
 mc_search__cond_struct_new_init_normal (const char *charset, mc_search_t * lc_mc_search,
@@ -88,6 +343,14 @@ mc_search__cond_struct_new_init_normal (const char *charset, mc_search_t * lc_mc
 {
     GString *tmp;
 
+    /* Whole words need the look-around assertions of the regex engine. Everything else is
+       matched as a plain string, the condition has no regex_handle in that case. */
+    if (!lc_mc_search->whole_words && mc_search_cond->str->len != 0)
+    {
+        mc_search__normal_init_literal (charset, lc_mc_search, mc_search_cond);
+        return;
+    }
+
     tmp = mc_search__normal_translate_to_regex (mc_search_cond->str);
     g_string_free (mc_search_cond->str, TRUE);
 
@@ -97,11 +360,149 @@ mc_search__cond_struct_new_init_normal (const char *charset, mc_search_t * lc_mc
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Run the plain search. Like the regex search, the text is looked at in the range
+ * [start_search; end_search] and a string is searched up to its terminating NUL.
+ * A string is scanned at once, data provided by search_fn is collected line by line
+ * unless get_span provides whole lines at once.
+ */
+
 gboolean
 mc_search__run_normal (mc_search_t * lc_mc_search, const void *user_data,
                        gsize start_search, gsize end_search, gsize * found_len)
 {
-    return mc_search__run_regex (lc_mc_search, user_data, start_search, end_search, found_len);
+    mc_search_cbret_t ret = MC_SEARCH_CB_NOTFOUND;
+    mc_search_cond_t *mc_search_cond;
+    gsize start, len;
+
+    mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, 0);
+    if (mc_search_cond->regex_handle != NULL)
+        return mc_search__run_regex (lc_mc_search, user_data, start_search, end_search,
+                                     found_len);
+
+    if (start_search > end_search)
+        ;                       /* nothing to look at */
+    else if (lc_mc_search->search_fn == NULL)
+    {
+        const char *buf = (const char *) user_data + start_search;
+        gsize buf_len;
+
+        if (end_search - start_search >= G_MAXSIZE - 1)
+            buf_len = strlen (buf);
+        else
+        {
+            const char *nul;
+
+            buf_len = end_search - start_search + 1;
+            nul = memchr (buf, '\0', buf_len);
+            if (nul != NULL)
+                buf_len = (gsize) (nul - buf);
+        }
+
+        lc_mc_search->start_buffer = start_search;
+
+        if (mc_search__normal_find_conditions (lc_mc_search, buf, buf_len, &start, &len))
+            return mc_search__normal_found (lc_mc_search, start_search + start, len, found_len);
+
+        if (lc_mc_search->update_fn != NULL
+            && lc_mc_search->update_fn (user_data, start_search + buf_len) == MC_SEARCH_CB_ABORT)
+            ret = MC_SEARCH_CB_ABORT;
+    }
+    else
+    {
+        gsize current_pos, virtual_pos;
+
+        if (lc_mc_search->regex_buffer != NULL)
+            g_string_set_size (lc_mc_search->regex_buffer, 0);
+        else
+            lc_mc_search->regex_buffer = g_string_sized_new (64);
+
+        virtual_pos = current_pos = start_search;
+        while (virtual_pos <= end_search)
+        {
+            const char *span;
+            gsize span_len;
+
+            /* take as many lines as the data provider has at hand */
+            if (mc_search__get_span_lines (lc_mc_search, user_data, current_pos, end_search,
+                                           &span, &span_len))
+            {
+                lc_mc_search->start_buffer = current_pos;
+
+                if (mc_search__normal_find_conditions (lc_mc_search, span, span_len, &start, &len))
+                {
+                    g_string_free (lc_mc_search->regex_buffer, TRUE);
+                    lc_mc_search->regex_buffer = NULL;
+                    return mc_search__normal_found (lc_mc_search, current_pos + start, len,
+                                                    found_len);
+                }
+
+                current_pos += span_len;
+                virtual_pos = current_pos;
+
+                if (lc_mc_search->update_fn != NULL
+                    && lc_mc_search->update_fn (user_data, current_pos) == MC_SEARCH_CB_ABORT)
+                {
+                    ret = MC_SEARCH_CB_ABORT;
+                    break;
+                }
+                continue;
+            }
+
+            g_string_set_size (lc_mc_search->regex_buffer, 0);
+            lc_mc_search->start_buffer = current_pos;
+
+            while (TRUE)
+            {
+                int current_chr = '\n';        /* stop search symbol */
+
+                ret = lc_mc_search->search_fn (user_data, current_pos, &current_chr);
+
+                if (ret == MC_SEARCH_CB_ABORT)
+                    break;
+
+                if (ret == MC_SEARCH_CB_INVALID)
+                    continue;
+
+                current_pos++;
+
+                if (ret == MC_SEARCH_CB_SKIP)
+                    continue;
+
+                virtual_pos++;
+
+                g_string_append_c (lc_mc_search->regex_buffer, (char) current_chr);
+
+                if ((char) current_chr == '\n' || virtual_pos > end_search)
+                    break;
+            }
+
+            if (mc_search__normal_find_conditions (lc_mc_search, lc_mc_search->regex_buffer->str,
+                                                   lc_mc_search->regex_buffer->len, &start,
+                                                   &len))
+            {
+                g_string_free (lc_mc_search->regex_buffer, TRUE);
+                lc_mc_search->regex_buffer = NULL;
+                return mc_search__normal_found (lc_mc_search, lc_mc_search->start_buffer + start,
+                                                len, found_len);
+            }
+
+            if ((lc_mc_search->update_fn != NULL) &&
+                ((lc_mc_search->update_fn) (user_data, current_pos) == MC_SEARCH_CB_ABORT))
+                ret = MC_SEARCH_CB_ABORT;
+
+            if (ret == MC_SEARCH_CB_ABORT || ret == MC_SEARCH_CB_NOTFOUND)
+                break;
+        }
+
+        g_string_free (lc_mc_search->regex_buffer, TRUE);
+        lc_mc_search->regex_buffer = NULL;
+    }
+
+    MC_PTR_FREE (lc_mc_search->error_str);
+    lc_mc_search->error = ret == MC_SEARCH_CB_ABORT ? MC_SEARCH_E_ABORT : MC_SEARCH_E_NOTFOUND;
+
+    return FALSE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
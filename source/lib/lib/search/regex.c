@@ -29,6 +29,7 @@
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>             /* memchr() */
 
 #include "lib/global.h"
 #include "lib/strutil.h"
@@ -46,6 +47,10 @@
 #define REPLACE_PREPARE_T_REPLACE_FLAG    -2
 #define REPLACE_PREPARE_T_ESCAPE_SEQ      -3
 
+/* Size of the first piece of a string matched at once, it is doubled for each next piece */
+#define REGEX_SPAN_MIN ((gsize) 4096)
+#define REGEX_SPAN_MAX ((gsize) 1024 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 typedef enum
@@ -385,6 +390,185 @@ mc_search__regex_found_cond (mc_search_t * lc_mc_search, GString * search_str)
 
 /* --------------------------------------------------------------------------------------------- */
 
+#ifdef SEARCH_TYPE_GLIB
+/**
+ * Match the whole lines in @piece, which holds @len bytes at @offset of the data, with one
+ * regex call instead of copying each line to regex_buffer. A match found this way is checked
+ * by matching its line alone, so the result is the same as that of the line by line search,
+ * also for a match that would cross a line end. The match info and regex_buffer are left
+ * as the line by line search leaves them.
+ *
+ * After a match that crossed the end of its line in vain, the lines are matched one at a time:
+ * a greedy pattern would run to the end of the piece again for each of the next lines.
+ */
+
+static mc_search__found_cond_t
+mc_search__regex_match_lines (mc_search_t * lc_mc_search, const char *piece, gsize offset,
+                              gsize len, gsize * found_len)
+{
+    mc_search_cond_t *mc_search_cond;
+    gsize pos = 0;
+    gboolean by_line = FALSE;
+
+    mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, 0);
+
+    while (pos < len)
+    {
+        gsize scan_len, line_start, line_end;
+        GMatchInfo *match_info = NULL;
+        GError *mcerror = NULL;
+        gint start_pos, end_pos;
+
+        scan_len = len - pos;
+        if (by_line)
+        {
+            const char *nl;
+
+            nl = memchr (piece + pos, '\n', scan_len);
+            if (nl != NULL)
+                scan_len = (gsize) (nl - (piece + pos)) + 1;
+        }
+
+        if (!mc_search__g_regex_match_full_safe
+            (mc_search_cond->regex_scan_handle, piece + pos, scan_len, 0,
+             G_REGEX_MATCH_NEWLINE_ANY, &match_info, &mcerror))
+        {
+            g_match_info_free (match_info);
+            if (mcerror == NULL)
+            {
+                if (!by_line)
+                    return COND__NOT_FOUND;
+                pos += scan_len;
+                continue;
+            }
+
+            lc_mc_search->error = MC_SEARCH_E_REGEX;
+            g_free (lc_mc_search->error_str);
+            lc_mc_search->error_str =
+                str_conv_gerror_message (mcerror, _("Regular expression error"));
+            g_error_free (mcerror);
+            return COND__FOUND_ERROR;
+        }
+
+        g_match_info_fetch_pos (match_info, 0, &start_pos, &end_pos);
+        g_match_info_free (match_info);
+
+        /* the line of the match, as the line by line search would cut it */
+        line_start = pos + (gsize) start_pos;
+        while (line_start > pos && piece[line_start - 1] != '\n')
+            line_start--;
+        line_end = pos + (gsize) start_pos;
+        while (line_end < len && piece[line_end++] != '\n')
+            ;
+
+        g_string_set_size (lc_mc_search->regex_buffer, 0);
+        g_string_append_len (lc_mc_search->regex_buffer, piece + line_start,
+                             line_end - line_start);
+        lc_mc_search->start_buffer = offset + line_start;
+
+        switch (mc_search__regex_found_cond (lc_mc_search, lc_mc_search->regex_buffer))
+        {
+        case COND__FOUND_OK:
+            g_match_info_fetch_pos (lc_mc_search->regex_match_info, 0, &start_pos, &end_pos);
+            if (found_len != NULL)
+                *found_len = end_pos - start_pos;
+            lc_mc_search->normal_offset = lc_mc_search->start_buffer + start_pos;
+            return COND__FOUND_OK;
+        case COND__NOT_ALL_FOUND:
+            break;
+        default:
+            return COND__FOUND_ERROR;
+        }
+
+        /* the match crossed the end of its line, go on with the next lines one by one */
+        by_line = TRUE;
+        pos = line_end;
+    }
+
+    return COND__NOT_FOUND;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search a NUL-terminated string many lines at a time.
+ */
+
+static gboolean
+mc_search__run_regex_buffer (mc_search_t * lc_mc_search, const char *data, gsize start_search,
+                             gsize end_search, gsize * found_len)
+{
+    const gsize end = end_search == G_MAXSIZE ? G_MAXSIZE : end_search + 1;
+    gsize pos = start_search;
+    gsize span = REGEX_SPAN_MIN;
+    mc_search_cbret_t ret = MC_SEARCH_CB_NOTFOUND;
+
+    while (pos < end)
+    {
+        const char *nul;
+        gsize piece_end;
+        gboolean stop = FALSE;
+
+        /* take whole lines, a match cannot cross a line end */
+        piece_end = end - pos > span ? pos + span : end;
+        nul = memchr (data + pos, '\0', piece_end - pos);
+        if (nul != NULL)
+        {
+            piece_end = (gsize) (nul - data);
+            stop = TRUE;
+        }
+        else
+            while (piece_end < end)
+            {
+                const char c = data[piece_end];
+
+                if (c == '\0')
+                {
+                    stop = TRUE;
+                    break;
+                }
+                piece_end++;
+                if (c == '\n')
+                    break;
+            }
+
+        if (piece_end == end)
+            stop = TRUE;
+
+        span = MIN (span * 2, REGEX_SPAN_MAX);
+
+        switch (mc_search__regex_match_lines
+                (lc_mc_search, data + pos, pos, piece_end - pos, found_len))
+        {
+        case COND__FOUND_OK:
+            return TRUE;
+        case COND__NOT_FOUND:
+            break;
+        default:
+            return FALSE;
+        }
+
+        if (lc_mc_search->update_fn != NULL
+            && lc_mc_search->update_fn (data, piece_end) == MC_SEARCH_CB_ABORT)
+        {
+            ret = MC_SEARCH_CB_ABORT;
+            break;
+        }
+
+        if (stop)
+            break;
+
+        pos = piece_end;
+    }
+
+    MC_PTR_FREE (lc_mc_search->error_str);
+    lc_mc_search->error = ret == MC_SEARCH_CB_ABORT ? MC_SEARCH_E_ABORT : MC_SEARCH_E_NOTFOUND;
+
+    return FALSE;
+}
+#endif /* SEARCH_TYPE_GLIB */
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 mc_search_regex__get_max_num_of_replace_tokens (const gchar * str, gsize len)
 {
@@ -802,7 +986,8 @@ mc_search__cond_struct_new_init_regex (const char *charset, mc_search_t * lc_mc_
     {
 #ifdef SEARCH_TYPE_GLIB
         GError *mcerror = NULL;
-        GRegexCompileFlags g_regex_options = G_REGEX_OPTIMIZE | G_REGEX_DOTALL;
+        GRegexCompileFlags g_regex_options =
+            G_REGEX_OPTIMIZE | G_REGEX_DOTALL | G_REGEX_MULTILINE;
 
         if (str_isutf8 (charset) && mc_global.utf8_display)
         {
@@ -824,6 +1009,7 @@ mc_search__cond_struct_new_init_regex (const char *charset, mc_search_t * lc_mc_
             }
         }
 
+        /* G_REGEX_OPTIMIZE makes GLib use the JIT compiler of PCRE where it is available */
         mc_search_cond->regex_handle =
             g_regex_new (mc_search_cond->str->str, g_regex_options, 0, &mcerror);
 
@@ -836,6 +1022,10 @@ mc_search__cond_struct_new_init_regex (const char *charset, mc_search_t * lc_mc_
             g_error_free (mcerror);
             return;
         }
+
+        /* for matching many lines of a contiguous buffer at once: the same flags keep the same
+           matches, mc_search__regex_match_lines() keeps each of them within its line */
+        mc_search_cond->regex_scan_handle = g_regex_ref (mc_search_cond->regex_handle);
 #else /* SEARCH_TYPE_GLIB */
         const char *error;
         int erroffset;
@@ -866,7 +1056,12 @@ mc_search__cond_struct_new_init_regex (const char *charset, mc_search_t * lc_mc_
             mc_search_set_error (lc_mc_search, MC_SEARCH_E_REGEX_COMPILE, "%s", error);
             return;
         }
+#ifdef PCRE_STUDY_JIT_COMPILE
+        lc_mc_search->regex_match_info =
+            pcre_study (mc_search_cond->regex_handle, PCRE_STUDY_JIT_COMPILE, &error);
+#else
         lc_mc_search->regex_match_info = pcre_study (mc_search_cond->regex_handle, 0, &error);
+#endif
         if (lc_mc_search->regex_match_info == NULL && error != NULL)
         {
             mc_search_set_error (lc_mc_search, MC_SEARCH_E_REGEX_COMPILE, "%s", error);
@@ -889,15 +1084,76 @@ mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
     gsize current_pos, virtual_pos;
     gint start_pos;
     gint end_pos;
+#ifdef SEARCH_TYPE_GLIB
+    gboolean scan_lines = FALSE;
+#endif
 
     if (lc_mc_search->regex_buffer != NULL)
         g_string_set_size (lc_mc_search->regex_buffer, 0);
     else
         lc_mc_search->regex_buffer = g_string_sized_new (64);
 
+#ifdef SEARCH_TYPE_GLIB
+    if (lc_mc_search->conditions->len == 1)
+    {
+        mc_search_cond_t *mc_search_cond;
+
+        mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, 0);
+        scan_lines = mc_search_cond->regex_scan_handle != NULL;
+    }
+
+    if (scan_lines && lc_mc_search->search_fn == NULL)
+    {
+        gboolean found;
+
+        found = mc_search__run_regex_buffer (lc_mc_search, (const char *) user_data,
+                                             start_search, end_search, found_len);
+        if (!found)
+        {
+            g_string_free (lc_mc_search->regex_buffer, TRUE);
+            lc_mc_search->regex_buffer = NULL;
+        }
+        return found;
+    }
+#endif /* SEARCH_TYPE_GLIB */
+
     virtual_pos = current_pos = start_search;
     while (virtual_pos <= end_search)
     {
+#ifdef SEARCH_TYPE_GLIB
+        const char *span;
+        gsize span_len;
+
+        /* take as many lines as the data provider has at hand */
+        if (scan_lines && mc_search__get_span_lines (lc_mc_search, user_data, current_pos,
+                                                     end_search, &span, &span_len))
+        {
+            mc_search__found_cond_t found;
+
+            found = mc_search__regex_match_lines (lc_mc_search, span, current_pos, span_len,
+                                                  found_len);
+            if (found == COND__FOUND_OK)
+                return TRUE;
+            if (found != COND__NOT_FOUND)
+            {
+                g_string_free (lc_mc_search->regex_buffer, TRUE);
+                lc_mc_search->regex_buffer = NULL;
+                return FALSE;
+            }
+
+            current_pos += span_len;
+            virtual_pos = current_pos;
+
+            if (lc_mc_search->update_fn != NULL
+                && lc_mc_search->update_fn (user_data, current_pos) == MC_SEARCH_CB_ABORT)
+            {
+                ret = MC_SEARCH_CB_ABORT;
+                break;
+            }
+            continue;
+        }
+#endif /* SEARCH_TYPE_GLIB */
+
         g_string_set_size (lc_mc_search->regex_buffer, 0);
         lc_mc_search->start_buffer = current_pos;
 
@@ -54,6 +54,7 @@ static const mc_search_type_str_t mc_search__list_types[] = {
     {N_("Re&gular expression"), MC_SEARCH_T_REGEX},
     {N_("He&xadecimal"), MC_SEARCH_T_HEX},
     {N_("Wil&dcard search"), MC_SEARCH_T_GLOB},
+    {N_("&Multiple strings"), MC_SEARCH_T_MULTI},
     {NULL, MC_SEARCH_T_INVALID}
 };
 
@@ -83,6 +84,9 @@ mc_search__cond_struct_new (mc_search_t * lc_mc_search, const char *str,
     case MC_SEARCH_T_HEX:
         mc_search__cond_struct_new_init_hex (charset, lc_mc_search, mc_search_cond);
         break;
+    case MC_SEARCH_T_MULTI:
+        mc_search__cond_struct_new_init_multi (charset, lc_mc_search, mc_search_cond);
+        break;
     default:
         break;
     }
@@ -106,10 +110,14 @@ mc_search__cond_struct_free (mc_search_cond_t * mc_search_cond)
 #ifdef SEARCH_TYPE_GLIB
     if (mc_search_cond->regex_handle)
         g_regex_unref (mc_search_cond->regex_handle);
+    if (mc_search_cond->regex_scan_handle != NULL)
+        g_regex_unref (mc_search_cond->regex_scan_handle);
 #else /* SEARCH_TYPE_GLIB */
     g_free (mc_search_cond->regex_handle);
 #endif /* SEARCH_TYPE_GLIB */
 
+    mc_search__multi_free (mc_search_cond->multi);
+
     g_free (mc_search_cond);
 }
 
@@ -194,7 +202,9 @@ mc_search_free (mc_search_t * lc_mc_search)
 #ifdef SEARCH_TYPE_GLIB
     if (lc_mc_search->regex_match_info != NULL)
         g_match_info_free (lc_mc_search->regex_match_info);
-#else /* SEARCH_TYPE_GLIB */
+#elif defined(PCRE_STUDY_JIT_COMPILE)
+    pcre_free_study (lc_mc_search->regex_match_info);
+#else
     g_free (lc_mc_search->regex_match_info);
 #endif /* SEARCH_TYPE_GLIB */
 
@@ -316,6 +326,9 @@ mc_search_run (mc_search_t * lc_mc_search, const void *user_data,
     case MC_SEARCH_T_HEX:
         ret = mc_search__run_hex (lc_mc_search, user_data, start_search, end_search, found_len);
         break;
+    case MC_SEARCH_T_MULTI:
+        ret = mc_search__run_multi (lc_mc_search, user_data, start_search, end_search, found_len);
+        break;
     default:
         break;
     }
@@ -333,6 +346,7 @@ mc_search_is_type_avail (mc_search_type_t search_type)
     case MC_SEARCH_T_NORMAL:
     case MC_SEARCH_T_REGEX:
     case MC_SEARCH_T_HEX:
+    case MC_SEARCH_T_MULTI:
         return TRUE;
     default:
         break;
@@ -379,6 +393,9 @@ mc_search_prepare_replace_str (mc_search_t * lc_mc_search, GString * replace_str
     case MC_SEARCH_T_HEX:
         ret = mc_search_hex_prepare_replace_str (lc_mc_search, replace_str);
         break;
+    case MC_SEARCH_T_MULTI:
+        ret = mc_search_multi_prepare_replace_str (lc_mc_search, replace_str);
+        break;
     default:
         ret = mc_g_string_dup (replace_str);
         break;
@@ -460,7 +477,8 @@ mc_search_getstart_result_by_num (mc_search_t * lc_mc_search, int lc_index)
 {
     if (lc_mc_search == NULL)
         return 0;
-    if (lc_mc_search->search_type == MC_SEARCH_T_NORMAL)
+    if (lc_mc_search->search_type == MC_SEARCH_T_NORMAL
+        || lc_mc_search->search_type == MC_SEARCH_T_MULTI)
         return 0;
 #ifdef SEARCH_TYPE_GLIB
     {
@@ -482,7 +500,8 @@ mc_search_getend_result_by_num (mc_search_t * lc_mc_search, int lc_index)
 {
     if (lc_mc_search == NULL)
         return 0;
-    if (lc_mc_search->search_type == MC_SEARCH_T_NORMAL)
+    if (lc_mc_search->search_type == MC_SEARCH_T_NORMAL
+        || lc_mc_search->search_type == MC_SEARCH_T_MULTI)
         return 0;
 #ifdef SEARCH_TYPE_GLIB
     {
@@ -642,6 +642,26 @@ extract_line (const char *s, const char *top)
     return tmp_line;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count the line ends, the '\n' bytes, in a piece of memory.
+ */
+
+size_t
+count_newlines (const char *s, size_t len)
+{
+    const char *end = s + len;
+    size_t n = 0;
+
+    while ((s = memchr (s, '\n', (size_t) (end - s))) != NULL)
+    {
+        s++;
+        n++;
+    }
+
+    return n;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * The basename routine
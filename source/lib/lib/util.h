@@ -209,6 +209,7 @@ const char *get_owner (uid_t uid);
 
 /* Returns a copy of *s until a \n is found and is below top */
 const char *extract_line (const char *s, const char *top);
+size_t count_newlines (const char *s, size_t len);
 
 /* Process spawning */
 int my_system (int flags, const char *shell, const char *command);
@@ -222,6 +223,11 @@ void mc_pclose (mc_pipe_t * p, GError ** error);
 
 GString *mc_pstream_get_string (mc_pipe_stream_t * ps);
 
+/* Read-only file mappings that survive the truncation of the file */
+void *mc_mmap_read (int fd, size_t size, gboolean shared);
+void mc_munmap_read (void *addr, size_t size);
+gboolean mc_mmap_read_faulted (const void *addr);
+
 void my_exit (int status);
 void save_stop_handler (void);
 
@@ -53,6 +53,9 @@
 #include <sys/select.h>
 #endif
 #include <sys/wait.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include <pwd.h>
 #include <grp.h>
 
@@ -84,6 +87,18 @@ struct sigaction startup_handler;
 /* More than that would be unportable */
 #define MAX_PIPE_SIZE 4096
 
+#ifdef HAVE_MMAP
+#ifndef MAP_FILE
+#define MAP_FILE 0
+#endif
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* Number of file mappings of mc_mmap_read() that can exist at once */
+#define MMAP_GUARD_SLOTS 64
+#endif /* HAVE_MMAP */
+
 /*** file scope type declarations ****************************************************************/
 
 typedef struct
@@ -106,11 +121,28 @@ typedef struct
     struct sigaction stop;
 } my_system_sigactions_t;
 
+#ifdef HAVE_MMAP
+/* A file mapping that the SIGBUS handler knows about */
+typedef struct
+{
+    gint used;                  /* the slot is taken */
+    char *start;                /* the mapping, NULL while it is set up or torn down */
+    size_t len;
+    volatile sig_atomic_t faulted;      /* a page of it has been replaced with zeros */
+} mmap_guard_t;
+#endif /* HAVE_MMAP */
+
 /*** file scope variables ************************************************************************/
 
 static int_cache uid_cache[UID_CACHE_SIZE];
 static int_cache gid_cache[GID_CACHE_SIZE];
 
+#ifdef HAVE_MMAP
+static mmap_guard_t mmap_guards[MMAP_GUARD_SLOTS];
+static size_t mmap_page_size;
+static struct sigaction mmap_old_sigbus;
+#endif /* HAVE_MMAP */
+
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -272,6 +304,85 @@ mc_pread_stream (mc_pipe_stream_t * ps, const fd_set * fds)
     ps->pos = 0;
 }
 
+#ifdef HAVE_MMAP
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * A page of a file mapping that lies past the end of the file raises SIGBUS when it is read.
+ * If the page belongs to a mapping of mc_mmap_read(), it is replaced with a page of zeros and
+ * the read is done again. Other faults get the action that was there before.
+ */
+
+static void
+mmap_guard_sigbus (int sig, siginfo_t * info, void *context)
+{
+    const char *addr = (const char *) info->si_addr;
+    int i;
+
+    (void) sig;
+    (void) context;
+
+    for (i = 0; i < MMAP_GUARD_SLOTS; i++)
+    {
+        mmap_guard_t *g = &mmap_guards[i];
+        char *start;
+
+        start = (char *) g_atomic_pointer_get (&g->start);
+        if (start != NULL && addr >= start && addr < start + g->len)
+        {
+            char *page;
+
+            page = start + ((size_t) (addr - start) & ~(mmap_page_size - 1));
+            if (mmap (page, mmap_page_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+                      -1, 0) == MAP_FAILED)
+                break;
+
+            g->faulted = 1;
+            return;
+        }
+    }
+
+    /* the fault happens again with the old action */
+    (void) sigaction (SIGBUS, &mmap_old_sigbus, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+mmap_guard_init (gpointer data)
+{
+    struct sigaction sa;
+
+    (void) data;
+
+    mmap_page_size = (size_t) sysconf (_SC_PAGESIZE);
+
+    memset (&sa, 0, sizeof (sa));
+    sa.sa_sigaction = mmap_guard_sigbus;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset (&sa.sa_mask);
+    (void) sigaction (SIGBUS, &sa, &mmap_old_sigbus);
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mmap_guard_t *
+mmap_guard_find (const void *addr)
+{
+    int i;
+
+    if (addr == NULL)
+        return NULL;
+
+    for (i = 0; i < MMAP_GUARD_SLOTS; i++)
+        if (g_atomic_pointer_get (&mmap_guards[i].start) == addr)
+            return &mmap_guards[i];
+
+    return NULL;
+}
+#endif /* HAVE_MMAP */
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -1306,3 +1417,102 @@ mc_build_filename (const char *first_element, ...)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Map a local file read-only. Unlike a bare mmap(), a mapping of a file that is truncated by
+ * another process meanwhile does not kill mc: the pages past the new end of the file read as
+ * zeros, and mc_mmap_read_faulted() tells that it happened.
+ *
+ * @param fd descriptor of the file
+ * @param size number of bytes to map from the beginning of the file, not 0
+ * @param shared map with MAP_SHARED rather than with MAP_PRIVATE
+ *
+ * @return the mapping, or NULL if the file cannot be mapped
+ */
+
+void *
+mc_mmap_read (int fd, size_t size, gboolean shared)
+{
+#ifdef HAVE_MMAP
+    static GOnce guard_once = G_ONCE_INIT;
+    mmap_guard_t *g = NULL;
+    void *data;
+    int i;
+
+    g_once (&guard_once, mmap_guard_init, NULL);
+
+    for (i = 0; i < MMAP_GUARD_SLOTS && g == NULL; i++)
+        if (g_atomic_int_compare_and_exchange (&mmap_guards[i].used, 0, 1))
+            g = &mmap_guards[i];
+
+    /* there is no guard left, the caller reads the file */
+    if (g == NULL)
+        return NULL;
+
+    data = mmap (NULL, size, PROT_READ, MAP_FILE | (shared ? MAP_SHARED : MAP_PRIVATE), fd, 0);
+    if (data == MAP_FAILED)
+    {
+        g_atomic_int_set (&g->used, 0);
+        return NULL;
+    }
+
+    g->len = size;
+    g->faulted = 0;
+    g_atomic_pointer_set (&g->start, data);
+
+    return data;
+#else
+    (void) fd;
+    (void) size;
+    (void) shared;
+
+    return NULL;
+#endif /* HAVE_MMAP */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Unmap a file mapped by mc_mmap_read().
+ */
+
+void
+mc_munmap_read (void *addr, size_t size)
+{
+#ifdef HAVE_MMAP
+    mmap_guard_t *g;
+
+    g = mmap_guard_find (addr);
+    if (g != NULL)
+        g_atomic_pointer_set (&g->start, NULL);
+
+    (void) munmap (addr, size);
+
+    if (g != NULL)
+        g_atomic_int_set (&g->used, 0);
+#else
+    (void) addr;
+    (void) size;
+#endif /* HAVE_MMAP */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether pages of a mapping of mc_mmap_read() have been read past the end of the file,
+ * i.e. whether the file has been truncated since it was mapped.
+ */
+
+gboolean
+mc_mmap_read_faulted (const void *addr)
+{
+#ifdef HAVE_MMAP
+    mmap_guard_t *g;
+
+    g = mmap_guard_find (addr);
+    return (g != NULL && g->faulted != 0);
+#else
+    (void) addr;
+
+    return FALSE;
+#endif /* HAVE_MMAP */
+}
+
+/* --------------------------------------------------------------------------------------------- */
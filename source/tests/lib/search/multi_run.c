@@ -0,0 +1,205 @@
+/*
+   libmc - checks for multi-string search
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/search/multi"
+
+#include "tests/mctest.h"
+
+#include "multi.c"              /* for testing static functions */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_multi_run_ds") */
+/* *INDENT-OFF* */
+static const struct test_multi_run_ds
+{
+    const char *input_text;
+    const char *input_pattern;
+    const gboolean input_case_sensitive;
+    const gboolean input_whole_words;
+    const gboolean expected_found;
+    const off_t expected_offset;
+    const gsize expected_len;
+    const gsize expected_id;
+} test_multi_run_ds[] =
+{
+    { /* 0. */
+        "error E042 and E007",
+        "E007|E042",
+        TRUE, FALSE,
+        TRUE, 6, 4, 1
+    },
+    { /* 1. the leftmost match wins even if another one ends first */
+        "abcd",
+        "bc|abcd",
+        TRUE, FALSE,
+        TRUE, 0, 4, 1
+    },
+    { /* 2. the longest of the matches that start at the same place wins */
+        "abcdef",
+        "abc|abcde",
+        TRUE, FALSE,
+        TRUE, 0, 5, 1
+    },
+    { /* 3. */
+        "ushers",
+        "he|she|his|hers",
+        TRUE, FALSE,
+        TRUE, 1, 3, 1
+    },
+    { /* 4. */
+        "Foo BAR",
+        "bar|baz",
+        FALSE, FALSE,
+        TRUE, 4, 3, 0
+    },
+    { /* 5. */
+        "Foo BAR",
+        "bar|baz",
+        TRUE, FALSE,
+        FALSE, 0, 0, 0
+    },
+    { /* 6. an escaped separator is a part of the string */
+        "a b a|b",
+        "a\\|b|x",
+        TRUE, FALSE,
+        TRUE, 4, 3, 0
+    },
+    { /* 7. empty strings are dropped */
+        "xyz",
+        "||z|",
+        TRUE, FALSE,
+        TRUE, 2, 1, 0
+    },
+    { /* 8. whole words are matched by the regex engine */
+        "E0421 E042",
+        "E042|E007",
+        TRUE, TRUE,
+        TRUE, 6, 4, 0
+    },
+    { /* 9. */
+        "xE007 E007",
+        "E042|E007",
+        TRUE, TRUE,
+        TRUE, 6, 4, 1
+    }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_multi_run_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_multi_run, test_multi_run_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *s;
+    gboolean found;
+    gsize found_len = 0;
+
+    s = mc_search_new (data->input_pattern, NULL);
+    s->is_case_sensitive = data->input_case_sensitive;
+    s->whole_words = data->input_whole_words;
+    s->search_type = MC_SEARCH_T_MULTI;
+
+    /* when */
+    found = mc_search_run (s, data->input_text, 0, strlen (data->input_text), &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (data->expected_found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+        mctest_assert_int_eq (s->match_id, data->expected_id);
+    }
+    else
+        mctest_assert_int_eq (s->error, MC_SEARCH_E_NOTFOUND);
+
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_multi_join)
+{
+    /* given */
+    const gchar *const strings[] = { "a|b", "c\\", "d", NULL };
+    gchar *pattern;
+
+    /* when */
+    pattern = mc_search_multi_join (strings);
+
+    /* then */
+    mctest_assert_str_eq (pattern, "a\\|b|c\\\\|d");
+
+    g_free (pattern);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_multi_split)
+{
+    /* given */
+    gchar **strings;
+
+    /* when */
+    strings = mc_search_multi_split ("a\\|b||c\\\\|d");
+
+    /* then */
+    mctest_assert_int_eq (g_strv_length (strings), 3);
+    mctest_assert_str_eq (strings[0], "a|b");
+    mctest_assert_str_eq (strings[1], "c\\");
+    mctest_assert_str_eq (strings[2], "d");
+
+    g_strfreev (strings);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_multi_run, test_multi_run_ds);
+    tcase_add_test (tc_core, test_multi_join);
+    tcase_add_test (tc_core, test_multi_split);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,153 @@
+/*
+   libmc - checks for plain (literal) search
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/search/normal"
+
+#include "tests/mctest.h"
+
+#include "normal.c"             /* for testing static functions */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_normal_run_ds") */
+/* *INDENT-OFF* */
+static const struct test_normal_run_ds
+{
+    const char *input_text;
+    const char *input_pattern;
+    const gboolean input_case_sensitive;
+    const gsize input_start;
+    const gsize input_end;
+    const gboolean expected_found;
+    const off_t expected_offset;
+    const gsize expected_len;
+} test_normal_run_ds[] =
+{
+    { /* 0. */
+        "one two three",
+        "two",
+        TRUE,
+        0, 13,
+        TRUE, 4, 3
+    },
+    { /* 1. */
+        "one Two three",
+        "two",
+        TRUE,
+        0, 13,
+        FALSE, 0, 0
+    },
+    { /* 2. */
+        "one TwO three",
+        "two",
+        FALSE,
+        0, 13,
+        TRUE, 4, 3
+    },
+    { /* 3. regex special characters are not special */
+        "a.b a*b [ab]",
+        "[ab]",
+        TRUE,
+        0, 12,
+        TRUE, 8, 4
+    },
+    { /* 4. the search starts at the given offset */
+        "abc abc abc",
+        "abc",
+        TRUE,
+        1, 11,
+        TRUE, 4, 3
+    },
+    { /* 5. the match must fit in the range */
+        "abc abc abc",
+        "abc",
+        TRUE,
+        1, 5,
+        FALSE, 0, 0
+    },
+    { /* 6. the string ends at NUL */
+        "abc",
+        "abcd",
+        TRUE,
+        0, (gsize) -1,
+        FALSE, 0, 0
+    },
+    { /* 7. a partial match of the first byte is skipped */
+        "aaab",
+        "aab",
+        FALSE,
+        0, 4,
+        TRUE, 1, 3
+    }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_normal_run_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_normal_run, test_normal_run_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *s;
+    gboolean found;
+    gsize found_len = 0;
+
+    s = mc_search_new (data->input_pattern, NULL);
+    s->is_case_sensitive = data->input_case_sensitive;
+    s->search_type = MC_SEARCH_T_NORMAL;
+
+    /* when */
+    found = mc_search_run (s, data->input_text, data->input_start, data->input_end, &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (data->expected_found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+    }
+    else
+        mctest_assert_int_eq (s->error, MC_SEARCH_E_NOTFOUND);
+
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_normal_run, test_normal_run_ds);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
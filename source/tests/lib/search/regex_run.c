@@ -0,0 +1,305 @@
+/*
+   libmc - checks for regex search in strings
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/search/regex"
+
+#include "tests/mctest.h"
+
+#include "regex.c"              /* for testing static functions */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_regex_run_ds") */
+/* *INDENT-OFF* */
+static const struct test_regex_run_ds
+{
+    const char *input_text;
+    const char *input_pattern;
+    const gsize input_start;
+    const gsize input_end;
+    const gboolean expected_found;
+    const off_t expected_offset;
+    const gsize expected_len;
+} test_regex_run_ds[] =
+{
+    { /* 0. */
+        "one\ntwo\nthree\n",
+        "t[a-z]+",
+        0, 14,
+        TRUE, 4, 3
+    },
+    { /* 1. '^' matches at the start of each line */
+        "one\ntwo\nthree\n",
+        "^th",
+        0, 14,
+        TRUE, 8, 2
+    },
+    { /* 2. a match does not cross a line end */
+        "abc\ndef\n",
+        "c[^x]d",
+        0, 8,
+        FALSE, 0, 0
+    },
+    { /* 3. the line after a match crossing a line end is searched */
+        "abc\ndef cd\n",
+        "c[^x]*d",
+        0, 11,
+        TRUE, 8, 2
+    },
+    { /* 4. '.' takes the end of the line like the line by line search does */
+        "ab\ncd\n",
+        "c.*",
+        0, 6,
+        TRUE, 3, 3
+    },
+    { /* 5. the match must fit in the range */
+        "one\ntwo\nthree\n",
+        "three",
+        0, 10,
+        FALSE, 0, 0
+    },
+    { /* 6. a '.' at the end of the pattern takes the end of the line */
+        "ab\ncd\nef\n",
+        "d.",
+        0, 9,
+        TRUE, 4, 2
+    },
+    { /* 7. a negated class takes the end of the line, but not the next line */
+        "ab\ncd\n",
+        "b[^x]+",
+        0, 6,
+        TRUE, 1, 2
+    },
+    { /* 8. the lines after a match crossing a line end are matched one by one */
+        "ac\nd\nccd\n",
+        "c[^x]*d",
+        0, 9,
+        TRUE, 5, 3
+    }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_regex_run_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_regex_run, test_regex_run_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *s;
+    gboolean found;
+    gsize found_len = 0;
+
+    s = mc_search_new (data->input_pattern, NULL);
+    s->search_type = MC_SEARCH_T_REGEX;
+
+    /* when */
+    found = mc_search_run (s, data->input_text, data->input_start, data->input_end, &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (data->expected_found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+    }
+    else
+        mctest_assert_int_eq (s->error, MC_SEARCH_E_NOTFOUND);
+
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_regex_run_long)
+{
+    /* given */
+    GString *text;
+    mc_search_t *s;
+    gboolean found;
+    gsize found_len = 0;
+    int i;
+
+    /* many pieces of the string are matched before the match is found */
+    text = g_string_new ("");
+    for (i = 0; i < 20000; i++)
+        g_string_append (text, "lorem ipsum dolor sit amet\n");
+    g_string_append (text, "the needle 42\n");
+
+    s = mc_search_new ("needle [0-9]+", NULL);
+    s->search_type = MC_SEARCH_T_REGEX;
+
+    /* when */
+    found = mc_search_run (s, text->str, 0, text->len, &found_len);
+
+    /* then */
+    mctest_assert_true (found);
+    mctest_assert_int_eq (s->normal_offset, 20000 * 27 + 4);
+    mctest_assert_int_eq (found_len, 9);
+
+    mc_search_free (s);
+    g_string_free (text, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Spans of a few bytes, so that some lines cross them */
+#define TEST_SPAN_SIZE 6
+
+static mc_search_cbret_t
+test_search_fn (const void *user_data, gsize char_offset, int *current_char)
+{
+    const char *text = (const char *) user_data;
+
+    if (char_offset >= strlen (text))
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *current_char = (unsigned char) text[char_offset];
+    return MC_SEARCH_CB_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_cbret_t
+test_get_span (const void *user_data, gsize offset, const char **ptr, gsize * len)
+{
+    const char *text = (const char *) user_data;
+    const gsize text_len = strlen (text);
+
+    if (offset >= text_len)
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *ptr = text + offset;
+    *len = MIN (TEST_SPAN_SIZE - offset % TEST_SPAN_SIZE, text_len - offset);
+    return MC_SEARCH_CB_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_regex_run_span_ds") */
+/* *INDENT-OFF* */
+static const struct test_regex_run_span_ds
+{
+    const mc_search_type_t input_type;
+    const char *input_text;
+    const char *input_pattern;
+    const gboolean expected_found;
+    const off_t expected_offset;
+    const gsize expected_len;
+} test_regex_run_span_ds[] =
+{
+    { /* 0. lines within a span */
+        MC_SEARCH_T_REGEX,
+        "ab\nc\nxyz\nthree\n",
+        "^th",
+        TRUE, 9, 2
+    },
+    { /* 1. a line crossing spans */
+        MC_SEARCH_T_REGEX,
+        "ab\nxcdefghij\n",
+        "d[a-z]+",
+        TRUE, 5, 7
+    },
+    { /* 2. a match does not cross a line end */
+        MC_SEARCH_T_REGEX,
+        "a\nbc\nde\n",
+        "c.d",
+        FALSE, 0, 0
+    },
+    { /* 3. */
+        MC_SEARCH_T_NORMAL,
+        "ab\nc\nxyz\nthree\n",
+        "thr",
+        TRUE, 9, 3
+    },
+    { /* 4. */
+        MC_SEARCH_T_NORMAL,
+        "ab\nxcdefghij\n",
+        "efgh",
+        TRUE, 6, 4
+    },
+    { /* 5. the last line has no line end */
+        MC_SEARCH_T_NORMAL,
+        "ab\nxcdefghij",
+        "hij",
+        TRUE, 10, 3
+    }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_regex_run_span_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_regex_run_span, test_regex_run_span_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *s;
+    gboolean found;
+    gsize found_len = 0;
+
+    s = mc_search_new (data->input_pattern, NULL);
+    s->search_type = data->input_type;
+    s->search_fn = test_search_fn;
+    s->get_span = test_get_span;
+
+    /* when */
+    found = mc_search_run (s, data->input_text, 0, strlen (data->input_text) - 1, &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (data->expected_found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+    }
+
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_regex_run, test_regex_run_ds);
+    tcase_add_test (tc_core, test_regex_run_long);
+    mctest_add_parameterized_test (tc_core, test_regex_run_span, test_regex_run_span_ds);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
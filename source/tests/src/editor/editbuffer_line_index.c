@@ -0,0 +1,225 @@
+/*
+   src/editor - tests for the line index of the editor buffer
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+/* buffers of 64 bytes, so that the text takes many of them */
+#define S_EDIT_BUF_SIZE 6
+
+#include "src/editor/editbuffer.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* lines of 0 to 8 bytes, and every tenth line is longer than EDIT_LINE_WALK */
+#define TEST_LINES 200
+#define TEST_LONG_LINE 3000
+
+static edit_buffer_t buf;
+static GString *text = NULL;
+
+/* @Before */
+static void
+setup (void)
+{
+    int i;
+
+    text = g_string_new (NULL);
+    for (i = 0; i < TEST_LINES; i++)
+    {
+        int j, len;
+
+        len = (i % 10 == 5) ? TEST_LONG_LINE : i % 9;
+        for (j = 0; j < len; j++)
+            g_string_append_c (text, (char) ('a' + j % 26));
+        g_string_append_c (text, '\n');
+    }
+    /* the last line has no line break */
+    g_string_append (text, "last");
+
+    edit_buffer_init (&buf, 0);
+    buf.curs_line = 0;
+    buf.lines = edit_buffer_insert_bytes_ahead (&buf, text->str, (off_t) text->len);
+    edit_buffer_move_gap (&buf, (off_t) text->len / 2);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_buffer_clean (&buf);
+    g_string_free (text, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static off_t
+test_bol (off_t offset)
+{
+    while (offset > 0 && text->str[offset - 1] != '\n')
+        offset--;
+
+    return offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static off_t
+test_eol (off_t offset)
+{
+    while (offset < (off_t) text->len && text->str[offset] != '\n')
+        offset++;
+
+    return offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_line_index_lines)
+{
+    off_t offset;
+    long lines = 0;
+
+    mctest_assert_int_eq (buf.lines, TEST_LINES);
+    mctest_assert_int_eq (buf.lines1->len, buf.b1->len);
+    mctest_assert_int_eq (buf.lines2->len, buf.b2->len);
+
+    for (offset = 0; offset <= (off_t) text->len; offset++)
+    {
+        mctest_assert_int_eq (edit_buffer_lines_before (&buf, offset), lines);
+        mctest_assert_int_eq (edit_buffer_count_lines (&buf, 0, offset), lines);
+        if (offset == test_bol (offset))
+            mctest_assert_int_eq (edit_buffer_line_offset (&buf, lines), offset);
+
+        if (offset < (off_t) text->len && text->str[offset] == '\n')
+            lines++;
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_line_index_navigation)
+{
+    off_t offset;
+
+    for (offset = 0; offset <= (off_t) text->len; offset += 7)
+    {
+        off_t expected;
+        long i;
+
+        mctest_assert_int_eq (edit_buffer_get_bol (&buf, offset), test_bol (offset));
+        mctest_assert_int_eq (edit_buffer_get_eol (&buf, offset), test_eol (offset));
+
+        /* far lines are looked up in the index */
+        for (i = 0, expected = offset; i < 50 && test_eol (expected) < (off_t) text->len; i++)
+            expected = test_eol (expected) + 1;
+        mctest_assert_int_eq (edit_buffer_get_forward_offset (&buf, offset, 50, 0), expected);
+
+        for (i = 0, expected = test_bol (offset); i < 50 && expected != 0; i++)
+            expected = test_bol (expected - 1);
+        mctest_assert_int_eq (edit_buffer_get_backward_offset (&buf, offset, 50), expected);
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_line_index_edit)
+{
+    /* given */
+    GArray *lines1, *lines2;
+    off_t offset;
+    guint i;
+
+    /* when */
+    edit_buffer_insert (&buf, '\n');
+    edit_buffer_insert_bytes_ahead (&buf, "\n\n", 2);
+    edit_buffer_delete_range (&buf, 100);
+    edit_buffer_move_gap (&buf, -1000);
+    edit_buffer_backspace (&buf);
+    edit_buffer_delete (&buf);
+    edit_buffer_move_gap (&buf, 3000);
+
+    /* then */
+    /* the sums that were kept up to date are those that are counted again */
+    lines1 = buf.lines1;
+    lines2 = buf.lines2;
+    buf.lines1 = NULL;
+    buf.lines2 = NULL;
+    edit_buffer_index_build (&buf);
+
+    mctest_assert_int_eq (lines1->len, buf.lines1->len);
+    for (i = 0; i < lines1->len; i++)
+        mctest_assert_int_eq (g_array_index (lines1, long, i), g_array_index (buf.lines1, long, i));
+    mctest_assert_int_eq (lines2->len, buf.lines2->len);
+    for (i = 0; i < lines2->len; i++)
+        mctest_assert_int_eq (g_array_index (lines2, long, i), g_array_index (buf.lines2, long, i));
+
+    g_array_free (lines1, TRUE);
+    g_array_free (lines2, TRUE);
+
+    g_string_set_size (text, 0);
+    for (offset = 0; offset < buf.size; offset++)
+        g_string_append_c (text, (char) edit_buffer_get_byte (&buf, offset));
+
+    for (offset = 0; offset <= buf.size; offset += 5)
+    {
+        mctest_assert_int_eq (edit_buffer_get_bol (&buf, offset), test_bol (offset));
+        mctest_assert_int_eq (edit_buffer_get_eol (&buf, offset), test_eol (offset));
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_line_index_lines);
+    tcase_add_test (tc_core, test_line_index_navigation);
+    tcase_add_test (tc_core, test_line_index_edit);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,193 @@
+/*
+   src/editor - tests for the lazy loading of files into the editor buffer
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/* buffers of 16 bytes, so that the file takes many of them */
+#define S_EDIT_BUF_SIZE 4
+
+#include "src/editor/editbuffer.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* 11 line breaks in 62 bytes: 3 whole buffers and 14 bytes at the beginning */
+#define TEST_TEXT "one\ntwo\nthree\nfour\nfive\nsix\nseven\neight\nnine\nten\neleven\ntwelve"
+
+static edit_buffer_t buf;
+static char *file_name = NULL;
+
+/* @Before */
+static void
+setup (void)
+{
+    int fd;
+
+    fd = g_file_open_tmp (NULL, &file_name, NULL);
+    mctest_assert_true (fd != -1);
+    mctest_assert_int_eq (write (fd, TEST_TEXT, sizeof (TEST_TEXT) - 1), sizeof (TEST_TEXT) - 1);
+
+    edit_buffer_init (&buf, sizeof (TEST_TEXT) - 1);
+    buf.curs_line = 0;
+    mctest_assert_true (edit_buffer_map_file (&buf, fd, buf.size));
+
+    close (fd);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_buffer_clean (&buf);
+    unlink (file_name);
+    g_free (file_name);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_map_file_read)
+{
+    /* given */
+    const off_t len = sizeof (TEST_TEXT) - 1;
+    off_t i;
+    guint j;
+
+    mctest_assert_true (edit_buffer_lines_pending (&buf));
+    for (j = 0; j < buf.b2->len - 1; j++)
+        mctest_assert_true (edit_buffer_is_mapped (&buf, g_ptr_array_index (buf.b2, j)));
+
+    /* when */
+    mctest_assert_int_eq (edit_buffer_move_gap (&buf, len), 11);
+
+    /* then */
+    for (i = 0; i < len; i++)
+        mctest_assert_int_eq (edit_buffer_get_byte (&buf, i), TEST_TEXT[i]);
+
+    /* the bytes after the first buffer are taken from the mapping again */
+    for (j = 1; j < buf.b1->len - 1; j++)
+        mctest_assert_true (edit_buffer_is_mapped (&buf, g_ptr_array_index (buf.b1, j)));
+
+    mctest_assert_false (edit_buffer_count_file_lines (&buf, FALSE));
+    mctest_assert_false (edit_buffer_lines_pending (&buf));
+    mctest_assert_int_eq (buf.lines, 11);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_map_file_modify)
+{
+    /* given */
+    const char expected[] =
+        "one\ntwo\nthree\nfour\nfive\nsix\nSEVEN\neight\nnine\nten\neleven\ntwelve";
+    char data[sizeof (TEST_TEXT)];
+    off_t i;
+    int fd;
+
+    edit_buffer_move_gap (&buf, 28);
+
+    /* when */
+    edit_buffer_delete_range (&buf, 5);
+    edit_buffer_insert_bytes_ahead (&buf, "SEVEN", 5);
+
+    /* then */
+    for (i = 0; i < buf.size; i++)
+        mctest_assert_int_eq (edit_buffer_get_byte (&buf, i), expected[i]);
+
+    /* the modified buffers are copied, the last one is kept in the mapping */
+    mctest_assert_false (edit_buffer_is_mapped (&buf, g_ptr_array_index (buf.b2, 2)));
+    mctest_assert_false (edit_buffer_is_mapped (&buf, g_ptr_array_index (buf.b2, 1)));
+    mctest_assert_true (edit_buffer_is_mapped (&buf, g_ptr_array_index (buf.b2, 0)));
+
+    /* the file is not changed */
+    fd = open (file_name, O_RDONLY);
+    mctest_assert_int_eq (read (fd, data, sizeof (data)), sizeof (TEST_TEXT) - 1);
+    close (fd);
+    mctest_assert_true (memcmp (data, TEST_TEXT, sizeof (TEST_TEXT) - 1) == 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_map_file_changed)
+{
+    /* given */
+    off_t i;
+    guint j;
+
+    mctest_assert_false (edit_buffer_map_changed (&buf));
+
+    /* when */
+    mctest_assert_int_eq (truncate (file_name, 10), 0);
+
+    /* then */
+    mctest_assert_true (edit_buffer_map_changed (&buf));
+    mctest_assert_true (edit_buffer_map_detach (&buf));
+    mctest_assert_int_eq (buf.map_fd, -1);
+    mctest_assert_false (edit_buffer_map_changed (&buf));
+
+    /* the buffers are in the copy now, and the text that was read before is kept */
+    for (j = 0; j < buf.b2->len - 1; j++)
+        mctest_assert_true (edit_buffer_is_mapped (&buf, g_ptr_array_index (buf.b2, j)));
+    for (i = 0; i < 10; i++)
+        mctest_assert_int_eq (edit_buffer_get_byte (&buf, i), TEST_TEXT[i]);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+#ifdef HAVE_MMAP
+    tcase_add_test (tc_core, test_map_file_read);
+    tcase_add_test (tc_core, test_map_file_modify);
+    tcase_add_test (tc_core, test_map_file_changed);
+#endif
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
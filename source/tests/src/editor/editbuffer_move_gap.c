@@ -0,0 +1,223 @@
+/*
+   src/editor - tests for edit_buffer_move_gap() and the block insertion and deletion
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+/* buffers of 16 bytes, so that the moves and the inserted or deleted blocks cross many of them */
+#define S_EDIT_BUF_SIZE 4
+
+#include "src/editor/editbuffer.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+#define TEST_TEXT "one\ntwo\nthree\nfour\nfive\nsix\nseven\neight\nnine\nten\neleven\ntwelve\n"
+
+static edit_buffer_t buf;
+
+/* @Before */
+static void
+setup (void)
+{
+    const char *p;
+
+    edit_buffer_init (&buf, 0);
+    buf.curs_line = 0;
+
+    for (p = TEST_TEXT; *p != '\0'; p++)
+    {
+        edit_buffer_insert (&buf, *p);
+        if (*p == '\n')
+            buf.curs_line++;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_buffer_clean (&buf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_move_gap_ds") */
+/* *INDENT-OFF* */
+static const struct test_move_gap_ds
+{
+    const off_t input_start;
+    const off_t input_delta;
+    const off_t expected_curs1;
+    const long expected_lines;
+} test_move_gap_ds[] =
+{
+    { /* 0. from the end to the beginning */
+        sizeof (TEST_TEXT) - 1, -1000,
+        0, 12
+    },
+    { /* 1. from the beginning to the end */
+        0, 1000,
+        sizeof (TEST_TEXT) - 1, 12
+    },
+    { /* 2. within a buffer */
+        5, 3,
+        8, 1
+    },
+    { /* 3. across buffers */
+        30, -20,
+        10, 4
+    },
+    { /* 4. */
+        10, 37,
+        47, 7
+    }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_move_gap_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_move_gap, test_move_gap_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    const off_t len = sizeof (TEST_TEXT) - 1;
+    long lines, curs_line;
+    off_t i;
+
+    edit_buffer_move_gap (&buf, data->input_start - buf.curs1);
+    curs_line = buf.curs_line;
+
+    /* when */
+    lines = edit_buffer_move_gap (&buf, data->input_delta);
+
+    /* then */
+    mctest_assert_int_eq (buf.curs1, data->expected_curs1);
+    mctest_assert_int_eq (buf.curs1 + buf.curs2, len);
+    mctest_assert_int_eq (lines, data->expected_lines);
+    mctest_assert_int_eq (buf.curs_line,
+                          curs_line + (data->input_delta < 0 ? -lines : lines));
+    mctest_assert_int_eq (buf.curs_line, edit_buffer_count_lines (&buf, 0, buf.curs1));
+    mctest_assert_int_eq (buf.b1->len, (buf.curs1 + EDIT_BUF_SIZE - 1) >> S_EDIT_BUF_SIZE);
+    mctest_assert_int_eq (buf.b2->len, (buf.curs2 + EDIT_BUF_SIZE - 1) >> S_EDIT_BUF_SIZE);
+
+    for (i = 0; i < len; i++)
+        mctest_assert_int_eq (edit_buffer_get_byte (&buf, i), TEST_TEXT[i]);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_insert_delete_ds") */
+/* *INDENT-OFF* */
+static const struct test_insert_delete_ds
+{
+    const off_t input_position;
+    const char *input_text;
+    const gboolean input_ahead;
+    const off_t input_delete;
+    const long expected_lines;
+    const char *expected_text;
+} test_insert_delete_ds[] =
+{
+    { /* 0. within a buffer */
+        1, "x\ny", FALSE, 0,
+        1,
+        "ox\nyne\ntwo\nthree\nfour\nfive\nsix\nseven\neight\nnine\nten\neleven\ntwelve\n"
+    },
+    { /* 1. across buffers */
+        4, "a\nb\nc\nd\ne\nf\ng\nh\n", TRUE, 0,
+        8,
+        "one\na\nb\nc\nd\ne\nf\ng\nh\n"
+        "two\nthree\nfour\nfive\nsix\nseven\neight\nnine\nten\neleven\ntwelve\n"
+    },
+    { /* 2. */
+        4, NULL, FALSE, 30,
+        6,
+        "one\neight\nnine\nten\neleven\ntwelve\n"
+    },
+    { /* 3. no more than there is after the cursor */
+        60, NULL, FALSE, 1000,
+        1,
+        "one\ntwo\nthree\nfour\nfive\nsix\nseven\neight\nnine\nten\neleven\ntwel"
+    }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_insert_delete_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_insert_delete, test_insert_delete_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    const off_t len = strlen (data->expected_text);
+    long lines;
+    off_t i;
+
+    edit_buffer_move_gap (&buf, data->input_position - buf.curs1);
+
+    /* when */
+    if (data->input_text == NULL)
+        lines = edit_buffer_delete_range (&buf, data->input_delete);
+    else if (data->input_ahead)
+        lines = edit_buffer_insert_bytes_ahead (&buf, data->input_text, strlen (data->input_text));
+    else
+        lines = edit_buffer_insert_bytes (&buf, data->input_text, strlen (data->input_text));
+
+    /* then */
+    mctest_assert_int_eq (lines, data->expected_lines);
+    mctest_assert_int_eq (buf.curs1 + buf.curs2, len);
+    mctest_assert_int_eq (buf.size, len);
+    mctest_assert_int_eq (buf.b1->len, (buf.curs1 + EDIT_BUF_SIZE - 1) >> S_EDIT_BUF_SIZE);
+    mctest_assert_int_eq (buf.b2->len, (buf.curs2 + EDIT_BUF_SIZE - 1) >> S_EDIT_BUF_SIZE);
+
+    for (i = 0; i < len; i++)
+        mctest_assert_int_eq (edit_buffer_get_byte (&buf, i), data->expected_text[i]);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_move_gap, test_move_gap_ds);
+    mctest_add_parameterized_test (tc_core, test_insert_delete, test_insert_delete_ds);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
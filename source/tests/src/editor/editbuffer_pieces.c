@@ -0,0 +1,296 @@
+/*
+   src/editor - tests and benchmark for the piece table of the editor buffer
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   The benchmark runs only if MC_TEST_EDITOR_BENCH_SIZE is set to the size
+   of the text in megabytes, e.g. 64 for editing at many places of 64 MB:
+
+   MC_TEST_EDITOR_BENCH_SIZE=64 ./editbuffer_pieces
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "src/editor/editbuffer.c"
+#include "src/editor/editpieces.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* 11 line breaks in 62 bytes */
+#define TEST_TEXT "one\ntwo\nthree\nfour\nfive\nsix\nseven\neight\nnine\nten\neleven\ntwelve"
+
+/* the benchmark types at this many places of the text at once, this many times */
+#define TEST_CURSORS 100
+#define TEST_ROUNDS 100
+
+static edit_buffer_t buf;
+
+/* @Before */
+static void
+setup (void)
+{
+    edit_buffer_init (&buf, 0);
+    edit_buffer_use_pieces (&buf);
+    buf.curs_line = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_buffer_clean (&buf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_check_text (const char *expected)
+{
+    off_t i, len;
+
+    len = (off_t) strlen (expected);
+    mctest_assert_int_eq (buf.size, len);
+    mctest_assert_int_eq (buf.curs1 + buf.curs2, len);
+
+    for (i = 0; i < len; i++)
+        mctest_assert_int_eq (edit_buffer_get_byte (&buf, i), expected[i]);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static long
+test_fill (char *data, size_t size)
+{
+    size_t i;
+    long lines = 0;
+
+    for (i = 0; i < size; i++)
+        if (i % 64 == 63)
+        {
+            data[i] = '\n';
+            lines++;
+        }
+        else
+            data[i] = (char) ('a' + (i % 26));
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/** Type a byte at each of the places in every round, then delete the bytes again */
+
+static double
+test_scattered_edits (edit_buffer_t * b, GTimer * timer)
+{
+    off_t pos[TEST_CURSORS];
+    int i, k;
+
+    for (k = 0; k < TEST_CURSORS; k++)
+        pos[k] = b->size / TEST_CURSORS * k;
+
+    g_timer_start (timer);
+
+    for (i = 0; i < TEST_ROUNDS; i++)
+        for (k = 0; k < TEST_CURSORS; k++)
+        {
+            /* the bytes typed before in this round move the place */
+            pos[k] += k;
+            edit_buffer_move_gap (b, pos[k] - b->curs1);
+            edit_buffer_insert (b, 'x');
+            pos[k]++;
+        }
+
+    for (i = 0; i < TEST_ROUNDS; i++)
+        for (k = TEST_CURSORS - 1; k >= 0; k--)
+        {
+            edit_buffer_move_gap (b, pos[k] - b->curs1);
+            edit_buffer_backspace (b);
+            pos[k] -= k + 1;
+        }
+
+    return g_timer_elapsed (timer, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_pieces_edit)
+{
+    /* given */
+    const char expected[] =
+        "one\ntwo\nthree\nFOUR\nfour\nfive\nsix\nseven\neight\nnine\nten\neleven!\ntwelve";
+    off_t len;
+    int i;
+
+    edit_buffer_insert_bytes_ahead (&buf, TEST_TEXT, sizeof (TEST_TEXT) - 1);
+    test_check_text (TEST_TEXT);
+    mctest_assert_int_eq (edit_buffer_count_lines (&buf, 0, buf.size), 11);
+
+    /* when */
+    mctest_assert_int_eq (edit_buffer_move_gap (&buf, 14), 3);
+    buf.curs_line += edit_buffer_insert_bytes (&buf, "FOUR\n", 5);
+    mctest_assert_int_eq (edit_buffer_move_gap (&buf, 41), 7);
+    mctest_assert_int_eq (buf.curs_line, 11);
+
+    /* "eleventeen" becomes "eleven!" */
+    for (i = 0; i < 4; i++)
+        edit_buffer_insert (&buf, "teen"[i]);
+    /* the typed bytes went on in one piece */
+    mctest_assert_not_null (edit_buffer_get_span (&buf, buf.curs1 - 4, &len));
+    mctest_assert_int_eq (len, 4);
+
+    mctest_assert_int_eq (edit_buffer_backspace (&buf), 'n');
+    edit_buffer_move_gap (&buf, -3);
+    mctest_assert_int_eq (edit_buffer_delete_range (&buf, 3), 0);
+    edit_buffer_insert (&buf, '!');
+
+    /* then */
+    test_check_text (expected);
+    mctest_assert_int_eq (buf.curs_line, 11);
+    mctest_assert_int_eq (edit_buffer_count_lines (&buf, 0, buf.size), 12);
+    mctest_assert_int_eq (edit_buffer_count_lines (&buf, 15, 40), 5);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_pieces_map_file)
+{
+    /* given */
+    const char expected[] =
+        "one\ntwo\nthree\nfour\nfive\nsix\nSEVEN\neight\nnine\nten\neleven\ntwelve";
+    char *file_name;
+    int fd;
+
+    fd = g_file_open_tmp (NULL, &file_name, NULL);
+    mctest_assert_true (fd != -1);
+    mctest_assert_int_eq (write (fd, TEST_TEXT, sizeof (TEST_TEXT) - 1), sizeof (TEST_TEXT) - 1);
+    buf.size = sizeof (TEST_TEXT) - 1;
+    mctest_assert_true (edit_buffer_map_file (&buf, fd, buf.size));
+    close (fd);
+
+    /* when */
+    mctest_assert_true (edit_buffer_lines_pending (&buf));
+    test_check_text (TEST_TEXT);
+    mctest_assert_int_eq (edit_buffer_move_gap (&buf, 28), 6);
+    edit_buffer_delete_range (&buf, 5);
+    edit_buffer_insert_bytes_ahead (&buf, "SEVEN", 5);
+
+    /* then */
+    test_check_text (expected);
+
+    /* the change has counted only the piece it cut, the rest is counted later */
+    mctest_assert_true (edit_buffer_lines_pending (&buf));
+    mctest_assert_false (edit_buffer_count_file_lines (&buf, TRUE));
+    mctest_assert_false (edit_buffer_lines_pending (&buf));
+    mctest_assert_int_eq (buf.lines, 11);
+    mctest_assert_int_eq (edit_buffer_count_lines (&buf, 0, buf.size), 11);
+
+    edit_buffer_clean (&buf);
+    unlink (file_name);
+    g_free (file_name);
+
+    edit_buffer_init (&buf, 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_pieces_bench)
+{
+    const char *env;
+    size_t size;
+    char *data;
+    long lines;
+    edit_buffer_t gap;
+    GTimer *timer;
+
+    env = g_getenv ("MC_TEST_EDITOR_BENCH_SIZE");
+    if (env == NULL)
+        return;
+
+    size = (size_t) g_ascii_strtoull (env, NULL, 10) * 1024 * 1024;
+    data = g_malloc (size);
+    lines = test_fill (data, size);
+
+    edit_buffer_init (&gap, 0);
+    gap.curs_line = 0;
+    edit_buffer_insert_bytes_ahead (&gap, data, (off_t) size);
+    edit_buffer_insert_bytes_ahead (&buf, data, (off_t) size);
+    g_free (data);
+
+    timer = g_timer_new ();
+
+    printf ("%d places x %d rounds in %zu MB: gap buffer %.3f s",
+            TEST_CURSORS, TEST_ROUNDS, size / (1024 * 1024), test_scattered_edits (&gap, timer));
+    printf (", piece table %.3f s\n", test_scattered_edits (&buf, timer));
+
+    g_timer_start (timer);
+    mctest_assert_int_eq (edit_buffer_count_lines (&gap, 0, gap.size), lines);
+    printf ("count lines: gap buffer %.3f s", g_timer_elapsed (timer, NULL));
+    g_timer_start (timer);
+    mctest_assert_int_eq (edit_buffer_count_lines (&buf, 0, buf.size), lines);
+    printf (", piece table %.3f s\n", g_timer_elapsed (timer, NULL));
+
+    g_timer_destroy (timer);
+    edit_buffer_clean (&gap);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_pieces_edit);
+#ifdef HAVE_MMAP
+    tcase_add_test (tc_core, test_pieces_map_file);
+#endif
+    tcase_add_test (tc_core, test_pieces_bench);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
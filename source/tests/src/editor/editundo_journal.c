@@ -0,0 +1,184 @@
+/*
+   src/editor - tests for the undo journal
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include "src/editor/editundo.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_undo_t undo;
+
+/* @Before */
+static void
+setup (void)
+{
+    edit_undo_init (&undo, 1024, FALSE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_undo_clean (&undo);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_undo_merge)
+{
+    /* given */
+    edit_undo_record_t r;
+    char *text;
+    const char *p;
+
+    edit_undo_push (&undo, EDIT_UNDO_KEY_PRESS, 10);
+    edit_undo_push (&undo, EDIT_UNDO_CURSOR, 5);
+    edit_undo_push (&undo, EDIT_UNDO_CURSOR, 7);
+    /* backspaces of "abc" and of "de" before it */
+    for (p = "cba"; *p != '\0'; p++)
+        edit_undo_push_text (&undo, EDIT_UNDO_INSERT, p, 1);
+    edit_undo_push_text (&undo, EDIT_UNDO_INSERT, "de", 2);
+
+    /* when */
+    text = edit_undo_pop (&undo, &r);
+
+    /* then */
+    mctest_assert_int_eq (r.action, EDIT_UNDO_INSERT);
+    mctest_assert_int_eq (r.value, 5);
+    mctest_assert_true (memcmp (text, "deabc", 5) == 0);
+    g_free (text);
+
+    mctest_assert_null (edit_undo_pop (&undo, &r));
+    mctest_assert_int_eq (r.action, EDIT_UNDO_CURSOR);
+    mctest_assert_int_eq (r.value, 12);
+
+    mctest_assert_null (edit_undo_pop (&undo, &r));
+    mctest_assert_int_eq (r.action, EDIT_UNDO_KEY_PRESS);
+    mctest_assert_int_eq (r.value, 10);
+
+    mctest_assert_null (edit_undo_peek (&undo));
+    mctest_assert_int_eq (undo.arena->len, 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_undo_budget)
+{
+    /* given */
+    edit_undo_record_t r;
+    char block[100];
+    char *text;
+    int i;
+
+    memset (block, 'x', sizeof (block));
+
+    /* when */
+    for (i = 0; i < 20; i++)
+    {
+        edit_undo_push (&undo, EDIT_UNDO_KEY_PRESS, i);
+        edit_undo_push_text (&undo, EDIT_UNDO_INSERT_AHEAD, block, sizeof (block));
+    }
+
+    /* then */
+    mctest_assert_true (undo.records->len * sizeof (edit_undo_record_t) + undo.arena->len <= 1024);
+
+    /* the last key presses are kept whole */
+    text = edit_undo_pop (&undo, &r);
+    mctest_assert_int_eq (r.action, EDIT_UNDO_INSERT_AHEAD);
+    mctest_assert_int_eq (r.value, sizeof (block));
+    mctest_assert_true (memcmp (text, block, sizeof (block)) == 0);
+    g_free (text);
+
+    edit_undo_pop (&undo, &r);
+    mctest_assert_int_eq (r.action, EDIT_UNDO_KEY_PRESS);
+    mctest_assert_int_eq (r.value, 19);
+
+    /* the oldest ones are dropped */
+    while (edit_undo_peek (&undo) != NULL)
+        g_free (edit_undo_pop (&undo, &r));
+    mctest_assert_int_eq (r.action, EDIT_UNDO_KEY_PRESS);
+    mctest_assert_true (r.value > 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_undo_lost)
+{
+    /* given */
+    char block[2000];
+
+    memset (block, 'x', sizeof (block));
+    edit_undo_push (&undo, EDIT_UNDO_KEY_PRESS, 0);
+    edit_undo_push (&undo, EDIT_UNDO_CURSOR, 1);
+
+    /* when */
+    edit_undo_push (&undo, EDIT_UNDO_KEY_PRESS, 1);
+    edit_undo_push_text (&undo, EDIT_UNDO_INSERT_AHEAD, block, sizeof (block));
+    edit_undo_push (&undo, EDIT_UNDO_CURSOR, 1);
+
+    /* then */
+    mctest_assert_null (edit_undo_peek (&undo));
+
+    /* the next key press is recorded again */
+    edit_undo_push (&undo, EDIT_UNDO_KEY_PRESS, 2);
+    edit_undo_push (&undo, EDIT_UNDO_CURSOR, 1);
+    mctest_assert_int_eq (undo.records->len, 2);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_undo_merge);
+    tcase_add_test (tc_core, test_undo_budget);
+    tcase_add_test (tc_core, test_undo_lost);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
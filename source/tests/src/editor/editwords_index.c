@@ -0,0 +1,251 @@
+/*
+   src/editor - tests for the word index of the word completion
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+/* buffers of 64 bytes, so that the words cross them */
+#define S_EDIT_BUF_SIZE 6
+
+#include "src/editor/editbuffer.c"
+#include "src/editor/editwords.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* the text is counted in batches too */
+#define TEST_WORDS 20000
+#define TEST_EDITS 2000
+
+static const char *test_words[] = {
+    "a", "al", "alpha", "alphabet", "alpine", "b", "be", "beta", "bet", "gamma",
+    /* longer than EDIT_WORDS_MAX_LEN, it is not indexed */
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+};
+
+static const char test_breaks[] = " \n\t.,;(";
+
+static const char *test_prefixes[] = { "", "a", "al", "alp", "b", "be", "x" };
+
+static edit_buffer_t buf;
+static edit_words_t *words = NULL;
+static GRand *test_rand = NULL;
+
+/* @Before */
+static void
+setup (void)
+{
+    GString *text;
+    int i;
+
+    test_rand = g_rand_new_with_seed (1);
+
+    text = g_string_new (NULL);
+    for (i = 0; i < TEST_WORDS; i++)
+    {
+        g_string_append (text, test_words[g_rand_int_range (test_rand, 0,
+                                                            G_N_ELEMENTS (test_words))]);
+        g_string_append_c (text, test_breaks[g_rand_int_range (test_rand, 0,
+                                                               sizeof (test_breaks) - 1)]);
+    }
+
+    edit_buffer_init (&buf, 0);
+    buf.curs_line = 0;
+    buf.lines = edit_buffer_insert_bytes_ahead (&buf, text->str, (off_t) text->len);
+    g_string_free (text, TRUE);
+
+    words = edit_words_new (&buf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_words_free (words);
+    edit_buffer_clean (&buf);
+    g_rand_free (test_rand);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_collect (const GString * word, guint count, gpointer data)
+{
+    GHashTable *found = (GHashTable *) data;
+
+    mctest_assert_null (g_hash_table_lookup (found, word->str));
+    g_hash_table_insert (found, g_strdup (word->str), GUINT_TO_POINTER (count));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Compare the completions of the index with the words that are counted in the text */
+
+static void
+test_check_words (void)
+{
+    GHashTable *expected;
+    GString *word;
+    off_t i;
+    size_t p;
+
+    expected = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    word = g_string_new (NULL);
+
+    for (i = 0; i <= buf.size; i++)
+    {
+        int c;
+
+        c = i < buf.size ? edit_buffer_get_byte (&buf, i) : ' ';
+        if (edit_words_is_word_byte (c))
+            g_string_append_c (word, (char) c);
+        else
+        {
+            if (word->len != 0 && word->len <= EDIT_WORDS_MAX_LEN)
+            {
+                guint count;
+
+                count = GPOINTER_TO_UINT (g_hash_table_lookup (expected, word->str));
+                g_hash_table_insert (expected, g_strdup (word->str), GUINT_TO_POINTER (count + 1));
+            }
+            g_string_set_size (word, 0);
+        }
+    }
+
+    for (p = 0; p < G_N_ELEMENTS (test_prefixes); p++)
+    {
+        const char *prefix = test_prefixes[p];
+        GHashTable *found;
+        GHashTableIter iter;
+        gpointer key, value;
+        guint n = 0;
+
+        found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        mctest_assert_true (edit_words_complete (words, prefix, strlen (prefix), test_collect,
+                                                 found));
+
+        g_hash_table_iter_init (&iter, expected);
+        while (g_hash_table_iter_next (&iter, &key, &value))
+            if (g_str_has_prefix ((const char *) key, prefix))
+            {
+                mctest_assert_int_eq (GPOINTER_TO_UINT (g_hash_table_lookup (found, key)),
+                                      GPOINTER_TO_UINT (value));
+                n++;
+            }
+        mctest_assert_int_eq (g_hash_table_size (found), n);
+
+        g_hash_table_destroy (found);
+    }
+
+    g_string_free (word, TRUE);
+    g_hash_table_destroy (expected);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_words_index_build)
+{
+    test_check_words ();
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_words_index_edit)
+{
+    int i;
+
+    for (i = 0; i < TEST_EDITS; i++)
+    {
+        const char *w;
+        off_t len;
+
+        edit_buffer_move_gap (&buf, g_rand_int_range (test_rand, 0, buf.size + 1) - buf.curs1);
+
+        switch (g_rand_int_range (test_rand, 0, 5))
+        {
+        case 0:
+            edit_words_change_begin (words, &buf, buf.curs1, 0);
+            edit_buffer_insert (&buf, test_breaks[g_rand_int_range (test_rand, 0, 2)]);
+            edit_words_change_end (words, &buf, 1);
+            break;
+        case 1:
+            if (buf.curs2 == 0)
+                break;
+            edit_words_change_begin (words, &buf, buf.curs1, 1);
+            edit_buffer_delete (&buf);
+            edit_words_change_end (words, &buf, 0);
+            break;
+        case 2:
+            if (buf.curs1 == 0)
+                break;
+            edit_words_change_begin (words, &buf, buf.curs1 - 1, 1);
+            edit_buffer_backspace (&buf);
+            edit_words_change_end (words, &buf, 0);
+            break;
+        case 3:
+            w = test_words[g_rand_int_range (test_rand, 0, G_N_ELEMENTS (test_words))];
+            len = (off_t) strlen (w);
+            edit_words_change_begin (words, &buf, buf.curs1, 0);
+            edit_buffer_insert_bytes (&buf, w, len);
+            edit_words_change_end (words, &buf, len);
+            break;
+        default:
+            len = MIN (buf.curs2, g_rand_int_range (test_rand, 0, 200));
+            edit_words_change_begin (words, &buf, buf.curs1, len);
+            edit_buffer_delete_range (&buf, len);
+            edit_words_change_end (words, &buf, 0);
+            break;
+        }
+    }
+
+    test_check_words ();
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_words_index_build);
+    tcase_add_test (tc_core, test_words_index_edit);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,266 @@
+/*
+   src/editor - tests for the keyword trie of the syntax highlighting
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include "src/editor/syntax.c"  /* for testing static functions */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#define TEST_KEYWORDS_MAX 4
+
+#define TEST_WHOLE_CHARS "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_"
+
+static WEdit test_edit;
+static context_rule_t *test_rule = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    if (test_rule != NULL)
+    {
+        context_rule_free (test_rule);
+        test_rule = NULL;
+    }
+
+    edit_buffer_clean (&test_edit.buffer);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Make a context of @keywords and compile it the way the syntax file is read */
+
+static void
+test_rule_init (const char *const *keywords, gboolean whole)
+{
+    int j;
+
+    test_rule = g_new0 (context_rule_t, 1);
+    test_rule->keyword = g_ptr_array_new ();
+
+    /* the first word is the context itself */
+    g_ptr_array_add (test_rule->keyword, g_new0 (syntax_keyword_t, 1));
+
+    for (j = 0; j < TEST_KEYWORDS_MAX && keywords[j] != NULL; j++)
+    {
+        syntax_keyword_t *k;
+
+        k = g_new0 (syntax_keyword_t, 1);
+        k->keyword = g_strdup (keywords[j]);
+        xx_lowerize_line (&test_edit, k->keyword, strlen (k->keyword));
+        convert (k->keyword);
+        if (whole)
+        {
+            k->whole_word_chars_left = g_strdup (TEST_WHOLE_CHARS);
+            k->whole_word_chars_right = g_strdup (TEST_WHOLE_CHARS);
+        }
+        g_ptr_array_add (test_rule->keyword, k);
+    }
+
+    context_rule_compile_keywords (test_rule);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_syntax_keyword_ds") */
+/* *INDENT-OFF* */
+static const struct test_syntax_keyword_ds
+{
+    const char *input_text;
+    const char *input_keywords[TEST_KEYWORDS_MAX];
+    const gboolean input_whole;
+    const gboolean input_case_insensitive;
+    const off_t input_offset;
+    const off_t expected_end;
+    const int expected_keyword;
+} test_syntax_keyword_ds[] =
+{
+    { /* 0. the earliest keyword in the file wins, not the longest */
+        "foreach (x)",
+        { "for", "foreach", NULL },
+        FALSE, FALSE,
+        0,
+        3, 1
+    },
+    { /* 1. */
+        "foreach (x)",
+        { "foreach", "for", NULL },
+        FALSE, FALSE,
+        0,
+        7, 1
+    },
+    { /* 2. keywords sharing a prefix: the shorter one is not a whole word here */
+        "integer x",
+        { "int", "integer", "in", NULL },
+        TRUE, FALSE,
+        0,
+        7, 2
+    },
+    { /* 3. */
+        "int x",
+        { "integer", "int", "in", NULL },
+        TRUE, FALSE,
+        0,
+        3, 2
+    },
+    { /* 4. a keyword starting with a wildcard is tried at the root */
+        "7 days",
+        { "days", "\\{0123456789\\}", NULL },
+        FALSE, FALSE,
+        0,
+        1, 2
+    },
+    { /* 5. */
+        "7 days",
+        { "days", "\\{0123456789\\}", NULL },
+        FALSE, FALSE,
+        2,
+        6, 1
+    },
+    { /* 6. a wildcard keyword earlier in the file wins over a literal one */
+        "days",
+        { "\\{dD\\}ays", "days", NULL },
+        FALSE, FALSE,
+        0,
+        4, 1
+    },
+    { /* 7. a star at the beginning */
+        "x = a.b;",
+        { "*;", "x", NULL },
+        FALSE, FALSE,
+        4,
+        8, 1
+    },
+    { /* 8. the keywords of a case-insensitive syntax are lowercased */
+        "While (1)",
+        { "WHILE", NULL },
+        TRUE, TRUE,
+        0,
+        5, 1
+    },
+    { /* 9. */
+        "While (1)",
+        { "WHILE", NULL },
+        TRUE, FALSE,
+        0,
+        -1, 0
+    },
+    { /* 10. the text ends in the middle of the keyword */
+        "fo",
+        { "for", NULL },
+        FALSE, FALSE,
+        0,
+        -1, 0
+    }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_syntax_keyword_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_syntax_keyword, test_syntax_keyword_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    off_t end;
+    int keyword = 0;
+
+    memset (&test_edit, 0, sizeof (test_edit));
+    test_edit.is_case_insensitive = data->input_case_insensitive;
+    edit_buffer_init (&test_edit.buffer, 0);
+    test_edit.buffer.curs_line = 0;
+    edit_buffer_insert_bytes_ahead (&test_edit.buffer, data->input_text,
+                                    (off_t) strlen (data->input_text));
+
+    test_rule_init (data->input_keywords, data->input_whole);
+
+    /* when */
+    end = context_rule_match_keyword (&test_edit, test_rule, data->input_offset, &keyword);
+
+    /* then */
+    mctest_assert_int_eq (end, data->expected_end);
+    mctest_assert_int_eq (keyword, data->expected_keyword);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_syntax_keyword_trie)
+{
+    /* given */
+    const char *const keywords[] = { "int", "in", "\\{ab\\}c", NULL };
+    GArray *ends;
+    gpointer node;
+
+    memset (&test_edit, 0, sizeof (test_edit));
+    edit_buffer_init (&test_edit.buffer, 0);
+
+    /* when */
+    test_rule_init (keywords, FALSE);
+
+    /* then */
+    /* root, i, in, int */
+    mctest_assert_int_eq (test_rule->keyword_nodes->len, 4);
+
+    /* the keyword starting with a wildcard ends at the root */
+    ends = (GArray *) g_ptr_array_index (test_rule->keyword_nodes, 0);
+    mctest_assert_not_null (ends);
+    mctest_assert_int_eq (ends->len, 1);
+    mctest_assert_int_eq (g_array_index (ends, guint, 0), 3);
+
+    node = g_hash_table_lookup (test_rule->keyword_edges, KEYWORD_EDGE (0, 'i'));
+    node = g_hash_table_lookup (test_rule->keyword_edges,
+                                KEYWORD_EDGE (GPOINTER_TO_UINT (node), 'n'));
+    ends = (GArray *) g_ptr_array_index (test_rule->keyword_nodes, GPOINTER_TO_UINT (node));
+    mctest_assert_not_null (ends);
+    mctest_assert_int_eq (g_array_index (ends, guint, 0), 2);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, NULL, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_syntax_keyword, test_syntax_keyword_ds);
+    tcase_add_test (tc_core, test_syntax_keyword_trie);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
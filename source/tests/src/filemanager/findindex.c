@@ -0,0 +1,374 @@
+/*
+   src/filemanager - tests for the trigram index of Find File
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include "src/filemanager/findindex.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* where the index is saved, the tests that do not save it do not set it */
+static char *test_cache_path = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+const char *
+mc_config_get_cache_path (void)
+{
+    return test_cache_path != NULL ? test_cache_path : "/nonexistent";
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_index_file (find_index_t * index, const char *path, const char *content)
+{
+    find_index_builder_t *builder;
+    struct stat st;
+
+    memset (&st, 0, sizeof (st));
+    st.st_size = (off_t) strlen (content);
+
+    builder = find_index_builder_new ();
+    find_index_builder_feed (builder, content, strlen (content));
+    find_index_update (index, path, &st, builder);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+test_lookup (find_index_t * index, const char *path, const char *content, const char *pattern,
+             gboolean case_sens)
+{
+    find_index_query_t *query;
+    struct stat st;
+    gboolean fresh, result;
+
+    memset (&st, 0, sizeof (st));
+    st.st_size = (off_t) strlen (content);
+
+    query = find_index_query_new (pattern, MC_SEARCH_T_NORMAL, case_sens);
+    result = find_index_lookup (index, path, &st, query, &fresh);
+    find_index_query_free (query);
+
+    mctest_assert_true (fresh);
+    return result;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_find_index_lookup_ds") */
+/* *INDENT-OFF* */
+static const struct test_find_index_lookup_ds
+{
+    const char *input_content;
+    const char *input_pattern;
+    const mc_search_type_t input_type;
+    const gboolean input_case_sens;
+    const gboolean expected_result;
+} test_find_index_lookup_ds[] =
+{
+    { /* 0. */
+        "The quick brown fox",
+        "brown",
+        MC_SEARCH_T_NORMAL,
+        TRUE,
+        TRUE
+    },
+    { /* 1. the index does not know the case */
+        "The quick brown fox",
+        "BROWN",
+        MC_SEARCH_T_NORMAL,
+        TRUE,
+        TRUE
+    },
+    { /* 2. */
+        "The quick brown fox",
+        "brawn",
+        MC_SEARCH_T_NORMAL,
+        TRUE,
+        FALSE
+    },
+    { /* 3. a short string may be anywhere */
+        "The quick brown fox",
+        "zz",
+        MC_SEARCH_T_NORMAL,
+        TRUE,
+        TRUE
+    },
+    { /* 4. */
+        "The quick brown fox",
+        "dog|fox",
+        MC_SEARCH_T_MULTI,
+        TRUE,
+        TRUE
+    },
+    { /* 5. */
+        "The quick brown fox",
+        "dog|cat",
+        MC_SEARCH_T_MULTI,
+        TRUE,
+        FALSE
+    },
+    { /* 6. the index cannot tell about a regular expression */
+        "The quick brown fox",
+        "d[o]g",
+        MC_SEARCH_T_REGEX,
+        TRUE,
+        TRUE
+    },
+    { /* 7. the trigrams with non-ASCII bytes are ignored without case */
+        "caf\xc3\xa9 au lait",
+        "CAF\xc3\x89",
+        MC_SEARCH_T_NORMAL,
+        FALSE,
+        TRUE
+    },
+    { /* 8. the file is spelled in another case */
+        "Field Notes",
+        "FIELD NOTES",
+        MC_SEARCH_T_NORMAL,
+        FALSE,
+        TRUE
+    },
+    { /* 9. U+017F (long s) is equal to s without case */
+        "pa\xc5\xbfta al forno",
+        "PASTA AL FORNO",
+        MC_SEARCH_T_NORMAL,
+        FALSE,
+        TRUE
+    },
+    { /* 10. U+212A (Kelvin sign) is equal to k without case */
+        "\xe2\x84\xaaing of the hill",
+        "king of the",
+        MC_SEARCH_T_NORMAL,
+        FALSE,
+        TRUE
+    },
+    { /* 11. the other trigrams still tell */
+        "pa\xc5\xbfta al forno",
+        "PASTRY",
+        MC_SEARCH_T_NORMAL,
+        FALSE,
+        FALSE
+    }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_find_index_lookup_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_find_index_lookup, test_find_index_lookup_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    find_index_t *index;
+    find_index_builder_t *builder;
+    find_index_query_t *query;
+    struct stat st;
+    const char *content = data->input_content;
+    gboolean fresh, result;
+
+    memset (&st, 0, sizeof (st));
+    st.st_size = (off_t) strlen (content);
+
+    index = find_index_get ("/test");
+
+    /* the content comes in pieces */
+    builder = find_index_builder_new ();
+    find_index_builder_feed (builder, content, 5);
+    find_index_builder_feed (builder, content + 5, strlen (content) - 5);
+    find_index_update (index, "/test/file", &st, builder);
+
+    query = find_index_query_new (data->input_pattern, data->input_type, data->input_case_sens);
+
+    /* when */
+    result = find_index_lookup (index, "/test/file", &st, query, &fresh);
+
+    /* then */
+    mctest_assert_true (fresh);
+    mctest_assert_int_eq (result, data->expected_result);
+
+    find_index_query_free (query);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_find_index_changed)
+{
+    /* given */
+    find_index_t *index;
+    find_index_query_t *query;
+    struct stat st;
+    gboolean fresh, result;
+
+    memset (&st, 0, sizeof (st));
+    st.st_size = 3;
+
+    index = find_index_get ("/test");
+    find_index_update (index, "/test/changed", &st, find_index_builder_new ());
+    query = find_index_query_new ("brown", MC_SEARCH_T_NORMAL, TRUE);
+
+    /* when */
+    st.st_size = 19;
+    result = find_index_lookup (index, "/test/changed", &st, query, &fresh);
+
+    /* then */
+    mctest_assert_false (fresh);
+    mctest_assert_true (result);
+
+    find_index_query_free (query);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_find_index_bitmap)
+{
+    /* given */
+    find_index_t *index;
+    find_index_builder_t *builder;
+    find_index_query_t *query;
+    struct stat st;
+    GString *content;
+    gboolean fresh;
+    guint32 r = 1;
+    int i;
+
+    /* enough distinct trigrams for the bitmap */
+    content = g_string_new ("");
+    for (i = 0; i < 100000; i++)
+    {
+        r = r * 1103515245 + 12345;
+        g_string_append_c (content, (char) (r >> 16));
+    }
+    g_string_append (content, "needle");
+
+    memset (&st, 0, sizeof (st));
+    st.st_size = (off_t) content->len;
+
+    index = find_index_get ("/test");
+    builder = find_index_builder_new ();
+    find_index_builder_feed (builder, content->str, content->len);
+    find_index_update (index, "/test/big", &st, builder);
+
+    /* when */
+    query = find_index_query_new ("needle", MC_SEARCH_T_NORMAL, TRUE);
+
+    /* then */
+    mctest_assert_true (find_index_lookup (index, "/test/big", &st, query, &fresh));
+    find_index_query_free (query);
+
+    query = find_index_query_new ("haystack", MC_SEARCH_T_NORMAL, TRUE);
+    mctest_assert_false (find_index_lookup (index, "/test/big", &st, query, &fresh));
+    find_index_query_free (query);
+
+    g_string_free (content, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_find_index_save)
+{
+    /* given */
+    const char *fox = "The quick brown fox";
+    const char *dog = "jumps over the lazy dog";
+    find_index_t *index;
+    find_index_file_t *f;
+    char *path;
+
+    test_cache_path = g_dir_make_tmp (NULL, NULL);
+    mctest_assert_not_null (test_cache_path);
+
+    index = find_index_get ("/test");
+    test_index_file (index, "/test/fox", fox);
+    test_index_file (index, "/test/dog", dog);
+    path = g_strdup (index->path);
+
+    /* when */
+    find_index_save (index);
+    mctest_assert_false (index->changed);
+
+    /* another tree frees the index, and it is read again */
+    find_index_get ("/other");
+    index = find_index_get ("/test");
+
+    /* then */
+    mctest_assert_not_null (index->mapped);
+    mctest_assert_int_eq (g_hash_table_size (index->files), 2);
+
+    /* the trigrams are left in the mapping of the saved index */
+    f = (find_index_file_t *) g_hash_table_lookup (index->files, "/test/fox");
+    mctest_assert_not_null (f);
+    mctest_assert_null (f->own);
+    mctest_assert_true ((const char *) f->trigrams >= g_mapped_file_get_contents (index->mapped));
+
+    mctest_assert_true (test_lookup (index, "/test/fox", fox, "brown", TRUE));
+    mctest_assert_false (test_lookup (index, "/test/fox", fox, "lazy", TRUE));
+    mctest_assert_true (test_lookup (index, "/test/dog", dog, "LAZY", FALSE));
+    mctest_assert_false (test_lookup (index, "/test/dog", dog, "brown", FALSE));
+
+    unlink (path);
+    g_free (path);
+    path = g_build_filename (test_cache_path, FIND_INDEX_DIR, (char *) NULL);
+    rmdir (path);
+    g_free (path);
+    rmdir (test_cache_path);
+    MC_PTR_FREE (test_cache_path);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_find_index_lookup, test_find_index_lookup_ds);
+    tcase_add_test (tc_core, test_find_index_changed);
+    tcase_add_test (tc_core, test_find_index_bitmap);
+    tcase_add_test (tc_core, test_find_index_save);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
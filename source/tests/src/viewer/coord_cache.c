@@ -0,0 +1,430 @@
+/*
+   src/viewer - tests and benchmark for the coordinate cache
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   The benchmark runs only if MC_TEST_VIEWER_BENCH_SIZE is set to the size
+   of the data in megabytes, e.g. 1024 for scrolling through 1 GB:
+
+   MC_TEST_VIEWER_BENCH_SIZE=1024 ./coord_cache
+ */
+
+#define TEST_SUITE_NAME "/src/viewer"
+
+#include "tests/mctest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/viewer/coord_cache.c"     /* for testing static functions */
+
+/* Long lines of varying length, like a log file viewed in wrap mode */
+#define TEST_LINE_MIN 40
+#define TEST_LINE_SPREAD 400
+
+/* Number of bytes scrolled at once: one screen of wrapped text */
+#define TEST_SCREEN_BYTES (50 * 200)
+
+static WView test_view;
+
+/* the line index that the mocks of its lookups use, none if test_index_size is 0 */
+static off_t *test_index_offset = NULL;
+static off_t *test_index_line = NULL;
+static size_t test_index_size = 0;
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+gboolean
+mcview_get_byte_growing_buffer (WView * view, off_t byte_index, int *retval)
+{
+    (void) view;
+    (void) byte_index;
+
+    if (retval != NULL)
+        *retval = -1;
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+mcview_file_load_data (WView * view, off_t byte_index)
+{
+    (void) view;
+    (void) byte_index;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+gboolean
+mcview_get_byte_string (WView * view, off_t byte_index, int *retval)
+{
+    (void) view;
+    (void) byte_index;
+
+    if (retval != NULL)
+        *retval = -1;
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+gboolean
+mcview_get_byte_none (WView * view, off_t byte_index, int *retval)
+{
+    (void) view;
+    (void) byte_index;
+
+    if (retval != NULL)
+        *retval = -1;
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+gboolean
+mcview_lineidx_lookup_line (WView * view, off_t line, off_t * ret_offset, off_t * ret_line)
+{
+    size_t i;
+
+    (void) view;
+
+    for (i = test_index_size; i > 0 && test_index_line[i - 1] > line; i--)
+        ;
+    if (i == 0)
+        return FALSE;
+
+    *ret_offset = test_index_offset[i - 1];
+    *ret_line = test_index_line[i - 1];
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+gboolean
+mcview_lineidx_lookup_offset (WView * view, off_t offset, off_t * ret_offset, off_t * ret_line)
+{
+    size_t i;
+
+    (void) view;
+
+    for (i = test_index_size; i > 0 && test_index_offset[i - 1] > offset; i--)
+        ;
+    if (i == 0)
+        return FALSE;
+
+    *ret_offset = test_index_offset[i - 1];
+    *ret_line = test_index_line[i - 1];
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Fill the memory datasource with lines, return the number of lines */
+static off_t
+test_fill (byte * data, size_t size)
+{
+    size_t i = 0;
+    off_t lines = 0;
+
+    srand (42);
+
+    while (i < size)
+    {
+        size_t len, j;
+
+        len = TEST_LINE_MIN + (size_t) (rand () % TEST_LINE_SPREAD);
+        for (j = 0; j < len && i < size; j++, i++)
+            data[i] = (byte) ('a' + (j % 26));
+        if (i < size)
+        {
+            data[i++] = '\n';
+            lines++;
+        }
+    }
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Record the start of every @step-th line of the data like the line index does */
+static void
+test_index_build (off_t step)
+{
+    off_t i, line = 0;
+
+    test_index_offset = g_new (off_t, test_view.ds_mmap_len / (size_t) step + 1);
+    test_index_line = g_new (off_t, test_view.ds_mmap_len / (size_t) step + 1);
+    test_index_size = 0;
+
+    for (i = 0; i < (off_t) test_view.ds_mmap_len; i++)
+        if (test_view.ds_mmap_data[i] == '\n' && ++line % step == 0)
+        {
+            test_index_offset[test_index_size] = i + 1;
+            test_index_line[test_index_size] = line;
+            test_index_size++;
+        }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_index_free (void)
+{
+    MC_PTR_FREE (test_index_offset);
+    MC_PTR_FREE (test_index_line);
+    test_index_size = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_view_init (size_t size)
+{
+    memset (&test_view, 0, sizeof (test_view));
+    test_view.datasource = DS_MMAP;
+    test_view.ds_mmap_data = g_malloc (size);
+    test_view.ds_mmap_len = size;
+    test_view.ds_file_filesize = (off_t) size;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_view_done (void)
+{
+    coord_cache_free (test_view.coord_cache);
+    test_view.coord_cache = NULL;
+    g_free (test_view.ds_mmap_data);
+    test_view.ds_mmap_data = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_coord_cache_lookup)
+{
+    /* given */
+    const size_t size = 256 * 1024;
+    off_t offset, line = 0, column = 0;
+
+    test_view_init (size);
+    test_fill (test_view.ds_mmap_data, size);
+
+    /* when */
+    /* then */
+    for (offset = 0; offset < (off_t) size; offset += 97)
+    {
+        coord_cache_entry_t coord;
+        off_t o;
+
+        /* the reference: count from the previous probe */
+        for (o = MAX (offset - 97, 0); o < offset && offset != 0; o++)
+        {
+            if (test_view.ds_mmap_data[o] == '\n')
+            {
+                line++;
+                column = 0;
+            }
+            else
+                column++;
+        }
+
+        coord.cc_offset = offset;
+        mcview_ccache_lookup (&test_view, &coord, CCACHE_LINECOL);
+        mctest_assert_int_eq (coord.cc_line, line);
+        mctest_assert_int_eq (coord.cc_column, column);
+
+        coord.cc_offset = -1;
+        coord.cc_line = line;
+        coord.cc_column = column;
+        coord.cc_nroff_column = column;
+        mcview_ccache_lookup (&test_view, &coord, CCACHE_OFFSET);
+        mctest_assert_int_eq (coord.cc_offset, offset);
+    }
+
+    /* the cache stays sorted */
+    for (offset = 1; offset < (off_t) test_view.coord_cache->size; offset++)
+        ck_assert (test_view.coord_cache->offset[offset - 1] < test_view.coord_cache->offset[offset]);
+
+    test_view_done ();
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_coord_cache_seed)
+{
+    /* given */
+    const size_t size = 256 * 1024;
+    const off_t step = 64;
+    coord_cache_entry_t coord;
+    off_t lines, line, offset, o;
+    size_t i;
+    gboolean seeded = FALSE;
+
+    test_view_init (size);
+    lines = test_fill (test_view.ds_mmap_data, size);
+    test_index_build (step);
+
+    /* the reference: the start of a line near the end of the data */
+    line = lines - 10;
+    for (offset = 0, o = 0; o < line; offset++)
+        if (test_view.ds_mmap_data[offset] == '\n')
+            o++;
+
+    /* when */
+    coord.cc_offset = -1;
+    coord.cc_line = line;
+    coord.cc_column = 0;
+    coord.cc_nroff_column = 0;
+    mcview_ccache_lookup (&test_view, &coord, CCACHE_OFFSET);
+
+    /* then */
+    mctest_assert_int_eq (coord.cc_offset, offset);
+
+    /* the lookup has started from the line start known to the index */
+    for (i = 0; i < test_view.coord_cache->size; i++)
+        if (test_view.coord_cache->offset[i] == test_index_offset[line / step - 1]
+            && test_view.coord_cache->line[i] == line / step * step)
+            seeded = TRUE;
+    mctest_assert_true (seeded);
+
+    /* when */
+    coord.cc_offset = offset + 5;
+    mcview_ccache_lookup (&test_view, &coord, CCACHE_LINECOL);
+
+    /* then */
+    mctest_assert_int_eq (coord.cc_line, line);
+    mctest_assert_int_eq (coord.cc_column, 5);
+
+    /* the cache stays sorted */
+    for (i = 1; i < test_view.coord_cache->size; i++)
+        ck_assert (test_view.coord_cache->offset[i - 1] < test_view.coord_cache->offset[i]);
+
+    test_index_free ();
+    test_view_done ();
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_coord_cache_bench)
+{
+    const char *env;
+    size_t size;
+    off_t lines, offset, line;
+    GTimer *timer;
+    coord_cache_entry_t coord;
+
+    env = g_getenv ("MC_TEST_VIEWER_BENCH_SIZE");
+    if (env == NULL)
+        return;
+
+    size = (size_t) g_ascii_strtoull (env, NULL, 10) * 1024 * 1024;
+    test_view_init (size);
+    lines = test_fill (test_view.ds_mmap_data, size);
+
+    timer = g_timer_new ();
+
+    /* scroll down screen by screen */
+    for (offset = 0; offset < (off_t) size; offset += TEST_SCREEN_BYTES)
+    {
+        coord.cc_offset = offset;
+        mcview_ccache_lookup (&test_view, &coord, CCACHE_LINECOL);
+    }
+    printf ("scroll down %zu MB: %.3f s, %zu cache entries\n", size / (1024 * 1024),
+            g_timer_elapsed (timer, NULL), test_view.coord_cache->size);
+
+    /* and back up */
+    g_timer_start (timer);
+    for (offset = (off_t) size - 1; offset >= 0; offset -= TEST_SCREEN_BYTES)
+    {
+        coord.cc_offset = offset;
+        mcview_ccache_lookup (&test_view, &coord, CCACHE_LINECOL);
+    }
+    printf ("scroll up: %.3f s\n", g_timer_elapsed (timer, NULL));
+
+    /* jump to lines all over the file */
+    g_timer_start (timer);
+    for (line = 0; line < lines; line += lines / 1000 + 1)
+    {
+        coord.cc_line = line;
+        coord.cc_column = 0;
+        coord.cc_nroff_column = 0;
+        mcview_ccache_lookup (&test_view, &coord, CCACHE_OFFSET);
+    }
+    printf ("goto line x1000: %.3f s\n", g_timer_elapsed (timer, NULL));
+
+    g_timer_destroy (timer);
+    test_view_done ();
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_coord_cache_lookup);
+    tcase_add_test (tc_core, test_coord_cache_seed);
+    tcase_add_test (tc_core, test_coord_cache_bench);
+    /* *********************************** */
+
+    /* the benchmark may take a while */
+    tcase_set_timeout (tc_core, 0);
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
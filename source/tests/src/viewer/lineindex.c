@@ -0,0 +1,291 @@
+/*
+   src/viewer - tests for the line index
+
+   Copyright (C) 2021
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/viewer"
+
+#include "tests/mctest.h"
+
+/* every second line start is recorded, so that a few lines make an index */
+#define VIEW_LINE_INDEX_STEP 2
+
+#include "src/viewer/lineindex.c"       /* for testing static functions */
+
+static WView test_view;
+
+/* the data of the view and the number of bytes the datasource has at hand at once */
+static const char *test_data;
+static off_t test_size;
+static size_t test_span;
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+off_t
+mcview_get_filesize (WView * view)
+{
+    (void) view;
+
+    return test_size;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+char *
+mcview_get_span (WView * view, off_t byte_index, size_t * len)
+{
+    (void) view;
+
+    if (byte_index < 0 || byte_index >= test_size)
+    {
+        *len = 0;
+        return NULL;
+    }
+
+    *len = (size_t) MIN ((off_t) (test_span - (size_t) byte_index % test_span),
+                         test_size - byte_index);
+    return (char *) test_data + byte_index;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    memset (&test_view, 0, sizeof (test_view));
+    test_view.datasource = DS_MMAP;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    mcview_lineidx_free (&test_view);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_lineidx_scan_ds") */
+/* *INDENT-OFF* */
+static const struct test_lineidx_scan_ds
+{
+    const char *input_text;
+    const size_t input_span;
+    const off_t expected_lines;
+    const size_t expected_size;
+    const off_t expected_offsets[2];
+    const off_t expected_line_numbers[2];
+} test_lineidx_scan_ds[] =
+{
+    { /* 0. LF */
+        "a\nb\nc\nd\ne\n",
+        64,
+        5, 2, { 4, 8 }, { 2, 4 }
+    },
+    { /* 1. CRLF is one line break */
+        "a\r\nb\r\nc\r\nd\r\n",
+        64,
+        4, 2, { 6, 12 }, { 2, 4 }
+    },
+    { /* 2. a lone CR is a line break, but the line after it is not recorded */
+        "a\rb\rc\nd\ne\n",
+        64,
+        5, 2, { 6, 10 }, { 3, 5 }
+    },
+    { /* 3. CRLF split between two spans */
+        "a\r\nb\r\nc\r\nd\r\n",
+        2,
+        4, 2, { 6, 12 }, { 2, 4 }
+    },
+    { /* 4. a lone CR at the end of a span */
+        "a\rb\rc\nd\ne\n",
+        2,
+        5, 2, { 6, 10 }, { 3, 5 }
+    },
+    { /* 5. CR CR LF is one line break: the first CR is followed by CR */
+        "a\r\r\nb\nc\n",
+        3,
+        3, 1, { 6, 0 }, { 2, 0 }
+    }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_lineidx_scan_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_lineidx_scan, test_lineidx_scan_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mcview_line_index_t *idx;
+    size_t i;
+
+    test_data = data->input_text;
+    test_size = (off_t) strlen (data->input_text);
+    test_span = data->input_span;
+
+    /* when */
+    while (mcview_lineidx_step (&test_view))
+        ;
+
+    /* then */
+    idx = test_view.line_index;
+    mctest_assert_not_null (idx);
+    mctest_assert_int_eq (idx->scanned, test_size);
+    mctest_assert_int_eq (idx->line, data->expected_lines);
+    mctest_assert_false (idx->pending_cr);
+    mctest_assert_int_eq (idx->size, data->expected_size);
+    for (i = 0; i < idx->size; i++)
+    {
+        mctest_assert_int_eq (idx->offsets[i], data->expected_offsets[i]);
+        mctest_assert_int_eq (idx->lines[i], data->expected_line_numbers[i]);
+    }
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_lineidx_pending_cr)
+{
+    /* given */
+    mcview_line_index_t idx;
+
+    memset (&idx, 0, sizeof (idx));
+    idx.next_mark = VIEW_LINE_INDEX_STEP;
+
+    /* when */
+    mcview_lineidx_scan (&idx, "ab\r", 3);
+
+    /* then */
+    /* the meaning of the CR is not known yet */
+    mctest_assert_true (idx.pending_cr);
+    mctest_assert_int_eq (idx.line, 0);
+    mctest_assert_int_eq (idx.scanned, 3);
+
+    /* when */
+    mcview_lineidx_scan (&idx, "\ncd\n", 4);
+
+    /* then */
+    /* CRLF counts once, and the line after it is recorded */
+    mctest_assert_false (idx.pending_cr);
+    mctest_assert_int_eq (idx.line, 2);
+    mctest_assert_int_eq (idx.size, 1);
+    mctest_assert_int_eq (idx.offsets[0], 7);
+    mctest_assert_int_eq (idx.lines[0], 2);
+
+    g_free (idx.offsets);
+    g_free (idx.lines);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_lineidx_lookup)
+{
+    /* given */
+    off_t offset = -1, line = -1;
+
+    test_data = "a\nb\nc\nd\ne\nf\n";
+    test_size = (off_t) strlen (test_data);
+    test_span = 4;
+
+    /* when */
+    /* then */
+    /* there is no recorded line start before the second line */
+    mctest_assert_false (mcview_lineidx_lookup_line (&test_view, 1, &offset, &line));
+    mctest_assert_false (mcview_lineidx_lookup_offset (&test_view, 3, &offset, &line));
+
+    mctest_assert_true (mcview_lineidx_lookup_line (&test_view, 3, &offset, &line));
+    mctest_assert_int_eq (offset, 4);
+    mctest_assert_int_eq (line, 2);
+
+    mctest_assert_true (mcview_lineidx_lookup_offset (&test_view, 9, &offset, &line));
+    mctest_assert_int_eq (offset, 8);
+    mctest_assert_int_eq (line, 4);
+
+    /* the last line start is found beyond the data */
+    mctest_assert_true (mcview_lineidx_lookup_line (&test_view, 100, &offset, &line));
+    mctest_assert_int_eq (offset, 12);
+    mctest_assert_int_eq (line, 6);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+START_TEST (test_lineidx_truncated)
+{
+    /* given */
+    off_t offset = -1, line = -1;
+
+    test_data = "a\nb\nc\nd\ne\nf\n";
+    test_size = (off_t) strlen (test_data);
+    test_span = 64;
+    while (mcview_lineidx_step (&test_view))
+        ;
+
+    /* when */
+    test_size = 5;
+
+    /* then */
+    /* the index is built again for the shorter data */
+    mctest_assert_false (mcview_lineidx_step (&test_view));
+    mctest_assert_int_eq (test_view.line_index->scanned, 5);
+    mctest_assert_int_eq (test_view.line_index->line, 2);
+    mctest_assert_true (mcview_lineidx_lookup_line (&test_view, 100, &offset, &line));
+    mctest_assert_int_eq (offset, 4);
+    mctest_assert_int_eq (line, 2);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_lineidx_scan, test_lineidx_scan_ds);
+    tcase_add_test (tc_core, test_lineidx_pending_cr);
+    tcase_add_test (tc_core, test_lineidx_lookup);
+    tcase_add_test (tc_core, test_lineidx_truncated);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */